@@ -11,6 +11,7 @@
  @version 1.4.0		10/10/2012		Gerhardus Muller		 delete txProcSocketLocalPath on exit
  @version 1.5.0		23/10/2012		Gerhardus Muller		 adjusted debug levels for regular events such as a timer running
  @version 1.6.0		08/06/2013		Gerhardus Muller		 main loop by default to block infinitely on file descriptors
+ @version 1.7.0		16/10/2026		agent		 results can be deferred and completed out of order for a pipelined app
 
  @note
 
@@ -65,6 +66,9 @@ appBase::appBase( int theArgc, char* theArgv[], const char* theAppName )
   pSignalSock = NULL;
   pResultEvent = NULL;
   workerPid = -1;
+  pipelineDepth = 1;
+  numDeferred = 0;
+  bResultDeferred = false;
 }	// appBase
 
 /**
@@ -343,6 +347,8 @@ void appBase::constructDefaultResultEvent( baseEvent* pEvent )
   pResultEvent->setSuccess( true );
   pResultEvent->setRef( pEvent->getRef() );
   pResultEvent->addParam( "generatedby", appName );
+  unsigned int pipelineRef = pEvent->getPipelineRef();
+  if( pipelineRef != 0 ) pResultEvent->setPipelineRef( pipelineRef );   // the worker matches the result to the event on it
   std::string resultQueue;
   if( pEvent->getParam("resultQueue", resultQueue) ) pResultEvent->setDestQueue( resultQueue );
 } // constructResultEvent
@@ -542,8 +548,10 @@ void appBase::handlePersistentCommand( baseEvent* pCommand )
     {
       ownQueue = pCommand->getParam( "ownqueue" );
       workerPid = pCommand->getParamAsInt( "workerpid" );
+      pipelineDepth = pCommand->getParamAsInt( "pipelinedepth" );
+      if( pipelineDepth < 1 ) pipelineDepth = 1;
       startupInfoAvailable();
-      log.info( log.LOGALWAYS, "handlePersistentCommand: ownQueue:%s workerPid:%d", ownQueue.c_str(), workerPid );
+      log.info( log.LOGALWAYS, "handlePersistentCommand: ownQueue:%s workerPid:%d pipelineDepth:%d", ownQueue.c_str(), workerPid, pipelineDepth );
     } // if( cmd.compare
     else
       handleUserPersistentCommand( pCommand );
@@ -579,6 +587,11 @@ void appBase::handleUnhandledCmdEvents( baseEvent* pCommand )
  * **/
 void appBase::sendDone()
 {
+  if( bResultDeferred )
+  {
+    bResultDeferred = false;    // dispatched by completeResult
+    return;
+  } // if
   if( pResultEvent == NULL )
   {
     log.debug( log.LOGNORMAL, "sendDone: pResultEvent==NULL - creating one" );
@@ -591,6 +604,39 @@ void appBase::sendDone()
   pResultEvent = NULL;
 } // sendDone
 
+/**
+ * takes over the result event of the current event - sendDone does not dispatch it and
+ * the handler hands it to completeResult once the event is done.  with a pipelineDepth
+ * above 1 the worker keeps writing events to the app in the meantime
+ * @return the result event - owned by the caller until passed to completeResult
+ * **/
+baseEvent* appBase::deferResult( )
+{
+  if( pResultEvent == NULL )
+  {
+    pResultEvent = new baseEvent( baseEvent::EV_RESULT );
+    pResultEvent->setSuccess( true );
+  } // if
+  baseEvent* pResult = pResultEvent;
+  pResultEvent = NULL;
+  bResultDeferred = true;
+  numDeferred++;
+  log.debug( log.LOGNORMAL, "deferResult: %u deferred pipelineDepth:%d", numDeferred, pipelineDepth );
+  return pResult;
+} // deferResult
+
+/**
+ * dispatches a result deferred by deferResult - results can be completed in any order
+ * @param pResult - deleted once dispatched
+ * **/
+void appBase::completeResult( baseEvent* pResult )
+{
+  pResult->serialise( eventReplyFd, baseEvent::FD_PIPE );
+  log.debug( log.LOGNORMAL, "completeResult:'%s' fd:%d", pResult->toString().c_str(), eventReplyFd );
+  delete pResult;
+  if( numDeferred > 0 ) numDeferred--;
+} // completeResult
+
 /**
  * handles received signal events (via the signalFd socket)
  * **/
@@ -4,8 +4,18 @@
  @version 1.0.0   17/11/2011    Gerhardus Muller     Script created
  @version 1.1.0   21/08/2012    Gerhardus Muller     support for a startup info command event
  @version 1.2.0		03/10/2012		Gerhardus Muller		 added a startupInfoAvailable and loglevelChanged virtual function callback
+ @version 1.2.1		16/10/2026		agent		 note on linking against libtxevent.a
+ @version 1.3.0		16/10/2026		agent		 deferResult / completeResult for pipelined apps
 
  @note
+ apps link appBase.o and optionsBase.o with bin/libtxevent.a - the event codec and socket layer
+ shared with txProc.  appBase supplies the pOptions and recoveryLog::writeEntry the library expects
+
+ a queue with a pipelineDepth above 1 writes up to that many events to the app before it has
+ responded to the first (announced in the startupinfo command as pipelinedepth).  A handler that
+ completes its event later - off handleOtherFdEvent or execMaintenance for instance - calls
+ deferResult and hands the result to completeResult once done; results may be completed in any
+ order as the default result carries the pipelineRef of its event
 
  @todo
  
@@ -54,6 +64,8 @@ class appBase : public object
     virtual void handleUserPersistentCommand( baseEvent* pEvent );  ///< default does nothing
     virtual void handleUnhandledCmdEvents( baseEvent* pEvent );     ///< default does nothing
     virtual void sendDone();
+    baseEvent* deferResult( );                                      ///< takes over pResultEvent to complete it later
+    void completeResult( baseEvent* pResult );                      ///< dispatches and deletes a deferred result
     virtual void handleSignalEvent( baseEvent::eCommandType theCommand ); ///< in process handling of signals
     virtual void appShutdown( baseEvent* pEvent )     {;}           ///< CMD_PERSISTENT_APP, cmd=shutdown 
     virtual void appUnShutdown( baseEvent* pEvent )   {;}           ///< CMD_PERSISTENT_APP, cmd=unshutdown 
@@ -61,7 +73,7 @@ class appBase : public object
     virtual void startLoopProcess()                   {;}           ///< first statement after the while bRunning
     virtual void setNow( unsigned int tNow )          {;}           ///< callback to set the time at the beginning of the loop - before waiting for an event
     virtual void execMaintenance()                    {;}           ///< hook to implement maintenance tasks off CMD_TIMER_SIGNAL. as soon as one of the shutdown commands have been received this function is called once per second irrespective
-    virtual bool canExit()                            {return 1;}   ///< default behaviour is we can exit immediately
+    virtual bool canExit()                            {return numDeferred==0;}   ///< default behaviour is we can exit once the deferred results are completed
     virtual void handleOtherFdEvent( int fd );                      ///< additional file descriptors that can originate events
     virtual void startupInfoAvailable()               {;}           ///< called as soon as a startup info command has been received
     virtual void loglevelChanged( int newLevel )      {;}           ///< called when the loglevel is adjusted
@@ -86,6 +98,9 @@ class appBase : public object
     int                         signalFd[2];          ///< unix domain socket to submit signal events to the parent process - the main program listens on [1]
     int                         txProcFd;             ///< unix domain socket to submit new events to txProc
     int                         workerPid;            ///< the worker managing this persistent app's pid - needed amongst others for the collection queue
+    int                         pipelineDepth;        ///< events the worker may have in flight with the app - from the startup info
+    unsigned int                numDeferred;          ///< deferred results not completed yet
+    bool                        bResultDeferred;      ///< the handler of the current event deferred its result
     std::string                 appName;              ///< name of the application
     std::string                 hostId;               ///< hostname entry
     std::string                 ownQueue;             ///< name of the queue serving this application
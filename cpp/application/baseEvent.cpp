@@ -7,6 +7,23 @@
  @version 1.1.0		11/02/2011		Gerhardus Muller		Enhanced error json handling in parse part1/part2
  @version 1.1.0		17/04/2012		Gerhardus Muller		added a workerPid field in part2
  @version 1.2.0		27/02/2013		Gerhardus Muller		support for fragmented serialisation to and from a streaming socket 
+ @version 1.3.0		16/10/2026		agent		unSerialise parses frames in place from the socket receive buffer
+ @version 1.4.0		16/10/2026		agent		frames received from a socket are kept and written out verbatim if no section changed
+ @version 1.5.0		16/10/2026		agent		scatter-gather serialisation to sockets and pipes; serialiseNonBlock tracks progress by offset
+ @version 1.6.0		16/10/2026		agent		sections can be encoded in a compact binary form (section type 2)
+ @version 1.7.0		16/10/2026		agent		scalar getters read from an index of the top level keys of an unextracted section
+ @version 1.8.0		16/10/2026		agent		pooled events - unSerialise takes its events from the pool
+ @version 1.9.0		16/10/2026		agent		EV_BATCH
+ @version 1.10.0		16/10/2026		agent		unSerialise resumes a partly received frame and resynchronises after a corrupt frame header
+ @version 1.11.0		16/10/2026		agent		frame and block headers use frameCodec rather than sprintf/sscanf
+ @version 1.12.0		16/10/2026		agent		readyTime is carried in part2
+ @version 1.13.0		16/10/2026		agent		priority is carried in part2
+ @version 1.13.1		16/10/2026		agent		parseMainDestQueue included the ';' in the subQueue so it always parsed as 0
+ @version 1.14.0		16/10/2026		agent		unSerialiseFromFrame for frames held in memory
+ @version 1.15.0		16/10/2026		agent		CMD_FLOW_CONTROL
+ @version 1.16.0		16/10/2026		agent		serialiseNonBlock never blocks and treats a full socket as a part write
+ @version 1.17.0		16/10/2026		agent		coalesceKey is carried in part2; mergeScriptParams
+ @version 1.17.1		17/10/2026		agent		encodeBinary writes strings with embedded NUL bytes in full
 
  @note
 
@@ -18,15 +35,25 @@
  */
 
 #include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
 #include <stdexcept>
+#include <typeinfo>
 #include "application/baseEvent.h"
+#include "application/frameCodec.h"
 #include "application/recoveryLog.h"
 #include "utils/utils.h"
 
 const char* baseEvent::PROTOCOL_VERSION_NUMBER = "3.0";
 const char* baseEvent::FRAME_HEADER = "#frameNewframe#v";
+static_assert( baseEvent::FRAME_HEADER_LEN==frameCodec::FRAME_HEADER_LEN, "baseEvent and frameCodec disagree on the frame header" );
+static_assert( baseEvent::BLOCK_HEADER_LEN==frameCodec::BLOCK_HEADER_LEN, "baseEvent and frameCodec disagree on the block header" );
+static_assert( baseEvent::MAX_HEADER_BLOCK_LEN==frameCodec::MAX_LEN, "baseEvent and frameCodec disagree on the max section length" );
 recoveryLog* baseEvent::theRecoveryLog = NULL;
 logger baseEvent::staticLogger = logger( "eventS", loggerDefs::MIDLEVEL );
+std::vector<baseEvent*> baseEvent::eventPool;
 
 /**
  * constructor
@@ -43,9 +70,16 @@ baseEvent::baseEvent( )
   bSysParamJsonValid = false;
   bExecParamsExtracted = false;
   bExecParamJsonValid = false;
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+  {
+    bSectionRaw[i] = false;
+    sectionType[i] = SECTION_JSON;
+    indexState[i] = 0;
+  } // for
   eventType = EV_UNKNOWN;
   queueTime = 0;
   readyTime = 0;
+  priority = -1;
   bExpired = false;
   subQueue = 0;
   retries = 0;
@@ -53,6 +87,9 @@ baseEvent::baseEvent( )
   expiryTime = 0;
   lifetime = -1;
   workerPid = -1;
+  serialisedLen = 0;
+  bytesSerialised = 0;
+  sectionEncoding = SECTION_JSON;
 } // baseEvent
 
 baseEvent::baseEvent( eEventType type, const char* queue, const char* objName )
@@ -67,11 +104,18 @@ baseEvent::baseEvent( eEventType type, const char* queue, const char* objName )
   bSysParamJsonValid = false;
   bExecParamsExtracted = false;
   bExecParamJsonValid = false;
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+  {
+    bSectionRaw[i] = false;
+    sectionType[i] = SECTION_JSON;
+    indexState[i] = 0;
+  } // for
   eventType = type;
   log.setInstanceName( typeToString() );
   if( queue != NULL ) destQueue = queue;
   queueTime = 0;
   readyTime = 0;
+  priority = -1;
   bExpired = false;
   subQueue = 0;
   retries = 0;
@@ -79,6 +123,9 @@ baseEvent::baseEvent( eEventType type, const char* queue, const char* objName )
   expiryTime = 0;
   lifetime = -1;
   workerPid = -1;
+  serialisedLen = 0;
+  bytesSerialised = 0;
+  sectionEncoding = SECTION_JSON;
 } // baseEvent
 
 baseEvent::baseEvent( const char* body, const char* objName )
@@ -88,6 +135,7 @@ baseEvent::baseEvent( const char* body, const char* objName )
   eventType = EV_UNKNOWN;
   queueTime = 0;
   readyTime = 0;
+  priority = -1;
   bExpired = false;
   subQueue = 0;
   retries = 0;
@@ -95,10 +143,34 @@ baseEvent::baseEvent( const char* body, const char* objName )
   expiryTime = 0;
   lifetime = -1;
   workerPid = -1;
+  serialisedLen = 0;
+  bytesSerialised = 0;
+  sectionEncoding = SECTION_JSON;
   parseBody( body );
   log.setInstanceName( typeToString() );
 } // baseEvent
 
+baseEvent::baseEvent( const char* frame, int frameLen, const char* objName )
+  : object( objName ),
+    execParamsConst(execParams)
+{
+  eventType = EV_UNKNOWN;
+  queueTime = 0;
+  readyTime = 0;
+  priority = -1;
+  bExpired = false;
+  subQueue = 0;
+  retries = 0;
+  returnFd = "-1";
+  expiryTime = 0;
+  lifetime = -1;
+  workerPid = -1;
+  serialisedLen = 0;
+  bytesSerialised = 0;
+  sectionEncoding = SECTION_JSON;
+  parseFrame( frame, frameLen );
+} // baseEvent
+
 baseEvent::baseEvent( const baseEvent& c )
   : object( c.log.getInstanceName().c_str() ),
     execParamsConst(execParams)
@@ -112,106 +184,286 @@ baseEvent::~baseEvent()
 {
 } // ~baseEvent
 
+/**
+ * returns an event from the pool or a new one if the pool is empty
+ * equivalent to new baseEvent( type, queue )
+ * @param type
+ * @param queue
+ * **/
+baseEvent* baseEvent::acquire( eEventType type, const char* queue )
+{
+  if( eventPool.empty() ) return new baseEvent( type, queue );
+
+  baseEvent* pEvent = eventPool.back();
+  eventPool.pop_back();
+  pEvent->eventType = type;
+  if( queue != NULL ) pEvent->destQueue = queue;
+  pEvent->log.setInstanceName( pEvent->typeToString() );
+  return pEvent;
+} // acquire
+
+/**
+ * resets the event and keeps it for reuse - deletes it if the pool is full
+ * only base class instances are pooled
+ * @param pEvent - can be NULL
+ * **/
+void baseEvent::release( baseEvent* pEvent )
+{
+  if( pEvent == NULL ) return;
+  if( (eventPool.size()>=MAX_POOLED_EVENTS) || (typeid(*pEvent)!=typeid(baseEvent)) )
+  {
+    delete pEvent;
+    return;
+  } // if
+  pEvent->reset();
+  if( eventPool.capacity() == 0 ) eventPool.reserve( MAX_POOLED_EVENTS );
+  eventPool.push_back( pEvent );
+} // release
+
+/**
+ * frees the pooled events
+ * **/
+void baseEvent::clearPool( )
+{
+  for( unsigned int i = 0; i < eventPool.size(); i++ )
+    delete eventPool[i];
+  eventPool.clear();
+} // clearPool
+
+/**
+ * returns the event to the state of baseEvent( EV_UNKNOWN ) - the string buffers keep their
+ * allocations unless they grew beyond MAX_POOLED_BUFFER_LEN
+ * **/
+void baseEvent::reset( )
+{
+  if( rawFrame.capacity() > MAX_POOLED_BUFFER_LEN ) std::string().swap( rawFrame );
+  else rawFrame.clear();
+  if( strSerialised.capacity() > MAX_POOLED_BUFFER_LEN ) std::string().swap( strSerialised );
+  else strSerialised.clear();
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+  {
+    std::string& str = sectionJson( i );
+    if( str.capacity() > MAX_POOLED_BUFFER_LEN ) std::string().swap( str );
+    else str.clear();
+    bSectionRaw[i] = false;
+    sectionType[i] = SECTION_JSON;
+    indexState[i] = 0;
+    sectionIndex[i].clear();
+  } // for
+
+  bPart1Extracted = true;
+  bPart1JsonValid = false;
+  bPart2Extracted = false;
+  bPart2JsonValid = false;
+  bSysParamsExtracted = false;
+  bSysParamJsonValid = false;
+  bExecParamsExtracted = false;
+  bExecParamJsonValid = false;
+  eventType = EV_UNKNOWN;
+  reference.clear();
+  returnFd = "-1";
+  destQueue.clear();
+  trace.clear();
+  traceTimestamp.clear();
+  expiryTime = 0;
+  lifetime = -1;
+  retries = 0;
+  workerPid = -1;
+  sysParams = Json::Value();
+  execParams = Json::Value();
+  queueTime = 0;
+  readyTime = 0;
+  priority = -1;
+  coalesceKey.clear();
+  bExpired = false;
+  mainQueue.clear();
+  subQueue = 0;
+  serialisedLen = 0;
+  bytesSerialised = 0;
+  sectionEncoding = SECTION_JSON;
+} // reset
+
+/**
+ * takes a copy of a complete frame and parses it in place
+ * @param frame - frame header followed by the body
+ * @param frameLen
+ * **/
+void baseEvent::parseFrame( const char* frame, int frameLen )
+{
+  rawFrame.assign( frame, frameLen );
+  parseBody( rawFrame.c_str()+FRAME_HEADER_LEN, frameLen-FRAME_HEADER_LEN, true );
+  log.setInstanceName( typeToString() );
+} // parseFrame
+
 /**
  * serialise to the given stream, write a header line indicating the number of bytes to follow
+ * sockets and pipes are written with a single scatter-gather call straight from the sections
  * @param fd - socket to use
  * @param bFdType - defaults to FD_SOCKET
  * @return the number of bytes written or -1 for error
  * **/
 int baseEvent::serialise( int fd, baseEvent::eFdType fdType )
 {
-  serialiseToString( );
-  
   int ret = 0;
-  bool bPipe = false;
   switch( fdType )
   {
     case FD_PIPE:
-      bPipe = true;
     case FD_SOCKET:
       {
-        ret = unixSocket::writeOnce( fd, strSerialised, bPipe );
-        if( ret < 1 )
-        {
-          if( theRecoveryLog != NULL )
-          {
-            theRecoveryLog->writeEntry( this, "ser_fail" );
-          }
-          else
-            log.warn( log.LOGALWAYS, "serialise: (theRecoveryLog is NULL) failed for %s", toString().c_str() );
-        } // error handling
+        struct iovec iov[MAX_IOVEC];
+        int iovcnt = buildIovec( iov );
+        ret = unixSocket::writeOnceV( fd, iov, iovcnt, fdType==FD_PIPE );
+        if( ret < 1 ) logSerialiseFailure( );
       } // case FD_SOCKET
       break;
     case FD_FILE:
-      ret = write( fd, (const void*)strSerialised.c_str(), strSerialised.length() );
+      ret = serialiseToFile( fd );
       break;
   } // switch
   return ret;
 } // serialise
 
 /**
- * invokes serialise and returns any data not sent
+ * writes as much of the frame as the socket accepts - a subsequent call continues 
+ * where the previous one left off until the entire frame is written. the event may not
+ * be modified while a frame is partially written.  sockets are written with MSG_DONTWAIT
+ * so the call does not block even if the socket is in blocking mode
  * @param fd - socket to use
  * @param bFdType - defaults to FD_SOCKET
- * @return -1 for error, 1 for success (entire packet written) or 0 if a part packet is written. In this case strSerialised contains the balance
+ * @return -1 for error, 1 for success (entire packet written) or 0 if a part packet (possibly
+ * nothing) is written - call again once the socket is writable or use getBytesSerialised
  * **/
 int baseEvent::serialiseNonBlock( int fd, baseEvent::eFdType fdType )
 {
-  int bytesWritten = serialise( fd, fdType );
-  if( bytesWritten == -1 ) return -1;
-  if( (unsigned int)bytesWritten >= strSerialised.length() ) return 1;      // we have to test for >= otherwise if there is a mess substr will throw
-  strSerialised = strSerialised.substr( bytesWritten );       // dump the part that has been written
+  struct iovec iov[MAX_IOVEC];
+  int iovcnt = buildIovec( iov );
+
+  // skip what has already been written
+  int first = 0;
+  unsigned int toSkip = bytesSerialised;
+  while( (first<iovcnt) && (toSkip>=iov[first].iov_len) )
+    toSkip -= iov[first++].iov_len;
+  if( first == iovcnt )
+  {
+    bytesSerialised = 0;
+    return 1;
+  } // if
+  iov[first].iov_base = (char*)iov[first].iov_base + toSkip;
+  iov[first].iov_len -= toSkip;
+
+  int bytesWritten = unixSocket::writeOnceV( fd, &iov[first], iovcnt-first, fdType==FD_PIPE, true );
+  if( (bytesWritten == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)) )
+    return 0;
+  if( bytesWritten < 1 )
+  {
+    logSerialiseFailure( );
+    bytesSerialised = 0;
+    return -1;
+  } // if
+  bytesSerialised += bytesWritten;
+  if( bytesSerialised >= serialisedLen )
+  {
+    bytesSerialised = 0;
+    return 1;
+  } // if
+  log.debug( log.LOGSELDOM, "serialiseNonBlock: fd:%d wrote %u of %u", fd, bytesSerialised, serialisedLen );
   return 0;
 } // serialiseNonBlock
 
 /**
- * unserialises from a file descriptor
+ * records a failed serialisation in the recovery log
  * **/
-baseEvent* baseEvent::unSerialise( unixSocket *fd )
+void baseEvent::logSerialiseFailure( )
 {
-  char header[128];
-
-  int bytesReceived = fd->read( header, FRAME_HEADER_LEN );   // read the frame header, protocol version and payload length including the \n at the end
-  if( bytesReceived == -1 ) return NULL;                      // nothing available
+  if( theRecoveryLog != NULL )
+    theRecoveryLog->writeEntry( this, "ser_fail" );
+  else
+    log.warn( log.LOGALWAYS, "serialise: (theRecoveryLog is NULL) failed for %s", toString().c_str() );
+} // logSerialiseFailure
 
-  // the current implementation is not built to handle a fragmented header
-  // ie don't use over the internet
-  header[bytesReceived] = '\0';
-  if( bytesReceived != FRAME_HEADER_LEN )
-    throw Exception( staticLogger, staticLogger.WARN, "unSerialise: expected the frame header, got %d bytes:'%s'", bytesReceived, header );
+/**
+ * describes the frame as a list of buffers without joining them - either the frame as it 
+ * was received or the frame and block headers followed by the (non-empty) sections
+ * sets serialisedLen to the total frame length
+ * @param iov - array of at least MAX_IOVEC entries
+ * @return the number of entries used
+ * **/
+int baseEvent::buildIovec( struct iovec* iov )
+{
+  if( isRawFrameValid() )
+  {
+    iov[0].iov_base = (void*)rawFrame.data();
+    iov[0].iov_len = rawFrame.length();
+    serialisedLen = rawFrame.length();
+    return 1;
+  } // if
 
-  int packetLen = 0;
-  int numParsed = 0;
-  char headerTemplate[128];
-  sprintf( headerTemplate, "%s%s:%cu", FRAME_HEADER,PROTOCOL_VERSION_NUMBER,toascii('%') );
-  numParsed = sscanf( header, headerTemplate, &packetLen );
-  if( numParsed != 1 )
-    throw Exception( staticLogger, staticLogger.WARN, "unSerialise: failed to parse frame header, got %d bytes:'%s'", bytesReceived, header );
+  int headerLen = buildFrameHeader( );
+  int iovcnt = 0;
+  iov[iovcnt].iov_base = (void*)frameHeader;
+  iov[iovcnt++].iov_len = headerLen;
+  serialisedLen = headerLen;
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+  {
+    unsigned int len = sectionSize( i );
+    if( len == 0 ) continue;
+    iov[iovcnt].iov_base = (void*)sectionData( i );
+    iov[iovcnt++].iov_len = len;
+    serialisedLen += len;
+  } // for
+  return iovcnt;
+} // buildIovec
 
-  // unserialise if the body can be read
-  char* body = new char[packetLen+1];
-  baseEvent* pEvent = NULL;
-  try
+/**
+ * unserialises from a file descriptor
+ * decoding resumes where the previous call left off - the frame header is decoded once
+ * and its length kept with the socket until the rest of the frame has arrived; the block
+ * header and sections are parsed in place from the socket's receive buffer once the frame is
+ * complete.  Frames may be split or coalesced arbitrarily by the transport
+ * @return the new event or NULL if a complete frame is not available
+ * @exception on a frame header or body that cannot be parsed - a corrupt frame is consumed 
+ * and after a corrupt frame header the stream is resynchronised on the next frame marker
+ * **/
+baseEvent* baseEvent::unSerialise( unixSocket *fd )
+{
+  int frameLen = fd->getRxFrameLen();
+  if( frameLen == 0 )
   {
-    int bytesReceived = 0;
-    if( packetLen > 0 )
-      bytesReceived = fd->read( body, packetLen );
-    if( bytesReceived != packetLen )
+    // the frame header, protocol version and payload length including the \n at the end
+    if( !fd->ensureRxAvailable( FRAME_HEADER_LEN ) ) return NULL;
+
+    const char* header = fd->getRxData();
+    unsigned int packetLen = 0;
+    if( !frameCodec::decodeFrameHeader( header, packetLen ) || (header[FRAME_HEADER_LEN-1]!='\n') || (packetLen<(unsigned)BLOCK_HEADER_LEN) )
     {
-      // will try again when there are more bytes available
-      staticLogger.debug( loggerDefs::MIDLEVEL, "unSerialise bytesReceived(%d) != packetLen(%d)", bytesReceived, packetLen );
-      if( bytesReceived > 0 ) fd->returnUnusedCharacters( body, bytesReceived ); // this includes any left-over characters from the resync operation
-      fd->returnUnusedCharacters( header, FRAME_HEADER_LEN ); // and in front of whatever we put back the header we read
-      if(staticLogger.wouldLog(staticLogger.LOGSELDOM)) staticLogger.debug( loggerDefs::MIDLEVEL, "unSerialise failed to read body - read %d of %d - %s", bytesReceived, packetLen, body );
-      return NULL;
+      std::string badHeader( header, FRAME_HEADER_LEN );
+      int discarded = fd->resyncRx( FRAME_HEADER, strlen(FRAME_HEADER) );
+      throw Exception( staticLogger, staticLogger.WARN, "unSerialise: failed to parse frame header:'%s' - discarded %d bytes to resynchronise", badHeader.c_str(), discarded );
     } // if
+    frameLen = FRAME_HEADER_LEN+packetLen;
+    fd->setRxFrameLen( frameLen );
+  } // if
+
+  // will try again when there are more bytes available
+  if( !fd->ensureRxAvailable( frameLen ) )
+  {
+    staticLogger.debug( loggerDefs::MIDLEVEL, "unSerialise buffered(%d) < frameLen(%d)", fd->getRxAvailable(), frameLen );
+    return NULL;
+  } // if
+  fd->setRxFrameLen( 0 );
 
-    pEvent = new baseEvent( body );
-    delete[] body;
+  // the frame is copied once out of the receive buffer and kept as is so that it can 
+  // be forwarded verbatim - it remains valid after consumeRx until the next read on the socket
+  const char* frame = fd->getRxData();
+  fd->consumeRx( frameLen );
+  baseEvent* pEvent = acquire( );
+  try
+  {
+    pEvent->parseFrame( frame, frameLen );
   } // try
-  catch( Exception e )
+  catch( ... )
   {
-    delete[] body;
+    release( pEvent );
     throw;
   } // catch
 
@@ -234,17 +486,14 @@ baseEvent* baseEvent::unSerialiseFromFile( const char* fn )
   // assume C++ streams per se a re reliable
   std::string header;
   getline( ifs, header );
-  int packetLen = 0;
-  char headerTemplate[128];
-  sprintf( headerTemplate, "%s%s:%cu", FRAME_HEADER,PROTOCOL_VERSION_NUMBER, toascii('%') );
-  int numParsed = sscanf( header.c_str(), headerTemplate, &packetLen );
-  if( numParsed != 1 )
+  unsigned int packetLen = 0;
+  if( (header.length()<FRAME_HEADER_LEN-1) || !frameCodec::decodeFrameHeader( header.c_str(), packetLen ) )
     throw Exception( staticLogger, loggerDefs::ERROR, "unSerialiseFromFile: failed to parse header line '%s', file '%s'", header.c_str(), fn );
 
   // unserialise if the body can be read
   char* body = new char[packetLen+1];
   baseEvent* pEvent = NULL;
-  int bytesReceived = 0;
+  unsigned int bytesReceived = 0;
   if( packetLen > 0 )
   {
     ifs.read( body, packetLen );
@@ -268,11 +517,8 @@ baseEvent* baseEvent::unSerialiseFromFile( const char* fn )
  * **/
 baseEvent* baseEvent::unSerialiseFromString( const std::string& packet )
 {
-  int packetLen = 0;
-  char headerTemplate[128];
-  sprintf( headerTemplate, "%s%s:%cu", FRAME_HEADER,PROTOCOL_VERSION_NUMBER, toascii('%') );
-  int numParsed = sscanf( packet.c_str(), headerTemplate, &packetLen );
-  if( numParsed != 1 ) return NULL;
+  unsigned int packetLen = 0;
+  if( (packet.length()<FRAME_HEADER_LEN) || !frameCodec::decodeFrameHeader( packet.c_str(), packetLen ) ) return NULL;
 
   baseEvent* pEvent = NULL;
   const char* body = &packet.c_str()[FRAME_HEADER_LEN];
@@ -280,68 +526,99 @@ baseEvent* baseEvent::unSerialiseFromString( const std::string& packet )
   return pEvent;
 } // unSerialiseFromString
 
+/**
+ * un-serialise a complete frame held in memory - the frame is copied into a pooled event
+ * @param frame - frame header followed by the body
+ * @param frameLen
+ * @return the event or NULL if the frame header is invalid or does not match frameLen
+ * @exception on a corrupt body
+ * **/
+baseEvent* baseEvent::unSerialiseFromFrame( const char* frame, int frameLen )
+{
+  unsigned int payloadLen = 0;
+  if( (frameLen<FRAME_HEADER_LEN) || !frameCodec::decodeFrameHeader( frame, payloadLen ) || (payloadLen+FRAME_HEADER_LEN != (unsigned int)frameLen) ) return NULL;
+
+  baseEvent* pEvent = acquire( );
+  try
+  {
+    pEvent->parseFrame( frame, frameLen );
+  } // try
+  catch( ... )
+  {
+    release( pEvent );
+    throw;
+  } // catch
+  return pEvent;
+} // unSerialiseFromFrame
+
 /**
  * parses a frame or message body
  * hardcoded to match serialiseToString - can later on be rewritten to support a 
- * derived event class or with section types other than json
- * @param body
+ * derived event class; each section can be of type SECTION_JSON or SECTION_BINARY
+ * @param body - has to be null terminated
+ * @param bodyLen - length of the body to verify the section sizes against; 0 if not known
+ * @param bRaw - true if body points into rawFrame - the sections are then left in place rather than copied out
  * **/
-void baseEvent::parseBody( const char* body )
+void baseEvent::parseBody( const char* body, int bodyLen, bool bRaw )
 {
   eventType = EV_UNKNOWN;
   unsigned int numSections = 0;
-  unsigned int part1Size = 0;
-  unsigned int part2Size = 0;
-  unsigned int sysSize = 0;
-  unsigned int execSize = 0;
-  int numParams = sscanf( body, "%02u,1,%06u,1,%06u,1,%06u,1,%06u\n",&numSections,&part1Size,&part2Size,&sysSize,&execSize );
-
-  if( numParams != 5 ) throw Exception( log, log.WARN, "parseBody: only parsed %d parameters from frame:'%s'", numParams, body );
+  unsigned int types[NUM_SECTIONS];
+  unsigned int sectionSizes[NUM_SECTIONS];
+  if( !frameCodec::decodeBlockHeader( body, numSections, types, sectionSizes ) ) throw Exception( log, log.WARN, "parseBody: failed to parse the block header of frame:'%s'", body );
   if( numSections != 4 ) throw Exception( log, log.WARN, "parseBody: expected 4 sections found %d", numSections );
-  if( part1Size == 0 ) throw Exception( log, log.WARN, "parseBody: part1 cannot be empty" );
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+    if( (types[i]!=SECTION_JSON) && (types[i]!=SECTION_BINARY) ) throw Exception( log, log.WARN, "parseBody: section %d has unsupported type %u", i, types[i] );
+  if( sectionSizes[SECT_PART1] == 0 ) throw Exception( log, log.WARN, "parseBody: part1 cannot be empty" );
+  if( (bodyLen>0) && ((unsigned int)bodyLen<BLOCK_HEADER_LEN+sectionSizes[0]+sectionSizes[1]+sectionSizes[2]+sectionSizes[3]) )
+    throw Exception( log, log.WARN, "parseBody: sections:%u+%u+%u+%u exceed the body length %d", sectionSizes[0], sectionSizes[1], sectionSizes[2], sectionSizes[3], bodyLen );
+
+  unsigned int startOffset = BLOCK_HEADER_LEN;
+  if( bRaw ) startOffset += body - rawFrame.data();
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+  {
+    bSectionRaw[i] = bRaw;
+    sectionType[i] = (eSectionType)types[i];
+    indexState[i] = 0;
+    sectionIndex[i].clear();
+    if( bRaw )
+    {
+      rawSectionOffset[i] = startOffset;
+      rawSectionLen[i] = sectionSizes[i];
+      startOffset += sectionSizes[i];
+    } // if
+    else if( sectionSizes[i] > 0 )
+    {
+      sectionJson( i ).assign( &body[startOffset], sectionSizes[i] );
+      startOffset += sectionSizes[i];
+    } // else if
+  } // for
 
-  int startOffset = BLOCK_HEADER_LEN;
-  jsonPart1.assign( &body[startOffset], part1Size );
-  startOffset += part1Size;
   bPart1Extracted = false;
   bPart1JsonValid = true;
   parsePart1();
-
-  if( part2Size > 0 )
-  {
-    jsonPart2.assign( &body[startOffset], part2Size );
-    startOffset += part2Size;
-  } // if
   bPart2Extracted = false;
   bPart2JsonValid = true;
-
-  if( sysSize > 0 )
-  {
-    jsonSysParams.assign( &body[startOffset], sysSize );
-    startOffset += sysSize;
-  } // if
   bSysParamsExtracted = false;
   bSysParamJsonValid = true;
-
-  if( execSize > 0 )
-  {
-    jsonExecParams.assign( &body[startOffset], execSize );
-    startOffset += execSize;
-  } // if
   bExecParamsExtracted = false;
   bExecParamJsonValid = true;
 
-  log.info( log.LOGONOCCASION, "parseBody: sections:%u part1Size:%u part2Size:%u sysSize:%u execSize:%u",numSections,part1Size,part2Size,sysSize,execSize );
+  log.info( log.LOGONOCCASION, "parseBody: sections:%u part1Size:%u part2Size:%u sysSize:%u execSize:%u",numSections,sectionSizes[0],sectionSizes[1],sectionSizes[2],sectionSizes[3] );
 } // parseBody
 
 /**
  * serialise to the given file descriptor
+ * files are always written as json - they are read by the recovery tools
  * @param fd 
  * @return the number of bytes written or -1 for error
  * **/
 int baseEvent::serialiseToFile( int fd )
 {
+  eSectionType encoding = sectionEncoding;
+  sectionEncoding = SECTION_JSON;
   std::string buf = serialiseToString();
+  sectionEncoding = encoding;
   int ret = write( fd, (const void*)buf.c_str(), buf.length() );
 
   return ret;
@@ -349,11 +626,57 @@ int baseEvent::serialiseToFile( int fd )
 
 /**
  * serialise the object to a string
- * create jsonPart1, jsonPart2, jsonSysParams, jsonExecParams
+ * create jsonPart1, jsonPart2, jsonSysParams, jsonExecParams in the encoding set by setSectionEncoding
  * assume the jsonxxx string to contain the correct json if it was never extracted
  * **/
 std::string& baseEvent::serialiseToString( )
 {
+  // a frame that was received and not changed since is written out as is
+  if( isRawFrameValid() )
+  {
+    if( log.wouldLog(log.LOGSELDOM) ) log.debug() << "baseEvent::serialiseToString: verbatim " << rawFrame;
+    return rawFrame;
+  } // if
+
+  int headerLen = buildFrameHeader( );
+  strSerialised.reserve( headerLen+sectionSize(SECT_PART1)+sectionSize(SECT_PART2)+sectionSize(SECT_SYSPARAMS)+sectionSize(SECT_EXECPARAMS) );
+  strSerialised.assign( frameHeader, headerLen );
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+    strSerialised.append( sectionData(i), sectionSize(i) );
+
+  if( log.wouldLog(log.LOGSELDOM) ) log.debug() << "baseEvent::serialiseToString: " << strSerialised;
+  return strSerialised;
+} // serialiseToString
+
+/**
+ * serialises the sections that have changed and builds the frame and block headers in frameHeader
+ * this can later be rewritten to make it possible for a derived class to add extra blocks
+ * sections that were not changed are taken from the received frame - typically only 
+ * the routing in part1 or the trace in part2 has been re-serialised
+ * @return the length of the headers
+ * @exception if a section or the payload exceeds MAX_HEADER_BLOCK_LEN
+ * **/
+int baseEvent::buildFrameHeader( )
+{
+  // sections held in another encoding than the one requested have to be extracted and re-serialised
+  if( bPart1JsonValid && (sectionType[SECT_PART1]!=sectionEncoding) && (sectionSize(SECT_PART1)>0) )
+    bPart1JsonValid = false;
+  if( bPart2JsonValid && (sectionType[SECT_PART2]!=sectionEncoding) && (sectionSize(SECT_PART2)>0) )
+  {
+    if( !bPart2Extracted ) parsePart2();
+    bPart2JsonValid = false;
+  } // if
+  if( bSysParamJsonValid && (sectionType[SECT_SYSPARAMS]!=sectionEncoding) && (sectionSize(SECT_SYSPARAMS)>0) )
+  {
+    if( !bSysParamsExtracted ) parseSysParams();
+    bSysParamJsonValid = false;
+  } // if
+  if( bExecParamJsonValid && (sectionType[SECT_EXECPARAMS]!=sectionEncoding) && (sectionSize(SECT_EXECPARAMS)>0) )
+  {
+    if( !bExecParamsExtracted ) parseExecParams();
+    bExecParamJsonValid = false;
+  } // if
+
   // create part1
   if( !bPart1JsonValid )
     serialisePart1();
@@ -370,19 +693,21 @@ std::string& baseEvent::serialiseToString( )
   if( !bExecParamJsonValid )
     serialiseExecParam();
 
-  // construct the payload - 4 payloads all of type 1 which is a json payload
-  // this can later be rewritten to make it possible for a derived class to add extra blocks
-  char payloadHeader[128];
-  int payloadLen = BLOCK_HEADER_LEN+jsonPart1.size()+jsonPart2.size()+jsonSysParams.size()+jsonExecParams.size();
-  if( ((unsigned int)payloadLen>MAX_HEADER_BLOCK_LEN)||(jsonPart1.size()>MAX_HEADER_BLOCK_LEN)||(jsonPart2.size()>MAX_HEADER_BLOCK_LEN)||(jsonSysParams.size()>MAX_HEADER_BLOCK_LEN)||(jsonExecParams.size()>MAX_HEADER_BLOCK_LEN))
-    throw Exception( log, log.WARN, "serialiseToString:MAX_HEADER_BLOCK_LEN exceeded: payloadLen:%u, jsonPart1:%u, jsonPart2:%u, jsonSysParams:%u, jsonExecParams:%u",payloadLen,(unsigned int)jsonPart1.size(),(unsigned int)jsonPart2.size(),(unsigned int)jsonSysParams.size(),(unsigned int)jsonExecParams.size() );
-  sprintf( payloadHeader, "%s%s:%06u\n%02u,1,%06u,1,%06u,1,%06u,1,%06u\n",FRAME_HEADER,PROTOCOL_VERSION_NUMBER,payloadLen,4,(unsigned int)jsonPart1.size(),(unsigned int)jsonPart2.size(),(unsigned int)jsonSysParams.size(),(unsigned int)jsonExecParams.size() );
-  strSerialised = payloadHeader;
-  strSerialised.append(jsonPart1).append(jsonPart2).append(jsonSysParams).append(jsonExecParams);
-
-  if( log.wouldLog(log.LOGSELDOM) ) log.debug() << "baseEvent::serialiseToString: " << strSerialised;
-  return strSerialised;
-} // serialiseToString
+  // construct the payload - 4 payloads of type 1 (json) or 2 (binary)
+  unsigned int part1Size = sectionSize( SECT_PART1 );
+  unsigned int part2Size = sectionSize( SECT_PART2 );
+  unsigned int sysSize = sectionSize( SECT_SYSPARAMS );
+  unsigned int execSize = sectionSize( SECT_EXECPARAMS );
+  int payloadLen = BLOCK_HEADER_LEN+part1Size+part2Size+sysSize+execSize;
+  if( ((unsigned int)payloadLen>MAX_HEADER_BLOCK_LEN)||(part1Size>MAX_HEADER_BLOCK_LEN)||(part2Size>MAX_HEADER_BLOCK_LEN)||(sysSize>MAX_HEADER_BLOCK_LEN)||(execSize>MAX_HEADER_BLOCK_LEN))
+    throw Exception( log, log.WARN, "serialiseToString:MAX_HEADER_BLOCK_LEN exceeded: payloadLen:%u, jsonPart1:%u, jsonPart2:%u, jsonSysParams:%u, jsonExecParams:%u",payloadLen,part1Size,part2Size,sysSize,execSize );
+  unsigned int types[NUM_SECTIONS] = { sectionType[SECT_PART1], sectionType[SECT_PART2], sectionType[SECT_SYSPARAMS], sectionType[SECT_EXECPARAMS] };
+  unsigned int sizes[NUM_SECTIONS] = { part1Size, part2Size, sysSize, execSize };
+  int len = frameCodec::encodeFrameHeader( frameHeader, payloadLen );
+  len += frameCodec::encodeBlockHeader( frameHeader+len, types, sizes );
+  frameHeader[len] = '\0';
+  return len;
+} // buildFrameHeader
 
 /**
  * **/
@@ -394,8 +719,7 @@ void baseEvent::serialisePart1( )
   if( !returnFd.empty() && (returnFd.compare("-1")!=0) ) part1["returnFd"] = returnFd;
   log.debug( log.LOGSELDOM, "serialisePart1: rFd:'%s'", returnFd.c_str() );
   if( !destQueue.empty() ) part1["destQueue"] = destQueue;
-  Json::FastWriter writer;
-  jsonPart1 = writer.write( part1 );
+  encodeSection( SECT_PART1, part1 );
   bPart1JsonValid = true;
 } // serialisePart1
 
@@ -406,12 +730,11 @@ void baseEvent::parsePart1( )
   if( bPart1Extracted ) return;
   //destQueue = "default";
 
-  if( !jsonPart1.empty() )
+  if( sectionSize(SECT_PART1) > 0 )
   {
     Json::Value root;
-    Json::Reader reader;
-    bool parsingSuccessful = reader.parse( jsonPart1, root );
-    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parsePart1: failed to parse:'%s'", jsonPart1.c_str() );
+    bool parsingSuccessful = decodeSection( SECT_PART1, root );
+    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parsePart1: failed to parse:'%s'", sectionText(SECT_PART1).c_str() );
 
     try
     {
@@ -422,7 +745,7 @@ void baseEvent::parsePart1( )
     } // try
     catch( std::runtime_error e )
     { // json-cpp throws runtime_error
-      throw Exception( log, log.WARN, "parsePart1: json-cpp exception:%s part1:'%s'", e.what(), jsonPart1.c_str() );
+      throw Exception( log, log.WARN, "parsePart1: json-cpp exception:%s part1:'%s'", e.what(), sectionText(SECT_PART1).c_str() );
     } // catch
   } // if
 
@@ -440,13 +763,16 @@ void baseEvent::serialisePart2( )
   if( lifetime != -1 ) part2["lifetime"] = lifetime;
   if( retries != 0 ) part2["retries"] = retries;
   if( workerPid != -1 ) part2["wpid"] = workerPid;
+  if( readyTime != 0 ) part2["readyTime"] = readyTime;
+  if( priority != -1 ) part2["priority"] = priority;
+  if( !coalesceKey.empty() ) part2["coalesceKey"] = coalesceKey;
   if( !part2.empty() )
+    encodeSection( SECT_PART2, part2 );
+  else
   {
-    Json::FastWriter writer;
-    jsonPart2 = writer.write( part2 );
+    jsonPart2.clear();
+    bSectionRaw[SECT_PART2] = false;
   } // else
-  else
-    jsonPart2.empty();
   bPart2JsonValid = true;
 } // serialisePart2
 
@@ -456,12 +782,11 @@ void baseEvent::parsePart2( )
 {
   if( bPart2Extracted ) return;
 
-  if( !jsonPart2.empty() )
+  if( sectionSize(SECT_PART2) > 0 )
   {
     Json::Value root;
-    Json::Reader reader;
-    bool parsingSuccessful = reader.parse( jsonPart2, root );
-    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parsePart2: failed to parse:'%s'", jsonPart2.c_str() );
+    bool parsingSuccessful = decodeSection( SECT_PART2, root );
+    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parsePart2: failed to parse:'%s'", sectionText(SECT_PART2).c_str() );
 
     try
     {
@@ -471,10 +796,13 @@ void baseEvent::parsePart2( )
       if( root.isMember("lifetime") ) lifetime = root.get("lifetime", -1 ).asInt();
       if( root.isMember("retries") ) retries = root.get("retries", 0 ).asInt();
       if( root.isMember("wpid") ) workerPid = root.get("wpid", 0 ).asInt();
+      if( root.isMember("readyTime") ) readyTime = root.get("readyTime", 0 ).asUInt();
+      if( root.isMember("priority") ) priority = root.get("priority", -1 ).asInt();
+      if( root.isMember("coalesceKey") ) coalesceKey = root.get("coalesceKey", "" ).asString();
     } // try
     catch( std::runtime_error e )
     { // json-cpp throws runtime_error
-      throw Exception( log, log.WARN, "parsePart2: json-cpp exception:'%s' part2:'%s'", e.what(), jsonPart2.c_str() );
+      throw Exception( log, log.WARN, "parsePart2: json-cpp exception:'%s' part2:'%s'", e.what(), sectionText(SECT_PART2).c_str() );
     } // catch
   } // if
 
@@ -485,11 +813,13 @@ void baseEvent::parsePart2( )
  * **/
 void baseEvent::serialiseSysParam( )
 {
-  Json::FastWriter writer;
   if( !sysParams.empty() )
-    jsonSysParams = writer.write( sysParams );
+    encodeSection( SECT_SYSPARAMS, sysParams );
   else
+  {
     jsonSysParams = "";
+    bSectionRaw[SECT_SYSPARAMS] = false;
+  } // else
   bSysParamJsonValid = true;
 } // serialiseSysParam
 
@@ -498,11 +828,10 @@ void baseEvent::serialiseSysParam( )
 void baseEvent::parseSysParams( )
 {
   if( bSysParamsExtracted ) return;
-  if( !jsonSysParams.empty() )
+  if( sectionSize(SECT_SYSPARAMS) > 0 )
   {
-    Json::Reader reader;
-    bool parsingSuccessful = reader.parse( jsonSysParams, sysParams );
-    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parseSysParams: failed to parse:'%s'", jsonSysParams.c_str() );
+    bool parsingSuccessful = decodeSection( SECT_SYSPARAMS, sysParams );
+    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parseSysParams: failed to parse:'%s'", sectionText(SECT_SYSPARAMS).c_str() );
   } // if
   bSysParamsExtracted = true;
 } // parseSysParams
@@ -511,11 +840,13 @@ void baseEvent::parseSysParams( )
  * **/
 void baseEvent::serialiseExecParam( )
 {
-  Json::FastWriter writer;
   if( !execParams.empty() )
-    jsonExecParams = writer.write( execParams );
+    encodeSection( SECT_EXECPARAMS, execParams );
   else
+  {
     jsonExecParams = "";
+    bSectionRaw[SECT_EXECPARAMS] = false;
+  } // else
   bExecParamJsonValid = true;
 } // serialiseExecParam
 
@@ -524,15 +855,611 @@ void baseEvent::serialiseExecParam( )
 void baseEvent::parseExecParams( )
 {
   if( bExecParamsExtracted ) return;
-  if( !jsonExecParams.empty() )
+  if( sectionSize(SECT_EXECPARAMS) > 0 )
   {
-    Json::Reader reader;
-    bool parsingSuccessful = reader.parse( jsonExecParams, execParams );
-    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parseExecParams: failed to parse:'%s'", jsonExecParams.c_str() );
+    bool parsingSuccessful = decodeSection( SECT_EXECPARAMS, execParams );
+    if ( !parsingSuccessful ) throw Exception( log, log.WARN, "parseExecParams: failed to parse:'%s'", sectionText(SECT_EXECPARAMS).c_str() );
   } // if
   bExecParamsExtracted = true;
 } // parseExecParams
 
+/**
+ * merges the execParams of another event into ours - script parameters (an array) are
+ * appended and named parameters are added, replacing ours with the same name
+ * @exception if one event has script parameters and the other named parameters
+ * **/
+void baseEvent::mergeScriptParams( baseEvent* pOther )
+{
+  if( !bExecParamsExtracted ) parseExecParams();
+  if( !pOther->bExecParamsExtracted ) pOther->parseExecParams();
+  const Json::Value& other = pOther->execParams;
+  if( other.isNull() || (other.size() == 0) ) return;
+  if( other.isArray() && (execParams.isNull() || execParams.isArray()) )
+  {
+    for( Json::ArrayIndex i = 0; i < other.size(); i++ )
+      execParams.append( other[i] );
+  } // if
+  else if( other.isObject() && (execParams.isNull() || execParams.isObject()) )
+  {
+    Json::Value::Members names = other.getMemberNames();
+    for( unsigned int i = 0; i < names.size(); i++ )
+      execParams[names[i]] = other[names[i]];
+  } // else if
+  else
+    throw Exception( log, log.WARN, "mergeScriptParams: cannot merge script parameters with named parameters" );
+  bExecParamJsonValid = false;
+} // mergeScriptParams
+
+/**
+ * @return the string holding the json of a section once it has been copied out of or 
+ * was never part of a received frame
+ * **/
+std::string& baseEvent::sectionJson( int i )
+{
+  switch( i )
+  {
+    case SECT_PART1:
+      return jsonPart1;
+    case SECT_PART2:
+      return jsonPart2;
+    case SECT_SYSPARAMS:
+      return jsonSysParams;
+    default:
+      return jsonExecParams;
+  } // switch
+} // sectionJson
+
+/**
+ * @return the json of a section - points into rawFrame if the section has not changed since it was received
+ * **/
+const char* baseEvent::sectionData( int i )
+{
+  if( bSectionRaw[i] ) return rawFrame.data()+rawSectionOffset[i];
+  return sectionJson( i ).data();
+} // sectionData
+unsigned int baseEvent::sectionSize( int i )
+{
+  if( bSectionRaw[i] ) return rawSectionLen[i];
+  return sectionJson( i ).size();
+} // sectionSize
+std::string baseEvent::sectionText( int i )
+{
+  if( sectionType[i] == SECTION_BINARY )
+  {
+    Json::Value root;
+    if( !decodeSection(i,root) ) return std::string( "<invalid binary section>" );
+    Json::FastWriter writer;
+    return writer.write( root );
+  } // if
+  return std::string( sectionData(i), sectionSize(i) );
+} // sectionText
+
+/**
+ * replaces the section with the encoding of root in sectionEncoding
+ * @param i - the section
+ * @param root - its value
+ * **/
+void baseEvent::encodeSection( int i, const Json::Value& root )
+{
+  std::string& str = sectionJson( i );
+  if( sectionEncoding == SECTION_BINARY )
+  {
+    str.clear();
+    encodeBinary( root, str );
+  } // if
+  else
+  {
+    Json::FastWriter writer;
+    str = writer.write( root );
+  } // else
+  sectionType[i] = sectionEncoding;
+  bSectionRaw[i] = false;
+  indexState[i] = 0;
+} // encodeSection
+
+/**
+ * decodes the section according to its type
+ * @param i - the section
+ * @param root - receives the value
+ * @return false if the section could not be decoded
+ * **/
+bool baseEvent::decodeSection( int i, Json::Value& root )
+{
+  const char* data = sectionData( i );
+  const char* end = data+sectionSize( i );
+  if( sectionType[i] == SECTION_BINARY )
+    return decodeBinary( data, end, root ) && (data==end);
+  Json::Reader reader;
+  return reader.parse( data, end, root );
+} // decodeSection
+
+/**
+ * appends the binary (SECTION_BINARY) encoding of a value
+ * @param v - the value
+ * @param out - string to append to
+ * **/
+void baseEvent::encodeBinary( const Json::Value& v, std::string& out )
+{
+  Json::Value::LargestUInt u = 0;
+  bool bLength = true;            // the tag is followed by the varint u
+  switch( v.type() )
+  {
+    case Json::nullValue:
+      out.push_back( (char)BIN_NULL );
+      return;
+    case Json::booleanValue:
+      out.push_back( (char)(v.asBool()?BIN_TRUE:BIN_FALSE) );
+      return;
+    case Json::intValue:
+      {
+        Json::Value::LargestInt i = v.asLargestInt();
+        out.push_back( (char)BIN_INT );
+        u = ((Json::Value::LargestUInt)i<<1) ^ (Json::Value::LargestUInt)(i>>(sizeof(i)*8-1));  // zigzag so that small negative numbers stay short
+      } // case intValue
+      break;
+    case Json::uintValue:
+      out.push_back( (char)BIN_UINT );
+      u = v.asLargestUInt();
+      break;
+    case Json::realValue:
+      {
+        double d = v.asDouble();
+        uint64_t bits;
+        memcpy( &bits, &d, sizeof(bits) );
+        out.push_back( (char)BIN_REAL );
+        for( int b = 0; b < 8; b++ ) out.push_back( (char)((bits>>(b*8))&0xff) );
+        bLength = false;
+      } // case realValue
+      break;
+    case Json::stringValue:
+      out.push_back( (char)BIN_STRING );
+      u = v.asString().length();
+      break;
+    case Json::arrayValue:
+      out.push_back( (char)BIN_ARRAY );
+      u = v.size();
+      break;
+    case Json::objectValue:
+      out.push_back( (char)BIN_OBJECT );
+      u = v.size();
+      break;
+  } // switch
+
+  if( bLength )
+  {
+    do
+    {
+      unsigned char c = u & 0x7f;
+      u >>= 7;
+      if( u != 0 ) c |= 0x80;
+      out.push_back( (char)c );
+    } while( u != 0 );
+  } // if
+
+  switch( v.type() )
+  {
+    case Json::stringValue:
+      out.append( v.asString() );
+      break;
+    case Json::arrayValue:
+      for( Json::Value::ArrayIndex i = 0; i < v.size(); i++ )
+        encodeBinary( v[i], out );
+      break;
+    case Json::objectValue:
+      for( Json::ValueConstIterator it = v.begin(); it != v.end(); ++it )
+      {
+        encodeBinary( it.key(), out );   // a BIN_STRING - keeps the decoder uniform
+        encodeBinary( *it, out );
+      } // for
+      break;
+    default:
+      break;
+  } // switch
+} // encodeBinary
+
+/**
+ * decodes a single binary (SECTION_BINARY) value
+ * @param p - start of the value, advanced past it
+ * @param end - end of the available bytes
+ * @param v - receives the value
+ * @param depth - current nesting depth
+ * @return false if the encoding is invalid or truncated
+ * **/
+bool baseEvent::decodeBinary( const char*& p, const char* end, Json::Value& v, int depth )
+{
+  if( (p>=end) || (depth>MAX_BINARY_DEPTH) ) return false;
+  unsigned char tag = (unsigned char)*p++;
+
+  // all tags other than null, bools and reals are followed by a varint
+  Json::Value::LargestUInt u = 0;
+  if( (tag==BIN_INT) || (tag==BIN_UINT) || (tag>=BIN_STRING) )
+  {
+    unsigned int shift = 0;
+    unsigned char c;
+    do
+    {
+      if( (p>=end) || (shift>=sizeof(u)*8) ) return false;
+      c = (unsigned char)*p++;
+      u |= (Json::Value::LargestUInt)(c&0x7f) << shift;
+      shift += 7;
+    } while( c & 0x80 );
+  } // if
+
+  switch( tag )
+  {
+    case BIN_NULL:
+      v = Json::Value( );
+      break;
+    case BIN_FALSE:
+      v = false;
+      break;
+    case BIN_TRUE:
+      v = true;
+      break;
+    case BIN_INT:
+      v = (Json::Value::LargestInt)((u>>1) ^ (~(u&1)+1));
+      break;
+    case BIN_UINT:
+      v = u;
+      break;
+    case BIN_REAL:
+      {
+        if( end-p < 8 ) return false;
+        uint64_t bits = 0;
+        for( int b = 0; b < 8; b++ ) bits |= (uint64_t)(unsigned char)p[b] << (b*8);
+        p += 8;
+        double d;
+        memcpy( &d, &bits, sizeof(d) );
+        v = d;
+      } // case BIN_REAL
+      break;
+    case BIN_STRING:
+      if( u > (Json::Value::LargestUInt)(end-p) ) return false;
+      v = std::string( p, u );
+      p += u;
+      break;
+    case BIN_ARRAY:
+      if( u > (Json::Value::LargestUInt)(end-p) ) return false;   // every element takes at least one byte
+      v = Json::Value( Json::arrayValue );
+      for( Json::Value::ArrayIndex i = 0; i < u; i++ )
+        if( !decodeBinary(p,end,v[i],depth+1) ) return false;
+      break;
+    case BIN_OBJECT:
+      if( u > (Json::Value::LargestUInt)(end-p) ) return false;
+      v = Json::Value( Json::objectValue );
+      for( Json::Value::LargestUInt i = 0; i < u; i++ )
+      {
+        Json::Value key;
+        if( !decodeBinary(p,end,key,depth+1) || !key.isString() ) return false;
+        if( !decodeBinary(p,end,v[key.asString()],depth+1) ) return false;
+      } // for
+      break;
+    default:
+      return false;
+  } // switch
+  return true;
+} // decodeBinary
+
+/**
+ * indexes the top level keys of a section that is a json or binary object in a single pass 
+ * without building a Json::Value tree - only used while the section is not extracted
+ * @param i - the section
+ * @return false if the section cannot be indexed - the caller has to fall back to parsing it
+ * **/
+bool baseEvent::indexSection( int i )
+{
+  if( indexState[i] == 0 )
+  {
+    sectionIndex[i].clear();
+    bool bIndexed;
+    if( sectionSize(i) == 0 )
+      bIndexed = true;
+    else if( sectionType[i] == SECTION_BINARY )
+      bIndexed = indexBinarySection( i );
+    else
+      bIndexed = indexJsonSection( i );
+    indexState[i] = bIndexed?1:-1;
+    if( !bIndexed ) sectionIndex[i].clear();
+  } // if
+  return indexState[i] == 1;
+} // indexSection
+
+bool baseEvent::indexJsonSection( int i )
+{
+  const char* data = sectionData( i );
+  const char* end = data+sectionSize( i );
+  const char* p = data;
+  while( (p<end) && isspace(*p) ) p++;
+  if( (p>=end) || (*p!='{') ) return false;
+  p++;
+  while( true )
+  {
+    while( (p<end) && isspace(*p) ) p++;
+    if( p >= end ) return false;
+    if( *p == '}' ) return true;
+    if( *p != '"' ) return false;
+
+    tSectionField field;
+    const char* key = p+1;
+    if( (p=skipJsonString(p,end)) == NULL ) return false;
+    field.keyOffset = key-data;
+    field.keyLen = p-1-key;
+    if( memchr(key,'\\',field.keyLen) != NULL ) return false;   // escaped keys are left to the parser
+
+    while( (p<end) && isspace(*p) ) p++;
+    if( (p>=end) || (*p!=':') ) return false;
+    p++;
+    while( (p<end) && isspace(*p) ) p++;
+    const char* value = p;
+    if( (p=skipJsonValue(p,end)) == NULL ) return false;
+    field.valueOffset = value-data;
+    field.valueLen = p-value;
+    sectionIndex[i].push_back( field );
+
+    while( (p<end) && isspace(*p) ) p++;
+    if( p >= end ) return false;
+    if( *p == ',' ) p++;
+    else if( *p != '}' ) return false;
+  } // while
+} // indexJsonSection
+
+bool baseEvent::indexBinarySection( int i )
+{
+  const char* data = sectionData( i );
+  const char* end = data+sectionSize( i );
+  const char* p = data;
+  if( (unsigned char)*p++ != BIN_OBJECT ) return false;
+  Json::Value::LargestUInt count = 0;
+  unsigned int shift = 0;
+  unsigned char c;
+  do
+  {
+    if( (p>=end) || (shift>=sizeof(count)*8) ) return false;
+    c = (unsigned char)*p++;
+    count |= (Json::Value::LargestUInt)(c&0x7f) << shift;
+    shift += 7;
+  } while( c & 0x80 );
+
+  for( Json::Value::LargestUInt n = 0; n < count; n++ )
+  {
+    // keys are BIN_STRING - tag, varint length, bytes
+    if( (p>=end) || ((unsigned char)*p!=BIN_STRING) ) return false;
+    const char* key = p;
+    if( !skipBinary(p,end) ) return false;
+    const char* value = p;
+    if( !skipBinary(p,end) ) return false;
+    tSectionField field;
+    key++;
+    while( (unsigned char)*key++ & 0x80 ) ;
+    field.keyOffset = key-data;
+    field.keyLen = value-key;
+    field.valueOffset = value-data;
+    field.valueLen = p-value;
+    sectionIndex[i].push_back( field );
+  } // for
+  return p == end;
+} // indexBinarySection
+
+/**
+ * @return the index of key in sectionIndex - the last occurrence as with the parser, 
+ * -1 if not present or -2 if the section cannot be indexed
+ * **/
+int baseEvent::findField( int i, const char* key )
+{
+  if( !indexSection(i) ) return -2;
+  const char* data = sectionData( i );
+  size_t keyLen = strlen( key );
+  for( int n = sectionIndex[i].size()-1; n >= 0; n-- )
+  {
+    tSectionField& field = sectionIndex[i][n];
+    if( (field.keyLen==keyLen) && (memcmp(data+field.keyOffset,key,keyLen)==0) ) return n;
+  } // for
+  return -1;
+} // findField
+
+/**
+ * reads an integer field of an unextracted section without parsing it
+ * @param i - the section
+ * @param key - the field
+ * @param v - receives the value if present; left unchanged if not
+ * @return 1 if present, 0 if not present or -1 if it can only be determined by parsing the 
+ * section (not indexable, not an integer or out of range)
+ * **/
+int baseEvent::peekInt( int i, const char* key, int& v )
+{
+  int field = findField( i, key );
+  if( field == -1 ) return 0;
+  long long val;
+  if( (field<0) || !peekInteger(i,field,val) || (val<INT_MIN) || (val>INT_MAX) ) return -1;
+  v = (int)val;
+  return 1;
+} // peekInt
+int baseEvent::peekUInt( int i, const char* key, unsigned int& v )
+{
+  int field = findField( i, key );
+  if( field == -1 ) return 0;
+  long long val;
+  if( (field<0) || !peekInteger(i,field,val) || (val<0) || (val>UINT_MAX) ) return -1;
+  v = (unsigned int)val;
+  return 1;
+} // peekUInt
+
+/**
+ * @return true if the field is an integer that fits into val
+ * **/
+bool baseEvent::peekInteger( int i, int field, long long& val )
+{
+  const char* p = sectionData(i)+sectionIndex[i][field].valueOffset;
+  const char* end = p+sectionIndex[i][field].valueLen;
+  if( sectionType[i] == SECTION_BINARY )
+  {
+    if( ((unsigned char)*p!=BIN_INT) && ((unsigned char)*p!=BIN_UINT) ) return false;
+    Json::Value value;
+    if( !decodeBinary(p,end,value) ) return false;
+    if( value.isUInt() ) { val = value.asUInt(); return true; }
+    if( value.isInt() ) { val = value.asInt(); return true; }
+    return false;
+  } // if
+
+  bool bNegative = false;
+  if( (p<end) && (*p=='-') )
+  {
+    bNegative = true;
+    p++;
+  } // if
+  if( (p>=end) || (end-p>18) ) return false;
+  val = 0;
+  for( ; p < end; p++ )
+  {
+    if( !isdigit(*p) ) return false;   // reals are left to the parser
+    val = val*10 + (*p-'0');
+  } // for
+  if( bNegative ) val = -val;
+  return true;
+} // peekInteger
+
+/**
+ * reads a string field of an unextracted section without parsing it
+ * @param i - the section
+ * @param key - the field
+ * @param v - receives the value if present; left unchanged if not
+ * @return 1 if present, 0 if not present or -1 if it can only be determined by parsing the 
+ * section (not indexable, not a string or containing escapes)
+ * **/
+int baseEvent::peekString( int i, const char* key, std::string& v )
+{
+  int field = findField( i, key );
+  if( field == -1 ) return 0;
+  if( field < 0 ) return -1;
+  const char* p = sectionData(i)+sectionIndex[i][field].valueOffset;
+  unsigned int len = sectionIndex[i][field].valueLen;
+  if( sectionType[i] == SECTION_BINARY )
+  {
+    if( (unsigned char)*p != BIN_STRING ) return -1;
+    const char* end = p+len;
+    p++;
+    while( (unsigned char)*p++ & 0x80 ) ;
+    v.assign( p, end-p );
+    return 1;
+  } // if
+
+  if( (len<2) || (*p!='"') || (memchr(p,'\\',len)!=NULL) ) return -1;
+  v.assign( p+1, len-2 );
+  return 1;
+} // peekString
+
+/**
+ * @param p - points to the opening quote
+ * @return the position following the closing quote or NULL if not terminated
+ * **/
+const char* baseEvent::skipJsonString( const char* p, const char* end )
+{
+  for( p++; p < end; p++ )
+  {
+    if( *p == '\\' ) p++;
+    else if( *p == '"' ) return p+1;
+  } // for
+  return NULL;
+} // skipJsonString
+
+/**
+ * @param p - points to the first character of the value
+ * @return the position following the value or NULL if it is not terminated
+ * **/
+const char* baseEvent::skipJsonValue( const char* p, const char* end )
+{
+  if( p >= end ) return NULL;
+  if( *p == '"' ) return skipJsonString( p, end );
+  if( (*p=='{') || (*p=='[') )
+  {
+    int depth = 0;
+    while( p < end )
+    {
+      if( *p == '"' )
+      {
+        if( (p=skipJsonString(p,end)) == NULL ) return NULL;
+        continue;
+      } // if
+      if( (*p=='{') || (*p=='[') ) depth++;
+      else if( (*p=='}') || (*p==']') )
+      {
+        if( --depth == 0 ) return p+1;
+      } // else if
+      p++;
+    } // while
+    return NULL;
+  } // if
+  // number, true, false or null
+  const char* start = p;
+  while( (p<end) && (*p!=',') && (*p!='}') && (*p!=']') && !isspace(*p) ) p++;
+  return (p>start)?p:NULL;
+} // skipJsonValue
+
+/**
+ * skips a binary value
+ * @param p - start of the value, advanced past it
+ * @return false if the encoding is invalid or truncated
+ * **/
+bool baseEvent::skipBinary( const char*& p, const char* end, int depth )
+{
+  if( (p>=end) || (depth>MAX_BINARY_DEPTH) ) return false;
+  unsigned char tag = (unsigned char)*p++;
+  if( tag == BIN_REAL )
+  {
+    if( end-p < 8 ) return false;
+    p += 8;
+    return true;
+  } // if
+  if( (tag!=BIN_INT) && (tag!=BIN_UINT) && (tag<BIN_STRING) ) return tag <= BIN_TRUE;
+
+  Json::Value::LargestUInt u = 0;
+  unsigned int shift = 0;
+  unsigned char c;
+  do
+  {
+    if( (p>=end) || (shift>=sizeof(u)*8) ) return false;
+    c = (unsigned char)*p++;
+    u |= (Json::Value::LargestUInt)(c&0x7f) << shift;
+    shift += 7;
+  } while( c & 0x80 );
+
+  switch( tag )
+  {
+    case BIN_STRING:
+      if( u > (Json::Value::LargestUInt)(end-p) ) return false;
+      p += u;
+      return true;
+    case BIN_ARRAY:
+      for( Json::Value::LargestUInt n = 0; n < u; n++ )
+        if( !skipBinary(p,end,depth+1) ) return false;
+      return true;
+    case BIN_OBJECT:
+      for( Json::Value::LargestUInt n = 0; n < 2*u; n++ )
+        if( !skipBinary(p,end,depth+1) ) return false;
+      return true;
+    case BIN_INT:
+    case BIN_UINT:
+      return true;
+    default:
+      return false;
+  } // switch
+} // skipBinary
+
+/**
+ * @return true if the frame as received can be written out as is - no section has been changed
+ * and the sections are already in the requested encoding
+ * **/
+bool baseEvent::isRawFrameValid( )
+{
+  if( !bPart1JsonValid || !bPart2JsonValid || !bSysParamJsonValid || !bExecParamJsonValid ) return false;
+  for( int i = 0; i < NUM_SECTIONS; i++ )
+  {
+    if( !bSectionRaw[i] ) return false;
+    if( (sectionType[i]!=sectionEncoding) && (rawSectionLen[i]>0) ) return false;
+  } // for
+  return true;
+} // isRawFrameValid
+
 /**
  * returns the current fd reference - tacked onto the fd with a ';'
  * has to occur before the record separator being a ':'
@@ -575,7 +1502,7 @@ void baseEvent::parseMainDestQueue( )
   {
     mainQueue.assign( destQueue, 0, t );
     std::string tmp;
-    tmp.assign( destQueue, t, destQueue.length()-t-1 );
+    tmp.assign( destQueue, t+1, destQueue.length()-t-1 );
     subQueue = strtoul( tmp.c_str(), NULL, 10 );
     log.debug( log.LOGONOCCASION, "parseMainDestQueue: destQueue:'%s' mainQueue:'%s' subQueue:%lu", destQueue.c_str(), mainQueue.c_str(), subQueue );
   } // if
@@ -592,7 +1519,7 @@ void baseEvent::parseMainDestQueue( )
  * **/
 bool baseEvent::isExpired( unsigned int now )
 {
-  if( !bPart2Extracted ) parsePart2();
+  if( !bPart2Extracted && (peekUInt(SECT_PART2,"expiryTime",expiryTime)<0) ) parsePart2();
   if( (expiryTime != 0) && (expiryTime < now) )
     return true;
   else
@@ -659,15 +1586,15 @@ std::string baseEvent::toString( )
   } // if bSysParamsExtracted
   else if( bSysParamJsonValid )
   {
-    std::string str = jsonSysParams;
+    std::string str = sectionText( SECT_SYSPARAMS );
     utils::stripTrailingCRLF( str, false );
     oss << " sysParams:" << str;
   } // else
 
   if( bExecParamsExtracted && !bExecParamJsonValid )  serialiseExecParam();
-  if( !jsonExecParams.empty() )
+  if( sectionSize(SECT_EXECPARAMS) > 0 )
   {
-    std::string str = jsonExecParams;
+    std::string str = sectionText( SECT_EXECPARAMS );
     utils::stripTrailingCRLF( str, false );
     oss << " execParams:" << str;
   } // if
@@ -678,15 +1605,17 @@ std::string baseEvent::toString( )
     if( bExpired ) oss << " expired";
     if( lifetime != -1 ) oss << " lifetime:" << lifetime;
     if( retries > 0 ) oss << " retries:" << retries;
+    if( readyTime != 0 ) oss << " readyTime:" << readyTime;
+    if( priority != -1 ) oss << " priority:" << priority;
+    if( !coalesceKey.empty() ) oss << " coalesceKey:" << coalesceKey;
   } // if part2
-  else if( !jsonPart2.empty() )
+  else if( sectionSize(SECT_PART2) > 0 )
   {
-    std::string str = jsonPart2;
+    std::string str = sectionText( SECT_PART2 );
     utils::stripTrailingCRLF( str, false );
     if( !str.empty() ) oss << " part2:" << str;
   } // else
 
-  if( readyTime != 0 ) oss << " readyTime:" << readyTime;
   if( !trace.empty() ) oss << " traceB||" << trace << "||traceE ";
   if( !traceTimestamp.empty() ) oss << " traceTS:" << traceTimestamp;
   oss << " p:" << this;
@@ -714,7 +1643,7 @@ std::string baseEvent::toStringBrief( )
   } // if bSysParamsExtracted
   else if( bSysParamJsonValid )
   {
-    std::string str = jsonSysParams;
+    std::string str = sectionText( SECT_SYSPARAMS );
     utils::stripTrailingCRLF( str, false );
     oss << " sysParams:" << str;
   } // else
@@ -764,6 +1693,9 @@ const char* baseEvent::typeToString( )
     case EV_ERROR:
       return "EV_ERROR";
       break;
+    case EV_BATCH:
+      return "EV_BATCH";
+      break;
     default:
       return "unknown eventType";
   } // switch
@@ -833,6 +1765,9 @@ const char* baseEvent::commandToString( )
     case CMD_WORKER_CONF:
       return "CMD_WORKER_CONF";
       break;
+    case CMD_FLOW_CONTROL:
+      return "CMD_FLOW_CONTROL";
+      break;
     default:
       return "unknown";
   } // switch
@@ -12,6 +12,23 @@
  @version 1.2.1		19/10/2012		Gerhardus Muller		required stdlib given that txproc options.h is no longer included
  @version 1.3.0		27/02/2013		Gerhardus Muller		support for fragmented serialisation to a streaming socket 
  @version 1.3.1		07/04/2014		Gerhardus Muller		setRecoveryEvent used incorrect key
+ @version 1.4.0		16/10/2026		agent		construction from a body of known length for parsing in place
+ @version 1.5.0		16/10/2026		agent		keeps the received frame for verbatim forwarding
+ @version 1.6.0		16/10/2026		agent		scatter-gather serialisation
+ @version 1.7.0		16/10/2026		agent		binary section encoding (section type 2)
+ @version 1.8.0		16/10/2026		agent		getters read scalars from an index of the section rather than parsing it
+ @version 1.9.0		16/10/2026		agent		pooled events - acquire/release with reset and reuse
+ @version 1.9.1		17/10/2026		agent		deleteParam invalidates jsonExecParams
+ @version 1.10.0		16/10/2026		agent		EV_BATCH envelope for bulk submission
+ @version 1.11.0		16/10/2026		agent		readyTime is carried in part2
+ @version 1.12.0		16/10/2026		agent		priority in part2
+ @version 1.13.0		16/10/2026		agent		unSerialiseFromFrame
+ @version 1.14.0		16/10/2026		agent		CMD_FLOW_CONTROL
+ @version 1.15.0		16/10/2026		agent		serialiseNonBlock does not block or fail on a full socket; getBytesSerialised
+ @version 1.16.0		16/10/2026		agent		coalesceKey in part2; mergeScriptParams
+ @version 1.17.0		16/10/2026		agent		perlCache in sysParams
+ @version 1.18.0		16/10/2026		agent		spawnUs in sysParams
+ @version 1.19.0		16/10/2026		agent		pipelineRef in sysParams
 
  @note
 
@@ -29,6 +46,7 @@
 #include "utils/object.h"
 #include "utils/unixSocket.h"
 #include <stdlib.h>
+#include <sys/uio.h>
 
 typedef std::map<std::string,std::string> baseEventSysMapT;
 typedef baseEventSysMapT::iterator baseEventSysMapIteratorT;
@@ -50,8 +68,25 @@ class baseEvent : public object
     static const char* PROTOCOL_VERSION_NUMBER;
     static const char* FRAME_HEADER;
     static const int MAX_RETRIES = 5;
-    enum eEventType { EV_UNKNOWN=0,EV_BASE=1,EV_SCRIPT=2,EV_PERL=3,EV_BIN=4,EV_URL=5,EV_RESULT=6,EV_WORKER_DONE=7,EV_COMMAND=8,EV_REPLY=9,EV_ERROR=10 };
+    enum eEventType { EV_UNKNOWN=0,EV_BASE=1,EV_SCRIPT=2,EV_PERL=3,EV_BIN=4,EV_URL=5,EV_RESULT=6,EV_WORKER_DONE=7,EV_COMMAND=8,EV_REPLY=9,EV_ERROR=10,EV_BATCH=11 };
     enum eFdType { FD_SOCKET,FD_PIPE,FD_FILE };
+    enum eSection { SECT_PART1=0,SECT_PART2=1,SECT_SYSPARAMS=2,SECT_EXECPARAMS=3,NUM_SECTIONS=4 };
+    static const int MAX_IOVEC = NUM_SECTIONS+1; // the frame and block headers followed by the sections
+    static const int MAX_BINARY_DEPTH = 64;   // nesting limit when decoding a binary section
+    static const unsigned int MAX_POOLED_EVENTS = 1024;         // released events kept for reuse
+    static const unsigned int MAX_POOLED_BUFFER_LEN = 65536;    // larger frame buffers are freed rather than kept with a pooled event
+
+    /**
+     * section types as carried in the block header
+     * SECTION_JSON=1     - json text
+     * SECTION_BINARY=2   - a single tagged value: a tag byte followed by its payload
+     *   0 null, 1 false, 2 true, 3 int (zigzag varint), 4 uint (varint), 5 double (8 bytes little endian), 
+     *   6 string (varint length, bytes), 7 array (varint count, values), 8 object (varint count, (varint key length, key, value) pairs)
+     * every receiver understands both types - a sender only uses SECTION_BINARY if the peer is 
+     * known to be a txProc process (see the queue option bBinarySections)
+     * */
+    enum eSectionType { SECTION_JSON=1,SECTION_BINARY=2 };
+    enum eBinaryTag { BIN_NULL=0,BIN_FALSE=1,BIN_TRUE=2,BIN_INT=3,BIN_UINT=4,BIN_REAL=5,BIN_STRING=6,BIN_ARRAY=7,BIN_OBJECT=8 };
 
     /**
      * Commands are always handled out of band and distributed to all workers if not handled 
@@ -74,14 +109,16 @@ class baseEvent : public object
      * CMD_PERSISTENT_APP=16    - command forwarded to the persistent app on the appropriate queue
      * CMD_EVENT=17             - event that needs be processed
      * CMD_WORKER_CONF=18
+     * CMD_FLOW_CONTROL=19      - nucleus to networkIf - stop or resume reading from connections feeding a queue
      * */
-    enum eCommandType { CMD_NONE=0,CMD_STATS=1,CMD_RESET_STATS=2,CMD_REOPEN_LOG=3,CMD_REREAD_CONF=4,CMD_EXIT_WHEN_DONE=5,CMD_SEND_UDP_PACKET=6,CMD_TIMER_SIGNAL=7,CMD_CHILD_SIGNAL=8,CMD_APP=9,CMD_SHUTDOWN=10,CMD_NUCLEUS_CONF=11,CMD_DUMP_STATE=12,CMD_NETWORKIF_CONF=13,CMD_END_OF_QUEUE=14,CMD_MAIN_CONF=15,CMD_PERSISTENT_APP=16,CMD_EVENT=17,CMD_WORKER_CONF=18 };
+    enum eCommandType { CMD_NONE=0,CMD_STATS=1,CMD_RESET_STATS=2,CMD_REOPEN_LOG=3,CMD_REREAD_CONF=4,CMD_EXIT_WHEN_DONE=5,CMD_SEND_UDP_PACKET=6,CMD_TIMER_SIGNAL=7,CMD_CHILD_SIGNAL=8,CMD_APP=9,CMD_SHUTDOWN=10,CMD_NUCLEUS_CONF=11,CMD_DUMP_STATE=12,CMD_NETWORKIF_CONF=13,CMD_END_OF_QUEUE=14,CMD_MAIN_CONF=15,CMD_PERSISTENT_APP=16,CMD_EVENT=17,CMD_WORKER_CONF=18,CMD_FLOW_CONTROL=19 };
  
     // Methods
   public:
     baseEvent( );
     baseEvent( eEventType type, const char* queue=NULL, const char* name="baseEvent" );
     baseEvent( const char* body, const char* name="baseEvent" );
+    baseEvent( const char* frame, int frameLen, const char* name="baseEvent" );
     baseEvent( const baseEvent& c );
     virtual ~baseEvent();
     virtual std::string toString ();
@@ -118,56 +155,72 @@ class baseEvent : public object
     void parseMainDestQueue( );
 
     // part2 properties extracted on request - all the accessor methods can throw
+    // the getters read the value from the section index (peekXXX) while part2 is not extracted
     // part2["trace"] = trace;
     // part2["traceTimestamp"] = traceTimestamp;
     // part2["expiryTime"] = expiryTime;
     // part2["lifetime"] = lifetime;
     // part2["retries"] = retries;
     // part2["wpid"] = workerPid;
+    // part2["readyTime"] = readyTime;
+    // part2["priority"] = priority;
+    // part2["coalesceKey"] = coalesceKey;
     void setTrace( const std::string& t )                   {if(!bPart2Extracted)parsePart2();trace=t;bPart2JsonValid=false;}
-    std::string& getTrace( )                                {if(!bPart2Extracted)parsePart2();return trace;}
+    std::string& getTrace( )                                {if(!bPart2Extracted&&(peekString(SECT_PART2,"trace",trace)<0))parsePart2();return trace;}
     void appendTrace( const char* t )                       {if(!bPart2Extracted)parsePart2();trace.append(t);bPart2JsonValid=false;}
     void appendTrace( std::string& t )                      {if(!bPart2Extracted)parsePart2();trace.append(t);bPart2JsonValid=false;}
     void setTraceTimestamp( const std::string& t )          {if(!bPart2Extracted)parsePart2();traceTimestamp=t;bPart2JsonValid=false;}
     void setTraceTimestamp( const char* t )                 {if(!bPart2Extracted)parsePart2();traceTimestamp=t;bPart2JsonValid=false;}
-    std::string& getTraceTimestamp( )                       {if(!bPart2Extracted)parsePart2();return traceTimestamp;}
-    unsigned int getExpiryTime( )                           {if(!bPart2Extracted)parsePart2();return expiryTime;}
+    std::string& getTraceTimestamp( )                       {if(!bPart2Extracted&&(peekString(SECT_PART2,"traceTimestamp",traceTimestamp)<0))parsePart2();return traceTimestamp;}
+    unsigned int getExpiryTime( )                           {if(!bPart2Extracted&&(peekUInt(SECT_PART2,"expiryTime",expiryTime)<0))parsePart2();return expiryTime;}
     void setExpiryTime( unsigned int t )                    {if(!bPart2Extracted)parsePart2();expiryTime=t;bPart2JsonValid=false;}
-    int  getLifetime( )                                     {if(!bPart2Extracted)parsePart2();return lifetime;}
+    int  getLifetime( )                                     {if(!bPart2Extracted&&(peekInt(SECT_PART2,"lifetime",lifetime)<0))parsePart2();return lifetime;}
     void setLifetime( int theTime )                         {if(!bPart2Extracted)parsePart2();lifetime=theTime;bPart2JsonValid=false;}
     void incRetryCounter( )                                 {if(!bPart2Extracted)parsePart2();retries++;bPart2JsonValid=false;}
-    bool isRetryExceeded( )                                 {if(!bPart2Extracted)parsePart2();return retries>MAX_RETRIES;}
-    int  getWorkerPid( )                                    {if(!bPart2Extracted)parsePart2();return workerPid;}
+    bool isRetryExceeded( )                                 {if(!bPart2Extracted&&(peekInt(SECT_PART2,"retries",retries)<0))parsePart2();return retries>MAX_RETRIES;}
+    int  getWorkerPid( )                                    {if(!bPart2Extracted&&(peekInt(SECT_PART2,"wpid",workerPid)<0))parsePart2();return workerPid;}
     void setWorkerPid( int thePid )                         {if(!bPart2Extracted)parsePart2();workerPid=thePid;bPart2JsonValid=false;}
+    unsigned int getReadyTime( )                            {if(!bPart2Extracted&&(peekUInt(SECT_PART2,"readyTime",readyTime)<0))parsePart2();return readyTime;}
+    void setReadyTime( unsigned int t )                     {if(!bPart2Extracted)parsePart2();readyTime=t;bPart2JsonValid=false;}
+    int  getPriority( )                                     {if(!bPart2Extracted&&(peekInt(SECT_PART2,"priority",priority)<0))parsePart2();return priority;}
+    void setPriority( int p )                               {if(!bPart2Extracted)parsePart2();priority=p;bPart2JsonValid=false;}
+    std::string& getCoalesceKey( )                          {if(!bPart2Extracted&&(peekString(SECT_PART2,"coalesceKey",coalesceKey)<0))parsePart2();return coalesceKey;}
+    void setCoalesceKey( const std::string& k )             {if(!bPart2Extracted)parsePart2();coalesceKey=k;bPart2JsonValid=false;}
 
     // sysParams
     // bStandardResponse,command,url,scriptName,result,bSuccess,bExpectReply,errorString,
-    // failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent,
-    bool getStandardResponse( )                             {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("bStandardResponse"))return false;Json::Value v=sysParams.get("bStandardResponse",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"getStandardResponse:not boolean:'%s'",v.toStyledString().c_str());return false;}}
+    // failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent,perlCache,spawnUs,pipelineRef
+    bool getStandardResponse( )                             {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"bStandardResponse",v)>=0)return v!=0;parseSysParams();}if(!sysParams.isMember("bStandardResponse"))return false;Json::Value v=sysParams.get("bStandardResponse",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"getStandardResponse:not boolean:'%s'",v.toStyledString().c_str());return false;}}
     void setStandardResponse( bool b )                      {if(!bSysParamsExtracted)parseSysParams();sysParams["bStandardResponse"]=b;bSysParamJsonValid=false;}
-    enum eCommandType getCommand( )                         {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("command"))return CMD_NONE;Json::Value v=sysParams.get("command",(int)CMD_NONE);if(v.isInt())return (eCommandType)v.asInt();else{log.warn(log.LOGMOSTLY,"getCommand:not integer:'%s'",v.toStyledString().c_str());return CMD_NONE;}}
+    enum eCommandType getCommand( )                         {if(!bSysParamsExtracted){int v=CMD_NONE;if(peekInt(SECT_SYSPARAMS,"command",v)>=0)return (eCommandType)v;parseSysParams();}if(!sysParams.isMember("command"))return CMD_NONE;Json::Value v=sysParams.get("command",(int)CMD_NONE);if(v.isInt())return (eCommandType)v.asInt();else{log.warn(log.LOGMOSTLY,"getCommand:not integer:'%s'",v.toStyledString().c_str());return CMD_NONE;}}
     void setCommand( enum eCommandType e )                  {if(!bSysParamsExtracted)parseSysParams();sysParams["command"]=(int)e;bSysParamJsonValid=false;}
-    std::string getUrl( )                                   {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("url"))return std::string();return sysParams.get("url",Json::Value()).asString();}
+    std::string getUrl( )                                   {if(!bSysParamsExtracted){std::string v;if(peekString(SECT_SYSPARAMS,"url",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("url"))return std::string();return sysParams.get("url",Json::Value()).asString();}
     void setUrl( const std::string& str )                   {if(!bSysParamsExtracted)parseSysParams();sysParams["url"]=str;bSysParamJsonValid=false;}
-    std::string getScriptName( )                            {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("scriptName"))return std::string();return sysParams.get("scriptName",Json::Value()).asString();}
+    std::string getScriptName( )                            {if(!bSysParamsExtracted){std::string v;if(peekString(SECT_SYSPARAMS,"scriptName",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("scriptName"))return std::string();return sysParams.get("scriptName",Json::Value()).asString();}
     void setScriptName( const std::string& str )            {if(!bSysParamsExtracted)parseSysParams();sysParams["scriptName"]=str;bSysParamJsonValid=false;}
-    std::string getResult( )                                {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("result"))return std::string();return sysParams.get("result",Json::Value()).asString();}
+    std::string getResult( )                                {if(!bSysParamsExtracted){std::string v;if(peekString(SECT_SYSPARAMS,"result",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("result"))return std::string();return sysParams.get("result",Json::Value()).asString();}
     void setResult( const std::string& str )                {if(!bSysParamsExtracted)parseSysParams();sysParams["result"]=str;bSysParamJsonValid=false;}
     void setResult( const char* str )                       {if(!bSysParamsExtracted)parseSysParams();sysParams["result"]=str;bSysParamJsonValid=false;}
-    bool isSuccess( )                                       {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("bSuccess"))return false;Json::Value v=sysParams.get("bSuccess",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"isSuccess:not boolean:'%s'",v.toStyledString().c_str());return false;}}
+    bool isSuccess( )                                       {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"bSuccess",v)>=0)return v!=0;parseSysParams();}if(!sysParams.isMember("bSuccess"))return false;Json::Value v=sysParams.get("bSuccess",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"isSuccess:not boolean:'%s'",v.toStyledString().c_str());return false;}}
     void setSuccess( bool b )                               {if(!bSysParamsExtracted)parseSysParams();sysParams["bSuccess"]=(int)b;bSysParamJsonValid=false;}
-    bool getExpectReply( )                                  {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("bExpectReply"))return false;Json::Value v=sysParams.get("bExpectReply",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"getExpectReply:not boolean:'%s'",v.toStyledString().c_str());return false;}}
+    bool getExpectReply( )                                  {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"bExpectReply",v)>=0)return v!=0;parseSysParams();}if(!sysParams.isMember("bExpectReply"))return false;Json::Value v=sysParams.get("bExpectReply",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"getExpectReply:not boolean:'%s'",v.toStyledString().c_str());return false;}}
     void setExpectReply( bool b )                           {if(!bSysParamsExtracted)parseSysParams();sysParams["bExpectReply"]=b;bSysParamJsonValid=false;}
-    std::string getErrorString( )                           {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("errorString"))return std::string();return sysParams.get("errorString",Json::Value()).asString();}
+    std::string getErrorString( )                           {if(!bSysParamsExtracted){std::string v;if(peekString(SECT_SYSPARAMS,"errorString",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("errorString"))return std::string();return sysParams.get("errorString",Json::Value()).asString();}
     void setErrorString( const std::string& str )           {if(!bSysParamsExtracted)parseSysParams();sysParams["errorString"]=str;bSysParamJsonValid=false;}
-    std::string getFailureCause( )                          {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("failureCause"))return std::string();return sysParams.get("failureCause",Json::Value()).asString();}
+    std::string getFailureCause( )                          {if(!bSysParamsExtracted){std::string v;if(peekString(SECT_SYSPARAMS,"failureCause",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("failureCause"))return std::string();return sysParams.get("failureCause",Json::Value()).asString();}
     void setFailureCause( const std::string& str )          {if(!bSysParamsExtracted)parseSysParams();sysParams["failureCause"]=str;bSysParamJsonValid=false;}
-    std::string getSystemParam( )                           {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("systemParam"))return std::string();return sysParams.get("systemParam",Json::Value()).asString();}
+    std::string getSystemParam( )                           {if(!bSysParamsExtracted){std::string v;if(peekString(SECT_SYSPARAMS,"systemParam",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("systemParam"))return std::string();return sysParams.get("systemParam",Json::Value()).asString();}
     void setSystemParam( const std::string& str )           {if(!bSysParamsExtracted)parseSysParams();sysParams["systemParam"]=str;bSysParamJsonValid=false;}
     void setElapsedTime( unsigned int theTime )             {if(!bSysParamsExtracted)parseSysParams();sysParams["elapsedTime"]=theTime;bSysParamJsonValid=false;}
     unsigned int getElapsedTime( )                          {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("bStandardResponse"))return 0;Json::Value v=sysParams.get("bStandardResponse",0);if(v.isUInt())return v.asUInt();else{log.warn(log.LOGMOSTLY,"getElapsedTime:not unsigned int:'%s'",v.toStyledString().c_str());return 0;}}
     void setRecoveryEvent( bool b )                         {if(!bSysParamsExtracted)parseSysParams();sysParams["bGeneratedRecoveryEvent"]=b;bSysParamJsonValid=false;}
-    bool getRecoveryEvent( )                                {if(!bSysParamsExtracted)parseSysParams();if(!sysParams.isMember("bGeneratedRecoveryEvent"))return false;Json::Value v=sysParams.get("bGeneratedRecoveryEvent",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"getRecoveryEvent:not boolean:'%s'",v.toStyledString().c_str());return false;}}
+    void setPerlCache( int c )                              {if(!bSysParamsExtracted)parseSysParams();sysParams["perlCache"]=c;bSysParamJsonValid=false;}
+    int  getPerlCache( )                                    {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"perlCache",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("perlCache"))return 0;Json::Value v=sysParams.get("perlCache",0);if(v.isInt())return v.asInt();else{log.warn(log.LOGMOSTLY,"getPerlCache:not integer:'%s'",v.toStyledString().c_str());return 0;}}
+    void setSpawnUs( int us )                               {if(!bSysParamsExtracted)parseSysParams();sysParams["spawnUs"]=us;bSysParamJsonValid=false;}
+    int  getSpawnUs( )                                      {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"spawnUs",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("spawnUs"))return 0;Json::Value v=sysParams.get("spawnUs",0);if(v.isInt())return v.asInt();else{log.warn(log.LOGMOSTLY,"getSpawnUs:not integer:'%s'",v.toStyledString().c_str());return 0;}}
+    void setPipelineRef( unsigned int ref )                 {if(!bSysParamsExtracted)parseSysParams();sysParams["pipelineRef"]=ref;bSysParamJsonValid=false;}
+    unsigned int getPipelineRef( )                          {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"pipelineRef",v)>=0)return v;parseSysParams();}if(!sysParams.isMember("pipelineRef"))return 0;Json::Value v=sysParams.get("pipelineRef",0);if(v.isUInt())return v.asUInt();else{log.warn(log.LOGMOSTLY,"getPipelineRef:not integer:'%s'",v.toStyledString().c_str());return 0;}}
+    bool getRecoveryEvent( )                                {if(!bSysParamsExtracted){int v=0;if(peekInt(SECT_SYSPARAMS,"bGeneratedRecoveryEvent",v)>=0)return v!=0;parseSysParams();}if(!sysParams.isMember("bGeneratedRecoveryEvent"))return false;Json::Value v=sysParams.get("bGeneratedRecoveryEvent",true);if(v.isInt())return (v.asInt()==0)?false:true;else{log.warn(log.LOGMOSTLY,"getRecoveryEvent:not boolean:'%s'",v.toStyledString().c_str());return false;}}
 
     // execParams
     // named parameters
@@ -181,12 +234,12 @@ class baseEvent : public object
     void addParamAsStr( const char* name, unsigned value )            {if(!bExecParamsExtracted)parseExecParams();char s[64];sprintf(s,"%u",value);execParams[name]=s;bExecParamJsonValid=false;}
     void addParamAsStr( const char* name, long value )                {if(!bExecParamsExtracted)parseExecParams();char s[64];sprintf(s,"%ld",value);execParams[name]=s;bExecParamJsonValid=false;}
     void addParamAsStr( const char* name, int value )                 {if(!bExecParamsExtracted)parseExecParams();char s[64];sprintf(s,"%d",value);execParams[name]=s;bExecParamJsonValid=false;}
-    std::string getParam( const char* name )                          {if(!bExecParamsExtracted)parseExecParams();if(!execParams.isMember(name))return std::string();Json::Value v=execParams.get(name,Json::Value());if(v.isString())return v.asString();else throw Exception(log,log.WARN,"getParam: unable to convert to string name:'%s' val:'%s'",name,v.toStyledString().c_str());}
-    bool getParam( const char* name, std::string& value )             {if(!bExecParamsExtracted)parseExecParams();if(!execParams.isMember(name))return false;Json::Value v=execParams.get(name,Json::Value());if(v.isString()){value=v.asString();return true;}else throw Exception(log,log.WARN,"getParam: unable to convert to string name:'%s' val:'%s'",name,v.toStyledString().c_str());}
-    int  getParamAsInt( const char* name )                            {if(!bExecParamsExtracted)parseExecParams();if(!execParams.isMember(name))return 0;Json::Value v=execParams.get(name,Json::Value());if(v.isInt())return v.asInt();if(v.isUInt())return v.asUInt();else throw Exception(log,log.WARN,"getParam: unable to convert to int name:'%s' val:'%s'",name,v.toStyledString().c_str());}
-    unsigned int  getParamAsUInt( const char* name )                  {if(!bExecParamsExtracted)parseExecParams();if(!execParams.isMember(name))return 0;Json::Value v=execParams.get(name,Json::Value());if(v.isUInt())return v.asUInt();if(v.isInt())return v.asInt();else throw Exception(log,log.WARN,"getParam: unable to convert to uint name:'%s' val:'%s'",name,v.toStyledString().c_str());}
+    std::string getParam( const char* name )                          {if(!bExecParamsExtracted){std::string v;if(peekString(SECT_EXECPARAMS,name,v)>=0)return v;parseExecParams();}if(!execParams.isMember(name))return std::string();Json::Value v=execParams.get(name,Json::Value());if(v.isString())return v.asString();else throw Exception(log,log.WARN,"getParam: unable to convert to string name:'%s' val:'%s'",name,v.toStyledString().c_str());}
+    bool getParam( const char* name, std::string& value )             {if(!bExecParamsExtracted){int r=peekString(SECT_EXECPARAMS,name,value);if(r>=0)return r==1;parseExecParams();}if(!execParams.isMember(name))return false;Json::Value v=execParams.get(name,Json::Value());if(v.isString()){value=v.asString();return true;}else throw Exception(log,log.WARN,"getParam: unable to convert to string name:'%s' val:'%s'",name,v.toStyledString().c_str());}
+    int  getParamAsInt( const char* name )                            {if(!bExecParamsExtracted){int v=0;if(peekInt(SECT_EXECPARAMS,name,v)>=0)return v;parseExecParams();}if(!execParams.isMember(name))return 0;Json::Value v=execParams.get(name,Json::Value());if(v.isInt())return v.asInt();if(v.isUInt())return v.asUInt();else throw Exception(log,log.WARN,"getParam: unable to convert to int name:'%s' val:'%s'",name,v.toStyledString().c_str());}
+    unsigned int  getParamAsUInt( const char* name )                  {if(!bExecParamsExtracted){unsigned int v=0;if(peekUInt(SECT_EXECPARAMS,name,v)>=0)return v;parseExecParams();}if(!execParams.isMember(name))return 0;Json::Value v=execParams.get(name,Json::Value());if(v.isUInt())return v.asUInt();if(v.isInt())return v.asInt();else throw Exception(log,log.WARN,"getParam: unable to convert to uint name:'%s' val:'%s'",name,v.toStyledString().c_str());}
     bool existsParam( const char* name )                              {if(!bExecParamsExtracted)parseExecParams();return execParams.isMember(name);}
-    void deleteParam( const char* name )                              {if(!bExecParamsExtracted)parseExecParams();execParams.removeMember(name);}
+    void deleteParam( const char* name )                              {if(!bExecParamsExtracted)parseExecParams();execParams.removeMember(name);bExecParamJsonValid=false;}
     Json::ValueConstIterator paramBegin( )                            {if(!bExecParamsExtracted)parseExecParams();return execParamsConst.begin();}
     Json::ValueConstIterator paramEnd( )                              {if(!bExecParamsExtracted)parseExecParams();return execParamsConst.end();}
 
@@ -195,6 +248,7 @@ class baseEvent : public object
     void addScriptParam( unsigned s )                                 {if(!bExecParamsExtracted)parseExecParams();execParams.append(s);bExecParamJsonValid=false;}
     void addScriptParam( int s )                                      {if(!bExecParamsExtracted)parseExecParams();execParams.append(s);bExecParamJsonValid=false;}
     void addScriptParam( float s )                                    {if(!bExecParamsExtracted)parseExecParams();execParams.append(s);bExecParamJsonValid=false;}
+    void mergeScriptParams( baseEvent* pOther );
     unsigned int scriptParamSize( )                                   {if(!bExecParamsExtracted)parseExecParams();return execParams.size();}
     std::string getScriptParam( int i )                               {if(!bExecParamsExtracted)parseExecParams();if(!execParams.isValidIndex(i))return std::string();if(execParams[i].isString())return execParams[i].asString();else throw Exception(log,log.WARN,"getScriptParam:parameters have to be strings at index:%d :'%s'",i,toString().c_str());}
     const char* getScriptParamAsCStr( int i )                         {if(!bExecParamsExtracted)parseExecParams();if(!execParams.isValidIndex(i))return NULL;if(execParams[i].isString())return execParams[i].asCString();else throw Exception(log,log.WARN,"getScriptParam:C parameters have to be strings at index:%d :'%s'",i,toString().c_str());}
@@ -207,21 +261,56 @@ class baseEvent : public object
     void expire()                                                     {bExpired=true;}
     unsigned int getQueueTime( )                                      {return queueTime;}
     void setQueueTime( unsigned int t )                               {queueTime=t;}
-    unsigned int getReadyTime( )                                      {return readyTime;}
-    void setReadyTime( unsigned int s )                               {readyTime = s;}
 
     // serialisation support
+    void setSectionEncoding( eSectionType t )                         {sectionEncoding=t;}
+    eSectionType getSectionEncoding( )                                {return sectionEncoding;}
     virtual int serialise( int fd, eFdType fdType=FD_SOCKET );
     virtual std::string& serialiseToString( );
     std::string& getStrSerialised( )                                  {return strSerialised;}
     int serialiseNonBlock( int fd, eFdType fdType=FD_SOCKET );
+    unsigned int getBytesSerialised( )                                {return bytesSerialised;}
+    void abandonSerialise( )                                          {bytesSerialised=0;}
+    int buildIovec( struct iovec* iov );
     int serialiseToFile( int fd );
     static baseEvent* unSerialise( unixSocket *fd );
     static baseEvent* unSerialiseFromFile( const char* fn );
     static baseEvent* unSerialiseFromString( const std::string& packet );
+    static baseEvent* unSerialiseFromFrame( const char* frame, int frameLen );
+
+    // pooled allocation - events are reset and reused rather than destructed
+    // an acquired event may also be deleted; release accepts any heap allocated event
+    static baseEvent* acquire( eEventType type=EV_UNKNOWN, const char* queue=NULL );
+    static void release( baseEvent* pEvent );
+    static void clearPool( );
+    static unsigned int getPoolSize( )                                {return eventPool.size();}
+    static void encodeBinary( const Json::Value& v, std::string& out );
+    static bool decodeBinary( const char*& p, const char* end, Json::Value& v, int depth=0 );
 
   private:
-    void parseBody( const char* body );
+    void reset( );
+    void parseFrame( const char* frame, int frameLen );
+    void parseBody( const char* body, int bodyLen=0, bool bRaw=false );
+    int buildFrameHeader( );
+    void logSerialiseFailure( );
+    std::string& sectionJson( int i );
+    const char* sectionData( int i );
+    unsigned int sectionSize( int i );
+    std::string sectionText( int i );
+    void encodeSection( int i, const Json::Value& root );
+    bool decodeSection( int i, Json::Value& root );
+    bool indexSection( int i );
+    bool indexJsonSection( int i );
+    bool indexBinarySection( int i );
+    int  findField( int i, const char* key );
+    int  peekInt( int i, const char* key, int& v );
+    int  peekUInt( int i, const char* key, unsigned int& v );
+    int  peekString( int i, const char* key, std::string& v );
+    bool peekInteger( int i, int field, long long& v );
+    static const char* skipJsonString( const char* p, const char* end );
+    static const char* skipJsonValue( const char* p, const char* end );
+    static bool skipBinary( const char*& p, const char* end, int depth=0 );
+    bool isRawFrameValid( );
     void serialisePart1( );
     void parsePart1( );
     void serialisePart2( );
@@ -236,10 +325,31 @@ class baseEvent : public object
     static recoveryLog*             theRecoveryLog;      ///< the recovery log
     static logger                   staticLogger;        ///< class scope logger
 
+  private:
+    static std::vector<baseEvent*>  eventPool;           ///< released events ready for reuse - the processes are single threaded
+
   protected:
     std::string                     strSerialised;        ///< string version of object serialisation
+    char                            frameHeader[FRAME_HEADER_LEN+BLOCK_HEADER_LEN+1]; ///< frame and block headers for scatter-gather serialisation
+    unsigned int                    serialisedLen;        ///< total length of the frame last described by buildIovec
+    unsigned int                    bytesSerialised;      ///< bytes of the frame written so far by serialiseNonBlock
+    eSectionType                    sectionEncoding;      ///< encoding used to serialise - SECTION_JSON unless the peer is known to understand SECTION_BINARY; not taken over from a received frame
 
   private:
+    std::string                     rawFrame;             ///< frame as received from a socket - written out verbatim while no section has changed
+    bool                            bSectionRaw[NUM_SECTIONS]; ///< true while the section's json is still the text in rawFrame rather than in its jsonXXX string
+    unsigned int                    rawSectionOffset[NUM_SECTIONS]; ///< offset of the section in rawFrame
+    unsigned int                    rawSectionLen[NUM_SECTIONS];    ///< length of the section in rawFrame
+    eSectionType                    sectionType[NUM_SECTIONS];      ///< encoding of the section as held in rawFrame or its jsonXXX string
+    struct tSectionField
+    {
+      unsigned int                  keyOffset;            ///< offset of the key (without quotes) in the section
+      unsigned int                  keyLen;
+      unsigned int                  valueOffset;          ///< offset of the value in the section
+      unsigned int                  valueLen;
+    };
+    int                             indexState[NUM_SECTIONS];       ///< 0 not indexed, 1 sectionIndex is valid, -1 the section cannot be indexed (not an object, escaped keys)
+    std::vector<tSectionField>      sectionIndex[NUM_SECTIONS];     ///< top level keys of an unextracted section
     bool                            bPart1Extracted;      ///< part 1 extracted from json
     bool                            bPart1JsonValid;      ///< true if jsonPart1 is a valid representation - ie the values have not changed
     std::string                     jsonPart1;            ///< json representation of part1
@@ -255,6 +365,9 @@ class baseEvent : public object
     std::string                     traceTimestamp;       ///< the trace timestamp to be used for subsequent logging entries
     unsigned int                    expiryTime;           ///< absolute expiry time in seconds since Jan 1970 or 0
     int                             lifetime;             ///< requested lifetime of the object in seconds - -1 if not applicable
+    unsigned int                    readyTime;            ///< time at which the object will be ready for execution - only used by the delay queue - 0 means it is ready for immediate execution, on submission this represents an offset to the current time on the server
+    int                             priority;             ///< priority level on a priority queue - higher is more urgent - -1 if not set
+    std::string                     coalesceKey;          ///< events with the same key are collapsed while queued on a queue that coalesces - empty if not set
     int                             retries;              ///< number of retries to process
     int                             workerPid;            ///< worker pid - in the case where the event is destined for a particular worker in the pool
 
@@ -270,7 +383,6 @@ class baseEvent : public object
 
     // non archived properties
     unsigned int                    queueTime;            ///< time at which the event was placed in the queue - to be used to calculate queuing times
-    unsigned int                    readyTime;            ///< time at which the object will be ready for execution - only used by the delay queue - 0 means it is ready for immediate execution, on submission this represents an offset to the current time on the server
     bool                            bExpired;             ///< event is expired and has been handled as such
     std::string                     mainQueue;            ///< main queue name seperated out of destQueue
     unsigned int                    subQueue;             ///< sub queue id seperated out of destQueue
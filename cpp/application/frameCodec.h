@@ -0,0 +1,143 @@
+/**
+ frameCodec - fixed width encoder / decoder for the frame and block headers
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ replaces the sprintf / sscanf formatting of the protocol v3.0 headers:
+   frame header '#frameNewframe#v3.0:%06u\n' - the payload length
+   block header '%02u,%1u,%06u,%1u,%06u,%1u,%06u,%1u,%06u\n' - the number of sections followed
+   by a type and size per section
+ the layout is derived at compile time from the field widths and checked against the
+ lengths the other language bindings hardcode (27 and 39).  Decoding is strict - every field
+ must have exactly its width in digits - and stops at the first mismatch so it never reads
+ past the terminator of a shorter null terminated string
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ */
+
+#if !defined( frameCodec_defined_ )
+#define frameCodec_defined_
+
+#include <string.h>
+
+#define FRAME_CODEC_MARKER "#frameNewframe#v3.0:"
+
+/** largest value that fits in n decimal digits **/
+constexpr unsigned frameCodecMaxForDigits( int n )          {return (n==0)?0:frameCodecMaxForDigits(n-1)*10+9;}
+
+class frameCodec
+{
+  // Definitions
+  public:
+    static const int FRAME_MARKER_LEN = sizeof( FRAME_CODEC_MARKER )-1;
+    static const int LEN_DIGITS = 6;            // payload length and section sizes
+    static const int NUM_SECTIONS_DIGITS = 2;
+    static const int TYPE_DIGITS = 1;
+    static const int NUM_SECTIONS = 4;
+    static const unsigned MAX_LEN = frameCodecMaxForDigits( LEN_DIGITS );
+    static const int FRAME_HEADER_LEN = FRAME_MARKER_LEN+LEN_DIGITS+1;
+    static const int SECTION_FIELD_LEN = 1+TYPE_DIGITS+1+LEN_DIGITS;   // ',T,nnnnnn'
+    static const int BLOCK_HEADER_LEN = NUM_SECTIONS_DIGITS+NUM_SECTIONS*SECTION_FIELD_LEN+1;
+
+    static_assert( FRAME_HEADER_LEN == 27, "frame header no longer matches the protocol v3.0 wire format" );
+    static_assert( BLOCK_HEADER_LEN == 39, "block header no longer matches the protocol v3.0 wire format" );
+    static_assert( MAX_LEN == 999999, "length fields no longer match the protocol v3.0 wire format" );
+
+    // Methods
+  public:
+    /**
+     * writes the frame header - the caller guarantees payloadLen <= MAX_LEN
+     * @return FRAME_HEADER_LEN
+     * **/
+    static int encodeFrameHeader( char* out, unsigned payloadLen )
+    {
+      memcpy( out, FRAME_CODEC_MARKER, FRAME_MARKER_LEN );
+      putDigits( out+FRAME_MARKER_LEN, payloadLen, LEN_DIGITS );
+      out[FRAME_HEADER_LEN-1] = '\n';
+      return FRAME_HEADER_LEN;
+    } // encodeFrameHeader
+
+    /**
+     * decodes the marker and payload length - the terminating \n is not checked as
+     * the header line read from a file has it stripped
+     * @return true if the header is valid
+     * **/
+    static bool decodeFrameHeader( const char* in, unsigned& payloadLen )
+    {
+      for( int i = 0; i < FRAME_MARKER_LEN; i++ )
+        if( in[i] != FRAME_CODEC_MARKER[i] ) return false;
+      return getDigits( in+FRAME_MARKER_LEN, LEN_DIGITS, payloadLen );
+    } // decodeFrameHeader
+
+    /**
+     * writes the block header - the caller guarantees types < 10 and sizes <= MAX_LEN
+     * @return BLOCK_HEADER_LEN
+     * **/
+    static int encodeBlockHeader( char* out, const unsigned types[NUM_SECTIONS], const unsigned sizes[NUM_SECTIONS] )
+    {
+      putDigits( out, NUM_SECTIONS, NUM_SECTIONS_DIGITS );
+      char* p = out+NUM_SECTIONS_DIGITS;
+      for( int i = 0; i < NUM_SECTIONS; i++ )
+      {
+        *p++ = ',';
+        putDigits( p, types[i], TYPE_DIGITS );
+        p += TYPE_DIGITS;
+        *p++ = ',';
+        putDigits( p, sizes[i], LEN_DIGITS );
+        p += LEN_DIGITS;
+      } // for
+      *p = '\n';
+      return BLOCK_HEADER_LEN;
+    } // encodeBlockHeader
+
+    /**
+     * decodes the block header
+     * @return true if the header is valid - the number of sections is returned as is for the caller to check
+     * **/
+    static bool decodeBlockHeader( const char* in, unsigned& numSections, unsigned types[NUM_SECTIONS], unsigned sizes[NUM_SECTIONS] )
+    {
+      if( !getDigits( in, NUM_SECTIONS_DIGITS, numSections ) ) return false;
+      const char* p = in+NUM_SECTIONS_DIGITS;
+      for( int i = 0; i < NUM_SECTIONS; i++ )
+      {
+        if( *p++ != ',' ) return false;
+        if( !getDigits( p, TYPE_DIGITS, types[i] ) ) return false;
+        p += TYPE_DIGITS;
+        if( *p++ != ',' ) return false;
+        if( !getDigits( p, LEN_DIGITS, sizes[i] ) ) return false;
+        p += LEN_DIGITS;
+      } // for
+      return *p == '\n';
+    } // decodeBlockHeader
+
+  private:
+    static void putDigits( char* p, unsigned v, int width )
+    {
+      for( int i = width-1; i >= 0; i-- )
+      {
+        p[i] = '0'+v%10;
+        v /= 10;
+      } // for
+    } // putDigits
+
+    static bool getDigits( const char* p, int width, unsigned& v )
+    {
+      v = 0;
+      for( int i = 0; i < width; i++ )
+      {
+        unsigned d = (unsigned char)p[i]-'0';
+        if( d > 9 ) return false;
+        v = v*10+d;
+      } // for
+      return true;
+    } // getDigits
+};	// class frameCodec
+
+#endif // !defined( frameCodec_defined_)
@@ -1,11 +1,15 @@
 /**
  recoveryLog - normally used by event to write recovery entries
  
- $Id: recoveryLog.h 2591 2012-09-25 17:43:55Z gerhardus $
+ $Id: recoveryLog.h 2891 2013-06-24 10:17:25Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		01/10/2009		Gerhardus Muller		Script created
+ @version 1.1.0		24/06/2013		Gerhardus Muller		splitting of reOpen into an open/close for worker::closeOpenFileHandles
+ @version 1.2.0		16/10/2026		agent		single copy in application/ - nucleus/recoveryLog.h links to it
 
  @note
+ the implementation in nucleus/recoveryLog.cpp is part of txProc; persistent apps only
+ use writeEntry which appBase implements as a no-op
 
  @todo
  
@@ -34,6 +38,7 @@ class recoveryLog : public object
     virtual ~recoveryLog();
     virtual std::string toString ();
 
+    void close( )                         {if(bStreamOpen){ofs.close();bStreamOpen=false;};}
     void reOpen( );
     static void rotate( const char* baseDir, const std::string& logrotatePath, const std::string& runAsUser, const std::string& logGroup, int logFilesToKeep );
     void writeEntry( baseEvent* theEvent, const char* error, const char* from=NULL, const char* to=NULL );
@@ -41,6 +46,7 @@ class recoveryLog : public object
     bool recover( );
     int getCountRecoveryLines()           {return countRecoveryLines;}
     void resetCountRecoveryLines()        {countRecoveryLines=0;}
+    void writeTestLine( const char* t );
 
   private:
     void processLine( std::string& line );
@@ -62,6 +68,7 @@ class recoveryLog : public object
     int                         countIgnored;   ///< count of lines ignored
     int                         startTime;      ///< start time of the recovery
     int                         dispatcherFd;   ///< file descriptor for dispatcher when doing recovery
+    bool                        bStreamOpen;
     std::fstream                recStream;      ///< recovery stream
     std::ofstream               ofs;            ///< output stream opened on the recovery log
     std::string                 recoveryDir;    ///< directory for recovery files
@@ -35,6 +35,11 @@ collectionQueue.cpp \
 collectionPool.cpp \
 queueManagementEvent.cpp \
 network.cpp \
+delayQueue.cpp \
+batchQueue.cpp \
+spillSegment.cpp \
+sharedPool.cpp \
+perlExec.cpp \
 }
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -10,6 +10,14 @@
  @version 1.3.1		14/05/2012		Gerhardus Muller		fixed unixSocket/TCP connection memory leak
  @version 1.4.0		27/02/2013		Gerhardus Muller		select support / fragmented packets on tcp write
  @version 1.5.0		16/10/2013		Gerhardus Muller		tcp listening on any ip or a specific ip
+ @version 1.6.0		16/10/2026		agent		read ahead on the event source and stream sockets
+ @version 1.7.0		16/10/2026		agent		part written results are continued from the event rather than a copy of the unwritten fragment
+ @version 1.8.0		16/10/2026		agent		EV_BATCH - members are acknowledged with a single aggregate result
+ @version 1.9.0		16/10/2026		agent		a frame that fails no longer strands the frames buffered behind it
+ @version 1.10.0		16/10/2026		agent		CMD_FLOW_CONTROL suspends reading from the connections feeding a saturated queue
+ @version 1.11.0		16/10/2026		agent		events are routed to the nucleus shard that owns the destination queue
+ @version 1.11.1		17/10/2026		agent		a connection blocked on a stopped queue is still polled for a hangup and closed when the peer goes away
+ @version 1.11.2		17/10/2026		agent		events from the nucleus shards arrive on a socket per shard as well as on pRecSock
 
  @note
 
@@ -41,6 +49,9 @@
 #ifndef PLATFORM_MAC 
 #include <sys/prctl.h>
 #endif
+#ifndef POLLRDHUP
+#define POLLRDHUP 0         // a blocked connection is then only closed once the hangup is reported as POLLHUP
+#endif
 
 #include "networkIf/networkIf.h"
 #include "networkIf/optionsNetworkIf.h"
@@ -61,12 +72,13 @@ const int networkIf::UN_TYPE = SOCK_DGRAM;    ///< Unix domain networkIf type -
 /**
  Construction
  @param networkIfFd - unix domain networkIf to submit events to the networkIf - the networkIf reads the [1] side
- @param nucleusFd - file descriptor to talk to the dispatcher
+ @param nucleusFds - file descriptor to talk to each of the dispatcher shards
+ @param nucleusReturnFds - read side of the socket each dispatcher shard writes its results and commands on
  @param theRecoveryLog
  @param theArgc
  @param theArgv
  */
-networkIf::networkIf( int networkIfFd[2], int nucleusFd, int parentFd, recoveryLog* recovery, int theArgc, char* theArgv[] )
+networkIf::networkIf( int networkIfFd[2], const std::vector<int>& nucleusFds, const std::vector<int>& nucleusReturnFds, int parentFd, recoveryLog* recovery, int theArgc, char* theArgv[] )
   : object( "networkIf" )
 {
   pRecSock = NULL;
@@ -80,7 +92,7 @@ networkIf::networkIf( int networkIfFd[2], int nucleusFd, int parentFd, recoveryL
   theRecoveryLog = recovery;
   argc = theArgc;
   argv = theArgv;
-  init( networkIfFd, nucleusFd, parentFd );
+  init( networkIfFd, nucleusFds, nucleusReturnFds, parentFd );
 }	// networkIf
 
 /**
@@ -103,12 +115,15 @@ networkIf::~networkIf()
     {
       log.debug( log.MIDLEVEL, "~networkIf closing fd:%d", it->first );
       delete( it->second->pSocket );
+      if( it->second->pFragmentEvent != NULL ) delete( it->second->pFragmentEvent );
       delete( it->second );
       close( it->first );
     } // for
     tcpFds.erase( tcpFds.begin(), tcpFds.end() );
   } // if
 
+  for( std::map<int,unixSocket*>::iterator itSource = eventSources.begin(); itSource != eventSources.end(); itSource++ )
+    if( itSource->second != pRecSock ) delete itSource->second;
   if( pRecSock != NULL ) delete pRecSock;
   if( pollFd != NULL ) delete[] pollFd;
 
@@ -135,10 +150,11 @@ std::string networkIf::toString( )
 /**
  * init
  * @param networkIfFd - unix domain socket to submit events to the networkIf - the networkIf reads the [1] side
- * @param nucleusFd - file descriptor to talk to the nucleus process
+ * @param nucleusFds - file descriptor to talk to each of the nucleus processes
+ * @param nucleusReturnFds - file descriptor each of the nucleus processes writes its results and commands on
  * @param parentFd - file descriptor to talk to the parent
  * **/
-void networkIf::init( int networkIfFd[2], int nucleusFd, int parentFd )
+void networkIf::init( int networkIfFd[2], const std::vector<int>& nucleusFds, const std::vector<int>& nucleusReturnFds, int parentFd )
 {
   pOptionsNetworkIf = new optionsNetworkIf();
   bool bDone = !pOptionsNetworkIf->parseOptions( argc, argv );
@@ -181,10 +197,22 @@ void networkIf::init( int networkIfFd[2], int nucleusFd, int parentFd )
   pRecSock = new unixSocket( networkIfFd[1], unixSocket::ET_QUEUE_EVENT, false, "networkIfFd1" );
   eventSourceFd = networkIfFd[1];
   fdSendSock = networkIfFd[0];
-  fdNucleusSock = nucleusFd;
+  nucleusShardFds = nucleusFds;
+  fdNucleusSock = nucleusShardFds[0];
   fdParentSock = parentFd;
   pRecSock->setNonblocking( );
-  log.info( log.LOGALWAYS, "init recSock %d, sendSock %d nucleusSock %d", networkIfFd[1], networkIfFd[0], nucleusFd );
+  pRecSock->setReadAhead( true );
+  eventSources[eventSourceFd] = pRecSock;
+  for( unsigned int i = 0; i < nucleusReturnFds.size(); i++ )
+  {
+    char name[32];
+    sprintf( name, "nucleusReturnFd%u", i );
+    unixSocket* pSock = new unixSocket( nucleusReturnFds[i], unixSocket::ET_QUEUE_EVENT, false, name );
+    pSock->setNonblocking( );
+    pSock->setReadAhead( true );
+    eventSources[nucleusReturnFds[i]] = pSock;
+  } // for
+  log.info( log.LOGALWAYS, "init recSock %d, sendSock %d nucleusSock %d shards %d", networkIfFd[1], networkIfFd[0], fdNucleusSock, (int)nucleusShardFds.size() );
   
   // retrieve our hostname
 #if !defined( HOST_NAME_MAX )
@@ -211,6 +239,9 @@ void networkIf::init( int networkIfFd[2], int nucleusFd, int parentFd )
   tConnectData* pConnect = new tConnectData;
   pConnect->pSocket = pSock;
   pConnect->bFragmentData = false;
+  pConnect->pFragmentEvent = NULL;
+  pConnect->batchRemaining = 0;
+  pConnect->batchReplies = 0;
   tcpFds.insert( std::pair<int,tConnectData*>( listenUdpFd, pConnect ) );
   
   // create a Unix domain networkIf
@@ -230,7 +261,7 @@ void networkIf::init( int networkIfFd[2], int nucleusFd, int parentFd )
   log.info( log.LOGALWAYS, "init: TCP listen fd:%d, UDP listen fd:%d, Unix domain fd:%d", listenTcpFd, listenUdpFd, listenUnFd );
   
   // create the data structure for poll and insert the starting fds into it
-  maxNumPollFdEntries = 4 + pOptionsNetworkIf->maxTcpConnections;   // pRecSock, listenTcpFd, listenUnFd, listenUdpFd + simultaneous open TCP / Unix domain connections
+  maxNumPollFdEntries = 3 + eventSources.size() + pOptionsNetworkIf->maxTcpConnections;   // eventSources, listenTcpFd, listenUnFd, listenUdpFd + simultaneous open TCP / Unix domain connections
   pollFd = new struct pollfd[maxNumPollFdEntries];
   memset( pollFd, 0, maxNumPollFdEntries*sizeof(struct pollfd) );
   numPollFdEntries = 0;
@@ -278,11 +309,13 @@ void networkIf::main( )
           // service a unix domain networkIf event from one of the other processes
           if( eventType & POLLIN )
           {
-            if( fd == eventSourceFd )
+            std::map<int,unixSocket*>::iterator itSource = eventSources.find( fd );
+            if( itSource != eventSources.end() )
             {
+              unixSocket* pSourceSock = itSource->second;
               log.debug( log.LOGSELDOM, "about to unserialise" );
               // the event will be deleted at the point of being consumed
-              baseEvent* pEvent = baseEvent::unSerialise( pRecSock );
+              baseEvent* pEvent = baseEvent::unSerialise( pSourceSock );
               while( pEvent != NULL )
               {
                 // generate a structured reference if the event does not have a reference
@@ -316,6 +349,10 @@ void networkIf::main( )
                   {
                     // don't support it at the moment
                   } // if
+                  else if( pEvent->getCommand( ) == baseEvent::CMD_FLOW_CONTROL )
+                  {
+                    flowControl( pEvent );
+                  } // if
                   else if( pEvent->getCommand( ) == baseEvent::CMD_SHUTDOWN )
                   {
                     log.info( log.LOGALWAYS, "main: baseEvent::CMD_SHUTDOWN" );
@@ -349,10 +386,12 @@ void networkIf::main( )
                         } // if
                         else if( ret == 0 )
                         {
-                          // we only had a part write - retrieve the unwritten fragment
+                          // we only had a part write - hang on to the event and continue on POLLOUT
                           // we are not making provision to not overwrite a previous fragment hanging around. there is currently in txProc
                           // no model to produce multiple return packets
-                          pConnect->fragmentData = pEvent->getStrSerialised();
+                          if( pConnect->pFragmentEvent != NULL ) delete pConnect->pFragmentEvent;
+                          pConnect->pFragmentEvent = pEvent;
+                          pEvent = NULL;
                           pConnect->bFragmentData = true;
                           rebuildPollList();
                         } // else if
@@ -365,7 +404,7 @@ void networkIf::main( )
                     else
                       log.warn( log.LOGMOSTLY, "main fd: %d no longer available to write response to", returnFd );
                   } // if
-                  delete pEvent;
+                  if( pEvent != NULL ) delete pEvent;
                 } // if dispatchResultEvent
                 else
                 {
@@ -374,9 +413,9 @@ void networkIf::main( )
                 } // else
 
                 pEvent = NULL;
-                pEvent = baseEvent::unSerialise( pRecSock );
+                pEvent = baseEvent::unSerialise( pSourceSock );
               } // while( pEvent != NULL
-            } // if( fd == eventSourceFd
+            } // if( itSource != eventSources.end()
             else if( fd == listenTcpFd )
             {
               // accept the networkIf and add to the poll structure
@@ -389,9 +428,13 @@ void networkIf::main( )
                   sprintf( name, "tcpFd-%d", newTcpFd );
                   unixSocket* pSock = new unixSocket( newTcpFd, unixSocket::ET_QUEUE_EVENT, false, name );
                   pSock->setNonblocking();
+                  pSock->setReadAhead( true );
                   tConnectData* pConnect = new tConnectData;
                   pConnect->pSocket = pSock;
                   pConnect->bFragmentData = false;
+                  pConnect->pFragmentEvent = NULL;
+                  pConnect->batchRemaining = 0;
+                  pConnect->batchReplies = 0;
                   tcpFds.insert( std::pair<int,tConnectData*>( newTcpFd, pConnect ) );
                   log.info( log.MIDLEVEL, "accepted new tcp fd %d", newTcpFd );
                   writeGreeting( pSock );
@@ -421,9 +464,13 @@ void networkIf::main( )
                   {
                     unixSocket* pSock = new unixSocket( newUnFd, unixSocket::ET_QUEUE_EVENT );
                     pSock->setNonblocking( );
+                    pSock->setReadAhead( true );
                     tConnectData* pConnect = new tConnectData;
                     pConnect->pSocket = pSock;
                     pConnect->bFragmentData = false;
+                    pConnect->pFragmentEvent = NULL;
+                    pConnect->batchRemaining = 0;
+                    pConnect->batchReplies = 0;
                     tcpFds.insert( std::pair<int,tConnectData*>( newUnFd, pConnect ) );
                     log.info( log.MIDLEVEL, "accepted new unix fd %d", newUnFd );
                     writeGreeting( pSock );
@@ -445,7 +492,7 @@ void networkIf::main( )
             else
             {
               dispatchPacket( fd, true );
-            } // else( fd == eventSourceFd
+            } // else( itSource != eventSources.end()
           } // if eventType POLLIN
           else if( eventType & POLLOUT )
           {
@@ -457,24 +504,24 @@ void networkIf::main( )
               tConnectData* pConnect = it->second;
               if( pConnect->bFragmentData )
               {
-                // send the fragment
-                int ret = unixSocket::writeOnce( fd, pConnect->fragmentData, pConnect->pSocket->getPipe() );
-                if( ret < 1 )
+                // continue writing the frame from where it stopped
+                int ret = pConnect->pFragmentEvent->serialiseNonBlock( fd, pConnect->pSocket->getPipe()?baseEvent::FD_PIPE:baseEvent::FD_SOCKET );
+                if( ret == -1 )
                 {
-                  log.warn( log.LOGALWAYS, "main: failed to write fragmentData for fd:%d bytes:%d", fd, pConnect->fragmentData.length() );
+                  log.warn( log.LOGALWAYS, "main: failed to write fragment for fd:%d", fd );
                   closeAndRemoveFd( fd );
                 } // error handling
-                else if( ret < (int)pConnect->fragmentData.length() )
+                else if( ret == 0 )
                 {
                   // we again have a part write
-                  pConnect->fragmentData = pConnect->fragmentData.substr( ret );       // dump the part that has been written
-                  log.debug( log.LOGSELDOM, "main: wrote fragment 1 on fd:%d bytes:%d wrote:%d", fd, pConnect->fragmentData.length(), ret );
+                  log.debug( log.LOGSELDOM, "main: wrote fragment 1 on fd:%d", fd );
                 } // else if
                 else
                 {
-                  log.debug( log.LOGSELDOM, "main: wrote fragment on fd:%d bytes:%d wrote:%d", fd, pConnect->fragmentData.length(), ret );
+                  log.debug( log.LOGSELDOM, "main: wrote fragment on fd:%d", fd );
+                  delete pConnect->pFragmentEvent;
+                  pConnect->pFragmentEvent = NULL;
                   pConnect->bFragmentData = false;
-                  pConnect->fragmentData.clear();
                   rebuildPollList( );
                 } // else
               } // if
@@ -573,137 +620,203 @@ void networkIf::sendUdpPacket( baseEvent* pCommand )
 } // sendUdpPacket
 
 /**
- * reads and then dispatches a packet from a publicly available networkIf (udp or tcp)
+ * reads and then dispatches the packets available on a publicly available networkIf (udp or tcp)
  * closes a networkIf that returns 0 bytes
  * @param fd - to read the packet from
  * @param bWriteReply on networkIf - do not use for datagram networkIfs
  * **/
 void networkIf::dispatchPacket( int fd, bool bWriteReply )
+{
+  std::map<int,tConnectData*>::iterator it;
+  it = tcpFds.find( fd );
+  if( it == tcpFds.end( ) )
+  {
+    log.error( "dispatchPacket: fd %d not found in tcpFds - closing networkIf", fd );
+    close( fd );
+    rebuildPollList( );
+    return;
+  } // if
+
+  // a frame that fails is consumed so the frames buffered behind it are still dispatched
+  // reading stops as soon as the connection is blocked on a stopped queue
+  tConnectData* pConnect = it->second;
+  while( pConnect->blockedQueue.empty() && dispatchFrame( fd, pConnect, bWriteReply ) )
+    ;
+
+  // an eof condition indicates that the networkIf is closed - a blocked connection
+  // still has to dispatch what it has buffered once the queue resumes unless getNextFd
+  // sees the peer hang up first
+  if( pConnect->pSocket->isEof( ) && pConnect->blockedQueue.empty() )
+  {
+    close( fd );
+    delete pConnect->pSocket;
+    if( pConnect->pFragmentEvent != NULL ) delete pConnect->pFragmentEvent;
+    delete pConnect;
+    tcpFds.erase( it );
+    log.info( log.MIDLEVEL, "dispatchPacket closed fd %d", fd );
+    rebuildPollList( );
+  } // if
+} // dispatchPacket
+
+/**
+ * unserialises and dispatches the next event received on a connection
+ * @param fd - the connection
+ * @param pConnect - its connection data
+ * @param bWriteReply on networkIf - do not use for datagram networkIfs
+ * @return true if a frame was consumed, successfully or not; false once a complete frame is not available
+ * **/
+bool networkIf::dispatchFrame( int fd, tConnectData* pConnect, bool bWriteReply )
 {
   baseEvent* pEvent = NULL;
-  unixSocket* pSocket = NULL;
+  unixSocket* pSocket = pConnect->pSocket;
   try
   {
-    std::map<int,tConnectData*>::iterator it;
-    it = tcpFds.find( fd );
-    if( it != tcpFds.end( ) )
+    pEvent = baseEvent::unSerialise( pSocket );
+    if( pEvent == NULL ) return false;
+
+    // add reference and returnFd info if required
+    bool bReplyRequested = false;
+    if( bWriteReply && (pEvent->getType()!=baseEvent::EV_BATCH) )
     {
-      pSocket = it->second->pSocket;
-      pEvent = baseEvent::unSerialise( pSocket );
-      while( pEvent != NULL )
+      int returnFd = pEvent->getReturnFd();
+      if( returnFd == 0 )
       {
-        // add reference and returnFd info if required
-        bool bReplyRequested = false;
-        if( bWriteReply )
-        {
-          int returnFd = pEvent->getReturnFd();
-          if( returnFd == 0 )
-          {
-            pEvent->addReturnRouting( fd, (void*)pSocket );
-            pEvent->addReturnRouting( fdSendSock, (const char*)NULL );
-            bReplyRequested = true;
-          } // if
-          else if( returnFd > 0 )
-          {
-            // assume the existing routing info to be a valid networkIf process fd
-            // add the sendSock fd to get the reply back to networkIf so that it can 
-            // dispatch it
-            pEvent->addReturnRouting( fdSendSock, (const char*)NULL );
-          } // if
-        } // if
-
-        if( pEvent->getType() == baseEvent::EV_COMMAND )
-        {
-          if( log.wouldLog( log.LOGONOCCASION ) )
-            log.debug( log.MIDLEVEL ) << "dispatching command event received on fd " << fd << " :" << pEvent->toString( );
-          else if( log.wouldLog( log.MIDLEVEL ) )
-            log.info( log.MIDLEVEL ) << "dispatching command event received on fd " << fd << " " << pEvent->commandToString();
-
-          if( pEvent->getCommand() == baseEvent::CMD_NUCLEUS_CONF )
-            pEvent->serialise( fdNucleusSock );  // send straight to the dispatcher
-          else if( pEvent->getCommand() == baseEvent::CMD_NETWORKIF_CONF )
-            reconfigure( pEvent );  // process directly
-          else if( pEvent->getCommand()==baseEvent::CMD_MAIN_CONF )
-            pEvent->serialise( fdParentSock );    // send to the main process
-          else if( pEvent->getCommand( )==baseEvent::CMD_PERSISTENT_APP )
-            pEvent->serialise( fdNucleusSock );
-          else
-          { // all other commands including CMD_APP get sent to the main process
-            if( pEvent->getReadyTime() > 0 )
-              pEvent->serialise( fdNucleusSock );
-            else
-              pEvent->serialise( fdParentSock );  // send to the main process
-          } // else
-
-          if( bWriteReply ) printResultToSocket( pSocket, true, bReplyRequested );
-        } // if EV_COMMAND
-        else if(  (pEvent->getType()==baseEvent::EV_URL) ||
-            (pEvent->getType()==baseEvent::EV_SCRIPT) ||
-            (pEvent->getType()==baseEvent::EV_PERL) ||
-            (pEvent->getType()==baseEvent::EV_BIN) ||
-            (pEvent->getType()==baseEvent::EV_RESULT)
-            )
-        {
-          // send to the dispatcher
-          if( log.wouldLog( log.LOGONOCCASION ) )
-            log.debug( log.MIDLEVEL ) << "dispatching event received on fd " << fd << " : " << pEvent->toString( );
-          else if( log.wouldLog( log.MIDLEVEL ) )
-            log.info( log.MIDLEVEL ) << "dispatching event received on fd " << fd << " type: " << pEvent->typeToString();
+        pEvent->addReturnRouting( fd, (void*)pSocket );
+        pEvent->addReturnRouting( fdSendSock, (const char*)NULL );
+        bReplyRequested = true;
+      } // if
+      else if( returnFd > 0 )
+      {
+        // assume the existing routing info to be a valid networkIf process fd
+        // add the sendSock fd to get the reply back to networkIf so that it can 
+        // dispatch it
+        pEvent->addReturnRouting( fdSendSock, (const char*)NULL );
+      } // if
+    } // if
 
-          // send it on its way
+    if( pEvent->getType() == baseEvent::EV_BATCH )
+    {
+      // the members follow as ordinary frames - only the result is deferred
+      if( bWriteReply )
+        startBatch( pConnect, pEvent );
+      else
+        log.warn( log.LOGMOSTLY ) << "dispatchFrame: ignoring EV_BATCH on datagram fd " << fd << " - members are dispatched individually";
+    } // if EV_BATCH
+    else if( pEvent->getType() == baseEvent::EV_COMMAND )
+    {
+      if( log.wouldLog( log.LOGONOCCASION ) )
+        log.debug( log.MIDLEVEL ) << "dispatching command event received on fd " << fd << " :" << pEvent->toString( );
+      else if( log.wouldLog( log.MIDLEVEL ) )
+        log.info( log.MIDLEVEL ) << "dispatching command event received on fd " << fd << " " << pEvent->commandToString();
+
+      if( pEvent->getCommand() == baseEvent::CMD_NUCLEUS_CONF )
+        pEvent->serialise( fdNucleusSock );  // send straight to the dispatcher
+      else if( pEvent->getCommand() == baseEvent::CMD_NETWORKIF_CONF )
+        reconfigure( pEvent );  // process directly
+      else if( pEvent->getCommand()==baseEvent::CMD_MAIN_CONF )
+        pEvent->serialise( fdParentSock );    // send to the main process
+      else if( pEvent->getCommand( )==baseEvent::CMD_PERSISTENT_APP )
+        pEvent->serialise( getNucleusFd( pEvent->getDestQueue() ) );
+      else
+      { // all other commands including CMD_APP get sent to the main process
+        if( pEvent->getReadyTime() > 0 )
           pEvent->serialise( fdNucleusSock );
-          if( bWriteReply ) printResultToSocket( pSocket, true, bReplyRequested );
-        } // if
         else
-        {
-          log.warn( log.LOGALWAYS ) << "main unable to handle event on fd " << fd << " : " << pEvent->toString( );
-          if( bWriteReply ) printResultToSocket( pSocket, false );
-        } // else
-
-        delete pEvent;
-        pEvent = NULL;
-        pEvent = baseEvent::unSerialise( pSocket );
-      } // while
-
-      // an eof condition indicates that the networkIf is closed
-      if( pSocket->isEof( ) )
+          pEvent->serialise( fdParentSock );  // send to the main process
+      } // else
+
+      if( bWriteReply ) recordResult( pConnect, true, bReplyRequested );
+    } // if EV_COMMAND
+    else if(  (pEvent->getType()==baseEvent::EV_URL) ||
+        (pEvent->getType()==baseEvent::EV_SCRIPT) ||
+        (pEvent->getType()==baseEvent::EV_PERL) ||
+        (pEvent->getType()==baseEvent::EV_BIN) ||
+        (pEvent->getType()==baseEvent::EV_RESULT)
+        )
+    {
+      // send to the dispatcher
+      if( log.wouldLog( log.LOGONOCCASION ) )
+        log.debug( log.MIDLEVEL ) << "dispatching event received on fd " << fd << " : " << pEvent->toString( );
+      else if( log.wouldLog( log.MIDLEVEL ) )
+        log.info( log.MIDLEVEL ) << "dispatching event received on fd " << fd << " type: " << pEvent->typeToString();
+
+      // send it on its way - to the shard that owns the queue
+      pEvent->serialise( getNucleusFd( pEvent->getDestQueue() ) );
+      if( bWriteReply ) recordResult( pConnect, true, bReplyRequested );
+
+      // stop reading from a stream connection that feeds a stopped queue
+      if( bWriteReply && !stoppedQueues.empty() && (stoppedQueues.count( pEvent->getDestQueue() ) > 0) )
       {
-        close( fd );
-        delete it->second->pSocket;
-        delete it->second;
-        tcpFds.erase( it );
-        log.info( log.MIDLEVEL, "dispatchPacket closed fd %d", fd );
+        pConnect->blockedQueue = pEvent->getDestQueue();
+        log.info( log.MIDLEVEL, "dispatchFrame: fd %d blocked on queue '%s'", fd, pConnect->blockedQueue.c_str() );
         rebuildPollList( );
       } // if
-      pSocket = NULL;
     } // if
     else
     {
-      log.error( "dispatchPacket: fd %d not found in tcpFds - closing networkIf" );
-      close( fd );
-      rebuildPollList( );
+      log.warn( log.LOGALWAYS ) << "main unable to handle event on fd " << fd << " : " << pEvent->toString( );
+      if( bWriteReply ) recordResult( pConnect, false );
     } // else
+
+    delete pEvent;
+    pEvent = NULL;
   } // try
   catch( Exception e )
   {
     // already logged
     if( pEvent != NULL ) delete pEvent;
     pEvent = NULL;
-    if( (pSocket!=NULL) && bWriteReply ) printResultToSocket( pSocket, false );
+    if( bWriteReply ) recordResult( pConnect, false );
   } // catch
   catch( std::runtime_error e )
   { // json-cpp throws runtime_error
     if( pEvent != NULL )
     {
-      log.error() << "dispatchPacket: caught std::runtime_error:'" << e.what() << "' event:" << pEvent->toString();
+      log.error() << "dispatchFrame: caught std::runtime_error:'" << e.what() << "' event:" << pEvent->toString();
       delete pEvent;
     } // if
     else
-      log.error( "dispatchPacket: caught std::runtime_error:'%s'", e.what() );
+      log.error( "dispatchFrame: caught std::runtime_error:'%s'", e.what() );
     pEvent = NULL;
-    if( (pSocket!=NULL) && bWriteReply ) printResultToSocket( pSocket, false );
+    if( bWriteReply ) recordResult( pConnect, false );
   } // catch
-} // dispatchPacket
+  return !pSocket->isEof( );
+} // dispatchFrame
+
+/**
+ * handles a CMD_FLOW_CONTROL from the nucleus - on resume the connections blocked on the
+ * queue dispatch the frames they have buffered and are polled for input again
+ * @param pCommand - params queue and stop (1 to stop, 0 to resume)
+ * **/
+void networkIf::flowControl( baseEvent* pCommand )
+{
+  std::string queue = pCommand->getParam( "queue" );
+  bool bStop = (pCommand->getParamAsInt( "stop" ) != 0);
+  if( bStop )
+  {
+    stoppedQueues.insert( queue );
+    log.warn( log.LOGMOSTLY, "flowControl: queue '%s' stopped", queue.c_str() );
+    return;
+  } // if
+
+  stoppedQueues.erase( queue );
+  std::vector<int> resumeFds;
+  std::map<int,tConnectData*>::iterator it;
+  for( it = tcpFds.begin(); it != tcpFds.end(); it++ )
+  {
+    if( it->second->blockedQueue == queue )
+    {
+      it->second->blockedQueue.clear();
+      resumeFds.push_back( it->first );
+    } // if
+  } // for
+  log.warn( log.LOGMOSTLY, "flowControl: queue '%s' resumed - %d connections unblocked", queue.c_str(), (int)resumeFds.size() );
+
+  // dispatchPacket may close the connection or block it again
+  for( unsigned int i = 0; i < resumeFds.size(); i++ )
+    dispatchPacket( resumeFds[i], true );
+  rebuildPollList( );
+} // flowControl
 
 /**
  * write an initial greeting to an external stream networkIf connection
@@ -732,6 +845,79 @@ void networkIf::printResultToSocket( unixSocket* pSocket, bool bSuccess, bool bE
   log.debug( log.LOGONOCCASION, "printResultToSocket: fd:%d parsed:%s reply:%s", pSocket->getSocketFd(), bSuccess?"success":"failure", bExpectReply?"reply":"noreply" );
 } // printResultToSocket
 
+/**
+ * writes the result of an event or adds it to the aggregate result if
+ * the event is a member of a batch
+ * @param pConnect
+ * @param bSuccess - true if success result
+ * @param bExpectReply - true if the event requested a reply
+ * **/
+void networkIf::recordResult( tConnectData* pConnect, bool bSuccess, bool bExpectReply )
+{
+  if( pConnect->batchRemaining == 0 )
+  {
+    printResultToSocket( pConnect->pSocket, bSuccess, bExpectReply );
+    return;
+  } // if
+
+  pConnect->batchResults += bSuccess?'1':'0';
+  if( bExpectReply ) pConnect->batchReplies++;
+  if( --pConnect->batchRemaining == 0 ) printBatchResultToSocket( pConnect );
+} // recordResult
+
+/**
+ * starts collecting results for the members of a batch
+ * a batch that is still open is closed with its missing members marked as failed
+ * @param pConnect
+ * @param pBatch - the EV_BATCH envelope
+ * **/
+void networkIf::startBatch( tConnectData* pConnect, baseEvent* pBatch )
+{
+  if( pConnect->batchRemaining > 0 )
+  {
+    log.warn( log.LOGMOSTLY, "startBatch: fd:%d batch ref:'%s' short by %d events", pConnect->pSocket->getSocketFd(), pConnect->batchRef.c_str(), pConnect->batchRemaining );
+    pConnect->batchResults.append( pConnect->batchRemaining, '0' );
+    pConnect->batchRemaining = 0;
+    printBatchResultToSocket( pConnect );
+  } // if
+
+  int count = pBatch->getParamAsInt( "count" );
+  pConnect->batchRef = pBatch->getRef();
+  pConnect->batchResults.clear();
+  pConnect->batchResults.reserve( (count>0)?count:0 );
+  pConnect->batchReplies = 0;
+  log.debug( log.MIDLEVEL, "startBatch: fd:%d ref:'%s' count:%d", pConnect->pSocket->getSocketFd(), pConnect->batchRef.c_str(), count );
+  if( count > 0 )
+    pConnect->batchRemaining = count;
+  else
+    printBatchResultToSocket( pConnect );
+} // startBatch
+
+/**
+ * writes the aggregate result of a batch
+ * @param pConnect
+ * **/
+void networkIf::printBatchResultToSocket( tConnectData* pConnect )
+{
+  int numFailed = 0;
+  for( std::string::size_type i = 0; i < pConnect->batchResults.length(); i++ )
+    if( pConnect->batchResults[i] != '1' ) numFailed++;
+
+  baseEvent replyPacket( baseEvent::EV_REPLY );
+  replyPacket.setRef( pConnect->batchRef );
+  replyPacket.setSuccess( numFailed == 0 );
+  replyPacket.setExpectReply( pConnect->batchReplies > 0 );
+  replyPacket.addParam( "count", (int)pConnect->batchResults.length() );
+  replyPacket.addParam( "numFailed", numFailed );
+  replyPacket.addParam( "numReplies", pConnect->batchReplies );
+  replyPacket.addParam( "results", pConnect->batchResults );
+  replyPacket.serialise( pConnect->pSocket->getSocketFd() );
+
+  log.debug( log.LOGONOCCASION, "printBatchResultToSocket: fd:%d ref:'%s' count:%d failed:%d replies:%d", pConnect->pSocket->getSocketFd(), pConnect->batchRef.c_str(), (int)pConnect->batchResults.length(), numFailed, pConnect->batchReplies );
+  pConnect->batchResults.clear();
+  pConnect->batchReplies = 0;
+} // printBatchResultToSocket
+
 /**
  * handles a reconfigure command
  * **/
@@ -797,8 +983,9 @@ bool networkIf::waitForEvent( )
  * adds an fd to the pollFd structure
  * @param fd
  * @param bOutAsWell
+ * @param bIn - false for a connection that is blocked on a stopped queue - it is only polled for a hangup
  * **/
-bool networkIf::addFdToPoll( int fd, bool bOutAsWell )
+bool networkIf::addFdToPoll( int fd, bool bOutAsWell, bool bIn )
 {
   if( numPollFdEntries < maxNumPollFdEntries )
   {
@@ -809,7 +996,7 @@ bool networkIf::addFdToPoll( int fd, bool bOutAsWell )
     } // if
 
     pollFd[numPollFdEntries].fd = fd;
-    pollFd[numPollFdEntries++].events = POLLIN | (bOutAsWell?POLLOUT:0);
+    pollFd[numPollFdEntries++].events = (bIn?POLLIN:POLLRDHUP) | (bOutAsWell?POLLOUT:0);
     log.debug( log.LOGONOCCASION, "addFdToPoll: added fd:%d numPollFdEntries:%d maxNumPollFdEntries:%d", fd, numPollFdEntries, maxNumPollFdEntries );
 
     return true;
@@ -832,7 +1019,8 @@ bool networkIf::addFdToPoll( int fd, bool bOutAsWell )
 void networkIf::rebuildPollList( bool bAdding )
 {
   numPollFdEntries = 0;
-  addFdToPoll( eventSourceFd );
+  for( std::map<int,unixSocket*>::iterator itSource = eventSources.begin(); itSource != eventSources.end(); itSource++ )
+    addFdToPoll( itSource->first );
   int numExistingStreamConnections = tcpFds.size()+numPollFdEntries;
   int maxEntriesToAllow = maxNumPollFdEntries-(bAdding?2:1);  // if we are adding the fd is not yet in the array
 
@@ -863,7 +1051,7 @@ void networkIf::rebuildPollList( bool bAdding )
           addFdToPoll( fd );
       } // if
       else
-        addFdToPoll( fd, it->second->bFragmentData );
+        addFdToPoll( fd, it->second->bFragmentData, it->second->blockedQueue.empty() );
     } // if
   } // if
 } // rebuildPollList
@@ -885,11 +1073,15 @@ int networkIf::getNextFd( short& eventType )
       numPollFdsProcessed++;
       return pollFd[lastFdProcessed].fd;
     }
-    else if( pollFd[lastFdProcessed].revents & (POLLERR | POLLHUP | POLLNVAL) )
+    else if( pollFd[lastFdProcessed].revents & (POLLERR | POLLHUP | POLLNVAL | POLLRDHUP) )
     {
-      // some form of error has occurred - remove the fd and close it
+      // some form of error has occurred or a blocked connection hung up - remove the fd and close it
       int fd = pollFd[lastFdProcessed].fd;
-      log.error( "getNextFd: poll returned error on fd %d", fd );
+      std::map<int,tConnectData*>::iterator it = tcpFds.find( fd );
+      if( (it != tcpFds.end()) && !it->second->blockedQueue.empty() )
+        log.warn( log.LOGMOSTLY, "getNextFd: fd %d blocked on queue '%s' hung up - discarding %d buffered bytes", fd, it->second->blockedQueue.c_str(), it->second->pSocket->getRxAvailable() );
+      else
+        log.error( "getNextFd: poll returned error on fd %d", fd );
       closeAndRemoveFd( fd );
     } // else
   } // while
@@ -910,6 +1102,7 @@ void networkIf::closeAndRemoveFd( int fd )
   if( it != tcpFds.end( ) )
   {
     delete it->second->pSocket;
+    if( it->second->pFragmentEvent != NULL ) delete it->second->pFragmentEvent;
     delete it->second;
     tcpFds.erase( it );
   } // if
@@ -1215,3 +1408,12 @@ void networkIf::sigHandler( int signo )
   } // switch
 } // sigHandler
 
+/**
+ * @param queueName - destination queue of an event
+ * @return the fd of the nucleus shard that owns the queue
+ * **/
+int networkIf::getNucleusFd( const std::string& queueName )
+{
+  if( nucleusShardFds.size() < 2 ) return fdNucleusSock;
+  return nucleusShardFds[pOptions->getQueueShard( queueName )];
+} // getNucleusFd
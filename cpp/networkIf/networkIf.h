@@ -4,8 +4,25 @@
  $Id: networkIf.h 2931 2013-10-16 09:47:29Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		11/11/2009		Gerhardus Muller		script created
+ @version 1.1.0		16/10/2026		agent		EV_BATCH - bulk submission with a single aggregate result
+ @version 1.2.0		16/10/2026		agent		flow control - reading is suspended on connections feeding a saturated queue
+ @version 1.3.0		16/10/2026		agent		events are routed to the nucleus shard that owns the destination queue
+ @version 1.3.1		17/10/2026		agent		a blocked connection is polled for a hangup
+ @version 1.3.2		17/10/2026		agent		reads the socket of each nucleus shard next to pRecSock
 
  @note
+ a batch on a stream connection is an EV_BATCH envelope with execParams {"count":N} followed
+ by N ordinary event frames.  The member events are dispatched as usual but the individual
+ results are withheld; once the Nth event has been handled a single EV_REPLY is written carrying
+ the envelope reference, bSuccess (true if all succeeded), bExpectReply (true if any member
+ requested a reply) and execParams count, numFailed, numReplies and results - a string with a
+ '1' or '0' for each member in the order received
+
+ the nucleus sends a CMD_FLOW_CONTROL (params queue, stop) when a queue crosses its high or low
+ watermark.  A stream connection that submits an event to a stopped queue is taken out of the
+ POLLIN set once the event has been forwarded - the frames already read ahead stay buffered - and
+ is dispatched again when the queue resumes.  Datagram sockets cannot be pushed back on and are
+ not affected
 
  @todo
  
@@ -21,14 +38,21 @@
 #include "utils/unixSocket.h"
 #include <sys/socket.h> // macos
 #include <map>
+#include <set>
+#include <vector>
 
 class recoveryLog;
 class baseEvent;
 struct tConnectData
 {
   unixSocket*   pSocket;
-  bool          bFragmentData;                ///< is used infrequently so it makes a little faster than checking for an empty fragmentData
-  std::string   fragmentData;
+  bool          bFragmentData;                ///< is used infrequently so it makes a little faster than checking for pFragmentEvent
+  baseEvent*    pFragmentEvent;               ///< event whose frame has only partially been written - continued on POLLOUT
+  int           batchRemaining;               ///< members of the current EV_BATCH still to be received - 0 if not in a batch
+  int           batchReplies;                 ///< members of the current batch that requested a reply
+  std::string   batchRef;                     ///< reference of the current batch envelope
+  std::string   batchResults;                 ///< '1' / '0' per member received so far
+  std::string   blockedQueue;                 ///< stopped queue the connection is waiting on - reading is suspended while not empty but a hangup still closes it
 };
 
 class networkIf : public object
@@ -40,14 +64,15 @@ class networkIf : public object
 
     // Methods
   public:
-    networkIf( int networkIfFd[2], int nucleusFd, int parentFd, recoveryLog* theRecoveryLog, int theArgc, char* theArgv[] );
+    networkIf( int networkIfFd[2], const std::vector<int>& nucleusFds, const std::vector<int>& nucleusReturnFds, int parentFd, recoveryLog* theRecoveryLog, int theArgc, char* theArgv[] );
     virtual ~networkIf();
     virtual std::string toString ();
     void main( );
     static void sigHandler( int signo );
 
   private:
-    void init( int networkIfFd[2], int nucleusFd, int parentFd );
+    void init( int networkIfFd[2], const std::vector<int>& nucleusFds, const std::vector<int>& nucleusReturnFds, int parentFd );
+    int  getNucleusFd( const std::string& queueName );
     bool dropPriviledge( const char* user );
     void dumpHttp( const std::string& time );
     bool waitForEvent( );
@@ -57,12 +82,17 @@ class networkIf : public object
     int acceptUnSocket( );
     int initServer( int type, const struct sockaddr *addr, socklen_t alen, int qlen=10 );
     void dispatchPacket( int fd, bool bWriteReply=true );
-    bool addFdToPoll( int fd, bool bOutAsWell=false );
+    bool dispatchFrame( int fd, tConnectData* pConnect, bool bWriteReply );
+    bool addFdToPoll( int fd, bool bOutAsWell=false, bool bIn=true );
     void rebuildPollList( bool bAdding=false );
     void closeAndRemoveFd( int fd );
     void sendUdpPacket( baseEvent* pCommand );
     void reconfigure( baseEvent* pCommand );
+    void flowControl( baseEvent* pCommand );
     void printResultToSocket( unixSocket* pSocket, bool bSuccess, bool bExpectReply=false );
+    void recordResult( tConnectData* pConnect, bool bSuccess, bool bExpectReply=false );
+    void startBatch( tConnectData* pConnect, baseEvent* pBatch );
+    void printBatchResultToSocket( tConnectData* pConnect );
     void writeGreeting( unixSocket* pSocket );
 
     // Properties
@@ -81,8 +111,10 @@ class networkIf : public object
     std::string                 eventRef;             ///< current event reference
     unixSocket*                 pRecSock;             ///< networkIf for acception incoming events
     int                         eventSourceFd;        ///< fd corresponding to pRecSock
+    std::map<int,unixSocket*>   eventSources;         ///< pRecSock and the socket each nucleus shard writes its results and commands on
     int                         fdSendSock;           ///< networkIf for sending events to the networkIf process (otherside of pRecSock)
-    int                         fdNucleusSock;        ///< networkIf for submitting events to the dispatcher
+    int                         fdNucleusSock;        ///< networkIf for submitting events to the dispatcher - the first shard
+    std::vector<int>            nucleusShardFds;      ///< networkIf for submitting events to each of the nucleus shards
     int                         fdParentSock;         ///< networkIf for submitting events to the parent mserver
     struct pollfd*              pollFd;               ///< poll fd structure
     int                         maxNumPollFdEntries;  ///< max number of entries in pollFd
@@ -94,6 +126,7 @@ class networkIf : public object
     int                         listenUdpFd;          ///< listen networkIf for udp connections
     int                         listenUnFd;           ///< listen networkIf for Unix domain networkIf connections
     std::map<int,tConnectData*> tcpFds;               ///< map containing the tcp networkIfs we are serving
+    std::set<std::string>       stoppedQueues;        ///< queues the nucleus has asked to stop feeding
     int                         argc;                 ///< command line parameters
     char**                      argv;                 ///< command line parameters
 };	// class networkIf
@@ -5,6 +5,8 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		10/09/2009		Gerhardus Muller		Script created
  @version 1.1.0		20/10/2010		Gerhardus Muller		split per queue logging into its own file
+ @version 1.2.0		16/10/2026		agent		dumped and expired events are returned to the baseEvent pool
+ @version 1.2.1		16/10/2026		agent		dumpList skips the places of events that were expired in place
 
  @note
 
@@ -118,6 +120,7 @@ int baseQueue::dumpList( straightQueueT* pList, const char* reason )
   {
     pEvent = pList->back();
     pList->pop_back();
+    if( pEvent == NULL ) continue;
     numProcessed++;
     if( !pEvent->hasBeenExpired() )
     {
@@ -142,7 +145,7 @@ int baseQueue::dumpList( straightQueueT* pList, const char* reason )
         log.info( log.LOGMOSTLY ) << "dumpQueue: expired event: " << pEvent->toString();
       }
     } // if !hasBeenExpired
-    delete pEvent;
+    baseEvent::release( pEvent );
   } // while( !priorityList.empty
 
   // TODO
@@ -163,7 +166,7 @@ baseEvent* baseQueue::checkIfEventIsExpired( baseEvent* pEvent )
 
   if( pEvent->hasBeenExpired() )
   { // remove and discard
-    delete pEvent;
+    baseEvent::release( pEvent );
     pEvent = NULL;
   } // if hasBeenExpired
   else if( pEvent->isExpired(now) )
@@ -172,7 +175,7 @@ baseEvent* baseQueue::checkIfEventIsExpired( baseEvent* pEvent )
     pEvent->expire();
     numExpiredEvents++;
     log.warn( log.LOGMOSTLY ) << "checkIfEventIsExpired: queue:'" << queueName << "' expired event (queued for " << (now-pEvent->getQueueTime()) << "s lag " << (now-pEvent->getExpiryTime()) << "s): " << pEvent->toString();
-    delete pEvent;
+    baseEvent::release( pEvent );
     pEvent = NULL;
   } // else if
 
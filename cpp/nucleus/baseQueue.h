@@ -4,6 +4,7 @@
  $Id: baseQueue.h 2547 2012-08-30 18:36:42Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		10/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		getQueueLength for flow control
 
  @note
 
@@ -50,6 +51,7 @@ class baseQueue : public object
     virtual baseEvent* checkIfEventIsExpired( baseEvent* pEvent );
     virtual void exitWhenDone( ) = 0;
     virtual void setMaxQueueLen( int m )                    {maxQueueLength=m;}
+    virtual unsigned int getQueueLength( )                  {return 0;}     ///< events held - 0 if the queue does not track it
     virtual void maintenance()                              {;}
     virtual void dumpQueue( const char* reason ) = 0;
     virtual void reopenLogfile( )                           {log.instanceReopenLogfile();}
@@ -1,29 +1,21 @@
 /** @class batchQueue
  Event queue class supporting round robin scheduling across batches of events
- Events are submitted as queueName:key. If the key is omitted it is assumed 0 and put into the main queue.  
- If the key is present a batch with that key is looked for and added to it.
- Batches will be round robin scheduled with a configurable bias towards the main queue
+ Events are submitted as queueName;key. If the key is omitted it is assumed 0.
+ Every key gets its own FIFO and the keys are deficit round robin scheduled with a
+ configurable bias towards key 0 so a single key with a large batch cannot starve the others.
  only integer keys are supported
 
- The scheme is as follows.  Events can be scheduled onto the queue with some 
- identifier following the queue name separated by a colon.  If such an identifier
- is not given the queue behaves exactly the same as the normal baseQueue.  
- If an event is queued with a sub queue id a sub queue is created with this id
- if it does not already exist and it is placed on this queue.  feedWorker behaves
- differently when there are additional queues. The workers now feed from all the 
- available queues in round-robin fashion with a potential bias towards the main queue
- ie the main queue may be sampled 3 times for every once the other queues are. this 
- bias should most likely be quite heavy.
- 
  $Id: batchQueue.cpp 31 2009-09-22 12:27:18Z gerhardus $
- Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
  @version 1.0.0		10/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		rewritten on the nucleus baseQueue as a deficit round robin across keys
 
  @note
+ options (queues.qname.): batchQuantum(1) events per turn for a key, mainQuantum(3) events
+ per turn for key 0, numHotKeys(5) keys reported by getStatus
 
  @todo
- make sure queue0 is seen to be the main queue
- 
+
  @bug
 
 	Copyright Notice
@@ -33,6 +25,7 @@
 #include "nucleus/optionsNucleus.h"
 #include "nucleus/baseEvent.h"
 #include "nucleus/recoveryLog.h"
+#include <algorithm>
 
 const char *const batchQueue::FROM = typeid( batchQueue ).name();
 
@@ -42,7 +35,9 @@ const char *const batchQueue::FROM = typeid( batchQueue ).name();
 batchQueue::batchQueue( tQueueDescriptor* theDescriptor, recoveryLog* theRecoveryLog, bool bRecovery )
   : baseQueue( theDescriptor, theRecoveryLog, bRecovery, "batchQueue" )
 {
-  init();
+  listSize = 0;
+  bExitWhenDone = false;
+  init( theDescriptor );
 } // batchQueue
 
 /**
@@ -50,396 +45,357 @@ batchQueue::batchQueue( tQueueDescriptor* theDescriptor, recoveryLog* theRecover
  * **/
 batchQueue::~batchQueue()
 {
-  log.info( log.MIDLEVEL, "~batchQueue: '%s' %d remaining events", queueName.c_str(), delayList.size() );
+  log.info( log.MIDLEVEL, "~batchQueue: '%s' %u remaining events in %u keys", queueName.c_str(), listSize, (unsigned int)batchMap.size() );
+  for( batchMapIteratorT it = batchMap.begin(); it != batchMap.end(); it++ )
+    delete it->second;
+  for( unsigned int i = 0; i < freeKeys.size(); i++ )
+    delete freeKeys[i];
 } // ~batchQueue
 
 /**
- * init 
+ * init
  * **/
-void batchQueue::init( )
+void batchQueue::init( tQueueDescriptor* theDescriptor )
 {
-  std::string key( optionsKey ); key.append( "numSubQueues" );
-  numSubQueues = pOptionsNucleus->getAsInt( key.c_str(), DEF_NUM_SUBQUEUES );
-  key.assign( baseName ); key.append( "maxEventsInSeqFromMainQueue" );
-  maxEventsFromMainQueue = pOptionsNucleus->getAsInt( key.c_str(), DEF_NUM_EVENTS_IN_SEQ_FROM_MAIN_QUEUE );
-  key.assign( baseName ); key.append( "maxEventsInSeqFromSubQueue" );
-  maxEventsFromSubQueue = pOptionsNucleus->getAsInt( key.c_str(), DEF_NUM_EVENTS_IN_SEQ_FROM_SUB_QUEUE );
-  numTimesReadFromMainQueue = 0;
-  bFeedingFromMainQueue = true;
-  listSize = 0;
-  log.info( log.LOGALWAYS, "init: queue:'%s' maxEventsInSeqFromMainQueue:%d maxEventsInSeqFromSubQueue:%d numSubQueues:%d", queueName.c_str(), maxEventsInSeqFromMainQueue, maxEventsInSeqFromSubQueue, numSubQueues );
+  log.setAddPid( true );
+  std::string key( optionsKey ); key.append( "batchQuantum" );
+  int val = pOptionsNucleus->getAsInt( key.c_str(), DEF_BATCH_QUANTUM );
+  batchQuantum = (val>0)?val:DEF_BATCH_QUANTUM;
+  key.assign( optionsKey ); key.append( "mainQuantum" );
+  val = pOptionsNucleus->getAsInt( key.c_str(), DEF_MAIN_QUANTUM );
+  mainQuantum = (val>0)?val:DEF_MAIN_QUANTUM;
+  key.assign( optionsKey ); key.append( "numHotKeys" );
+  numHotKeys = pOptionsNucleus->getAsInt( key.c_str(), DEF_NUM_HOT_KEYS );
+  if( numHotKeys < 0 ) numHotKeys = 0;
+  resetStats();
+  log.info( log.LOGALWAYS, "init: queue:'%s' maxLength:%d batchQuantum:%u mainQuantum:%u numHotKeys:%d", queueName.c_str(), maxQueueLength, batchQuantum, mainQuantum, numHotKeys );
 } // init
 
 /**
+ * resets the stats
  * **/
-std::string& batchQueue::getStatus( )
+void batchQueue::resetStats( )
 {
-  baseQueue::getStatus();
-//  char str[64];
-//  sprintf( str, "l:%u e:%u", availableQueues.size(), subListSize );
-//  statusStr.append( str );
-  return statusStr;
-} // getStatus
+  baseQueue::resetStats();
+  numKeysCreated = 0;
+  for( batchMapIteratorT it = batchMap.begin(); it != batchMap.end(); it++ )
+    it->second->numDequeued = 0;
+} // resetStats
 
 /**
- * retrieves the next event from a queue to be executed
+ * retrieves the next event from the queue to be executed
+ * @param fd is ignored for the batch queue
  * @return the event or NULL if there are none
  * **/
-baseEvent* batchQueue::popAvailableEvent( )
+baseEvent* batchQueue::popAvailableEvent( int fd )
 {
-  if( listSize == 0 ) return NULL;
-  baseEvent* pEvent = NULL;
+  if( !bExitWhenDone && (listSize==0) ) return NULL;
+
+  // feed persistent apps with end of queue commands so that they can detect the
+  // end of the queue when it is empty
+  if( bExitWhenDone && (listSize==0) )
+  {
+    baseEvent* pCommand = new baseEvent( baseEvent::EV_COMMAND );
+    pCommand->setCommand( baseEvent::CMD_END_OF_QUEUE );
+    log.info( log.LOGMOSTLY, "popAvailableEvent: generating a CMD_END_OF_QUEUE" );
+    return pCommand;
+  } // if
 
+  baseEvent* pEvent = NULL;
   do
   {
-    if( bFeedingFromMainQueue )
-    {
-      pEvent = getEventFromMainQueue();
-      if( pEvent != NULL )
-      {
-        pEvent = checkIfEventIsExpired( pEvent );
-        // TODO - check if this should not precede the previous - alternatively
-        // the previous should also update the queued stats
-        // updateQueuedStats( pEvent );
-
-        numTimesReadFromMainQueue++;
-        if( numTimesReadFromMainQueue >= maxEventsFromMainQueue )
-        {
-          bFeedingFromMainQueue = false;
-          numTimesReadFromMainQueue = 0;
-        } // if
-      } // if
-      else
-      {
-        bFeedingFromMainQueue = false;
-        numTimesReadFromMainQueue = 0;
-      } // else
-    } // if bFeedingFromMainQueue
-    else
-    {
-      pEvent = getEventFromSubQueue();
-      if( pEvent != NULL )
-      {
-        pEvent = checkIfEventIsExpired( pEvent );
-        // TODO - check if this should not precede the previous - alternatively
-        // the previous should also update the queued stats
-        // updateQueuedStats( pEvent );
-
-        numTimesReadFromSubQueue++;
-        if( numTimesReadFromSubQueue >= maxEventsFromSubQueue )
-        {
-          bFeedingFromMainQueue = true;
-          numTimesReadFromSubQueue = 0;
-        } // if
-      } // if
-      else
-      {
-        bFeedingFromMainQueue = true;
-        numTimesReadFromSubQueue = 0;
-      } // else
-    } // else bFeedingFromMainQueue
+    pEvent = popEvent();
+    pEvent = checkIfEventIsExpired( pEvent );
   } while( (pEvent == NULL) && (listSize > 0) );
 
-  // updateQueuedStats( pEvent );
-  if( pEvent == NULL ) log.info( log.MIDLEVEL, "popAvailableEvent: queue:'%s' only had expired events", queueName.c_str() );
+  if( pEvent == NULL )
+    log.info( log.MIDLEVEL, "popAvailableEvent: queue:'%s' only had expired events", queueName.c_str() );
+  else
+    log.info( log.MIDLEVEL, "popAvailableEvent: qlen:%u keys:%u", listSize, (unsigned int)activeKeys.size() );
   return pEvent;
 } // popAvailableEvent
 
 /**
- * pops a single event from the eventList
- * @param the queue from which to retrieve
- * @return the next event on the queue or NULL
+ * pops an event from the key whose turn it is - the key starts its turn with its quantum
+ * and moves to the end of the ring once the quantum is used up
+ * @return the next event or NULL
  * **/
-baseEvent* batchQueue::popEvent( straightQueueT* theQueue )
+baseEvent* batchQueue::popEvent( )
 {
-  if( theQueue->empty() ) return NULL;
-  baseEvent* pEvent = theQueue->back();
-  theQueue->pop_back();
-  listSize--;
-  return pEvent;
-} // popEvent
-
-/**
- * drop a queue - assume it is already removed from commonQueue or batchOnlyQueue
- * it either contained a single event and was still in commonQueue or it contains
- * multiple events and was in batchOnlyQueue
- * @exception on error
- * **/
-void batchQueue::dropQueue( straightQueueT* pQueue, bool bDropMapLookup, bool bDropMap )
-{
-  try
+  // keys whose events all expired are reclaimed once they reach the head of the ring
+  while( !activeKeys.empty() && (activeKeys.back()->listSize == 0) )
   {
-    unsigned int key = getKeyForQueue( pQueue );
-    key = it->second;
-    if( bDropMapLookup )
-      batchMapLookup.erase( it );
-
-    if( bDropMap )
-    {
-      batchMapIteratorT it1;
-      it1 = batchMap.find( key );
-      if( it1 != batchMap.end() )
-        batchMap.erase( it1 );
-      else
-        log.error( "dropQueue: queue:%p key:%d failed to find in batchMap", pQueue, key );
-    } // if bDropMap
-    log.info( log.LOGNORMAL, "dropQueue: queue:%p bDropMapLookup:%d bDropMap:%d", pQueue, bDropMapLookup, bDropMap );
-  } // try
-  catch( Exception e )
-  {
-    log.error( "dropQueue: failed for queue:%p", pQueue );
-  } // catch
-} // dropQueue
-
-/**
- * get the next event from the main queue
- * @return the event or NULL if empty
- * **/
-baseEvent* batchQueue::getEventFromMainQueue( )
-{
-  baseEvent* pEvent = NULL;
+    reclaimKey( activeKeys.back() );
+    activeKeys.pop_back();
+  } // while
+  if( activeKeys.empty() ) return NULL;
+  tBatchKey* pKey = activeKeys.back();
+  if( pKey->deficit == 0 ) pKey->deficit = (pKey->key==0)?mainQuantum:batchQuantum;
+
+  baseEvent* pEvent = pKey->eventList.back();
+  pKey->eventList.pop_back();
+  pKey->backSeq++;
+  pKey->listSize--;
+  pKey->deficit--;
+  pKey->numDequeued++;
+  listSize--;
 
-  // the easy case is if mainQueue is not empty
-  // mainQueue only ever has events if these got removed from commonQueue
-  // in an attempt to find new candidates for batchOnlyQueue
-  if( !mainQueue.empty() )
+  if( pKey->listSize == 0 )
   {
-    pEvent = popEvent( &mainQueue );
-    return pEvent;
+    activeKeys.pop_back();
+    reclaimKey( pKey );
   } // if
-  
-  // we now pop events from the common queue if there are any.
-  // the first single event (single event in a batch queue) will be returned.
-  // all multi-event batches encountered before the first single event queue will
-  // be stuck into the batchOnlyQueue
-  if( commonQueue.empty() ) return NULL;
-  while( (pEvent==NULL) && !commonQueue.empty() )
+  else
   {
-    straightQueueT* pQueue = commonQueue.back();
-    commonQueue.pop_back();
-    unsigned int key = getKeyForQueue( pQueue );
-
-    // all queues should contain 1 or more events
-    if( (pQueue.size()==1) || (key==0) )
+    trimKey( pKey );
+    if( pKey->deficit == 0 )
     {
-      // retrieve the singular event (or multiple events if queue 0) and drop the queue
-      pEvent = popEvent( pQueue );
-      // queue 0 is the main queue and could have a number of events associated with it
-      if( !pQueue->empty() )
-      {
-        while( !pQueue->empty() )
-        {
-          baseEvent* pEvent1;
-          pEvent1 = popEvent( pQueue );
-          mainQueue.push_front( pEvent1 );
-        } // while
-      } // if
-      dropQueue( pQueue, true, true );
-      delete pQueue;
+      activeKeys.pop_back();
+      activeKeys.push_front( pKey );
     } // if
-    else
-    {
-      // place on the batch only queue
-      batchOnlyQueue.push_front( pQueue );
-    } // else
-  } // while
+  } // else
+  if( listSize == 0 ) clearExpiryIndex();
   return pEvent;
-} // getEventFromMainQueue
+} // popEvent
 
 /**
- * get the next event from the sub queues
- * @return the event or NULL if empty
+ * finds the key or creates it at the end of the ring - a new key waits its turn
+ * @param key
+ * @return the key descriptor
  * **/
-baseEvent* batchQueue::getEventFromSubQueue( )
+tBatchKey* batchQueue::findOrCreateKey( unsigned int key )
 {
-  baseEvent* pEvent = NULL;
+  batchMapIteratorT it = batchMap.find( key );
+  if( it != batchMap.end() ) return it->second;
 
-  // make sure we run the configured number of round-robin queues if possible
-  while( (subQueues.size()<numSubQueues) && (!batchOnlyQueue.empty()||!commonQueue.empty()) )
+  tBatchKey* pKey;
+  if( !freeKeys.empty() )
   {
-    // if there are batch queues in the batchOnlyQueue retrieve from here
-    if( !batchOnlyQueue.empty() )
-    {
-      straightQueueT* pQueue = batchOnlyQueue.back();
-      batchOnlyQueue.pop_back();
-      subQueues.push_front( pQueue );
-    } // if
-    else
-    {
-      straightQueueT* pQueue = commonQueue.back();
-      commonQueue.pop_back();
-      unsigned int key = getKeyForQueue( pQueue );
-      if( (pQueue.size()>1) && (key!=0) )
-      {
-        // place into the sub queues list
-        subQueues.push_front( pQueue );
-      } // if
-      else
-      {
-        // transfer the contents of the queue to the main queue
-        while( !pQueue->empty() )
-        {
-          baseEvent* pEvent1;
-          pEvent1 = popEvent( pQueue );
-          mainQueue.push_front( pEvent1 );
-        } // while
-        dropQueue( pQueue, true, true );
-        delete pQueue;
-      } // else
-    } // else
-  } // while subQueues.size()
-
-  if( subQueues.empty() )
-    return NULL;
-
-  // grab the next subqueue
-  straightQueueT* pQueue = subQueues.back();
-  subQueues.pop_back();
-
-  // retrieve an event
-  pEvent = popEvent( pQueue );
-
-  // place the queue on the back of the subQueues queue again
-  if( !pQueue.empty() )
-  {
-    subQueues.push_front( pQueue );
+    pKey = freeKeys.back();
+    freeKeys.pop_back();
   } // if
   else
   {
-    log.info( log.LOGNORMAL, "getEventFromSubQueue: deleting queue:%p", pQueue );
-    dropQueue( pQueue, true, true );
-    delete pQueue;
+    pKey = new tBatchKey;
+    pKey->generation = 0;
+    pKey->numIndexed = 0;
+    pKey->frontSeq = 0;
   } // else
+  pKey->key = key;
+  pKey->listSize = 0;
+  pKey->deficit = 0;
+  pKey->backSeq = pKey->frontSeq;
+  pKey->numDequeued = 0;
+  batchMap.insert( batchMapPairT(key,pKey) );
+  activeKeys.push_front( pKey );
+  numKeysCreated++;
+  log.debug( log.LOGNORMAL, "findOrCreateKey: queue:'%s' key:%u keys:%u", queueName.c_str(), key, (unsigned int)batchMap.size() );
+  return pKey;
+} // findOrCreateKey
 
-  return pEvent;
-} // getEventFromSubQueue
+/**
+ * removes an empty key from the map and keeps the descriptor for reuse - the caller has
+ * already taken it off the ring.  A descriptor the expiry index still points at is always kept
+ * **/
+void batchQueue::reclaimKey( tBatchKey* pKey )
+{
+  batchMap.erase( pKey->key );
+  pKey->eventList.clear();
+  pKey->generation++;
+  if( (freeKeys.size() < MAX_FREE_KEYS) || (pKey->numIndexed > 0) )
+    freeKeys.push_back( pKey );
+  else
+    delete pKey;
+} // reclaimKey
+
+/**
+ * drops the places of expired events from the back of a key
+ * **/
+void batchQueue::trimKey( tBatchKey* pKey )
+{
+  while( !pKey->eventList.empty() && (pKey->eventList.back() == NULL) )
+  {
+    pKey->eventList.pop_back();
+    pKey->backSeq++;
+  } // while
+} // trimKey
 
 /**
  * queue a new event
  * **/
 void batchQueue::queueEvent( baseEvent* pEvent )
 {
-  // set the queue time
-  // calculate expiry time if requested
-  pEvent->setQueueTime( now );
-  int lifetime = pEvent->getLifetime( );
-  if( lifetime != -1 )
-    pEvent->setExpiryTime( lifetime + now );
-
   checkQueueOverflow( );
-  unsigned int batchQueueKey = pEvent->getSubQueue();
-
-  // find an existing batchQueue if any
-  straightQueueT* pBatchQueue = findExistingQueue( batchQueueKey );
 
-  // if no existing batchQueue create one and insert it into the map and commonQueue
-  if( pBatchQueue == NULL )
-    pBatchQueue = createBatchQueue( batchQueueKey );
-  
-  // queue the event on the applicable queue
-  pBatchQueue->push_front( pEvent );
+  tBatchKey* pKey = findOrCreateKey( pEvent->getSubQueue() );
+  unsigned long long seq = pKey->frontSeq++;
+  pKey->eventList.push_front( pEvent );
+  pKey->listSize++;
   listSize++;
 
-  log.info( log.MIDLEVEL ) << "queueEvent: queue:'" << queueName << "' qlen:" << listSize << " queued event: " << pEvent->toString( );
+  // index it if it can expire
+  unsigned int expiryTime = pEvent->getExpiryTime();
+  if( expiryTime != 0 )
+  {
+    tBatchExpiryEntry entry;
+    entry.expiryTime = expiryTime;
+    entry.generation = pKey->generation;
+    entry.pKey = pKey;
+    entry.seq = seq;
+    pKey->numIndexed++;
+    expiryIndex.push_back( entry );
+    std::push_heap( expiryIndex.begin(), expiryIndex.end(), expiresLater );
+    if( expiryIndex.size() > 2*(size_t)listSize+1024 ) compactExpiryIndex();
+  } // if
+
+  log.info( log.MIDLEVEL ) << "queueEvent: queue:'" << queueName << "' qlen:" << listSize << " key:" << pKey->key << " klen:" << pKey->listSize << " queued event: " << pEvent->toString( );
 } // queueEvent
 
 /**
- * find the existing batch queue
- * @param key
+ * rebuilds the expiry index with only the entries of events that are still queued
+ * **/
+void batchQueue::compactExpiryIndex( )
+{
+  size_t numEntries = expiryIndex.size();
+  batchExpiryIndexT::iterator it = expiryIndex.begin();
+  batchExpiryIndexT::iterator dest = expiryIndex.begin();
+  for( ; it != expiryIndex.end(); it++ )
+  {
+    tBatchKey* pKey = it->pKey;
+    if( (it->generation == pKey->generation) && (it->seq >= pKey->backSeq) && (pKey->eventList[pKey->frontSeq-1-it->seq] != NULL) )
+      *dest++ = *it;
+    else
+      pKey->numIndexed--;
+  } // for
+  expiryIndex.erase( dest, expiryIndex.end() );
+  std::make_heap( expiryIndex.begin(), expiryIndex.end(), expiresLater );
+  log.debug( log.MIDLEVEL, "compactExpiryIndex: queue:'%s' %u entries reduced to %u", queueName.c_str(), (unsigned int)numEntries, (unsigned int)expiryIndex.size() );
+} // compactExpiryIndex
+
+/**
+ * empties the expiry index
  * **/
-straightQueueT* batchQueue::findExistingQueue( int key )
+void batchQueue::clearExpiryIndex( )
 {
-  straightQueueT* theQueue = NULL;
-  batchMapIteratorT it;
-  it = batchMap.find( key );
-  if( it != batchMap.end() )
-    theQueue = it->second;
-  return theQueue;
-} // findExistingQueue
+  for( batchExpiryIndexT::iterator it = expiryIndex.begin(); it != expiryIndex.end(); it++ )
+    it->pKey->numIndexed--;
+  expiryIndex.clear();
+} // clearExpiryIndex
 
 /**
- * find key for queue
- * @param pQueue
- * @param bThrowOnNotFound
- * @return the key or 0 on not found unless bThrowOnNotFound
- * @exception on not found and bThrowOnNotFound
+ * expires the events whose expiry time has passed - only the expiring events are visited
+ * and they are removed from the queue
  * **/
-unsigned int batchQueue::getKeyForQueue( straightQueueT* pQueue, bool bThrowOnNotFound )
+void batchQueue::scanForExpiredEvents( )
 {
-  unsigned int key = 0;
-  batchMapLookupIteratorT it;
-  it = batchMapLookup.find( pQueue );
-  if( it != batchMapLookup.end() )
+  int numExpired = 0;
+  while( !expiryIndex.empty() && (expiryIndex.front().expiryTime < now) )
   {
-    key = it->second;
-  } // if
-  else
+    tBatchExpiryEntry entry = expiryIndex.front();
+    std::pop_heap( expiryIndex.begin(), expiryIndex.end(), expiresLater );
+    expiryIndex.pop_back();
+    tBatchKey* pKey = entry.pKey;
+    pKey->numIndexed--;
+    if( (entry.generation != pKey->generation) || (entry.seq < pKey->backSeq) ) continue;   // already left the queue
+
+    baseEvent*& pEvent = pKey->eventList[pKey->frontSeq-1-entry.seq];
+    if( (pEvent == NULL) || !pEvent->isExpired(now) ) continue;
+    sendResult( pEvent, false, std::string(), std::string(), std::string(), std::string("expired"), std::string() );
+    pEvent->expire();
+    numExpiredEvents++;
+    numExpired++;
+    log.warn( log.LOGMOSTLY ) << "scanForExpiredEvents: queue '" << queueName << "' key:" << pKey->key << " expired event (queued for " << (now-pEvent->getQueueTime()) << "s lag " << (now-pEvent->getExpiryTime()) << "s): " << pEvent->toString();
+    baseEvent::release( pEvent );
+    pEvent = NULL;
+    pKey->listSize--;
+    listSize--;
+    trimKey( pKey );    // an emptied key stays on the ring until popEvent reaches it
+  } // while
+
+  if( numExpired > 0 )
   {
-    if( bThrowOnNotFound )
-      throw new Exception( log, log.WARN, "getKeyForQueue: key not found for queue:%p", pQueue );
-    else
-      log.warn( log.LOGALWAYS, "getKeyForQueue: key not found for queue:%p", pQueue );
-  } // else
-  return key;
-} // getKeyForQueue
+    if( listSize == 0 ) clearExpiryIndex();
+    log.info( log.MIDLEVEL, "scanForExpiredEvents: queue '%s' expired %d events qlen:%u", queueName.c_str(), numExpired, listSize );
+  } // if
+} // scanForExpiredEvents
 
 /**
- * creates a new batch queue and insert it into the map and commonQueue
- * @param key
+ * dumps the events of a key to the recovery log and reclaims the key
+ * @return the number of events dumped
  * **/
-straightQueueT* batchQueue::createBatchQueue( int key )
+int batchQueue::dumpKey( tBatchKey* pKey, const char* reason )
 {
-  straightQueueT* theQueue = new straightQueueT;
-  commonQueue.push_front( theQueue );
-  batchMap.insert( batchMapPairT(key,theQueue) );
-  batchMapLookup.insert( batchMapLookupPairT(theQueue,key) );
-  return theQueue;
-} // createBatchQueue
+  int numProcessed = dumpList( &pKey->eventList, reason );
+  pKey->listSize = 0;
+  listSize -= numProcessed;
+  reclaimKey( pKey );
+  return numProcessed;
+} // dumpKey
 
 /**
- * checks overflow on queue - if so dump to the recoveryLog
+ * checks overflow on queue - the key with the most events is dumped to the recoveryLog
+ * so that one key flooding the queue does not cost the other keys their events
  * **/
 void batchQueue::checkQueueOverflow()
 {
   if( bRecoveryProcess ) return;  // allow the queue to take all the events for recovery
-  if( listSize > maxQueueLength )
-    dumpList( "overflow" );
+  if( (listSize < maxQueueLength) || activeKeys.empty() ) return;
+
+  batchRingT::iterator hottest = std::min_element( activeKeys.begin(), activeKeys.end(), hasMoreEvents );
+  tBatchKey* pKey = *hottest;
+  activeKeys.erase( hottest );
+  unsigned int key = pKey->key;
+  int numProcessed = dumpKey( pKey, "overflow" );
+  if( listSize == 0 ) clearExpiryIndex();
+  log.warn( log.LOGALWAYS, "checkQueueOverflow: queue '%s' dumped %d events of key %u listSize:%u", queueName.c_str(), numProcessed, key, listSize );
 } // checkQueueOverflow
 
 /**
- * dumps the list to the recovery log
+ * dumps all the keys to the recovery log
  * expired events are not dumped
  * @param reason
  * **/
-void batchQueue::dumpList( const char* reason )
+void batchQueue::dumpQueue( const char* reason )
 {
-  int numProcessed = dumpQueue( &mainQueue, reason );
-
-  while( !subQueues.empty() )
+  int numProcessed = 0;
+  while( !activeKeys.empty() )
   {
-    // grab the next subqueue
-    straightQueueT* pQueue = subQueues.back();
-    subQueues.pop_back();
-    numProcessed += dumpQueue( pQueue, reason );
-
-    log.info( log.LOGNORMAL, "dumpList: deleting queue:%p", pQueue );
-    dropQueue( pQueue, true, true );
-    delete pQueue;
+    tBatchKey* pKey = activeKeys.back();
+    activeKeys.pop_back();
+    numProcessed += dumpKey( pKey, reason );
   } // while
-
-  numProcessed += dumpQueue( &batchOnlyQueue, reason );
-  numProcessed += dumpQueue( &commonQueue, reason );
-  listSize -= numProcessed;
-  
-  log.warn( log.LOGALWAYS, "dumpList: queue '%s' processed %d entries listSize:%d, reason:'%s'", queueName.c_str(), numProcessed, listSize, reason );
-} // dumpList
+  clearExpiryIndex();
+  log.warn( log.LOGALWAYS, "dumpQueue: queue '%s' processed %d entries listSize:%u, reason:'%s'", queueName.c_str(), numProcessed, listSize, reason );
+} // dumpQueue
 
 /**
- * dump stats into an http object
+ * produces a csv version of the queue status and statistics - the hot keys are the keys with
+ * the most events as a space separated list of key:queued:dequeued
  * **/
-void batchQueue::dumpHttp( dispatchNotifyEvent* pEvent )
+std::string& batchQueue::getStatus( )
 {
-//  baseQueue::dumpHttp( pEvent );
-//  pEvent->addParam( "delayqlen", delayListSize );
-} // dumpHttp
+  char str[128];
+  sprintf( str, "%u,%u,%d,%u,%u,", listSize, maxQueueLength, numExpiredEvents, (unsigned int)batchMap.size(), numKeysCreated );
+  statusStr = str;
+
+  batchKeyListT hotKeys( activeKeys.begin(), activeKeys.end() );
+  size_t numReported = std::min( hotKeys.size(), (size_t)numHotKeys );
+  std::partial_sort( hotKeys.begin(), hotKeys.begin()+numReported, hotKeys.end(), hasMoreEvents );
+  for( size_t i = 0; i < numReported; i++ )
+  {
+    sprintf( str, "%s%u:%u:%u", (i>0)?" ":"", hotKeys[i]->key, hotKeys[i]->listSize, hotKeys[i]->numDequeued );
+    statusStr.append( str );
+  } // for
 
+  resetStats();
+  return statusStr;
+} // getStatus
+
+/**
+ * returns the key to getStatus - typically used as a heading to the csv it is stored in
+ * **/
+std::string& batchQueue::getStatusKey( )
+{
+  statusStrKey = "qSize,qMax,numExp,numKeys,keysCreated,hotKeys";
+  return statusStrKey;
+} // getStatusKey
@@ -1,14 +1,25 @@
 /**
  Event queue class supporting round robin scheduling across batches of events
- 
+
  $Id: batchQueue.h 32 2009-09-23 10:14:24Z gerhardus $
- Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
  @version 1.0.0		10/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		rewritten on the nucleus baseQueue as a deficit round robin across keys
+ @version 1.2.0		16/10/2026		agent		getQueueLength
 
  @note
+ each key (the subQueue of destQueue - 'queue;key') has its own FIFO.  The keys with events
+ are kept in a ring; the key at the head of the ring receives its quantum of events
+ (batchQuantum, mainQuantum for key 0 - the events without a key) and is served until the
+ quantum is used up or it runs out of events before the ring moves on.  As every event costs
+ one unit the deficit never carries over to the next round.  The key descriptors are looked
+ up in a hash map and recycled through a free list so creating and reclaiming a key is O(1).
+ Expiry is indexed like the straightQueue - a generation on the key descriptor invalidates
+ the index entries of a recycled key and a descriptor is only deleted once no index entry
+ points at it
 
  @todo
- 
+
  @bug
 
 	Copyright Notice
@@ -17,82 +28,104 @@
 #if !defined( batchQueue_defined_ )
 #define batchQueue_defined_
 
-#include "dispatcher/baseQueue.h"
+#include "nucleus/baseQueue.h"
+#include "nucleus/queueContainer.h"
+#include <unordered_map>
+#include <vector>
 
-// queue of straightQueues
-typedef std::deque<straightQueueT*> batchQueueT;
-typedef batchQueueT::iterator batchQueueIteratorT;
-
-// map of straightQueues
-typedef std::map<unsigned int,straightQueueT*> batchMapT;
+/** the events of one key **/
+struct tBatchKey
+{
+  unsigned int              key;
+  straightQueueT            eventList;      // NULL where an event has been expired in place - never at the back
+  unsigned int              listSize;       // number of events queued for the key
+  unsigned int              deficit;        // events left in the current turn
+  unsigned int              generation;     // incremented each time the descriptor is reclaimed
+  unsigned int              numIndexed;     // expiry index entries pointing at the descriptor - it cannot be deleted while non zero
+  unsigned long long        frontSeq;       // sequence number of the next event pushed to the front
+  unsigned long long        backSeq;        // sequence number of the event at the back
+  unsigned int              numDequeued;    // events taken from the key since the stats were reset
+};
+
+// map of the active keys
+typedef std::unordered_map<unsigned int,tBatchKey*> batchMapT;
 typedef batchMapT::iterator  batchMapIteratorT;
-typedef std::pair<unsigned int,straightQueueT*> batchMapPairT;
+typedef std::pair<unsigned int,tBatchKey*> batchMapPairT;
 
-// lookup map to get to the key of a batchQueue based on the object
-typedef std::map<straightQueueT*,unsigned int> batchMapLookupT;
-typedef batchMapLookupT::iterator  batchMapLookupIteratorT;
-typedef std::pair<straightQueueT*,unsigned int> batchMapLookupPairT;
+// ring of keys with events and the recycled key descriptors
+typedef std::deque<tBatchKey*> batchRingT;
+typedef std::vector<tBatchKey*> batchKeyListT;
 
-struct tQueueDescriptor;
+/** an entry in the expiry index **/
+struct tBatchExpiryEntry
+{
+  unsigned int              expiryTime;
+  unsigned int              generation;
+  tBatchKey*                pKey;
+  unsigned long long        seq;
+};
+typedef std::vector<tBatchExpiryEntry> batchExpiryIndexT;
 
 class batchQueue : public baseQueue
 {
   // Definitions
   public:
     static const char *const FROM;
-    static const int MAX_SUBQUEUES = 5;
-    static const int DEF_NUM_SUBQUEUES = 2;
-    static const int DEF_NUM_EVENTS_IN_SEQ_FROM_MAIN_QUEUE = 3;
-    static const int DEF_NUM_EVENTS_IN_SEQ_FROM_SUB_QUEUE = 2;
+    static const int DEF_BATCH_QUANTUM = 1;
+    static const int DEF_MAIN_QUANTUM = 3;
+    static const int DEF_NUM_HOT_KEYS = 5;
+    static const unsigned int MAX_FREE_KEYS = 1024;
 
     // Methods
   public:
-    batchQueue( tQueueDescriptor* theDescriptor, recoveryLog* theRecoveryLog, bool bRecovery, int theMserverFd, const std::string& thePersistentApp );
+    batchQueue( tQueueDescriptor* theDescriptor, recoveryLog* theRecoveryLog, bool bRecovery );
     virtual ~batchQueue();
-    baseEvent* popAvailableEvent( );
 
-    virtual bool canExecuteEventDirectly( )             {return listSize==0;}
-    virtual bool isQueueEmpty( )                        {return listSize==0;}
+    virtual bool canExecuteEventDirectly( baseEvent* pEvent )   {return listSize==0;}
+    virtual bool isQueueEmpty( )                                {return !bExitWhenDone && (listSize==0);}
+    virtual unsigned int getQueueLength( )                      {return listSize;}
+    virtual baseEvent* popAvailableEvent( int fd );
     virtual void queueEvent( baseEvent* pEvent );
+
+    virtual void exitWhenDone( )                                {bExitWhenDone=true;}
     virtual void scanForExpiredEvents( );
-    virtual void dumpList( const char* reason );
+    virtual void dumpQueue( const char* reason );
     virtual std::string& getStatus( );
-    virtual void maintenance( );
-    
+    virtual std::string& getStatusKey( );
+    virtual void resetStats( );
+
 
   protected:
 
   private:
-    void init( );
-    baseEvent* popEvent( straightQueueT* theQueue );
-    void dropQueue( straightQueueT* pQueue, bool bDropMapLookup, bool bDropMap );
-    baseEvent* getEventFromMainQueue( );
-    baseEvent* getEventFromSubQueue( );
-    straightQueueT* findExistingQueue( int key );
-    unsigned int getKeyForQueue( straightQueueT* pQueue, bool bThrowOnNotFound );
-    straightQueueT* createBatchQueue( int key );
+    void init( tQueueDescriptor* theDescriptor );
+    baseEvent* popEvent( );
+    tBatchKey* findOrCreateKey( unsigned int key );
+    void reclaimKey( tBatchKey* pKey );
+    void trimKey( tBatchKey* pKey );
+    int dumpKey( tBatchKey* pKey, const char* reason );
     void checkQueueOverflow( );
-    unsigned int getKeyForQueue( straightQueueT* pQueue, bool bThrowOnNotFound=false );
+    void compactExpiryIndex( );
+    void clearExpiryIndex( );
+    static bool expiresLater( const tBatchExpiryEntry& a, const tBatchExpiryEntry& b )  {return a.expiryTime>b.expiryTime;}
+    static bool hasMoreEvents( const tBatchKey* a, const tBatchKey* b )                 {return a->listSize>b->listSize;}
 
-    // Properties  
+    // Properties
   public:
 
   protected:
 
   private:
-    batchQueueT                       commonQueue;                ///< shared between single and batch events
-    batchMapT                         batchMap;                   ///< all batch queues go in here
-    batchMapLookupT                   batchMapLookup;             ///< reverse lookup from batchQueue to key
-    batchQueueT                       batchOnlyQueue;             ///< queue containing batches with more than one event
-    batchQueueT                       subQueues;                  ///< subqueues that contain batches that feed workers - will use it like a ring
-    straightQueueT                    mainQueue;                  ///< main queue for single events or queue 0
+    batchMapT                         batchMap;                   ///< the keys that have events
+    batchRingT                        activeKeys;                 ///< ring of the keys with events - the back is served
+    batchKeyListT                     freeKeys;                   ///< reclaimed key descriptors for reuse
+    batchExpiryIndexT                 expiryIndex;                ///< min-heap on expiryTime of the queued events that can expire
     unsigned int                      listSize;                   ///< total number of queued events
-    int                               numSubQueues;               ///< number of sub queues to round robin over
-    int                               maxEventsFromMainQueue;     ///< number of times the main queue is serviced before switching to the sub queues
-    int                               maxEventsFromSubQueue;      ///< number of times the sub queues are serviced before switching to the main queue
-    int                               numTimesReadFromMainQueue;  ///< number of events we have taken from the main queue in sequence
-    int                               numTimesReadFromSubQueue;   ///< number of events we have taken from the sub queue in sequence
-    bool                              bFeedingFromMainQueue;      ///< true while feeding off the main queue
+    unsigned int                      batchQuantum;               ///< events per turn for a key
+    unsigned int                      mainQuantum;                ///< events per turn for key 0
+    int                               numHotKeys;                 ///< number of keys reported by getStatus
+    unsigned int                      numKeysCreated;             ///< keys created since the stats were reset
+    bool                              bExitWhenDone;              ///< shutdown procedure for persistent apps
 };	// class batchQueue
 
 #endif // !defined( batchQueue_defined_)
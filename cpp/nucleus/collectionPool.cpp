@@ -6,6 +6,7 @@
  $Id: collectionPool.cpp 2879 2013-06-04 20:05:10Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		21/12/2012		Gerhardus Muller		Script created
+ @version 1.0.1		17/10/2026		agent		a worker the event could not be sent to stays idle
 
  @note
  resizeWorkerPool - gaan nie idle workers eers laat gaan nie maar van een kant af delete
@@ -165,7 +166,11 @@ void collectionPool::executeEvent( baseEvent* pEvent )
   int pid = pEvent->getWorkerPid();
   if( pid <= 1 ) throw Exception( log, log.WARN, "executeEvent: getWorkerPid returned an invalid value" );  // strictly speaking checking for -1 is sufficient but are crossing language barriers and perhaps we end up with a zero here
   workerDescriptor* pWorker = getIdleWorkerByPid( pid );
-  pWorker->submitEvent( pEvent, now );
+  if( !pWorker->submitEvent( pEvent, now ) )
+  {
+    addIdleWorkersEntry( pid, pWorker );
+    return;
+  } // if
   pWorker->setBusy( true );
   if( log.wouldLog( log.LEVEL6 ) )
     log.info( log.MIDLEVEL ) << "executeEvent: given event to worker " << pWorker->getPid() << ", " << pEvent->toString();
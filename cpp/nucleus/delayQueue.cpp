@@ -0,0 +1,180 @@
+/**
+ delayQueue - holds events with a readyTime until the second they become ready
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#include <sstream>
+#include "nucleus/delayQueue.h"
+
+/**
+ * constructor
+ * @param now - the wheel starts processing from this second
+ * **/
+delayQueue::delayQueue( unsigned int now )
+  : object( "delayQueue" )
+{
+  current = now;
+  numEvents = 0;
+  numLevel0 = 0;
+} // delayQueue
+
+/**
+ * destructor - events that were not drained are discarded
+ * **/
+delayQueue::~delayQueue()
+{
+  delayEventListT pending;
+  drain( pending );
+  if( !pending.empty() ) log.warn( log.LOGALWAYS, "~delayQueue: discarding %u delayed events", (unsigned int)pending.size() );
+  for( unsigned int i = 0; i < pending.size(); i++ )
+    baseEvent::release( pending[i] );
+} // ~delayQueue
+
+/**
+ * Standard logging call - produces a generic text version of the delayQueue.
+ * **/
+std::string delayQueue::toString( )
+{
+  std::ostringstream oss;
+  oss << "delayQueue current:" << current << " events:" << numEvents << " level0:" << numLevel0;
+  return oss.str();
+} // toString
+
+/**
+ * takes ownership of an event until its readyTime
+ * @param pEvent - readyTime has to be absolute
+ * **/
+void delayQueue::insert( baseEvent* pEvent )
+{
+  place( pEvent );
+  numEvents++;
+} // insert
+
+/**
+ * places an event in the lowest level that spans its readyTime
+ * an event that is already due goes into the slot processed next
+ * **/
+void delayQueue::place( baseEvent* pEvent )
+{
+  unsigned int t = pEvent->getReadyTime();
+  if( t < current ) t = current;
+  unsigned int delta = t - current;
+  if( delta > MAX_DELAY )
+  { // parked - placed again when its slot cascades
+    delta = MAX_DELAY;
+    t = current + MAX_DELAY;
+  } // if
+
+  int level = 0;
+  if( delta >= LEVEL0_SIZE )
+  {
+    level = 1;
+    while( (level < NUM_LEVELS-1) && (delta >= (1u<<(LEVEL0_BITS+level*LEVEL_BITS))) ) level++;
+  } // if
+  slot( level, t ).push_back( pEvent );
+  if( level == 0 ) numLevel0++;
+} // place
+
+/**
+ * moves the events of the slot in a level that starts at current one or more levels down
+ * @return the slot index in the level - the next level up only cascades when this is 0
+ * **/
+unsigned int delayQueue::cascade( int level )
+{
+  unsigned int idx = (current>>(LEVEL0_BITS+(level-1)*LEVEL_BITS))&LEVEL_MASK;
+  delayEventListT moving;
+  moving.swap( wheel[level-1][idx] );
+  for( unsigned int i = 0; i < moving.size(); i++ )
+    place( moving[i] );
+  return idx;
+} // cascade
+
+/**
+ * processes every second up to and including now
+ * @param now
+ * @param ready - the events that have become ready are appended, earliest second first
+ * **/
+void delayQueue::advance( unsigned int now, delayEventListT& ready )
+{
+  while( current <= now )
+  {
+    if( numEvents == 0 )
+    { // nothing to cascade - the wheel can jump
+      current = now+1;
+      break;
+    } // if
+
+    unsigned int idx = current & LEVEL0_MASK;
+    if( idx == 0 )
+    {
+      for( int level = 1; level < NUM_LEVELS; level++ )
+        if( cascade( level ) != 0 ) break;
+    } // if
+    else if( numLevel0 == 0 )
+    { // skip to the next cascade
+      unsigned int next = current + (LEVEL0_SIZE-idx);
+      current = (next>now)?now+1:next;
+      continue;
+    } // else if
+
+    delayEventListT& due = wheel0[idx];
+    if( !due.empty() )
+    {
+      ready.insert( ready.end(), due.begin(), due.end() );
+      numLevel0 -= due.size();
+      numEvents -= due.size();
+      due.clear();
+    } // if
+    current++;
+  } // while
+} // advance
+
+/**
+ * removes all the events from the wheel
+ * @param pending - the events are appended
+ * **/
+void delayQueue::drain( delayEventListT& pending )
+{
+  for( unsigned int i = 0; i < LEVEL0_SIZE; i++ )
+  {
+    pending.insert( pending.end(), wheel0[i].begin(), wheel0[i].end() );
+    delayEventListT().swap( wheel0[i] );
+  } // for
+  for( int level = 0; level < NUM_LEVELS-1; level++ )
+    for( unsigned int i = 0; i < LEVEL_SIZE; i++ )
+    {
+      pending.insert( pending.end(), wheel[level][i].begin(), wheel[level][i].end() );
+      delayEventListT().swap( wheel[level][i] );
+    } // for
+  numEvents = 0;
+  numLevel0 = 0;
+} // drain
+
+/**
+ * the second by which advance has to be called next - either the first occupied level 0
+ * slot or the next cascade if that comes first
+ * @return the second or 0 if the wheel is empty
+ * **/
+unsigned int delayQueue::nextDue( )
+{
+  if( numEvents == 0 ) return 0;
+  unsigned int idx = current & LEVEL0_MASK;
+  if( idx == 0 ) return current;
+  if( numLevel0 > 0 )
+  {
+    for( unsigned int i = idx; i < LEVEL0_SIZE; i++ )
+      if( !wheel0[i].empty() ) return current+(i-idx);
+  } // if
+  return current+(LEVEL0_SIZE-idx);
+} // nextDue
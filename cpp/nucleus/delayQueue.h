@@ -0,0 +1,77 @@
+/**
+ delayQueue - holds events with a readyTime until the second they become ready
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ a hierarchical timing wheel with a resolution of one second.  Level 0 has a slot for each of
+ the next 256 seconds; levels 1 to 3 have 64 slots each covering 2^8, 2^14 and 2^20 seconds.
+ An event is inserted into the lowest level that spans its readyTime and is moved (cascaded)
+ one level down each time the wheel reaches the start of the range its slot covers, so both
+ insert and expiry are O(1) per event.  Events further away than the wheel spans (about two
+ years) are parked in the last slot and re-placed when cascaded.
+ The wheel only stores the events - the nucleus decides where they go once they are ready and
+ writes the pending events to the recovery log on shutdown
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#if !defined( delayQueue_defined_ )
+#define delayQueue_defined_
+
+#include "utils/object.h"
+#include "nucleus/baseEvent.h"
+#include <vector>
+
+typedef std::vector<baseEvent*> delayEventListT;
+
+class delayQueue : public object
+{
+  // Definitions
+  public:
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int NUM_LEVELS = 4;
+    static const unsigned int LEVEL0_SIZE = 1<<LEVEL0_BITS;
+    static const unsigned int LEVEL_SIZE = 1<<LEVEL_BITS;
+    static const unsigned int LEVEL0_MASK = LEVEL0_SIZE-1;
+    static const unsigned int LEVEL_MASK = LEVEL_SIZE-1;
+    static const unsigned int MAX_DELAY = (1u<<(LEVEL0_BITS+(NUM_LEVELS-1)*LEVEL_BITS))-1;
+
+    // Methods
+  public:
+    delayQueue( unsigned int now );
+    virtual ~delayQueue();
+    virtual std::string toString ();
+    void insert( baseEvent* pEvent );
+    void advance( unsigned int now, delayEventListT& ready );
+    void drain( delayEventListT& pending );
+    unsigned int nextDue( );
+    unsigned int size( )                                    {return numEvents;}
+    bool empty( )                                           {return numEvents==0;}
+
+  private:
+    void place( baseEvent* pEvent );
+    unsigned int cascade( int level );
+    delayEventListT& slot( int level, unsigned int t )      {return (level==0)?wheel0[t&LEVEL0_MASK]:wheel[level-1][(t>>(LEVEL0_BITS+(level-1)*LEVEL_BITS))&LEVEL_MASK];}
+
+    // Properties
+  public:
+
+  protected:
+
+  private:
+    delayEventListT                   wheel0[LEVEL0_SIZE];        ///< level 0 - one slot per second
+    delayEventListT                   wheel[NUM_LEVELS-1][LEVEL_SIZE];  ///< levels 1..3
+    unsigned int                      current;                    ///< the next second to be processed
+    unsigned int                      numEvents;                  ///< number of events held across all the levels
+    unsigned int                      numLevel0;                  ///< number of events in level 0
+};	// class delayQueue
+
+#endif // !defined( delayQueue_defined_)
@@ -5,6 +5,9 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		04/09/2012		Gerhardus Muller		Script created
  @version 1.0.1		20/05/2014		Gerhardus Muller		acceptUnSocket used the datagram fd
+ @version 1.1.0		16/10/2026		agent		read ahead on stream sockets
+ @version 1.2.0		16/10/2026		agent		per destination outbound buffers written on EPOLLOUT
+ @version 1.3.0		16/10/2026		agent		bListen - only one nucleus shard binds the Unix domain sockets
 
  @note
 
@@ -20,6 +23,7 @@
 #include "src/options.h"
 #include "nucleus/network.h"
 #include "nucleus/optionsNucleus.h"
+#include "nucleus/recoveryLog.h"
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
@@ -29,16 +33,25 @@
 #include <grp.h>
 #include <errno.h>
 
-network::network( )
+network* network::theNetwork = NULL;
+
+/**
+ * constructor
+ * @param bListen - false to leave the Unix domain sockets to another nucleus shard
+ * **/
+network::network( bool bListen )
   : object( "network" )
 {
   listenUnFd = -1;
   listenUnStreamFd = -1;
   pUnSock = NULL;
   pUnStreamSock = NULL;
+  pWrSock = NULL;
   pEpollRd = NULL;
   pEpollWr = NULL;
-  init();
+  maxOutBufferBytes = (unsigned long long)pOptionsNucleus->maxWriteBufferMB*1024*1024;
+  init( bListen );
+  theNetwork = this;
 } // network
 
 /**
@@ -46,6 +59,14 @@ network::network( )
  * **/
 network::~network( )
 {
+  if( theNetwork == this ) theNetwork = NULL;
+  for( outBufferMapIteratorT itBuf = outBuffers.begin(); itBuf != outBuffers.end(); itBuf++ )
+  {
+    log.warn( log.LOGALWAYS, "~network fd:%d discarding %u buffered frames", itBuf->first, (unsigned int)itBuf->second->frames.size() );
+    delete itBuf->second;
+  } // for
+  outBuffers.clear();
+  if( pWrSock != NULL ) delete pWrSock;
   if( pEpollRd != NULL ) delete pEpollRd;
   if( pEpollWr != NULL ) delete pEpollWr;
   if( pUnSock != NULL ) delete pUnSock;
@@ -68,8 +89,9 @@ network::~network( )
 
 /**
  * init
+ * @param bListen - create the Unix domain sockets
  * **/
-void network::init( )
+void network::init( bool bListen )
 {
   log.setAddPid( true );
 
@@ -80,13 +102,13 @@ void network::init( )
   // create a Unix domain networkIf
   // for a stream networkIf create only a listen networkIf and accept in the same way as TCP
   // note that rebuildPollList() has to be altered to reflect the permanent listen networkIf as well
-  if( pOptionsNucleus->unixSocketPath.length() > 0 )
+  if( bListen && (pOptionsNucleus->unixSocketPath.length() > 0) )
   {
     listenUnFd = createUnListenSocket( SOCK_DGRAM, pOptionsNucleus->unixSocketPath.c_str() );
     pUnSock = new unixSocket( listenUnFd, unixSocket::ET_QUEUE_EVENT, true, "unFd" );
     pUnSock->setNonblocking( );
   } // if
-  if( pOptionsNucleus->unixSocketStreamPath.length() > 0 )
+  if( bListen && (pOptionsNucleus->unixSocketStreamPath.length() > 0) )
   {
     listenUnStreamFd = createUnListenSocket( SOCK_STREAM, pOptionsNucleus->unixSocketStreamPath.c_str() );
     pUnStreamSock = new unixSocket( listenUnStreamFd, unixSocket::ET_LISTEN, true, "unStreamFd" );
@@ -118,9 +140,13 @@ void network::resetRdPollMap( )
  * **/
 void network::resetWrPollMap( )
 {
+  if( pWrSock != NULL ) delete pWrSock;
   if( pEpollWr != NULL ) delete pEpollWr;
   pEpollWr = new epoll( pOptionsNucleus->maxNetworkDescriptors );
   pEpollWr->setLoggingId( "pEpollWr" );
+  pWrSock = new unixSocket( pEpollWr->getEpollFd(), unixSocket::ET_WRITE_READY, false, "epollWr" );
+  for( outBufferMapIteratorT it = outBuffers.begin(); it != outBuffers.end(); it++ )
+    pEpollWr->addFd( it->first, (void*)it->second, EPOLLOUT );
 } // resetWrPollMap
 
 /**
@@ -128,6 +154,7 @@ void network::resetWrPollMap( )
  * **/
 void network::buildRdPollMap( )
 {
+  addRdFd( pWrSock );
   if( listenUnFd != -1 ) addRdFd( pUnSock );
   if( listenUnStreamFd != -1 ) addRdFd( pUnStreamSock );
 
@@ -245,11 +272,11 @@ void network::listenEvent()
   {
     unixSocket* pSock = new unixSocket( newUnFd, unixSocket::ET_QUEUE_EVENT );
     pSock->setNonblocking();
+    pSock->setReadAhead( true );
     tcpFds.insert( std::pair<int,unixSocket*>( newUnFd, pSock ) );
     log.info( log.MIDLEVEL, "accepted new unix fd %d", newUnFd );
     writeGreeting( pSock );
     addRdFd( pSock );
-    addWrFd( pSock );
   } // if
   else
     log.error( "listenEvent: acceptUnSocket should have returned a valid fd not %d", newUnFd );
@@ -289,7 +316,7 @@ void network::closeStreamSocket( int fd )
     unixSocket* pSock = it->second;
     tcpFds.erase( it );
     deleteRdFd( fd );
-    deleteWrFd( fd );
+    deleteOutBuffer( fd );
     close( fd );
     delete pSock;
   } // if
@@ -309,3 +336,168 @@ void network::writeGreeting( unixSocket* pSocket )
   snprintf( str, 1024, "%03d:%s", (int)greetingString.length(), greetingString.c_str() );
   pSocket->write( str, strlen( str ) );
 } // writeGreeting
+
+/**
+ * writes an event without blocking - what the socket does not accept is buffered and written
+ * by writeReady.  falls back to a plain serialise if there is no network instance
+ * @param fd - destination
+ * @param pEvent - the event remains owned by the caller and can be released on return
+ * @return -1 on error (the event is written to the recovery log), 0 if (part of) the event is buffered, 1 if written
+ * **/
+int network::sendEvent( int fd, baseEvent* pEvent )
+{
+  if( theNetwork == NULL ) return (pEvent->serialise(fd)<1)?-1:1;
+  return theNetwork->queueEvent( fd, pEvent );
+} // sendEvent
+
+/**
+ * discards the frames buffered for an fd - to be used when the fd is closed or the peer is replaced
+ * @param fd
+ * **/
+void network::dropOutBuffer( int fd )
+{
+  if( theNetwork != NULL ) theNetwork->deleteOutBuffer( fd );
+} // dropOutBuffer
+
+/**
+ * implements sendEvent
+ * **/
+int network::queueEvent( int fd, baseEvent* pEvent )
+{
+  outBufferMapIteratorT it = outBuffers.find( fd );
+  if( it != outBuffers.end() )
+  {
+    // queue behind the pending frames
+    tOutBuffer* pBuf = it->second;
+    std::string& frame = pEvent->serialiseToString();
+    if( (maxOutBufferBytes>0) && (pBuf->numBytes+frame.length() > maxOutBufferBytes) )
+    {
+      log.warn( log.LOGALWAYS, "sendEvent: fd:%d buffer full at %llu bytes", fd, pBuf->numBytes );
+      if( baseEvent::theRecoveryLog != NULL ) baseEvent::theRecoveryLog->writeEntry( pEvent, "ser_fail" );
+      return -1;
+    } // if
+    pBuf->frames.push_back( frame );
+    pBuf->numBytes += frame.length();
+    return 0;
+  } // if
+
+  int ret = pEvent->serialiseNonBlock( fd );
+  if( ret != 0 ) return ret;
+
+  // keep the rest of the frame
+  tOutBuffer* pBuf = new tOutBuffer;
+  pBuf->fd = fd;
+  pBuf->offset = 0;
+  pBuf->frames.push_back( pEvent->serialiseToString().substr(pEvent->getBytesSerialised()) );
+  pBuf->numBytes = pBuf->frames.front().length();
+  pEvent->abandonSerialise();
+  outBuffers.insert( std::pair<int,tOutBuffer*>( fd, pBuf ) );
+  pEpollWr->addFd( fd, (void*)pBuf, EPOLLOUT );
+  log.info( log.MIDLEVEL, "sendEvent: fd:%d full - buffered %llu bytes", fd, pBuf->numBytes );
+  return 0;
+} // queueEvent
+
+/**
+ * writes the buffers of the fds that are ready for writing - called when pEpollWr is readable
+ * **/
+void network::writeReady( )
+{
+  int numReady = pEpollWr->waitForEvent( 0 );
+  for( int i = 0; i < numReady; i++ )
+  {
+    unsigned int events;
+    bool bErr;
+    tOutBuffer* pBuf = static_cast<tOutBuffer*>( pEpollWr->getReadyRef( i, bErr, events ) );
+    if( bErr && !(events&EPOLLOUT) )
+    {
+      log.warn( log.LOGALWAYS, "writeReady: fd:%d error events:0x%x", pBuf->fd, events );
+      recoverOutBuffer( pBuf );
+    } // if
+    else
+      flushOutBuffer( pBuf );
+  } // for
+} // writeReady
+
+/**
+ * writes as many of the buffered frames as the fd accepts - the buffer is deleted once it is empty
+ * @param pBuf
+ * **/
+void network::flushOutBuffer( tOutBuffer* pBuf )
+{
+  while( !pBuf->frames.empty() )
+  {
+    std::string& frame = pBuf->frames.front();
+    struct iovec iov;
+    iov.iov_base = (void*)(frame.data()+pBuf->offset);
+    iov.iov_len = frame.length()-pBuf->offset;
+    int bytesWritten = unixSocket::writeOnceV( pBuf->fd, &iov, 1, false, true );
+    if( bytesWritten == -1 )
+    {
+      if( (errno == EAGAIN) || (errno == EWOULDBLOCK) ) return;
+      log.warn( log.LOGALWAYS, "flushOutBuffer: fd:%d write failed: %s", pBuf->fd, strerror(errno) );
+      recoverOutBuffer( pBuf );
+      return;
+    } // if
+    pBuf->offset += bytesWritten;
+    pBuf->numBytes -= bytesWritten;
+    if( pBuf->offset == frame.length() )
+    {
+      pBuf->frames.pop_front();
+      pBuf->offset = 0;
+    } // if
+  } // while
+
+  log.debug( log.MIDLEVEL, "flushOutBuffer: fd:%d drained", pBuf->fd );
+  deleteOutBuffer( pBuf->fd );
+} // flushOutBuffer
+
+/**
+ * writes the buffered frames of an fd that failed to the recovery log and deletes the buffer
+ * @param pBuf
+ * **/
+void network::recoverOutBuffer( tOutBuffer* pBuf )
+{
+  for( unsigned int i = 0; i < pBuf->frames.size(); i++ )
+  {
+    // the front frame is recovered in full even if the peer received a part of it
+    std::string& frame = pBuf->frames[i];
+    baseEvent* pEvent = NULL;
+    try
+    {
+      pEvent = baseEvent::unSerialiseFromFrame( frame.data(), frame.length() );
+    } // try
+    catch( Exception e )
+    {
+      pEvent = NULL;
+    } // catch
+    if( (pEvent != NULL) && (baseEvent::theRecoveryLog != NULL) )
+      baseEvent::theRecoveryLog->writeEntry( pEvent, "ser_fail" );
+    else
+      log.warn( log.LOGALWAYS, "recoverOutBuffer: fd:%d lost a frame of %u bytes", pBuf->fd, (unsigned int)frame.length() );
+    baseEvent::release( pEvent );
+  } // for
+  deleteOutBuffer( pBuf->fd );
+} // recoverOutBuffer
+
+/**
+ * removes the buffer of an fd from the write poll map and deletes it
+ * @param fd
+ * **/
+void network::deleteOutBuffer( int fd )
+{
+  outBufferMapIteratorT it = outBuffers.find( fd );
+  if( it == outBuffers.end() ) return;
+  tOutBuffer* pBuf = it->second;
+  if( !pBuf->frames.empty() )
+    log.info( log.LOGMOSTLY, "deleteOutBuffer: fd:%d discarding %u frames %llu bytes", fd, (unsigned int)pBuf->frames.size(), pBuf->numBytes );
+  outBuffers.erase( it );
+  try
+  {
+    deleteWrFd( fd );
+  } // try
+  catch( Exception e )
+  {
+    // the fd may already have been closed
+  } // catch
+  delete pBuf;
+} // deleteOutBuffer
@@ -4,8 +4,16 @@
  $Id: network.h 2588 2012-09-17 16:45:27Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		04/09/2012		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		per destination outbound buffers written on EPOLLOUT
+ @version 1.2.0		16/10/2026		agent		bListen - only one nucleus shard binds the Unix domain sockets
 
  @note
+ sendEvent writes an event to a worker, a return socket or the networkIf without blocking.  The
+ part of the frame the socket does not accept is copied into an outbound buffer for the fd,
+ and the fd is registered for EPOLLOUT in pEpollWr for as long as the buffer is not empty.
+ pEpollWr is itself in the read set (ET_WRITE_READY) so the main loop calls writeReady when any
+ of the buffered fds can take more.  Further events to an fd with a pending buffer are queued
+ behind it to keep the order
 
  @todo
  
@@ -21,12 +29,24 @@
 #include "utils/unixSocket.h"
 #include "nucleus/baseEvent.h"
 #include "utils/epoll.h"
+#include <deque>
 
 class epoll;
 
 typedef std::map<int,unixSocket*> socketMapT;
 typedef socketMapT::iterator socketMapIteratorT;
 
+/** frames waiting to be written to an fd **/
+struct tOutBuffer
+{
+  int                       fd;
+  std::deque<std::string>   frames;         // the front frame is partially written up to offset
+  unsigned int              offset;         // bytes of the front frame already written
+  unsigned long long        numBytes;       // bytes still to be written
+};
+typedef std::map<int,tOutBuffer*> outBufferMapT;
+typedef outBufferMapT::iterator outBufferMapIteratorT;
+
 class network : public object
 {
   // Definitions
@@ -34,7 +54,7 @@ class network : public object
 
     // Methods
   public:
-    network( );
+    network( bool bListen=true );
     virtual ~network();
     int  getUnFd()                                            {return listenUnFd;}
     int  getUnStreamFd()                                      {return listenUnStreamFd;}
@@ -52,9 +72,16 @@ class network : public object
     void closeStreamSocket( int fd );
     unixSocket* getReadSocket( int i, bool& bErr, unsigned int& events )  {return static_cast<unixSocket*>(pEpollRd->getReadyRef(i,bErr,events));}
     void listenEvent();
+    void writeReady();
+    static int sendEvent( int fd, baseEvent* pEvent );
+    static void dropOutBuffer( int fd );
 
   private:
-    void init();
+    void init( bool bListen );
+    int  queueEvent( int fd, baseEvent* pEvent );
+    void flushOutBuffer( tOutBuffer* pBuf );
+    void recoverOutBuffer( tOutBuffer* pBuf );
+    void deleteOutBuffer( int fd );
     int createUnListenSocket( int type, const char* networkIfPath, int qlen=10 );
     int acceptUnSocket();
     void writeGreeting( unixSocket* pSocket );
@@ -65,15 +92,19 @@ class network : public object
   public:
 
   protected:
+    static network*                   theNetwork;                 ///< the instance used by sendEvent - NULL if there is none
     int                               listenUnFd;                 ///< listen networkIf for Unix domain networkIf connections
     int                               listenUnStreamFd;           ///< listen networkIf for Unix domain networkIf connections - stream socket
     unixSocket*                       pUnSock;                    ///< corresponding socket object
     unixSocket*                       pUnStreamSock;              ///< corresponding socket object
+    unixSocket*                       pWrSock;                    ///< socket object for pEpollWr in the read set
 
   private:
     epoll*                            pEpollRd;                   ///< fd poll object for reading - replaces pRecSock's roll of providing a poll interface
     epoll*                            pEpollWr;                   ///< fd poll object for writing
     socketMapT                        tcpFds;                     ///< map containing the tcp/ud stream sockets we are serving
+    outBufferMapT                     outBuffers;                 ///< fds with frames waiting to be written
+    unsigned long long                maxOutBufferBytes;          ///< limit on the buffered bytes per fd
     std::string                       hostId;                     ///< hostname entry
     std::string                       greetingString;             ///< greeting string for external networkIf connections
 };	// class network
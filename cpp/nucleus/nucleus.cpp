@@ -15,6 +15,20 @@
  @version 1.7.0		05/06/2013		Gerhardus Muller		support for FD_CLOEXEC
  @version 1.8.0		20/06/2013		Gerhardus Muller		theNetworkIf for the fdsToRemainOpen list
  @version 1.8.1		26/03/2014		Gerhardus Muller		buildLookupMaps was forgotten in a reconfigure createqueue
+ @version 1.9.0		16/10/2026		agent		read ahead on the event source socket
+ @version 1.10.0		16/10/2026		agent		bBinarySections is carried over when a queue is dropped
+ @version 1.11.0		16/10/2026		agent		events are returned to the baseEvent pool rather than deleted
+ @version 1.12.0		16/10/2026		agent		events with a readyTime are held in a delay queue; the alarm is set for the earlier of the maintenance and the next delayed event
+ @version 1.13.0		16/10/2026		agent		a timerfd in the read set replaces SIGALRM - per queue maintenance schedules in ms
+ @version 1.13.1		16/10/2026		agent		spillMaxMB is carried over when a queue is dropped
+ @version 1.14.0		16/10/2026		agent		CMD_FLOW_CONTROL to the networkIf when a queue crosses its watermarks
+ @version 1.15.0		16/10/2026		agent		results and flow control are sent through the network outbound buffers; ET_WRITE_READY
+ @version 1.16.0		16/10/2026		agent		shards - queues are partitioned across nucleus processes
+ @version 1.17.0		16/10/2026		agent		shared pool - idle workers are lent to backlogged pool queues
+ @version 1.18.0		16/10/2026		agent		workers added by the queue autoscaler are picked up in runTimers
+ @version 1.19.0		16/10/2026		agent		pipelineDepth is kept when a queue is dropped
+ @version 1.19.1		17/10/2026		agent		results and flow control go to the networkIf on networkIfReturnFd
+ @version 1.19.2		17/10/2026		agent		events are passed to the other shards on a link per pair of shards
 
  @note
 
@@ -35,6 +49,9 @@
 #include <sys/wait.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/time.h>
+#include <time.h>
 #ifndef PLATFORM_MAC 
 #include <sys/prctl.h>
 #endif
@@ -43,10 +60,13 @@
 #include <pwd.h>
 #include <stddef.h>
 #include <fcntl.h>
+#include <limits.h>
 
 #include "nucleus/nucleus.h"
 #include "nucleus/recoveryLog.h"
 #include "nucleus/network.h"
+#include "nucleus/sharedPool.h"
+#include "src/options.h"
 #include "utils/utils.h"
 #include "utils/unixSocket.h"
 
@@ -54,11 +74,11 @@ bool nucleus::bRunning = true;
 bool nucleus::bReopenLog = false;
 bool nucleus::bResetStats = false;
 bool nucleus::bDump = false;
-bool nucleus::bTimerTick = false;
 int  nucleus::sigTermCount = 0;
 int  nucleus::signalFd0 = 0;
 recoveryLog* nucleus::theRecoveryLog = NULL;
 const char *const nucleus::FROM = typeid( nucleus ).name();
+const char *const nucleus::SHARD_FWD_PARAM = "shardFwd";
 optionsNucleus* pOptionsNucleus = NULL;
 
 /**
@@ -66,13 +86,26 @@ optionsNucleus* pOptionsNucleus = NULL;
  @param nucleusFd - unix domain socket to submit events to the nucleus - the nucleus reads the [1] side
  @param theRecoveryLog
  @param bRecovery - true if it is a recovery instance
+ @param theNetworkIf - the socket the networkIf and the workers share to submit events to the networkIf
+ @param theNetworkIfReturn - the socket only this nucleus writes to the networkIf on
+ @param theShard - index of the shard in theShardFds
+ @param theShardFds - the link to each of the other shards and the write side of its own event socket at theShard
  */
-nucleus::nucleus( int nucleusFd[2], int theParentFd, recoveryLog* recovery, bool bRecovery, int theArgc, char* theArgv[], int theNetworkIf )
-  : object( "nucleus" )
+nucleus::nucleus( int nucleusFd[2], int theParentFd, recoveryLog* recovery, bool bRecovery, int theArgc, char* theArgv[], int theNetworkIf, int theNetworkIfReturn, int theShard, const std::vector<int>& theShardFds )
+  : object( "nucleus" ),
+    shard( theShard ),
+    shardFds( theShardFds )
 {
   theRecoveryLog = recovery;
   bRecoveryProcess = bRecovery;
   pNetwork = NULL;
+  pDelayQueue = NULL;
+  pSharedPool = NULL;
+  maintIntervalMs = 0;
+  nextTimerMs = ULLONG_MAX;
+  nowMs = 0;
+  timerFd = -1;
+  pTimerSock = NULL;
   pRecSock = NULL;
   pSignalSock = NULL;
   numQueues = 0;
@@ -84,10 +117,15 @@ nucleus::nucleus( int nucleusFd[2], int theParentFd, recoveryLog* recovery, bool
   eventSourceFd = nucleusFd[1];
   parentFd = theParentFd;
   networkIfFd = theNetworkIf;
+  networkIfReturnFd = theNetworkIfReturn;
+  numForwarded = 0;
+  if( bRecoveryProcess ) shardFds.clear();    // a recovery owns all the queues
 
   // prevent these file handles from being available / open on all the children
   unixSocket::setCloseOnExec( true, parentFd );
   unixSocket::setCloseOnExec( true, eventSourceFd );
+  for( unsigned int i = 0; i < shardFds.size(); i++ )
+    if( (int)i != shard ) unixSocket::setCloseOnExec( true, shardFds[i] );
 }	// nucleus
 
 /**
@@ -97,8 +135,14 @@ nucleus::~nucleus()
 {
   log.generateTimestamp();
   if( pNetwork != NULL ) delete pNetwork;
+  if( pDelayQueue != NULL ) delete pDelayQueue;
+  if( pSharedPool != NULL ) delete pSharedPool;
   if( pRecSock != NULL ) delete pRecSock;
+  for( unsigned int i = 0; i < shardLinkSocks.size(); i++ )
+    delete shardLinkSocks[i];
   if( pSignalSock != NULL ) delete pSignalSock;
+  if( pTimerSock != NULL ) delete pTimerSock;
+  if( timerFd != -1 ) close( timerFd );
   queueContainerStrMapIteratorT it;
   for( it = queues.begin(); it != queues.end(); it++ )
   {
@@ -254,6 +298,12 @@ void nucleus::init( )
     log.setLogConsole( pOptionsNucleus->bLogConsole );
   log.setAddPid( true );
   log.setAddExecTrace( true );
+  if( shardFds.size() > 1 )
+  {
+    char name[32];
+    sprintf( name, "nucleus%d", shard );
+    log.setInstanceName( name );
+  } // if
   log.generateTimestamp();
   unixSocket::pStaticLogger->init( "unixSocket", (loggerDefs::eLogLevel)pOptionsNucleus->defaultLogLevel );
   unixSocket::pStaticLogger->setAddPid( true );
@@ -273,7 +323,6 @@ void nucleus::init( )
   signal( SIGINT, SIG_IGN );
   signal( SIGTERM, nucleus::sigHandler );
   signal( SIGCHLD, nucleus::sigHandler );
-  signal( SIGALRM, nucleus::sigHandler );
 
   // reset the signal blocking mask that we inherited
   sigset_t blockmask;
@@ -289,7 +338,14 @@ void nucleus::init( )
   hostId = hostname;
 
   // create the networking object that will handle events from outside and our children
-  pNetwork = new network();
+  // only the first shard listens on the Unix domain sockets
+  pNetwork = new network( shard == 0 );
+
+  // holds the events submitted with a readyTime
+  pDelayQueue = new delayQueue( now );
+
+  // lends idle workers across the queues that declare a poolWeight
+  if( pOptionsNucleus->bSharedPool ) pSharedPool = new sharedPool();
 
   // create the queues
   createQueues();
@@ -303,6 +359,25 @@ void nucleus::init( )
   // create the receive socket object - from where our instructions originate
   pRecSock = new unixSocket( eventSourceFd, unixSocket::ET_QUEUE_EVENT, false, "nucleusFd1" );
   pRecSock->setNonblocking( );
+  pRecSock->setReadAhead( true );
+
+  // the events the other shards pass on arrive on the links to them - only this shard writes to
+  // its end so a frame the non blocking write leaves in part cannot be interleaved
+  for( unsigned int i = 0; i < shardFds.size(); i++ )
+  {
+    if( (int)i == shard ) continue;
+    char name[32];
+    sprintf( name, "shardLink%u", i );
+    unixSocket* pSock = new unixSocket( shardFds[i], unixSocket::ET_QUEUE_EVENT, false, name );
+    pSock->setNonblocking( );
+    pSock->setReadAhead( true );
+    shardLinkSocks.push_back( pSock );
+  } // for
+
+  // timer for the queue maintenance, expired event scans and the delay queue
+  timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC );
+  if( timerFd == -1 ) throw Exception( log, log.ERROR, "init: timerfd_create failed: %s", strerror(errno) );
+  pTimerSock = new unixSocket( timerFd, unixSocket::ET_TIMER, false, "timerFd" );
 
   buildLookupMaps();
 } // init
@@ -364,7 +439,16 @@ bool nucleus::createQueue( const std::string& q )
 
   if( pOptionsNucleus->existVar(key.c_str()) )
   {
-    pOptionsNucleus->getAsString( key.c_str(), queueDesc[numQueues].name );
+    std::string name;
+    pOptionsNucleus->getAsString( key.c_str(), name );
+    int owner = (shardFds.size()>1)?pOptions->getQueueShard( name ):shard;
+    if( owner != shard )
+    {
+      remoteQueues[name] = owner;
+      log.info( log.LOGALWAYS, "createQueue: queue:'%s' belongs to shard %d", name.c_str(), owner );
+      return false;
+    } // if
+    queueDesc[numQueues].name = name;
     queueDesc[numQueues].key = baseName;
     key.assign( baseName ); key.append( "type" );
     pOptionsNucleus->getAsString( key.c_str(), queueDesc[numQueues].type );
@@ -376,6 +460,7 @@ bool nucleus::createQueue( const std::string& q )
     log.info( log.LOGALWAYS, "createQueue: queue:%s name:'%s' type:'%s'", key.c_str(), queueDesc[numQueues].name.c_str(), queueDesc[numQueues].type.c_str() );
     queueDesc[numQueues].pQueue = new queueContainer( &queueDesc[numQueues], theRecoveryLog, bRecoveryProcess, eventSourceWriteFd );
     queues.insert( queueContainerStrPairT(queueDesc[numQueues].name,queueDesc[numQueues].pQueue) );
+    if( pSharedPool != NULL ) pSharedPool->addQueue( queueDesc[numQueues].pQueue );
     totNumWorkers += queueDesc[numQueues].numWorkers;
 
     // create the stats directory if it does not exist
@@ -404,6 +489,7 @@ void nucleus::dropQueue( const std::string& q )
   tQueueDescriptor* newQueueDesc = new tQueueDescriptor[pOptionsNucleus->maxNumQueues];
   int numNewQueues = 0;
   int numQueuesDropped = 0;
+  remoteQueues.erase( q );
 
   for( unsigned int i = 0; i < numQueues; i++ )
   {
@@ -418,7 +504,29 @@ void nucleus::dropQueue( const std::string& q )
       newQueueDesc[numNewQueues].parseResponseForObject = queueDesc[i].parseResponseForObject;
       newQueueDesc[numNewQueues].bRunPriviledged = queueDesc[i].bRunPriviledged;
       newQueueDesc[numNewQueues].bBlockingWorkerSocket = queueDesc[i].bBlockingWorkerSocket;
+      newQueueDesc[numNewQueues].bBinarySections = queueDesc[i].bBinarySections;
+      newQueueDesc[numNewQueues].bEmbeddedPerl = queueDesc[i].bEmbeddedPerl;
+      newQueueDesc[numNewQueues].perlPreload = queueDesc[i].perlPreload;
+      newQueueDesc[numNewQueues].maintIntervalMs = queueDesc[i].maintIntervalMs;
+      newQueueDesc[numNewQueues].priorityLevels = queueDesc[i].priorityLevels;
+      newQueueDesc[numNewQueues].defaultPriority = queueDesc[i].defaultPriority;
+      newQueueDesc[numNewQueues].priorityAging = queueDesc[i].priorityAging;
+      newQueueDesc[numNewQueues].priorityWeights = queueDesc[i].priorityWeights;
+      newQueueDesc[numNewQueues].coalescePolicy = queueDesc[i].coalescePolicy;
+      newQueueDesc[numNewQueues].spillMaxMB = queueDesc[i].spillMaxMB;
+      newQueueDesc[numNewQueues].highWatermarkPct = queueDesc[i].highWatermarkPct;
+      newQueueDesc[numNewQueues].lowWatermarkPct = queueDesc[i].lowWatermarkPct;
+      newQueueDesc[numNewQueues].poolMin = queueDesc[i].poolMin;
+      newQueueDesc[numNewQueues].poolMax = queueDesc[i].poolMax;
+      newQueueDesc[numNewQueues].poolWeight = queueDesc[i].poolWeight;
+      newQueueDesc[numNewQueues].autoscaleMin = queueDesc[i].autoscaleMin;
+      newQueueDesc[numNewQueues].autoscaleMax = queueDesc[i].autoscaleMax;
+      newQueueDesc[numNewQueues].autoscaleTargetWait = queueDesc[i].autoscaleTargetWait;
+      newQueueDesc[numNewQueues].autoscaleInterval = queueDesc[i].autoscaleInterval;
+      newQueueDesc[numNewQueues].autoscaleMaxSpawn = queueDesc[i].autoscaleMaxSpawn;
+      newQueueDesc[numNewQueues].autoscaleIdleIntervals = queueDesc[i].autoscaleIdleIntervals;
       newQueueDesc[numNewQueues].persistentApp = queueDesc[i].persistentApp;
+      newQueueDesc[numNewQueues].pipelineDepth = queueDesc[i].pipelineDepth;
       newQueueDesc[numNewQueues].errorQueue = queueDesc[i].errorQueue;
       newQueueDesc[numNewQueues].pQueue = queueDesc[i].pQueue;
       newQueueDesc[numNewQueues].statsFile = queueDesc[i].statsFile;
@@ -431,6 +539,8 @@ void nucleus::dropQueue( const std::string& q )
       // it is the queue we need to delete
       queueContainerStrMapIteratorT it = queues.find( q );
       if( it != queues.end() ) queues.erase( it );
+      if( (queueDesc[i].pQueue != NULL) && queueDesc[i].pQueue->isFlowStopped() ) sendFlowControl( queueDesc[i].name, false );
+      if( (queueDesc[i].pQueue != NULL) && (pSharedPool != NULL) ) pSharedPool->removeQueue( queueDesc[i].pQueue );
       if( queueDesc[i].pQueue == NULL )
       {
         if( queueDesc[i].pQueue->getTotalWorkers() > 0 ) log.warn( log.LOGALWAYS, "dropQueue queue:%s workers should be 0 at this point! - a total of %d workers will be aborted", q.c_str(), queueDesc[i].pQueue->getTotalWorkers() );
@@ -468,7 +578,10 @@ void nucleus::buildLookupMaps( )
   // init the poll array with static entries
   pNetwork->buildRdPollMap();
   pNetwork->addRdFd( pRecSock );
+  for( unsigned int i = 0; i < shardLinkSocks.size(); i++ )
+    pNetwork->addRdFd( shardLinkSocks[i] );
   pNetwork->addRdFd( pSignalSock );
+  pNetwork->addRdFd( pTimerSock );
 
   for( queueContainerStrMapIteratorT it = queues.begin(); it != queues.end(); it++ )
   {
@@ -520,6 +633,7 @@ void nucleus::respawnChild( )
       queueContainer* pQueue = it->second;
       if( pQueue == NULL ) throw Exception( log, loggerDefs::ERROR, "respawnChild: pid %d pQueue is NULL", pid );
       workerPids.erase( it );
+      if( pSharedPool != NULL ) pSharedPool->workerExited( pid );
 
       // auto restart - remove stale entry from workers
       if( bRunning )
@@ -785,7 +899,18 @@ void nucleus::queueEvent( baseEvent* pEvent )
   try
   {
     queueContainer* pQueue = findQueueByName( destQueue, false );
-    if( pQueue == NULL ) pQueue = routeNonLocalqueue( destQueue );
+    if( pQueue == NULL )
+    {
+      // the owning shard or else the shard of the router queue
+      int toShard = findRemoteShard( destQueue );
+      if( (toShard == -1) && !pOptionsNucleus->notLocalqueueRouterQueue.empty() ) toShard = findRemoteShard( pOptionsNucleus->notLocalqueueRouterQueue );
+      if( toShard != -1 )
+      {
+        forwardToShard( toShard, pEvent );
+        return;
+      } // if
+      pQueue = routeNonLocalqueue( destQueue );
+    } // if
     pQueue->submitEvent( pEvent );
   } // try
   catch( Exception e )
@@ -797,9 +922,177 @@ void nucleus::queueEvent( baseEvent* pEvent )
     numRecoveryEvents++;
     sendResult( pEvent, false, std::string(), std::string(), std::string(), std::string(reason) );
     log.error() << "queueEvent: '" << reason << "' for event:" << pEvent->toString();
+    baseEvent::release( pEvent );
   } // catch
 } // queueEvent
 
+/**
+ * hold an event until its readyTime
+ * @param pEvent - readyTime is an offset to the current time on submission
+ * **/
+void nucleus::delayEvent( baseEvent* pEvent )
+{
+  unsigned int readyTime = now + pEvent->getReadyTime();
+  pEvent->setReadyTime( readyTime );
+  pDelayQueue->insert( pEvent );
+  log.info( log.LOGNORMAL, "delayEvent: to queue '%s' ready at %u", pEvent->getDestQueue().c_str(), readyTime );
+  unsigned long long readyMs = nowMs + (unsigned long long)(readyTime-now-1)*1000;   // lower bound - now is whole seconds
+  if( readyMs < nextTimerMs ) armTimer();
+} // delayEvent
+
+/**
+ * queue the delayed events that have become ready - commands are sent to the main
+ * process as the networkIf would have done without the delay
+ * **/
+void nucleus::releaseDelayedEvents( )
+{
+  delayEventListT ready;
+  pDelayQueue->advance( now, ready );
+  for( unsigned int i = 0; i < ready.size(); i++ )
+  {
+    baseEvent* pEvent = ready[i];
+    pEvent->setReadyTime( 0 );
+    if( pEvent->getType() == baseEvent::EV_COMMAND )
+    {
+      log.info( log.LOGNORMAL, "releaseDelayedEvents: command %s to the main process", pEvent->commandToString() );
+      pEvent->serialise( parentFd );
+      baseEvent::release( pEvent );
+    } // if
+    else
+      queueEvent( pEvent );
+  } // for
+} // releaseDelayedEvents
+
+/**
+ * dumps the delayed events to the recovery log - readyTime stays absolute and is
+ * converted back to an offset when the event is recovered
+ * expired events are not dumped
+ * @param reason
+ * **/
+void nucleus::dumpDelayedEvents( const char* reason )
+{
+  delayEventListT pending;
+  pDelayQueue->drain( pending );
+  int count = 0;
+  int numExpiredEvents = 0;
+  for( unsigned int i = 0; i < pending.size(); i++ )
+  {
+    baseEvent* pEvent = pending[i];
+    if( !pEvent->isExpired( now ) )
+    {
+      theRecoveryLog->writeEntry( pEvent, reason, FROM, "delayQueue" );
+      sendResult( pEvent, false, std::string(), std::string(), std::string(), std::string("dumped") );
+      count++;
+    } // if
+    else
+    {
+      numExpiredEvents++;
+      sendResult( pEvent, false, std::string(), std::string(), std::string(), std::string("expired") );
+      log.info( log.LOGMOSTLY ) << "dumpDelayedEvents: expired event: " << pEvent->toString();
+    } // else
+    baseEvent::release( pEvent );
+  } // for
+  log.warn( log.LOGALWAYS, "dumpDelayedEvents: dumped %d entries, %d expired events, reason '%s'", count, numExpiredEvents, reason );
+} // dumpDelayedEvents
+
+/**
+ * the nucleus scheduler - releases the delayed events, scans for expired events and runs
+ * the maintenance of every queue on its own interval; then re-arms the timer
+ * cheap enough to be run on every pass of the main loop
+ * **/
+void nucleus::runTimers( )
+{
+  releaseDelayedEvents();
+
+  if( (pOptionsNucleus->expiredEventInterval > 0) && (now >= nextExpiredEventCheck) )
+  {
+    scanForExpiredEvents();
+    nextExpiredEventCheck = now + pOptionsNucleus->expiredEventInterval;
+  } // if
+
+  bool bLoggedStatus = false;
+  queueContainerStrMapIteratorT it;
+  for( it = queues.begin(); it != queues.end(); it++ )
+  {
+    queueContainer* pQueue = it->second;
+    unsigned int interval = pQueue->getMaintIntervalMs();
+    if( interval == 0 ) interval = maintIntervalMs;
+    if( interval == 0 ) continue;
+    if( pQueue->getNextMaintenanceMs() == 0 )
+      pQueue->setNextMaintenanceMs( nowMs + interval );   // new queue - first maintenance one interval out
+    else if( nowMs >= pQueue->getNextMaintenanceMs() )
+    {
+      pQueue->checkOverrunningWorkers();
+      if( pQueue->maintenance() > 0 )
+      { // the autoscaler added workers
+        buildLookupMaps();
+        pQueue->feedWorker();
+      } // if
+      if( pOptionsNucleus->bLogQueueStatus )
+      {
+        pQueue->getStatus( true );
+        bLoggedStatus = true;
+      } // if
+      pQueue->setNextMaintenanceMs( nowMs + interval );
+    } // else if
+  } // for
+  if( bLoggedStatus && !pDelayQueue->empty() ) log.info( log.LOGNORMAL, "runTimers: %s", pDelayQueue->toString().c_str() );
+
+  armTimer();
+} // runTimers
+
+/**
+ * arms the timer for the earliest of the queue maintenance schedules, the next expired
+ * event scan and the next second the delay queue has to be advanced - disarmed if none applies
+ * the timerfd is only touched if the deadline changed
+ * **/
+void nucleus::armTimer( )
+{
+  unsigned long long dueMs = ULLONG_MAX;
+  queueContainerStrMapIteratorT it;
+  for( it = queues.begin(); it != queues.end(); it++ )
+  {
+    unsigned long long queueMs = it->second->getNextMaintenanceMs();
+    if( (queueMs != 0) && (queueMs < dueMs) ) dueMs = queueMs;
+  } // for
+
+  // the expired event scan and the delay queue are scheduled in wall clock seconds
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  long long wallMs = (long long)tv.tv_sec*1000 + tv.tv_usec/1000;
+  unsigned int wallDue[2] = { (pOptionsNucleus->expiredEventInterval>0)?nextExpiredEventCheck:0, pDelayQueue->nextDue() };
+  for( int i = 0; i < 2; i++ )
+  {
+    if( wallDue[i] == 0 ) continue;
+    long long untilMs = (long long)wallDue[i]*1000 - wallMs;
+    unsigned long long ms = nowMs + ((untilMs>0)?untilMs:0);
+    if( ms < dueMs ) dueMs = ms;
+  } // for
+
+  if( dueMs == nextTimerMs ) return;
+  nextTimerMs = dueMs;
+  struct itimerspec its;
+  memset( &its, 0, sizeof(its) );
+  if( dueMs != ULLONG_MAX )
+  {
+    if( dueMs == 0 ) dueMs = 1;   // 0 would disarm
+    its.it_value.tv_sec = dueMs/1000;
+    its.it_value.tv_nsec = (dueMs%1000)*1000000;
+  } // if
+  if( timerfd_settime( timerFd, TFD_TIMER_ABSTIME, &its, NULL ) == -1 )
+    log.error( "armTimer: timerfd_settime failed: %s", strerror(errno) );
+} // armTimer
+
+/**
+ * monotonic clock in ms - the timer schedule is not affected by changes to the wall clock
+ * **/
+unsigned long long nucleus::getMonotonicMs( )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (unsigned long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+} // getMonotonicMs
+
 /**
  * find the queue to route non local queues with 
  * @param pEvent
@@ -811,6 +1104,66 @@ queueContainer* nucleus::routeNonLocalqueue( const std::string& destQueue )
   return findQueueByName( pOptionsNucleus->notLocalqueueRouterQueue );
 } // routeNonLocalqueue
 
+/**
+ * @param queueName
+ * @return the shard that owns the queue or -1 if it is local or not known to any of the shards
+ * **/
+int nucleus::findRemoteShard( const std::string& queueName )
+{
+  if( remoteQueues.empty() ) return -1;
+  std::map<std::string,int>::iterator it = remoteQueues.find( queueName );
+  if( it == remoteQueues.end() ) return -1;
+  return it->second;
+} // findRemoteShard
+
+/**
+ * passes an event on to another shard - the event is consumed
+ * @param toShard
+ * @param pEvent
+ * **/
+void nucleus::forwardToShard( int toShard, baseEvent* pEvent )
+{
+  log.info( log.LOGNORMAL, "forwardToShard: queue '%s' to shard %d", pEvent->getDestQueue().c_str(), toShard );
+  if( network::sendEvent( shardFds[toShard], pEvent ) == -1 )
+  {
+    numRecoveryEvents++;
+    log.error() << "forwardToShard: failed to pass on to shard " << toShard << " event:" << pEvent->toString();
+  } // if
+  else
+    numForwarded++;
+  baseEvent::release( pEvent );
+} // forwardToShard
+
+/**
+ * passes a CMD_NUCLEUS_CONF or CMD_WORKER_CONF on to the other shards.  A command with a queue
+ * goes to the shard that owns it; the rest - createqueue included as every shard has to learn
+ * where a new queue lives - go to all the shards
+ * @param pCommand
+ * @return true if this shard has to execute the command
+ * **/
+bool nucleus::shardCommand( baseEvent* pCommand )
+{
+  if( shardFds.size() < 2 ) return true;
+  if( !pCommand->getParam( SHARD_FWD_PARAM ).empty() ) return true;   // passed on by another shard
+
+  std::string queue = pCommand->getParam( "queue" );
+  std::string cmd = pCommand->getParam( "cmd" );
+  pCommand->addParamAsStr( SHARD_FWD_PARAM, shard );
+  if( !queue.empty() && (cmd.compare( "createqueue" ) != 0) )
+  {
+    int owner = pOptions->getQueueShard( queue );
+    if( owner == shard ) return true;
+    log.info( log.LOGMOSTLY, "shardCommand: %s for queue '%s' to shard %d", pCommand->commandToString(), queue.c_str(), owner );
+    network::sendEvent( shardFds[owner], pCommand );
+    return false;
+  } // if
+
+  for( unsigned int i = 0; i < shardFds.size(); i++ )
+    if( (int)i != shard ) network::sendEvent( shardFds[i], pCommand );
+  log.info( log.LOGMOSTLY, "shardCommand: %s '%s' to all the shards", pCommand->commandToString(), cmd.c_str() );
+  return true;
+} // shardCommand
+
 /**
  * dumps the list to the recovery log
  * expired events are not dumped
@@ -824,6 +1177,7 @@ void nucleus::dumpLists( const char* reason )
     queueContainer* pQueue = it->second;
     pQueue->dumpQueue( reason );
   } // for
+  if( !pDelayQueue->empty() ) dumpDelayedEvents( reason );
 } // dumpLists
 
 /**
@@ -841,7 +1195,7 @@ void nucleus::sendResult( baseEvent* pEvent, bool bSuccess, const std::string& r
   if( ( returnFd != -1 ) && !bRecoveryProcess && !pEvent->hasBeenExpired())
   {
     pEvent->shiftReturnFd();  // drop the return fd that we have just used
-    baseEvent* pReturn = new baseEvent( baseEvent::EV_RESULT );
+    baseEvent* pReturn = baseEvent::acquire( baseEvent::EV_RESULT );
     pReturn->setSuccess( bSuccess );
     if( !result.empty() ) pReturn->setResult( result );
     pReturn->setRef( pEvent->getRef() );
@@ -851,9 +1205,12 @@ void nucleus::sendResult( baseEvent* pEvent, bool bSuccess, const std::string& r
     if( !systemParam.empty() ) pReturn->setSystemParam( systemParam );
     pReturn->setTrace( pEvent->getTrace() );
     pReturn->setReturnFd( pEvent->getFullReturnFd() );
-    
-    pReturn->serialise( returnFd );
-    delete pReturn;
+
+    // the workers write to networkIfFd as well - a part frame left by a non blocking write would
+    // have their frames land in the middle of it
+    if( returnFd == networkIfFd ) returnFd = networkIfReturnFd;
+    network::sendEvent( returnFd, pReturn );
+    baseEvent::release( pReturn );
   } // if
 } // sendResult
 
@@ -870,19 +1227,6 @@ void nucleus::scanForExpiredEvents( )
   } // for
 } // scanForExpiredEvents
 
-/** 
- * check if any workers are overrunning execution time
- * **/
-void nucleus::checkOverrunningWorkers( )
-{
-  queueContainerStrMapIteratorT it;
-  for( it = queues.begin(); it != queues.end(); it++ )
-  {
-    queueContainer* pQueue = it->second;
-    pQueue->checkOverrunningWorkers();
-  } // for
-} // checkOverrunningWorkers
-
 /**
  * main nucleus processing loop
  * **/
@@ -890,32 +1234,33 @@ void nucleus::main( )
 {
   baseEvent::theRecoveryLog = theRecoveryLog;   // separate process - need to re-init
   
-  // set an alarm for maintenance events
+  // schedule the maintenance events
   now = time( NULL );
-  if( pOptionsNucleus->maintInterval > 0 )
-    alarm( pOptionsNucleus->maintInterval );
-  else
+  nowMs = getMonotonicMs();
+  maintIntervalMs = (pOptionsNucleus->maintIntervalMs>0)?pOptionsNucleus->maintIntervalMs:pOptionsNucleus->maintInterval*1000;
+  if( maintIntervalMs == 0 )
     log.warn( log.LOGALWAYS, "main: - not running a maintenance timer" );
   nextExpiredEventCheck = now + pOptionsNucleus->expiredEventInterval;
+  runTimers();
   
   bRunning = true;
   while( bRunning )
   {
     try
     {
-      // waitForRdEvent only returns when there is an event ready
-      // or when interrupted by a signal (timer as an example)
+      // waitForRdEvent only returns when there is an event ready - the timers included
+      // or when interrupted by a signal (a child exiting as an example)
       int numReady = pNetwork->waitForRdEvent();
       log.generateTimestamp();
 
       // retrieve the current time and update the time for all the queues
       now = log.getNow();
+      nowMs = getMonotonicMs();
       queueContainerStrMapIteratorT it1;
       for( it1 = queues.begin(); it1 != queues.end(); it1++ )
       {
         queueContainer* pQueue = it1->second;
         pQueue->setTime( now );
-        if( bTimerTick ) pQueue->maintenance();
       } // for
 
       // only execute if multiFdWaitForEvent returned with an event - otherwise
@@ -957,7 +1302,12 @@ void nucleus::main( )
                     // log.updateReference( eventRef );
 
                     if( log.wouldLog( log.HIGHLEVEL ) ) log.debug( log.HIGHLEVEL ) << "main: unserialised:" << pEvent->toString();
-                    if( pEvent->getType() == baseEvent::EV_COMMAND )
+                    if( pEvent->getReadyTime() > 0 )
+                    {
+                      // hold it until it is ready
+                      delayEvent( pEvent );
+                    } // if
+                    else if( pEvent->getType() == baseEvent::EV_COMMAND )
                     {
                       // execute command requested - rather handle all commands out of band and distribute them to all the workers if not handled here directly
                       //if( (pEvent->getCommand()==baseEvent::CMD_APP) || (pEvent->getCommand()==baseEvent::CMD_PERSISTENT_APP) )
@@ -971,13 +1321,15 @@ void nucleus::main( )
                         log.info( log.LOGNORMAL, "main: baseEvent::received a CMD_STATS" );
                         writeStats( time );
                         dumpHttp( time );
+                        if( shardFds.size() > 1 ) log.info( log.LOGMOSTLY, "main: shard %d passed %u events to the other shards", shard, numForwarded );
                         sendCommandToChildren( pEvent );
-                        delete pEvent;
+                        baseEvent::release( pEvent );
                       } // if
                       else if(pEvent ->getCommand() == baseEvent::CMD_RESET_STATS )
                       {
                         log.info( log.MIDLEVEL, "main: baseEvent::CMD_RESET_STATS" );
                         numRecoveryEvents = 0;
+                        numForwarded = 0;
                         theRecoveryLog->resetCountRecoveryLines( );
                         queueContainerStrMapIteratorT it;
                         for( it = queues.begin(); it != queues.end(); it++ )
@@ -985,7 +1337,7 @@ void nucleus::main( )
                           queueContainer* pQueue = it->second;
                           pQueue->resetStats( );
                         } // for
-                        delete pEvent;
+                        baseEvent::release( pEvent );
                       } // if
                       else if( pEvent->getCommand() == baseEvent::CMD_REOPEN_LOG )
                       {
@@ -1010,38 +1362,43 @@ void nucleus::main( )
                         sendCommandToChildren( pEvent );
                         closeStatsFiles();
                         openStatsFiles( 0, numQueues );
-                        delete pEvent;
+                        baseEvent::release( pEvent );
                       } // if
                       else if( pEvent->getCommand() == baseEvent::CMD_NUCLEUS_CONF )
                       {
                         log.info( log.LOGALWAYS, "main: baseEvent::CMD_NUCLEUS_CONF" );
-                        reconfigure( pEvent );
-                        delete pEvent;
+                        if( shardCommand( pEvent ) ) reconfigure( pEvent );
+                        baseEvent::release( pEvent );
                       } // if
                       else if( pEvent->getCommand() == baseEvent::CMD_WORKER_CONF )
                       {
                         log.info( log.LOGALWAYS, "main: baseEvent::CMD_WORKER_CONF" );
-                        workerReconfigure( pEvent );
-                        delete pEvent;
+                        if( shardCommand( pEvent ) ) workerReconfigure( pEvent );
+                        baseEvent::release( pEvent );
                       } // if
                       else if( pEvent->getCommand() == baseEvent::CMD_EXIT_WHEN_DONE )
                       {
                         log.info( log.LOGALWAYS, "main: baseEvent::CMD_EXIT_WHEN_DONE" );
                         exitWhenDone();  // give persistent workers the opportunity to exit on their own
                         bExitOnDone = true;
-                        delete pEvent;
+                        baseEvent::release( pEvent );
                       } // if
                       else if( pEvent->getCommand() == baseEvent::CMD_SHUTDOWN )
                       {
                         log.info( log.LOGALWAYS, "main: baseEvent::CMD_SHUTDOWN" );
                         bRunning = false;
-                        delete pEvent;
+                        baseEvent::release( pEvent );
                       } // if
+                      else if( findRemoteShard( pEvent->getDestQueue() ) != -1 )
+                      {
+                        // the workers of the queue are on another shard
+                        forwardToShard( findRemoteShard( pEvent->getDestQueue() ), pEvent );
+                      } // else if
                       else
                       {
                         log.info( log.LOGALWAYS, "main: passed command %s to children", pEvent->commandToString() );
                         sendCommandToChildren( pEvent );
-                        delete pEvent;
+                        baseEvent::release( pEvent );
                       } // else
                     } // if EV_COMMAND
                     else
@@ -1081,8 +1438,9 @@ void nucleus::main( )
                   {
                     queueContainer* pQueue = it->second;
                     baseEvent* pEvent = baseEvent::unSerialise( pSocket );
+                    if( pSharedPool != NULL ) pSharedPool->workerReturned( fd );
                     pQueue->releaseWorker( fd, pEvent );
-                    if( pEvent != NULL ) delete pEvent;
+                    baseEvent::release( pEvent );
                   } // if( it != workerFds.end
                   else
                     log.error( "main: fd:%d is not in workerFds", fd );
@@ -1094,6 +1452,21 @@ void nucleus::main( )
                   pNetwork->listenEvent();
                 } // case unixSocket::ET_SIGNAL:
                 break;
+              case unixSocket::ET_WRITE_READY:
+                {
+                  // one or more of the outbound buffers can be written
+                  pNetwork->writeReady();
+                } // case unixSocket::ET_WRITE_READY
+                break;
+              case unixSocket::ET_TIMER:
+                {
+                  // consume the expiration - the schedule is run once the events have been processed
+                  uint64_t expirations;
+                  if( ::read( timerFd, &expirations, sizeof(expirations) ) != sizeof(expirations) )
+                    log.debug( log.MIDLEVEL, "main: timerFd read nothing - %s", strerror(errno) );
+                  nextTimerMs = ULLONG_MAX;   // the timer is no longer armed
+                } // case unixSocket::ET_TIMER
+                break;
               default:
                 {
                   log.error( "main: not supporting eEventType:%s", unixSocket::eEventTypeToStr(pSocket->getEventType()) );
@@ -1104,29 +1477,9 @@ void nucleus::main( )
       } // if( numReady
       
       log.generateTimestamp(); // want a different log timestamp for maintenance events
-      if( bTimerTick )
-      {
-        log.info( log.LOGONOCCASION, "main: bTimerTick" );
-        bTimerTick = false;
-        if( (pOptionsNucleus->expiredEventInterval > 0) && (now >= nextExpiredEventCheck) )
-        {
-          scanForExpiredEvents();
-          nextExpiredEventCheck = now + pOptionsNucleus->expiredEventInterval;
-        } // if
-        checkOverrunningWorkers();
-
-        if( pOptionsNucleus->bLogQueueStatus )
-        {
-          queueContainerStrMapIteratorT it1;
-          for( it1 = queues.begin(); it1 != queues.end(); it1++ )
-          {
-            queueContainer* pQueue = it1->second;
-            pQueue->getStatus( true );
-          } // for
-        } // if
-
-        alarm( pOptionsNucleus->maintInterval );
-      } // if( bTimerTick
+      runTimers();
+      if( pSharedPool != NULL ) pSharedPool->balance();
+      checkFlowControl();
       if( bExitOnDone )
       {
         bool bDone = true;
@@ -1173,6 +1526,36 @@ void nucleus::main( )
   log.info( log.LOGALWAYS, "main: exit" );
 } // main
 
+/**
+ * tells the networkIf about the queues that crossed their watermarks since the last pass
+ * **/
+void nucleus::checkFlowControl( )
+{
+  if( bRecoveryProcess ) return;
+  for( unsigned int i = 0; i < numQueues; i++ )
+  {
+    if( queueDesc[i].pQueue == NULL ) continue;
+    int change = queueDesc[i].pQueue->checkFlowControl();
+    if( change != 0 ) sendFlowControl( queueDesc[i].name, change>0 );
+  } // for
+} // checkFlowControl
+
+/**
+ * sends a CMD_FLOW_CONTROL to the networkIf
+ * @param queueName
+ * @param bStop - true to stop reading from the connections feeding the queue, false to resume
+ * **/
+void nucleus::sendFlowControl( const std::string& queueName, bool bStop )
+{
+  baseEvent command( baseEvent::EV_COMMAND );
+  command.setCommand( baseEvent::CMD_FLOW_CONTROL );
+  command.addParam( "queue", queueName );
+  command.addParam( "stop", bStop?1:0 );
+  // through the outbound buffer so it cannot overtake results to the networkIf
+  if( network::sendEvent( networkIfReturnFd, &command ) == -1 )
+    log.error( "sendFlowControl: failed to notify the networkIf for queue:'%s' stop:%d", queueName.c_str(), bStop );
+} // sendFlowControl
+
 /**
  * writes queue stats in CSV files
  * **/
@@ -1371,9 +1754,6 @@ void nucleus::sigHandler( int signo )
     case SIGCHLD:
       sendSignalCommand( baseEvent::CMD_CHILD_SIGNAL );
       break;
-    case SIGALRM:
-      bTimerTick = true;
-      break;
     default:;
       fprintf( stderr, "sigHandler cannot handle signal %s", strsignal( signo ) );
   } // switch
@@ -5,8 +5,21 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		21/09/2009		Gerhardus Muller		Script created
  @version 1.0.0		20/06/2013		Gerhardus Muller		theNetworkIf for the fdsToRemainOpen list
+ @version 1.1.0		16/10/2026		agent		delay queue for events with a readyTime
+ @version 1.2.0		16/10/2026		agent		timerfd based scheduler replaces SIGALRM
+ @version 1.3.0		16/10/2026		agent		flow control to the networkIf
+ @version 1.4.0		16/10/2026		agent		shards - a nucleus process owns a partition of the queues
+ @version 1.5.0		16/10/2026		agent		shared pool
+ @version 1.5.1		17/10/2026		agent		networkIfReturnFd - a socket to the networkIf no other process writes to
+ @version 1.5.2		17/10/2026		agent		shardFds are links to the other shards - shardLinkSocks reads them
 
  @note
+ with main.nucleusShards > 1 txProc forks a nucleus per shard.  Each shard creates only the queues
+ options::getQueueShard assigns to it and records the owner of the others in remoteQueues.  An
+ event for a queue of another shard - from a worker, the Unix domain sockets (only shard 0 listens
+ on them) or a delayed event - is passed to the event socket of the owning shard.  CMD_NUCLEUS_CONF
+ and CMD_WORKER_CONF for a queue go to its owner and the rest go to all the shards, marked with
+ the shardFwd param so they are not passed on again
 
  @todo
  
@@ -23,13 +36,16 @@
 #include "nucleus/baseEvent.h"
 #include "nucleus/optionsNucleus.h"
 #include "nucleus/queueContainer.h"
+#include "nucleus/delayQueue.h"
 #include <map>
 #include <deque>
+#include <vector>
 
 class workerDescriptor;
 class recoveryLog;
 class queueContainer;
 class network;
+class sharedPool;
 
 typedef std::map<std::string,queueContainer*> queueContainerStrMapT;
 typedef queueContainerStrMapT::iterator queueContainerStrMapIteratorT;
@@ -45,10 +61,11 @@ class nucleus : public object
   public:
     static const char *const FROM;
     static const char *const TO_WORKER;
+    static const char *const SHARD_FWD_PARAM;
 
     // Methods
   public:
-    nucleus( int nucleusFd[2], int theParentFd, recoveryLog* theRecoveryLog, bool bRecovery, int theArgc, char* theArgv[], int theNetworkIf );
+    nucleus( int nucleusFd[2], int theParentFd, recoveryLog* theRecoveryLog, bool bRecovery, int theArgc, char* theArgv[], int theNetworkIf, int theNetworkIfReturn, int theShard, const std::vector<int>& theShardFds );
     virtual ~nucleus();
     virtual std::string toString ();
     void init( );
@@ -61,14 +78,24 @@ class nucleus : public object
     void dropQueue( const std::string& q );
     void respawnChild( );
     void queueEvent( baseEvent* pEvent );
+    void delayEvent( baseEvent* pEvent );
+    void releaseDelayedEvents( );
+    void dumpDelayedEvents( const char* reason );
+    void runTimers( );
+    void armTimer( );
+    static unsigned long long getMonotonicMs( );
     queueContainer* routeNonLocalqueue( const std::string& destQueue );
+    int  findRemoteShard( const std::string& queueName );
+    void forwardToShard( int toShard, baseEvent* pEvent );
+    bool shardCommand( baseEvent* pCommand );
     bool dropPriviledge( const char* user );
     void dumpLists( const char* reason );
     void signalChildren( int sig );
     void dumpHttp( const std::string& time );
     void sendResult( baseEvent* pEvent, bool bSuccess, const std::string& result, const std::string& errorString=std::string(), const std::string& traceTimestamp=std::string(), const std::string& failureCause=std::string(), const std::string& systemParam=std::string() );
     void scanForExpiredEvents( );
-    void checkOverrunningWorkers( );
+    void checkFlowControl( );
+    void sendFlowControl( const std::string& queueName, bool bStop );
     void sendCommandToChildren( baseEvent::eCommandType command );
     void sendCommandToChildren( baseEvent* pCommand );
     void exitWhenDone( );
@@ -90,7 +117,6 @@ class nucleus : public object
     static bool                 bReopenLog;                       ///< true if a signal has been received indicating all logs to be reopened
     static bool                 bResetStats;                      ///< true if a signal has been received indicating the recovery log to be reopened
     static bool                 bDump;                            ///< true if a SIGHUP has been received - dump current state and statistics + reset counters
-    static bool                 bTimerTick;                       ///< true if a timer event has occurred
     static int                  sigTermCount;                     ///< counts the number of times we have been asked to shutdown
     static recoveryLog*         theRecoveryLog;                   ///< the recovery log
     static int                  signalFd0;                        ///< signalFd[0] for the signal handling
@@ -105,17 +131,30 @@ class nucleus : public object
     unsigned int                      numQueues;                  ///< number of entries in the queueDesc array
     int                               totNumWorkers;              ///< number of workers across all the queues
     network*                          pNetwork;                   ///< network object
+    delayQueue*                       pDelayQueue;                ///< events waiting for their readyTime
+    sharedPool*                       pSharedPool;                ///< lends idle workers across the pool queues - NULL unless nucleus.bSharedPool
     unixSocket*                       pRecSock;                   ///< socket for accepting incoming events
     unixSocket*                       pSignalSock;                ///< socket for received signal events
+    unixSocket*                       pTimerSock;                 ///< socket object for the timerFd
+    int                               timerFd;                    ///< timerfd driving the maintenance, expired event scans and the delay queue
     int                               eventSourceFd;              ///< fd corresponding to pRecSock
     int                               eventSourceWriteFd;         ///< write side of the eventSourceFd socket - ie the fd for other processes to submit events to the nucleus for processing
     int                               networkIfFd;                ///< write side of the networkIF process socket
+    int                               networkIfReturnFd;          ///< write side of the socket to the networkIF that only this nucleus writes to - used instead of networkIfFd
     int                               parentFd;                   ///< parent fd
+    int                               shard;                      ///< index of this nucleus process in shardFds
+    std::vector<int>                  shardFds;                   ///< socket to each of the other shards that only this shard writes to and its own event socket (write side) at [shard] - only this shard for a recovery
+    std::vector<unixSocket*>          shardLinkSocks;             ///< the links in shardFds to the other shards read for the events they pass on
+    std::map<std::string,int>         remoteQueues;               ///< queues owned by the other shards and their shard
+    unsigned int                      numForwarded;               ///< events passed on to the other shards
     int                               numRecoveryEvents;          ///< number of recovery events in the recovery log for the time period
     int                               signalFd[2];                ///< unix domain socket to submit signal events to the process - parent listens on [1]
     bool                              bRecoveryProcess;           ///< recoveryProcess
     bool                              bExitOnDone;                ///< exit as soon as the last worker has finished
     unsigned int                      nextExpiredEventCheck;      ///< next time to check for expired event
+    unsigned int                      maintIntervalMs;            ///< maintenance interval in ms for queues without their own - 0 disables
+    unsigned long long                nextTimerMs;                ///< monotonic time in ms the timer is armed for
+    unsigned long long                nowMs;                      ///< monotonic time in ms at the beginning of the loop
     unsigned int                      now;                        ///< time at the beginning of the loop
     std::string                       hostId;                     ///< hostname entry
     int                               argc;                       ///< command line parameters
@@ -4,6 +4,18 @@
  $Id: optionsNucleus.cpp 2622 2012-10-11 15:24:56Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		22/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		documented bBinarySections
+ @version 1.2.0		16/10/2026		agent		maintIntervalMs for sub-second maintenance and the per queue maintIntervalMs
+ @version 1.3.0		16/10/2026		agent		documented the priority queue settings
+ @version 1.4.0		16/10/2026		agent		documented the batch queue settings
+ @version 1.5.0		16/10/2026		agent		spillDir and the per queue spillMaxMB
+ @version 1.6.0		16/10/2026		agent		documented the flow control watermarks
+ @version 1.7.0		16/10/2026		agent		maxWriteBufferMB
+ @version 1.8.0		16/10/2026		agent		bSharedPool and the per queue pool settings
+ @version 1.9.0		16/10/2026		agent		documented the autoscale settings
+ @version 1.10.0		16/10/2026		agent		documented coalescePolicy
+ @version 1.11.0		16/10/2026		agent		documented the embedded perl settings
+ @version 1.12.0		16/10/2026		agent		documented pipelineDepth
 
  @note
 
@@ -66,6 +78,8 @@ bool optionsNucleus::parseOptions( int ac, char* av[] )
     logFile.append( "nucleus.log" );
     statsDir = pOptions->logBaseDir;
     statsDir.append( "stats/" );
+    spillDir = pOptions->logBaseDir;
+    spillDir.append( "spill/" );
     unixSocketPath = pOptions->logBaseDir;
     unixSocketPath.append( pOptions->APP_BASE_NAME );
     unixSocketPath.append( ".sock" );
@@ -98,17 +112,21 @@ bool optionsNucleus::parseOptions( int ac, char* av[] )
       ("nucleus.logFile", po::value<std::string>(&logFile)->default_value(logFile), "log file - created in main.logBaseDir by default")
       ("nucleus.defaultLogLevel", po::value<int>(&defaultLogLevel)->default_value(5), "log levels 1-10 - only levels less or equal to this will be logged")
       ("nucleus.logGroup", po::value<std::string>(&logGroup)->default_value("uucp"), "group for log file")
-      ("nucleus.maintInterval", po::value<unsigned int>(&maintInterval)->default_value( 10 ), "timer interval used for maintenance, 0 disables, base timer for event expiration, max exec times and the delay queue")
+      ("nucleus.maintInterval", po::value<unsigned int>(&maintInterval)->default_value( 10 ), "timer interval in seconds used for maintenance, 0 disables, covers max exec times and the queue status")
+      ("nucleus.maintIntervalMs", po::value<unsigned int>(&maintIntervalMs)->default_value( 0 ), "timer interval in milliseconds used for maintenance, overrides maintInterval if non zero")
       ("nucleus.expiredEventInterval", po::value<unsigned int>(&expiredEventInterval)->default_value( 10 ), "interval in seconds between checks for expired events in the queue, 0 disables")
       ("nucleus.bLogQueueStatus", po::value<unsigned int>(&bLogQueueStatus)->default_value( 1 ), "logs queue status on maintenance interval (1 to enable, 0 to disable")
       ("nucleus.maxNumQueues", po::value<unsigned int>(&maxNumQueues)->default_value( 100 ), "max number of queues to provision for")
       ("nucleus.statsDir", po::value<std::string>(&statsDir)->default_value(statsDir), "stats directory for the queues")
+      ("nucleus.spillDir", po::value<std::string>(&spillDir)->default_value(spillDir), "directory for the segments that hold queue overflow")
       ("nucleus.activeQueues", po::value<std::string>(&activeQueues), "comma separated list of active queue names")
       ("nucleus.notLocalqueueRouterQueue", po::value<std::string>(&notLocalqueueRouterQueue), "queue that handles events destined for remote nodes")
       ("nucleus.unixSocketPath", po::value<std::string>(&unixSocketPath)->default_value(unixSocketPath), "unix socket path to submit events to the dispatcher from outside")
       ("nucleus.unixSocketStreamPath", po::value<std::string>(&unixSocketStreamPath)->default_value(unixSocketStreamPath), "unix socket path to submit events to the dispatcher from outside - stream connection")
       ("nucleus.socketGroup", po::value<std::string>(&socketGroup)->default_value("uucp"), "group for Unix domain socket")
       ("nucleus.maxNetworkDescriptors", po::value<unsigned int>(&maxNetworkDescriptors)->default_value( 300 ), "indication of the maximum num of descriptors in the epoll object")
+      ("nucleus.maxWriteBufferMB", po::value<unsigned int>(&maxWriteBufferMB)->default_value( 64 ), "limit in MB on the unwritten data buffered for a worker or return socket, 0 for no limit - events beyond it go to the recovery log")
+      ("nucleus.bSharedPool", po::value<unsigned int>(&bSharedPool)->default_value( 0 ), "lends idle workers of the queues with a poolWeight to backlogged pool queues (1 to enable, 0 to disable)")
        ;
     
 //    // queue options - think this is necessary otherwise it does not recognise it even as unparsed values
@@ -186,7 +204,31 @@ bool optionsNucleus::parseOptions( int ac, char* av[] )
       std::cout << "Queues are defined in their own section '[queues]' and should be defined as '[queues.qname].'\n";
       std::cout << "nucleus.activeQueues contains a comma separated list of qname's to be started\n";
       std::cout << "Required parameters are name (queues.qname.name - in most cases 'qname' and 'name' would be the same) and numWorkers.\n";
-      std::cout << "type('straight','collection'),maxLength,maxExecTime(0),persistentApp(none),parseResponseForObject(1),bRunPriviledged(0),bBlockingWorkerSocket(0),errorQueue(none) are optional\n";
+      std::cout << "type('straight','collection','priority','batch'),maxLength,maxExecTime(0),persistentApp(none),parseResponseForObject(1),bRunPriviledged(0),bBlockingWorkerSocket(0),bBinarySections(0),errorQueue(none) are optional\n";
+      std::cout << "bBlockingWorkerSocket(0) no longer applies to writes - the nucleus never blocks writing to a worker and buffers what the socket does not accept\n";
+      std::cout << "bBinarySections(0) exchanges events with the workers in the compact binary section encoding rather than json\n";
+      std::cout << "bEmbeddedPerl(0) runs EV_PERL events in a Perl interpreter inside the worker that keeps the compiled scripts - requires a build with EMBEDDED_PERL\n";
+      std::cout << "perlPreload(empty) comma or space separated modules the embedded interpreter loads when the worker starts\n";
+      std::cout << "maintIntervalMs(0) maintenance interval in milliseconds for the queue - 0 uses the nucleus maintenance interval\n";
+      std::cout << "priorityLevels(3) number of levels of a 'priority' queue (max 8) - events go to the level of their priority, higher is more urgent\n";
+      std::cout << "defaultPriority(0) level for events that carry no priority\n";
+      std::cout << "priorityAging(60) seconds an event waits to be promoted by one level - 0 serves strictly by priority\n";
+      std::cout << "priorityWeights(empty) comma separated events per round for each level starting at level 0 - replaces aging if set\n";
+      std::cout << "spillMaxMB(0) a 'straight' or 'priority' queue beyond maxLength spills to disk in nucleus.spillDir up to this per level - 0 dumps the queue on overflow\n";
+      std::cout << "  spilled events are not durable: unlike a dump to the recovery log they are lost if the nucleus crashes or is killed\n";
+      std::cout << "highWatermarkPct(90) percentage of maxLength at which the networkIf stops reading from the stream connections feeding the queue - 0 disables\n";
+      std::cout << "lowWatermarkPct(50) percentage of maxLength the queue has to drain to before the networkIf resumes reading\n";
+      std::cout << "coalescePolicy(empty) for a 'straight' or 'priority' queue collapses an event into the queued event with the same part2 coalesceKey - 'first' keeps the queued event, 'last' replaces it, 'append' merges the script params into it\n";
+      std::cout << "a 'batch' queue schedules fairly across the keys of events submitted to 'qname;key' - the key is an integer, 0 if omitted\n";
+      std::cout << "batchQuantum(1) events per turn for a key, mainQuantum(3) events per turn for key 0, numHotKeys(5) keys with the most events reported in the status\n";
+      std::cout << "poolWeight(0) share of a queue in the shared pool (nucleus.bSharedPool) - 0 keeps the queue out of the pool, persistent app and 'collection' queues never take part\n";
+      std::cout << "poolMin(0) workers the queue keeps for itself rather than lend, poolMax(0) limit on its own plus borrowed workers - 0 for no limit\n";
+      std::cout << "workers are only lent between queues with the same errorQueue, defaultScript, defaultUrl, parseResponseForObject, bRunPriviledged, bBinarySections and bEmbeddedPerl\n";
+      std::cout << "autoscaleMax(0) lets the nucleus size the worker pool between autoscaleMin(1) and autoscaleMax - 0 disables, numWorkers is the starting size\n";
+      std::cout << "autoscaleTargetWait(30) seconds events may wait or the backlog may take to drain before workers are added, autoscaleInterval(10) seconds between decisions\n";
+      std::cout << "autoscaleMaxSpawn(2) most workers forked per decision, autoscaleIdleIntervals(6) decisions without a backlog and with an idle worker before one is retired\n";
+      std::cout << "pipelineDepth(1) events a worker of a persistent app queue keeps outstanding with the app - responses are matched on the sysParams pipelineRef so the app may complete them in any order\n";
+      std::cout << "an app only receives more than one event at a time if it supports pipelining (see the startupinfo pipelinedepth parameter) - not for 'collection' queues\n";
       std::cout << "defaultScript(empty) used if no script is supplied with the event\n";
       std::cout << "defaultUrl(empty) used if no url is supplied with the event\n";
       std::cout << "managementQueue(empty) queue for management events - disabled if empty\n";
@@ -4,6 +4,10 @@
  $Id: optionsNucleus.h 2555 2012-09-04 14:12:00Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		22/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		maintIntervalMs for sub-second maintenance
+ @version 1.2.0		16/10/2026		agent		spillDir for queue overflow
+ @version 1.3.0		16/10/2026		agent		maxWriteBufferMB
+ @version 1.4.0		16/10/2026		agent		bSharedPool
 
  @note
 
@@ -68,6 +72,7 @@ class optionsNucleus
     // nucleus
     std::string                 logFile;              ///< log file to use
     std::string                 statsDir;             ///< stats directory to use
+    std::string                 spillDir;             ///< directory for the queue spill segments
     std::string                 activeQueues;         ///< comma separated list of active queue names
     std::string                 notLocalqueueRouterQueue; ///< queue that handles events destined for remote nodes
     std::string                 unixSocketPath;       ///< unix socket path to submit events to the dispatcher from outside
@@ -75,10 +80,13 @@ class optionsNucleus
     std::string                 socketGroup;          ///< group for Unix socket ownership
     int                         defaultLogLevel;      ///< defaultLogLevel
     unsigned int                maxNetworkDescriptors;///< indication of the maximum num of descriptors in the epoll object
-    unsigned int                maintInterval;        ///< timer interval used for maintenance, this includes event expiration, max exec times and the delay queue
+    unsigned int                maxWriteBufferMB;     ///< limit on the unwritten data buffered for a worker or return socket
+    unsigned int                maintInterval;        ///< timer interval in seconds used for maintenance, this includes max exec times and the queue status
+    unsigned int                maintIntervalMs;      ///< timer interval in milliseconds used for maintenance - overrides maintInterval if non zero
     unsigned int                expiredEventInterval; ///< interval in seconds between checks for expired events in the queue
     unsigned int                maxNumQueues;         ///< max number of queues to provision for
     unsigned int                bLogQueueStatus;      ///< logs queue status on maintenance interval
+    unsigned int                bSharedPool;          ///< lends idle workers of the pool queues to backlogged pool queues
 
     // worker
     std::string                 perlPath;             ///< path to the perl executable
@@ -0,0 +1,387 @@
+/**
+ perlExec - embedded Perl interpreter that runs EV_PERL scripts inside the worker
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#include <sstream>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include "nucleus/perlExec.h"
+#include "nucleus/baseEvent.h"
+#include "exception/Exception.h"
+
+#if defined( EMBEDDED_PERL )
+// perl.h defines a great many macros - it has to come after the C++ headers
+#include <EXTERN.h>
+#include <perl.h>
+#undef warn       // clashes with logger::warn
+
+EXTERN_C void boot_DynaLoader( pTHX_ CV* cv );
+
+/**
+ * makes XS modules loadable through DynaLoader
+ * **/
+static void xs_init( pTHX )
+{
+  newXS( (char*)"DynaLoader::boot_DynaLoader", boot_DynaLoader, (char*)__FILE__ );
+} // xs_init
+
+/**
+ * the Perl side of the executor - compiles each script into a handler sub in a package of its
+ * own, caches it on the path and restores the package variables after every run.  _eval is
+ * defined before anything else so the script cannot see any of the lexicals of the executor
+ * **/
+static const char* BOOTSTRAP =
+  "package TxProc::Embed;\n"
+  "sub _eval { eval $_[0] }\n"
+  "require Symbol;\n"
+  "our %cache;\n"
+  "our $seq = 0;\n"
+  "BEGIN { *CORE::GLOBAL::exit = sub (;$) { die bless( { status => (@_ ? $_[0] : 0) }, q{TxProc::Embed::Exit} ) }; }\n"
+  "sub preload\n"
+  "{\n"
+  "  my $failed = q{};\n"
+  "  foreach my $module ( @_ )\n"
+  "  {\n"
+  "    if( $module !~ /^\\w+(?:::\\w+)*$/ ) { $failed .= qq{'$module': not a module name\\n}; next; }\n"
+  "    _eval( qq{require $module; 1} ) or $failed .= qq{'$module': $@};\n"
+  "  }\n"
+  "  return $failed;\n"
+  "}\n"
+  "sub snapshot\n"
+  "{\n"
+  "  my( $pkg ) = @_;\n"
+  "  my %snap;\n"
+  "  my $stash = \\%{ $pkg . '::' };\n"
+  "  foreach my $name ( keys %$stash )\n"
+  "  {\n"
+  "    my $glob = $stash->{$name};\n"
+  "    $snap{$name} = undef;\n"
+  "    next if( ($name =~ /::$/) || (ref(\\$glob) ne q{GLOB}) );\n"
+  "    my %slot = ( scalar => ${*$glob{SCALAR}} );\n"
+  "    $slot{array} = [ @{*$glob{ARRAY}} ] if( defined *$glob{ARRAY} );\n"
+  "    $slot{hash} = { %{*$glob{HASH}} } if( defined *$glob{HASH} );\n"
+  "    $snap{$name} = \\%slot;\n"
+  "  }\n"
+  "  return \\%snap;\n"
+  "}\n"
+  "sub restore\n"
+  "{\n"
+  "  my( $entry ) = @_;\n"
+  "  my $snap = $entry->{snap};\n"
+  "  my $stash = \\%{ $entry->{pkg} . '::' };\n"
+  "  foreach my $name ( keys %$stash )\n"
+  "  {\n"
+  "    next if( $name =~ /::$/ );\n"
+  "    if( !exists($snap->{$name}) ) { delete $stash->{$name}; next; }\n"
+  "    my $slot = $snap->{$name};\n"
+  "    my $glob = $stash->{$name};\n"
+  "    next if( !defined($slot) || (ref(\\$glob) ne q{GLOB}) );\n"
+  "    eval { ${*$glob{SCALAR}} = $slot->{scalar} };\n"
+  "    if( defined *$glob{ARRAY} ) { eval { @{*$glob{ARRAY}} = exists($slot->{array}) ? @{$slot->{array}} : () } }\n"
+  "    if( defined *$glob{HASH} ) { eval { %{*$glob{HASH}} = exists($slot->{hash}) ? %{$slot->{hash}} : () } }\n"
+  "  }\n"
+  "}\n"
+  "sub compile\n"
+  "{\n"
+  "  my( $path ) = @_;\n"
+  "  my @st = stat( $path );\n"
+  "  die qq{cannot stat '$path': $!\\n} if( !@st );\n"
+  "  my $entry = $cache{$path};\n"
+  "  return ( $entry, 1 ) if( $entry && ($entry->{mtime} == $st[9]) && ($entry->{size} == $st[7]) );\n"
+  "  if( $entry ) { delete $cache{$path}; Symbol::delete_package( $entry->{pkg} ); }\n"
+  "  open( my $fh, q{<}, $path ) or die qq{cannot open '$path': $!\\n};\n"
+  "  my $src = do { local $/; <$fh> };\n"
+  "  close( $fh );\n"
+  "  $src = q{} if( !defined($src) );\n"
+  "  $src =~ s/^__(?:END|DATA)__\\b.*\\z//ms;\n"
+  "  my $pkg = q{TxProc::Embed::S} . ++$seq;\n"
+  "  if( !_eval( qq{package $pkg; sub __txproc_handler {\\n#line 1 \"$path\"\\n$src\\n;}\\n1;} ) )\n"
+  "  {\n"
+  "    my $err = $@;\n"
+  "    Symbol::delete_package( $pkg );\n"
+  "    die $err;\n"
+  "  }\n"
+  "  $entry = { mtime => $st[9], size => $st[7], pkg => $pkg, handler => \\&{ $pkg . '::__txproc_handler' } };\n"
+  "  $entry->{snap} = snapshot( $pkg );\n"
+  "  $cache{$path} = $entry;\n"
+  "  return ( $entry, 2 );\n"
+  "}\n"
+  "sub run\n"
+  "{\n"
+  "  my $path = shift;\n"
+  "  my( $entry, $compiled );\n"
+  "  my $out = q{};\n"
+  "  my $status = 0;\n"
+  "  {\n"
+  "    local *STDOUT;\n"
+  "    local *STDERR;\n"
+  "    open( STDOUT, q{>}, \\$out );\n"
+  "    *STDERR = *STDOUT;\n"
+  "    local %ENV = %ENV;\n"
+  "    local @ARGV = @_;\n"
+  "    local $0 = $path;\n"
+  "    local ( $@, $_, $/, $\\, $, );\n"
+  "    $/ = qq{\\n};\n"
+  "    if( !eval { ( $entry, $compiled ) = compile( $path ); $entry->{handler}->( @_ ); 1 } )\n"
+  "    {\n"
+  "      if( ref($@) eq q{TxProc::Embed::Exit} ) { $status = int( $@->{status} || 0 ) & 255; }\n"
+  "      else { print STDOUT $@; $status = 255; }\n"
+  "    }\n"
+  "    close( STDOUT );\n"
+  "  }\n"
+  "  restore( $entry ) if( $entry );\n"
+  "  return ( $status, $compiled || 2, $out );\n"
+  "}\n"
+  "1;\n";
+
+// signals the worker handles that a script could take over
+static const int SAVED_SIGNALS[] = { SIGTERM, SIGCHLD, SIGINT, SIGHUP, SIGPIPE, SIGALRM, SIGUSR1, SIGUSR2 };
+static const int NUM_SAVED_SIGNALS = sizeof(SAVED_SIGNALS)/sizeof(SAVED_SIGNALS[0]);
+static bool bPerlSysInit = false;
+
+/**
+ * constructor - creates the interpreter and loads the executor and the preloaded modules
+ * @param theQueueName - for logging
+ * @param thePreload - comma or space separated list of modules to load up front
+ * @exception on failure to create the interpreter
+ * **/
+perlExec::perlExec( const std::string& theQueueName, const std::string& thePreload )
+  : object( "perlExec" )
+{
+  char tmp[64];
+  snprintf( tmp, sizeof(tmp), "perlExec-%s", theQueueName.c_str() );
+  log.setInstanceName( tmp );
+  log.setAddPid( true );
+  pPerl = NULL;
+  lastCache = CACHE_NONE;
+  numHits = 0;
+  numCompiles = 0;
+  cwdFd = open( ".", O_RDONLY|O_DIRECTORY|O_CLOEXEC );
+  if( cwdFd == -1 ) log.warn( log.LOGALWAYS, "perlExec: cannot open the working directory: %s", strerror(errno) );
+
+  if( !bPerlSysInit )
+  {
+    int argc = 0;
+    char** argv = NULL;
+    char** env = NULL;
+    PERL_SYS_INIT3( &argc, &argv, &env );
+    bPerlSysInit = true;
+  } // if
+
+  PerlInterpreter* my_perl = perl_alloc();
+  if( my_perl == NULL ) throw Exception( log, log.ERROR, "perlExec: perl_alloc failed" );
+  PERL_SET_CONTEXT( my_perl );
+  perl_construct( my_perl );
+  pPerl = (struct interpreter*)my_perl;
+  PL_exit_flags |= PERL_EXIT_DESTRUCT_END;
+
+  // perl writes $0 into the argv it was started with so it has to be writable and outlive the interpreter
+  static char arg0[] = "txProc";
+  static char arg1[] = "-e";
+  static char arg2[] = "0";
+  static char* args[] = { arg0, arg1, arg2, NULL };
+  if( (perl_parse( my_perl, xs_init, 3, args, NULL ) != 0) || (perl_run( my_perl ) != 0) )
+    throw Exception( log, log.ERROR, "perlExec: failed to start the interpreter" );
+  eval_pv( BOOTSTRAP, FALSE );
+  if( SvTRUE( ERRSV ) ) throw Exception( log, log.ERROR, "perlExec: failed to load the executor: %s", SvPV_nolen( ERRSV ) );
+
+  preload( thePreload );
+  log.info( log.LOGMOSTLY, "perlExec: perl %s preload:'%s'", PERL_API_VERSION_STRING, thePreload.c_str() );
+} // perlExec
+
+/**
+ * destructor - runs the END blocks of the scripts
+ * **/
+perlExec::~perlExec()
+{
+  if( pPerl != NULL )
+  {
+    PerlInterpreter* my_perl = (PerlInterpreter*)pPerl;
+    PERL_SET_CONTEXT( my_perl );
+    perl_destruct( my_perl );
+    perl_free( my_perl );
+  } // if
+  if( cwdFd != -1 ) close( cwdFd );
+} // ~perlExec
+
+/**
+ * @return true if built with EMBEDDED_PERL
+ * **/
+bool perlExec::isAvailable( )
+{
+  return true;
+} // isAvailable
+
+/**
+ * loads the modules every script can then use without compiling them
+ * @param modules - comma or space separated
+ * **/
+void perlExec::preload( const std::string& modules )
+{
+  std::vector<std::string> moduleList;
+  size_t pos = 0;
+  while( pos < modules.length() )
+  {
+    size_t end = modules.find_first_of( ", ", pos );
+    if( end == std::string::npos ) end = modules.length();
+    if( end > pos ) moduleList.push_back( modules.substr( pos, end-pos ) );
+    pos = end+1;
+  } // while
+  if( moduleList.empty() ) return;
+
+  PerlInterpreter* my_perl = (PerlInterpreter*)pPerl;
+  dSP;
+  ENTER;
+  SAVETMPS;
+  PUSHMARK( SP );
+  for( unsigned int i = 0; i < moduleList.size(); i++ )
+    XPUSHs( sv_2mortal( newSVpvn( moduleList[i].data(), moduleList[i].length() ) ) );
+  PUTBACK;
+  int count = call_pv( "TxProc::Embed::preload", G_SCALAR|G_EVAL );
+  SPAGAIN;
+  std::string failed;
+  if( SvTRUE( ERRSV ) )
+    failed = SvPV_nolen( ERRSV );
+  else if( count == 1 )
+  {
+    SV* sv = POPs;      // the Sv macros evaluate their argument more than once
+    failed = SvPV_nolen( sv );
+  } // else if
+  PUTBACK;
+  FREETMPS;
+  LEAVE;
+  if( !failed.empty() ) log.warn( log.LOGALWAYS, "preload: failed to load: %s", failed.c_str() );
+} // preload
+
+/**
+ * runs a script - compiles it if it is not cached or has changed
+ * @param script - path of the script
+ * @param pEvent - supplies the script parameters
+ * @param result - out parameter with the output of the script
+ * @return the exit status of the script - 0 for success
+ * @exception if a script parameter is not a string
+ * **/
+int perlExec::run( const std::string& script, baseEvent* pEvent, std::string& result )
+{
+  std::vector<std::string> params;
+  for( unsigned int i = 0; i < pEvent->scriptParamSize(); i++ )
+    params.push_back( pEvent->getScriptParam( i ) );
+
+  // keep the worker's signal handling whatever the script does to %SIG
+  struct sigaction savedActions[NUM_SAVED_SIGNALS];
+  for( int i = 0; i < NUM_SAVED_SIGNALS; i++ )
+    sigaction( SAVED_SIGNALS[i], NULL, &savedActions[i] );
+
+  PerlInterpreter* my_perl = (PerlInterpreter*)pPerl;
+  PERL_SET_CONTEXT( my_perl );
+  dSP;
+  ENTER;
+  SAVETMPS;
+  PUSHMARK( SP );
+  XPUSHs( sv_2mortal( newSVpvn( script.data(), script.length() ) ) );
+  for( unsigned int i = 0; i < params.size(); i++ )
+    XPUSHs( sv_2mortal( newSVpvn( params[i].data(), params[i].length() ) ) );
+  PUTBACK;
+  int count = call_pv( "TxProc::Embed::run", G_ARRAY|G_EVAL );
+  SPAGAIN;
+
+  int status = 255;
+  lastCache = CACHE_NONE;
+  if( SvTRUE( ERRSV ) )
+  {
+    result.append( SvPV_nolen( ERRSV ) );
+    SP -= count;
+  } // if
+  else if( count == 3 )
+  {
+    STRLEN len;
+    SV* sv = POPs;      // the Sv macros evaluate their argument more than once
+    const char* out = SvPV( sv, len );
+    result.append( out, len );
+    lastCache = (ePerlCache)POPi;
+    status = POPi;
+  } // else if
+  else
+  {
+    log.error( "run: the executor returned %d values for '%s'", count, script.c_str() );
+    SP -= count;
+  } // else
+  PUTBACK;
+  FREETMPS;
+  LEAVE;
+
+  for( int i = 0; i < NUM_SAVED_SIGNALS; i++ )
+    sigaction( SAVED_SIGNALS[i], &savedActions[i], NULL );
+  alarm( 0 );
+  if( (cwdFd != -1) && (fchdir( cwdFd ) == -1) ) log.warn( log.LOGMOSTLY, "run: failed to restore the working directory: %s", strerror(errno) );
+
+  if( lastCache == CACHE_HIT )
+    numHits++;
+  else if( lastCache == CACHE_COMPILE )
+    numCompiles++;
+  log.debug( log.MIDLEVEL, "run: '%s' status:%d %s", script.c_str(), status, (lastCache==CACHE_HIT)?"cached":"compiled" );
+  return status;
+} // run
+
+#else
+
+/**
+ * built without EMBEDDED_PERL - the worker falls back to spawning perl
+ * @exception always
+ * **/
+perlExec::perlExec( const std::string& theQueueName, const std::string& thePreload )
+  : object( "perlExec" )
+{
+  pPerl = NULL;
+  cwdFd = -1;
+  lastCache = CACHE_NONE;
+  numHits = 0;
+  numCompiles = 0;
+  throw Exception( log, log.ERROR, "perlExec: built without EMBEDDED_PERL" );
+} // perlExec
+
+perlExec::~perlExec()
+{
+} // ~perlExec
+
+bool perlExec::isAvailable( )
+{
+  return false;
+} // isAvailable
+
+void perlExec::preload( const std::string& modules )
+{
+} // preload
+
+int perlExec::run( const std::string& script, baseEvent* pEvent, std::string& result )
+{
+  throw Exception( log, log.ERROR, "run: built without EMBEDDED_PERL" );
+} // run
+
+#endif // EMBEDDED_PERL
+
+/**
+ * Standard logging call - produces a generic text version of the perlExec.
+ * **/
+std::string perlExec::toString( )
+{
+  std::ostringstream oss;
+  oss << "perlExec hits:" << numHits << " compiles:" << numCompiles;
+  return oss.str();
+} // toString
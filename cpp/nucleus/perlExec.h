@@ -0,0 +1,70 @@
+/**
+ perlExec - embedded Perl interpreter that runs EV_PERL scripts inside the worker
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ only available if built with EMBEDDED_PERL (see PERL_H and PERL_LIBS in the Makefile).  Each
+ script is compiled once into a package of its own as the body of a handler sub and is only
+ compiled again if its mtime or size changes; the modules it uses and the modules listed in
+ perlPreload stay loaded for the life of the worker.  After each run the variables of the
+ script's package are restored to the values they had after compilation and the symbols the
+ run created are deleted; %ENV, @ARGV, $0 and the working directory are restored as well.
+ STDOUT and STDERR are captured into the result, exit() ends the script rather than the worker
+ and die() fails it with exit status 255.  As with any persistent Perl: file level lexicals
+ shared with named subs keep their first value, BEGIN blocks run once at compile time, END
+ blocks only when the worker exits, state left in other packages persists and output written
+ straight to fd 1 by child processes or XS code is not captured.  The resource limits of the
+ worker apply to the worker itself rather than to a child per event
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#if !defined( perlExec_defined_ )
+#define perlExec_defined_
+
+#include "utils/object.h"
+
+class baseEvent;
+struct interpreter;
+
+class perlExec : public object
+{
+  // Definitions
+  public:
+    enum ePerlCache { CACHE_NONE=0, CACHE_HIT=1, CACHE_COMPILE=2 };
+
+    // Methods
+  public:
+    perlExec( const std::string& theQueueName, const std::string& thePreload );
+    virtual ~perlExec();
+    virtual std::string toString ();
+    int run( const std::string& script, baseEvent* pEvent, std::string& result );
+    ePerlCache getLastCache( )                              {return lastCache;}
+    unsigned int getNumHits( )                              {return numHits;}
+    unsigned int getNumCompiles( )                          {return numCompiles;}
+    static bool isAvailable( );
+
+  private:
+    void preload( const std::string& modules );
+
+    // Properties
+  public:
+
+  protected:
+
+  private:
+    struct interpreter*               pPerl;                      ///< the embedded interpreter
+    int                               cwdFd;                      ///< working directory restored after each run
+    ePerlCache                        lastCache;                  ///< whether the last script was found compiled
+    unsigned int                      numHits;                    ///< runs of an already compiled script
+    unsigned int                      numCompiles;                ///< runs that had to compile the script
+};	// class perlExec
+
+#endif // !defined( perlExec_defined_)
@@ -7,6 +7,19 @@
  @version 1.1.0		20/10/2010		Gerhardus Muller		split per queue logging into its own file
  @version 1.2.0		30/03/2011		Gerhardus Muller		added bBlockingWorkerSocket to tQueueDescriptor
  @version 1.2.1		14/08/2012		Gerhardus Muller		pQueue and pWorkers were never deleted in the destructor
+ @version 1.3.0		16/10/2026		agent		added bBinarySections to tQueueDescriptor
+ @version 1.4.0		16/10/2026		agent		added maintIntervalMs to tQueueDescriptor
+ @version 1.5.0		16/10/2026		agent		queue type 'priority'
+ @version 1.6.0		16/10/2026		agent		queue type 'batch'
+ @version 1.7.0		16/10/2026		agent		added spillMaxMB
+ @version 1.8.0		16/10/2026		agent		flow control watermarks
+ @version 1.9.0		16/10/2026		agent		lending and borrowing of workers through the shared pool
+ @version 1.10.0		16/10/2026		agent		autoscaling of the worker pool from the maintenance schedule
+ @version 1.11.0		16/10/2026		agent		added coalescePolicy
+ @version 1.12.0		16/10/2026		agent		added bEmbeddedPerl and perlPreload
+ @version 1.13.0		16/10/2026		agent		added pipelineDepth
+ @version 1.13.1		17/10/2026		agent		no loan is recorded for an event that could not be sent to the worker
+ @version 1.13.2		17/10/2026		agent		flowStopped and numFlowStops at the end of the status so the existing columns keep their place
 
  @note
 
@@ -24,6 +37,7 @@
 #include "nucleus/straightQueue.h"
 #include "nucleus/collectionPool.h"
 #include "nucleus/collectionQueue.h"
+#include "nucleus/batchQueue.h"
 #include "nucleus/optionsNucleus.h"
 #include "nucleus/baseQueue.h"
 #include "nucleus/queueManagementEvent.h"
@@ -80,12 +94,56 @@ void queueContainer::init( )
   pContainerDesc->maxExecTime = pOptionsNucleus->getAsInt( key.c_str() );
   key.assign( pContainerDesc->key ); key.append( "persistentApp" );
   pOptionsNucleus->getAsString( key.c_str(), pContainerDesc->persistentApp );
+  key.assign( pContainerDesc->key ); key.append( "pipelineDepth" );
+  pContainerDesc->pipelineDepth = pOptionsNucleus->getAsInt( key.c_str(), 1 );
   key.assign( pContainerDesc->key ); key.append( "parseResponseForObject" );
   pContainerDesc->parseResponseForObject = pOptionsNucleus->getAsInt( key.c_str(), 1 );
   key.assign( pContainerDesc->key ); key.append( "bRunPriviledged" );
   pContainerDesc->bRunPriviledged = (bool)pOptionsNucleus->getAsInt( key.c_str(), false );
   key.assign( pContainerDesc->key ); key.append( "bBlockingWorkerSocket" );
   pContainerDesc->bBlockingWorkerSocket = (bool)pOptionsNucleus->getAsInt( key.c_str(), false );
+  key.assign( pContainerDesc->key ); key.append( "bBinarySections" );
+  pContainerDesc->bBinarySections = (bool)pOptionsNucleus->getAsInt( key.c_str(), false );
+  key.assign( pContainerDesc->key ); key.append( "bEmbeddedPerl" );
+  pContainerDesc->bEmbeddedPerl = (bool)pOptionsNucleus->getAsInt( key.c_str(), false );
+  key.assign( pContainerDesc->key ); key.append( "perlPreload" );
+  pOptionsNucleus->getAsString( key.c_str(), pContainerDesc->perlPreload );
+  key.assign( pContainerDesc->key ); key.append( "maintIntervalMs" );
+  pContainerDesc->maintIntervalMs = pOptionsNucleus->getAsInt( key.c_str(), 0 );
+  key.assign( pContainerDesc->key ); key.append( "priorityLevels" );
+  pContainerDesc->priorityLevels = pOptionsNucleus->getAsInt( key.c_str(), DEF_PRIORITY_LEVELS );
+  key.assign( pContainerDesc->key ); key.append( "defaultPriority" );
+  pContainerDesc->defaultPriority = pOptionsNucleus->getAsInt( key.c_str(), 0 );
+  key.assign( pContainerDesc->key ); key.append( "priorityAging" );
+  pContainerDesc->priorityAging = pOptionsNucleus->getAsInt( key.c_str(), DEF_PRIORITY_AGING );
+  key.assign( pContainerDesc->key ); key.append( "priorityWeights" );
+  pOptionsNucleus->getAsString( key.c_str(), pContainerDesc->priorityWeights );
+  key.assign( pContainerDesc->key ); key.append( "coalescePolicy" );
+  pOptionsNucleus->getAsString( key.c_str(), pContainerDesc->coalescePolicy );
+  key.assign( pContainerDesc->key ); key.append( "spillMaxMB" );
+  pContainerDesc->spillMaxMB = pOptionsNucleus->getAsInt( key.c_str(), DEF_SPILL_MAX_MB );
+  key.assign( pContainerDesc->key ); key.append( "highWatermarkPct" );
+  pContainerDesc->highWatermarkPct = pOptionsNucleus->getAsInt( key.c_str(), DEF_HIGH_WATERMARK_PCT );
+  key.assign( pContainerDesc->key ); key.append( "lowWatermarkPct" );
+  pContainerDesc->lowWatermarkPct = pOptionsNucleus->getAsInt( key.c_str(), DEF_LOW_WATERMARK_PCT );
+  key.assign( pContainerDesc->key ); key.append( "poolMin" );
+  pContainerDesc->poolMin = pOptionsNucleus->getAsInt( key.c_str(), 0 );
+  key.assign( pContainerDesc->key ); key.append( "poolMax" );
+  pContainerDesc->poolMax = pOptionsNucleus->getAsInt( key.c_str(), 0 );
+  key.assign( pContainerDesc->key ); key.append( "poolWeight" );
+  pContainerDesc->poolWeight = pOptionsNucleus->getAsInt( key.c_str(), 0 );
+  key.assign( pContainerDesc->key ); key.append( "autoscaleMin" );
+  pContainerDesc->autoscaleMin = pOptionsNucleus->getAsInt( key.c_str(), 1 );
+  key.assign( pContainerDesc->key ); key.append( "autoscaleMax" );
+  pContainerDesc->autoscaleMax = pOptionsNucleus->getAsInt( key.c_str(), 0 );
+  key.assign( pContainerDesc->key ); key.append( "autoscaleTargetWait" );
+  pContainerDesc->autoscaleTargetWait = pOptionsNucleus->getAsInt( key.c_str(), DEF_AUTOSCALE_TARGET_WAIT );
+  key.assign( pContainerDesc->key ); key.append( "autoscaleInterval" );
+  pContainerDesc->autoscaleInterval = pOptionsNucleus->getAsInt( key.c_str(), DEF_AUTOSCALE_INTERVAL );
+  key.assign( pContainerDesc->key ); key.append( "autoscaleMaxSpawn" );
+  pContainerDesc->autoscaleMaxSpawn = pOptionsNucleus->getAsInt( key.c_str(), DEF_AUTOSCALE_MAX_SPAWN );
+  key.assign( pContainerDesc->key ); key.append( "autoscaleIdleIntervals" );
+  pContainerDesc->autoscaleIdleIntervals = pOptionsNucleus->getAsInt( key.c_str(), DEF_AUTOSCALE_IDLE_INTERVALS );
   key.assign( pContainerDesc->key ); key.append( "errorQueue" );
   pOptionsNucleus->getAsString( key.c_str(), pContainerDesc->errorQueue );
 
@@ -144,12 +202,29 @@ void queueContainer::init( )
   bWorkersFrozen = false;
   bShutdown = false;
   bExitWhenDone = false;
+  bFlowStopped = false;
+  numFlowStops = 0;
+  lentWorkers = 0;
+  borrowedWorkers = 0;
+  numLent = 0;
+  numBorrowed = 0;
+  nextAutoscale = 0;
+  quietIntervals = 0;
+  meanExecEstimate = 0;
+  numScaleUp = 0;
+  numScaleDown = 0;
   queueName = pContainerDesc->name;
   queueType = pContainerDesc->type;
   int totalWorkers = pContainerDesc->numWorkers;
   maxQueueLength = pContainerDesc->maxLength;
+  highWatermarkPct = pContainerDesc->highWatermarkPct;
+  lowWatermarkPct = (pContainerDesc->lowWatermarkPct<highWatermarkPct)?pContainerDesc->lowWatermarkPct:highWatermarkPct;
+  setWatermarks();
   maxExecTime = pContainerDesc->maxExecTime;
+  maintIntervalMs = (pContainerDesc->maintIntervalMs>0)?pContainerDesc->maintIntervalMs:0;
+  nextMaintenanceMs = 0;
   persistentApp = pContainerDesc->persistentApp;
+  bPoolMember = pOptionsNucleus->bSharedPool && (pContainerDesc->poolWeight > 0) && persistentApp.empty() && (queueType.compare("collection") != 0);
   log.info( log.LOGMOSTLY, "init: queue:'%s', type:'%s', numWorkers:%d, maxLength:%d, maxExecTime:%d bRunPriviledged:%d persistentApp:'%s' errorQueue:'%s'",queueName.c_str(),queueType.c_str(),totalWorkers,maxQueueLength,maxExecTime,pContainerDesc->bRunPriviledged,persistentApp.c_str(),pContainerDesc->errorQueue.c_str() );
 
   if( queueType.compare("straight") == 0 )
@@ -157,6 +232,16 @@ void queueContainer::init( )
     pQueue = new straightQueue( pContainerDesc, pRecoveryLog, bRecoveryProcess );
     pWorkers = new workerPool( pContainerDesc, pRecoveryLog, bRecoveryProcess, nucleusFd );
   } // if
+  else if( queueType.compare("priority") == 0 )       // straight queue with priority levels
+  {
+    pQueue = new straightQueue( pContainerDesc, pRecoveryLog, bRecoveryProcess, "priorityQueue" );
+    pWorkers = new workerPool( pContainerDesc, pRecoveryLog, bRecoveryProcess, nucleusFd );
+  } // else if
+  else if( queueType.compare("batch") == 0 )          // fair scheduling across the keys in 'queue;key'
+  {
+    pQueue = new batchQueue( pContainerDesc, pRecoveryLog, bRecoveryProcess );
+    pWorkers = new workerPool( pContainerDesc, pRecoveryLog, bRecoveryProcess, nucleusFd );
+  } // else if
   else if( queueType.compare("collection") == 0 )     // single queue per worker
   {
     collectionPool* theWorkers = new collectionPool( pContainerDesc, pRecoveryLog, bRecoveryProcess, nucleusFd );   // contains a collection of queue/worker pairs
@@ -165,6 +250,23 @@ void queueContainer::init( )
   } // else if
   else
     throw new Exception( log, log.ERROR, "init: queue type:'%s' not supported", queueType.c_str() );
+  bAutoscale = (pContainerDesc->autoscaleMax > 0) && persistentApp.empty() && (queueType.compare("collection") != 0);
+  if( bAutoscale )
+  {
+    if( pContainerDesc->autoscaleMin < 1 ) pContainerDesc->autoscaleMin = 1;
+    if( pContainerDesc->autoscaleMax < pContainerDesc->autoscaleMin ) pContainerDesc->autoscaleMax = pContainerDesc->autoscaleMin;
+    if( pContainerDesc->autoscaleTargetWait < 1 ) pContainerDesc->autoscaleTargetWait = 1;
+    if( pContainerDesc->autoscaleMaxSpawn < 1 ) pContainerDesc->autoscaleMaxSpawn = 1;
+    log.info( log.LOGMOSTLY, "init: queue:'%s' autoscale min:%d max:%d targetWait:%ds interval:%ds maxSpawn:%d idleIntervals:%d", queueName.c_str(), pContainerDesc->autoscaleMin, pContainerDesc->autoscaleMax, pContainerDesc->autoscaleTargetWait, pContainerDesc->autoscaleInterval, pContainerDesc->autoscaleMaxSpawn, pContainerDesc->autoscaleIdleIntervals );
+  } // if
+  if( (pContainerDesc->pipelineDepth > 1) && (persistentApp.empty() || (queueType.compare("collection") == 0)) )
+  {
+    log.warn( log.LOGALWAYS, "init: queue:'%s' pipelineDepth:%d only applies to a persistent app on a queue other than 'collection' - using 1", queueName.c_str(), pContainerDesc->pipelineDepth );
+    pContainerDesc->pipelineDepth = 1;
+  } // if
+  if( pContainerDesc->pipelineDepth < 1 ) pContainerDesc->pipelineDepth = 1;
+  if( pContainerDesc->pipelineDepth > 1 ) log.info( log.LOGMOSTLY, "init: queue:'%s' pipelined with up to %d events in flight per worker", queueName.c_str(), pContainerDesc->pipelineDepth );
+  if( bPoolMember ) log.info( log.LOGMOSTLY, "init: queue:'%s' in the shared pool poolMin:%d poolMax:%d poolWeight:%d", queueName.c_str(), pContainerDesc->poolMin, pContainerDesc->poolMax, pContainerDesc->poolWeight );
 } // init
 
 /**
@@ -231,7 +333,10 @@ void queueContainer::feedWorker( )
   {
 log.debug( log.LOGSELDOM, "feedWorker fd:%d", fd );
     baseEvent* pEvent = pQueue->popAvailableEvent( fd );
-    if( pEvent != NULL ) pWorkers->executeEvent( pEvent );
+    if( pEvent != NULL )
+      pWorkers->executeEvent( pEvent );
+    else if( queueType.compare("collection") != 0 )
+      break;        // the idle worker is not consumed - only expired events or nothing could be popped
   } // while
 } // feedWorker
 
@@ -320,14 +425,194 @@ void queueContainer::resetStats( )
 {
   pQueue->resetStats();
   pWorkers->resetStats();
+  numFlowStops = 0;
+  numLent = 0;
+  numBorrowed = 0;
+  numScaleUp = 0;
+  numScaleDown = 0;
 } // resetStats
 
 /**
+ * a pool queue can lend an idle worker if it has nothing queued and keeps poolMin workers
+ * that are not on loan
+ * **/
+bool queueContainer::canLend( )
+{
+  if( !bPoolMember || bWorkersFrozen || bShutdown || bExitWhenDone ) return false;
+  if( !pWorkers->anyAvailableWorkers() || !pQueue->isQueueEmpty() ) return false;
+  return (pWorkers->getTotalWorkers()-lentWorkers-1) >= pContainerDesc->poolMin;
+} // canLend
+
+/**
+ * a pool queue can borrow a worker if it has events queued, none of its own workers are idle
+ * and its own plus borrowed workers are below poolMax
+ * **/
+bool queueContainer::canBorrow( )
+{
+  if( !bPoolMember || bWorkersFrozen || bShutdown || bExitWhenDone ) return false;
+  if( pWorkers->anyAvailableWorkers() || pQueue->isQueueEmpty() ) return false;
+  return (pContainerDesc->poolMax <= 0) || ((pWorkers->getTotalWorkers()+borrowedWorkers) < pContainerDesc->poolMax);
+} // canBorrow
+
+/**
+ * executes the next event of pBorrower on one of our idle workers
+ * @param pid - out parameter - pid of the worker
+ * @return the fd of the worker or -1 if the borrower had no event after all or it could not be sent
+ * **/
+int queueContainer::lendWorker( queueContainer* pBorrower, int& pid )
+{
+  int fd = pWorkers->getNextIdleFd( pid );
+  if( fd == -1 ) return -1;
+  baseEvent* pEvent = pBorrower->popEventForLoan();
+  if( pEvent == NULL ) return -1;
+  if( pWorkers->submitToIdleWorker( pEvent ) == -1 ) return -1;
+  lentWorkers++;
+  numLent++;
+  log.info( log.MIDLEVEL, "lendWorker: queue:'%s' lent worker pid:%d fd:%d to queue:'%s' lent:%d", queueName.c_str(), pid, fd, pBorrower->getQueueName().c_str(), lentWorkers );
+  return fd;
+} // lendWorker
+
+/**
+ * takes the next event off the queue for a borrowed worker - the queuing stats stay with this queue
+ * @return the event or NULL if the queue only had expired events
+ * **/
+baseEvent* queueContainer::popEventForLoan( )
+{
+  baseEvent* pEvent = pQueue->popAvailableEvent( -1 );
+  if( pEvent == NULL ) return NULL;
+  pWorkers->updateQueueStats( pEvent );
+  borrowedWorkers++;
+  numBorrowed++;
+  return pEvent;
+} // popEventForLoan
+
+/**
+ * a lent worker finished or died
+ * @param bLender - true on the lending side, false on the borrowing side
+ * **/
+void queueContainer::endLoan( bool bLender )
+{
+  if( bLender )
+  {
+    if( lentWorkers > 0 ) lentWorkers--;
+  } // if
+  else
+  {
+    if( borrowedWorkers > 0 ) borrowedWorkers--;
+  } // else
+} // endLoan
+
+/**
+ * derives the flow control watermarks from maxLength - a high watermark of 0 disables flow control
+ * **/
+void queueContainer::setWatermarks( )
+{
+  highWatermark = (highWatermarkPct>0)?(unsigned int)((unsigned long long)maxQueueLength*highWatermarkPct/100):0;
+  lowWatermark = (lowWatermarkPct>0)?(unsigned int)((unsigned long long)maxQueueLength*lowWatermarkPct/100):0;
+  if( (highWatermarkPct > 0) && (highWatermark == 0) ) highWatermark = 1;
+  log.info( log.LOGMOSTLY, "setWatermarks: queue:'%s' high:%u low:%u", queueName.c_str(), highWatermark, lowWatermark );
+} // setWatermarks
+
+/**
+ * compares the queue length with the watermarks - the flow is stopped at the high watermark and
+ * resumed once the queue has drained to the low watermark
+ * @return 1 if the flow has to be stopped, -1 if it can be resumed and 0 if it is unchanged
+ * **/
+int queueContainer::checkFlowControl( )
+{
+  if( highWatermark == 0 )
+  { // disabled while stopped - let it go
+    if( !bFlowStopped ) return 0;
+    bFlowStopped = false;
+    return -1;
+  } // if
+
+  unsigned int queueLength = pQueue->getQueueLength();
+  if( !bFlowStopped && (queueLength >= highWatermark) )
+  {
+    bFlowStopped = true;
+    numFlowStops++;
+    log.warn( log.LOGMOSTLY, "checkFlowControl: queue:'%s' length %u reached the high watermark %u - stopping the flow", queueName.c_str(), queueLength, highWatermark );
+    return 1;
+  } // if
+  if( bFlowStopped && (queueLength <= lowWatermark) )
+  {
+    bFlowStopped = false;
+    log.info( log.LOGMOSTLY, "checkFlowControl: queue:'%s' length %u reached the low watermark %u - resuming the flow", queueName.c_str(), queueLength, lowWatermark );
+    return -1;
+  } // if
+  return 0;
+} // checkFlowControl
+
+/**
+ * runs on the maintenance schedule of the queue
+ * @return the number of workers added - the nucleus has to pick up their fds
  * **/
-void queueContainer::maintenance( )
+int queueContainer::maintenance( )
 {
+  if( bAutoscale && (now >= nextAutoscale) )
+  {
+    nextAutoscale = now + pContainerDesc->autoscaleInterval;
+    return autoscale();
+  } // if
+  return 0;
 } // maintenance
 
+/**
+ * sizes the worker pool to the load seen since the previous decision.  The pool grows by up to
+ * autoscaleMaxSpawn workers once events wait longer than autoscaleTargetWait or the backlog
+ * would take longer than that to drain, and shrinks by a worker once there has been no backlog
+ * and an idle worker for autoscaleIdleIntervals decisions in a row.  Nothing is decided while
+ * retired workers are still on their way out as the pool size still counts them
+ * @return the number of workers added
+ * **/
+int queueContainer::autoscale( )
+{
+  tLoadSample sample;
+  pWorkers->takeLoadSample( sample );
+  if( sample.countExecEvents > 0 )
+  {
+    float meanExec = (float)sample.accExecTime/sample.countExecEvents;
+    meanExecEstimate = (meanExecEstimate==0)?meanExec:(meanExecEstimate*0.7f+meanExec*0.3f);
+  } // if
+  if( bWorkersFrozen || bShutdown || bExitWhenDone ) return 0;
+  if( pWorkers->countShuttingDown() > 0 ) return 0;
+
+  int totalWorkers = pWorkers->getTotalWorkers();
+  unsigned int backlog = pQueue->getQueueLength();
+  float meanWait = (sample.countQueueEvents>0)?(float)sample.accQueueTime/sample.countQueueEvents:0;
+  float drainTime = (totalWorkers>0)?backlog*meanExecEstimate/totalWorkers:backlog*meanExecEstimate;
+  int targetWait = pContainerDesc->autoscaleTargetWait;
+
+  if( (backlog > 0) && !pWorkers->anyAvailableWorkers() && ((meanWait > targetWait) || (drainTime > targetWait)) )
+  {
+    quietIntervals = 0;
+    if( totalWorkers >= pContainerDesc->autoscaleMax ) return 0;
+    int needed = (meanExecEstimate>0)?(int)(backlog*meanExecEstimate/targetWait)+1:totalWorkers+pContainerDesc->autoscaleMaxSpawn;
+    if( needed <= totalWorkers ) needed = totalWorkers+1;
+    int newNum = totalWorkers+pContainerDesc->autoscaleMaxSpawn;
+    if( needed < newNum ) newNum = needed;
+    if( newNum > pContainerDesc->autoscaleMax ) newNum = pContainerDesc->autoscaleMax;
+    log.info( log.LOGALWAYS, "autoscale: queue:'%s' backlog:%u meanWait:%.1fs maxWait:%us drainTime:%.1fs - growing from %d to %d workers", queueName.c_str(), backlog, meanWait, sample.maxQueueTime, drainTime, totalWorkers, newNum );
+    int numNew = pWorkers->resizeWorkerPool( newNum );
+    numScaleUp += numNew;
+    return numNew;
+  } // if
+
+  if( (backlog == 0) && pWorkers->anyAvailableWorkers() && (meanWait <= targetWait/2.0f) )
+    quietIntervals++;
+  else
+    quietIntervals = 0;
+  if( (quietIntervals >= pContainerDesc->autoscaleIdleIntervals) && (totalWorkers > pContainerDesc->autoscaleMin) )
+  {
+    quietIntervals = 0;
+    log.info( log.LOGALWAYS, "autoscale: queue:'%s' quiet for %d intervals - shrinking from %d to %d workers", queueName.c_str(), pContainerDesc->autoscaleIdleIntervals, totalWorkers, totalWorkers-1 );
+    pWorkers->resizeWorkerPool( totalWorkers-1 );
+    numScaleDown++;
+  } // if
+  return 0;
+} // autoscale
+
 /**
  * produces a csv version of the queue status and statistics
  * **/
@@ -339,6 +624,8 @@ std::string& queueContainer::getStatus( bool bLog )
   statusStr.append( pQueue->getStatus() );
   statusStr.append( "," );
   statusStr.append( pWorkers->getStatus() );
+  sprintf( stat, ",%d,%d,%u,%u,%u,%u,%d,%u", lentWorkers, borrowedWorkers, numLent, numBorrowed, numScaleUp, numScaleDown, bFlowStopped, numFlowStops );
+  statusStr.append( stat );
   if( statusStrKey.empty() ) getStatusKey();
 
   if( bLog ) log.info( log.LOGNORMAL, "getStatus: queue:'%s'(%s):%s (%s)", queueName.c_str(), queueType.c_str(), statusStr.c_str(), statusStrKey.c_str() );
@@ -354,6 +641,7 @@ std::string& queueContainer::getStatusKey( )
   statusStrKey.append( pQueue->getStatusKey() );
   statusStrKey.append( "," );
   statusStrKey.append( pWorkers->getStatusKey() );
+  statusStrKey.append( ",lentW,borrowedW,cntLent,cntBorrowed,scaleUp,scaleDown,flowStopped,numFlowStops" );
 
   return statusStrKey;
 } // getStatusKey
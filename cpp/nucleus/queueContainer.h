@@ -5,6 +5,16 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		16/09/2009		Gerhardus Muller		Script created
  @version 1.1.0		30/03/2011		Gerhardus Muller		added bBlockingWorkerSocket to tQueueDescriptor
+ @version 1.2.0		16/10/2026		agent		added bBinarySections to tQueueDescriptor
+ @version 1.3.0		16/10/2026		agent		added maintIntervalMs to tQueueDescriptor and a per queue maintenance schedule
+ @version 1.4.0		16/10/2026		agent		added the priority queue settings to tQueueDescriptor
+ @version 1.5.0		16/10/2026		agent		added spillMaxMB to tQueueDescriptor
+ @version 1.6.0		16/10/2026		agent		high / low watermarks for flow control to the networkIf
+ @version 1.7.0		16/10/2026		agent		shared pool settings and lending / borrowing of workers
+ @version 1.8.0		16/10/2026		agent		autoscaling of the worker pool
+ @version 1.9.0		16/10/2026		agent		added coalescePolicy to tQueueDescriptor
+ @version 1.10.0		16/10/2026		agent		added bEmbeddedPerl and perlPreload to tQueueDescriptor
+ @version 1.11.0		16/10/2026		agent		added pipelineDepth to tQueueDescriptor
 
  @note
 
@@ -38,7 +48,29 @@ struct tQueueDescriptor
   int                       parseResponseForObject;   // default 1
   bool                      bRunPriviledged;          // if true the worker will not drop its priviledges permanently - default false
   bool                      bBlockingWorkerSocket;    // if true use a blocking socket to communicate with the worker - default false
+  bool                      bBinarySections;          // if true events are exchanged with the workers in the binary section encoding - default false
+  bool                      bEmbeddedPerl;            // if true EV_PERL events run in an interpreter embedded in the worker - default false
+  std::string               perlPreload;              // modules the embedded interpreter loads at startup - comma or space separated
+  int                       maintIntervalMs;          // maintenance interval for the queue in ms - default 0 uses the nucleus interval
+  int                       priorityLevels;           // number of levels of a priority queue - default DEF_PRIORITY_LEVELS
+  int                       defaultPriority;          // level for events without a priority - default 0
+  int                       priorityAging;            // seconds of waiting that promote an event by one level - default DEF_PRIORITY_AGING, 0 disables
+  std::string               priorityWeights;          // comma separated events per round for each level starting at 0 - replaces aging if set
+  std::string               coalescePolicy;           // 'first', 'last' or 'append' to collapse events with the coalesce key of a queued event - default empty disables
+  int                       spillMaxMB;               // limit on the disk spill of each level beyond maxLength - default DEF_SPILL_MAX_MB, 0 disables
+  int                       highWatermarkPct;         // percentage of maxLength at which the networkIf stops reading for the queue - default DEF_HIGH_WATERMARK_PCT, 0 disables
+  int                       lowWatermarkPct;          // percentage of maxLength at which reading resumes - default DEF_LOW_WATERMARK_PCT
+  int                       poolMin;                  // workers the queue never lends to the shared pool - default 0
+  int                       poolMax;                  // limit on own plus borrowed workers serving the queue - default 0 for no limit
+  int                       poolWeight;               // share of the queue in the shared pool - default 0 keeps it out of the pool
+  int                       autoscaleMin;             // least workers the autoscaler shrinks to - default 1
+  int                       autoscaleMax;             // most workers the autoscaler grows to - default 0 disables autoscaling
+  int                       autoscaleTargetWait;      // seconds an event should wait in the queue - default DEF_AUTOSCALE_TARGET_WAIT
+  int                       autoscaleInterval;        // seconds between autoscaler decisions - default DEF_AUTOSCALE_INTERVAL
+  int                       autoscaleMaxSpawn;        // most workers forked per decision - default DEF_AUTOSCALE_MAX_SPAWN
+  int                       autoscaleIdleIntervals;   // quiet decisions in a row before a worker is retired - default DEF_AUTOSCALE_IDLE_INTERVALS
   std::string               persistentApp;            // persistent application to execute
+  int                       pipelineDepth;            // events a persistent app worker has outstanding with the app - default 1
   std::string               defaultScript;            // default script if the EV_PERL etc specifies none
   std::string               defaultUrl;               // default URL to use if the EV_URL specifies none
   std::string               errorQueue;               // for failures place a copy of the event on this queue with its type changed to EV_ERROR rather than generating a recovery event
@@ -58,6 +90,15 @@ class queueContainer : public object
   public:
   static const int DEF_MAX_QUEUE_LEN = 500000;
   static const int DEF_NUM_QUEUE_WORKERS = 2;
+  static const int DEF_PRIORITY_LEVELS = 3;
+  static const int DEF_PRIORITY_AGING = 60;
+  static const int DEF_SPILL_MAX_MB = 0;
+  static const int DEF_HIGH_WATERMARK_PCT = 90;
+  static const int DEF_LOW_WATERMARK_PCT = 50;
+  static const int DEF_AUTOSCALE_TARGET_WAIT = 30;
+  static const int DEF_AUTOSCALE_INTERVAL = 10;
+  static const int DEF_AUTOSCALE_MAX_SPAWN = 2;
+  static const int DEF_AUTOSCALE_IDLE_INTERVALS = 6;
 
   // Methods
   public:
@@ -74,7 +115,7 @@ class queueContainer : public object
   int  getNextFd( int& pid, unixSocket*& pSocket )  {return pWorkers->getNextFd(pid,pSocket);}
   void signalChildren( int sig )                    {pWorkers->signalChildren(sig);}
   int  resizeWorkerPool( int newNum )               {return pWorkers->resizeWorkerPool(newNum);}
-  void setMaxQueueLen( int m )                      {pQueue->setMaxQueueLen(m);log.info(log.LOGMOSTLY,"setMaxQueueLen:%d",m);}
+  void setMaxQueueLen( int m )                      {maxQueueLength=m;setWatermarks();pQueue->setMaxQueueLen(m);log.info(log.LOGMOSTLY,"setMaxQueueLen:%d",m);}
   void setMaxExecTime( unsigned int m )             {pWorkers->setMaxExecTime(m);}
   void freeze( bool bFreeze );
   void submitEvent( baseEvent* pEvent );
@@ -92,16 +133,34 @@ class queueContainer : public object
   void releaseWorker( int fd, baseEvent* pEvent );
   void setTime( unsigned int t )                    {now=t;pWorkers->setTime(t);pQueue->setTime(t);}
   unixSocket* getWorkerSock( int workerFd )         {return pWorkers->getWorkerSock(workerFd);}
-  void maintenance( );
+  int  maintenance( );
+  unsigned int getMaintIntervalMs( )                {return maintIntervalMs;}
+  unsigned long long getNextMaintenanceMs( )        {return nextMaintenanceMs;}
+  void setNextMaintenanceMs( unsigned long long t ) {nextMaintenanceMs=t;}
   void reconfigureCmd( baseEvent* pCommand );
   void sendCommandToChildren( baseEvent* pCommand ) {pWorkers->sendCommandToChildren(pCommand);}
   void exitWhenDone( );
   void shutdown( )                                  {termChildren();freeze(true);bShutdown=true;}
   bool isShutdown( )                                {return bShutdown;}
   void reopenLogfile( );
+  int  checkFlowControl( );
+  bool isFlowStopped( )                             {return bFlowStopped;}
+  tQueueDescriptor* getQueueDescriptor( )           {return pContainerDesc;}
+  bool isPoolMember( )                              {return bPoolMember;}
+  unsigned int getQueueLength( )                    {return pQueue->getQueueLength();}
+  int  getLentWorkers( )                            {return lentWorkers;}
+  int  getBorrowedWorkers( )                        {return borrowedWorkers;}
+  int  getPoolWeight( )                             {return pContainerDesc->poolWeight;}
+  bool canLend( );
+  bool canBorrow( );
+  int  lendWorker( queueContainer* pBorrower, int& pid );
+  baseEvent* popEventForLoan( );
+  void endLoan( bool bLender );
 
   private:
   void init( );
+  void setWatermarks( );
+  int  autoscale( );
 
   protected:
 
@@ -124,10 +183,29 @@ class queueContainer : public object
   bool                              bWorkersFrozen;       ///< execution frozen
   bool                              bShutdown;            ///< has been shut down
   bool                              bExitWhenDone;        ///< shutdown procedure for persistent apps
+  bool                              bFlowStopped;         ///< the networkIf has been told to stop reading for the queue
+  bool                              bPoolMember;          ///< takes part in the shared pool
+  unsigned int                      highWatermark;        ///< queue length at which the flow is stopped - 0 disables flow control
+  unsigned int                      lowWatermark;         ///< queue length at which the flow resumes
+  unsigned int                      numFlowStops;         ///< times the flow has been stopped since the stats were reset
+  int                               lentWorkers;          ///< own workers executing an event of another queue
+  int                               borrowedWorkers;      ///< workers of other queues executing an event of this queue
+  unsigned int                      numLent;              ///< events executed for other queues since the stats were reset
+  unsigned int                      numBorrowed;          ///< events executed by workers of other queues since the stats were reset
+  bool                              bAutoscale;           ///< the autoscaler sizes the worker pool
+  unsigned int                      nextAutoscale;        ///< time of the next autoscaler decision
+  int                               quietIntervals;       ///< decisions in a row without a backlog and with idle workers
+  float                             meanExecEstimate;     ///< smoothed mean execution time in seconds
+  unsigned int                      numScaleUp;           ///< workers added by the autoscaler since the stats were reset
+  unsigned int                      numScaleDown;         ///< workers retired by the autoscaler since the stats were reset
+  int                               highWatermarkPct;     ///< high watermark as a percentage of maxQueueLength
+  int                               lowWatermarkPct;      ///< low watermark as a percentage of maxQueueLength
   int                               nucleusFd;            ///< nucleus process fd
   unsigned int                      maxExecTime;          ///< max time a worker is allowed to run in seconds, 0 disables
   unsigned int                      now;                  ///< current time
   unsigned int                      maxQueueLength;       ///< max length of the queue
+  unsigned int                      maintIntervalMs;      ///< maintenance interval in ms, 0 uses the nucleus interval
+  unsigned long long                nextMaintenanceMs;    ///< monotonic time in ms of the next maintenance - scheduled by the nucleus
 };	// class queueContainer
 
 #endif // !defined( queueContainer_defined_)
@@ -0,0 +1 @@
+../application/recoveryLog.h
\ No newline at end of file
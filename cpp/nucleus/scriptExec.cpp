@@ -11,6 +11,10 @@
  @version 1.4.0		11/10/2012		Gerhardus Muller		finer grained reporting of the return status of a process for queue event management and the tracking of the pid of the process that has exited before it is started up again
  @version 1.5.0		28/02/2013		Gerhardus Muller		support for reading fragments for the output of a persistent process
  @version 1.6.0		06/11/2013		Gerhardus Muller		compilation under debian
+ @version 1.7.0		16/10/2026		agent		EV_PERL can run in an embedded interpreter
+ @version 1.8.0		16/10/2026		agent		posix_spawn rather than fork with close-on-exec pipes; spawn latency; shellEscape without a regex
+ @version 1.9.0		16/10/2026		agent		writePipe / readPipeEvent for a worker with several events in flight to a persistent app
+ @version 1.9.1		17/10/2026		agent		the stdin of a pipelined app is non blocking - writePipe buffers what the pipe does not accept and flushPipe writes it once the pipe is writable
 
  @note
 
@@ -22,6 +26,10 @@
  */
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/types.h> 
 #include <sys/wait.h>
 #include <vector>
@@ -31,6 +39,7 @@
 #include "nucleus/scriptExec.h"
 #include "nucleus/baseEvent.h"
 #include "nucleus/queueManagementEvent.h"
+#include "nucleus/perlExec.h"
 #include "utils/utils.h"
 
 /**
@@ -53,6 +62,10 @@ scriptExec::scriptExec( int thePid )
   bPersistentApp = false;
   bParseResponseForObject = false;
   pRecSock = NULL;
+  pPerlExec = NULL;
+  perlCache = perlExec::CACHE_NONE;
+  spawnUs = 0;
+  pipelineDepth = 1;
 }
 
 scriptExec::scriptExec( int thePid, const std::string& perl, const std::string& shell, const std::string& execSuc, const std::string& execFail, const std::string& errorPref, const std::string& tracePref, const std::string& paramPref, const std::string& theQueueName, bool theParseResponseForObject, const std::string& theDefaultScript )
@@ -86,6 +99,10 @@ scriptExec::scriptExec( int thePid, const std::string& perl, const std::string&
   bPersistentApp = false;
   pRecSock = NULL;
   pQueueManagement = NULL;
+  pPerlExec = NULL;
+  perlCache = perlExec::CACHE_NONE;
+  spawnUs = 0;
+  pipelineDepth = 1;
 }	// scriptExec
 
 /**
@@ -193,6 +210,8 @@ bool scriptExec::process( baseEvent* pEvent, std::string& result, baseEvent* &pR
   traceTimestamp.erase();
   systemParam.erase();
   failureCause.erase();
+  perlCache = perlExec::CACHE_NONE;
+  spawnUs = 0;
   result.reserve( 4096 );
   
   try
@@ -253,9 +272,15 @@ bool scriptExec::process( baseEvent* pEvent, std::string& result, baseEvent* &pR
 std::string scriptExec::shellEscape( const std::string& str )
 {
   std::string retString;
-  boost::regex reg( "(')" );    // replace all single quotes with '\''
-  retString = "'";              // single quote each parameter and escape single quotes
-  retString += boost::regex_replace( str, reg, "'\\\\''" ); // the regex doubles the \ and the C-string
+  retString.reserve( str.length()+8 );
+  retString = "'";              // single quote each parameter and replace all single quotes with '\''
+  for( std::string::const_iterator it = str.begin(); it != str.end(); it++ )
+  {
+    if( *it == '\'' )
+      retString += "'\\''";
+    else
+      retString += *it;
+  } // for
   retString += "'";
   return retString;
 } // shellEscape
@@ -288,8 +313,13 @@ bool scriptExec::execScript( baseEvent* pEvent, std::string& resultLine )
   bool bSuccess;
   try
   {
-    spawnScript( pEvent, bPersistentApp );
-    bSuccess = readPipe( resultLine );
+    if( (pPerlExec!=NULL) && !bPersistentApp && (pEvent->getType()==baseEvent::EV_PERL) )
+      bSuccess = runEmbedded( pEvent, resultLine );
+    else
+    {
+      spawnScript( pEvent, bPersistentApp );
+      bSuccess = readPipe( resultLine );
+    } // else
   } // try
   catch( Exception e )
   {
@@ -298,6 +328,33 @@ bool scriptExec::execScript( baseEvent* pEvent, std::string& resultLine )
   return bSuccess;
 } // execScript
 
+/**
+ * runs an EV_PERL script in the embedded interpreter - the output and exit status are
+ * reported as if the script was spawned
+ * @param pEvent
+ * @param resultLine - output returned
+ * @return true if the script exited with 0
+ * @exception on a script parameter that is not a string
+ * **/
+bool scriptExec::runEmbedded( baseEvent* pEvent, std::string& resultLine )
+{
+  scriptCmd = pEvent->getScriptName();
+  if( scriptCmd.empty() && (defaultScript.length()>0) ) scriptCmd = defaultScript;
+  log.info( log.LOGMOSTLY ) << "runEmbedded: cmd:" << scriptCmd;
+
+  exitStatus = pPerlExec->run( scriptCmd, pEvent, resultLine );
+  perlCache = pPerlExec->getLastCache();
+  exitedChildPid = pid;
+  termSignal = 0;
+  if( exitStatus != 0 )
+  {
+    log.error( ) << "runEmbedded: bad exit status:" << exitStatus << " for '" << scriptCmd << "'";
+    failureCause = "execFailure";
+    return false;
+  } // if
+  return true;
+} // runEmbedded
+
 /**
  Executes the reporting script, captures stdout and stderr
  @param pEvent
@@ -360,8 +417,11 @@ void scriptExec::spawnScript( baseEvent* pEvent, bool bPersistent )
   
   // we always use a pipe to collect the stdout from the child. for persistent apps
   // we create two more pipes - one for stdin and one for stderr. for non-persistent
-  // apps we send the child's stderr to the stdout
-  int res = pipe( pipefdStdOut );
+  // apps we send the child's stderr to the stdout.  the pipes are close-on-exec - the
+  // child only keeps the ends that are dup'ed onto its stdio
+  struct timespec spawnStart;
+  clock_gettime( CLOCK_MONOTONIC, &spawnStart );
+  int res = pipe2( pipefdStdOut, O_CLOEXEC );
   if( res != 0 )
   {
     delete[] argsArr;
@@ -369,93 +429,98 @@ void scriptExec::spawnScript( baseEvent* pEvent, bool bPersistent )
   } // if
   if( bPersistentApp )
   {
-    res = pipe( pipefdStdIn );
+    res = pipe2( pipefdStdIn, O_CLOEXEC );
     if( res != 0 )
     {
       delete[] argsArr;
       throw Exception( log, log.ERROR, "spawnScript: pipe in create failed %s", strerror( errno ) );
     } // if
-    res = pipe( pipefdStdErr );
+    res = pipe2( pipefdStdErr, O_CLOEXEC );
     if( res != 0 )
     {
       delete[] argsArr;
       throw Exception( log, log.ERROR, "spawnScript: pipe err create failed %s", strerror( errno ) );
     } // if
   } // if
-  
-  exitedChildPid = -1;
-  childPid = fork();
-  switch( childPid ) 
+
+  // posix_spawn has vfork semantics - the worker's page tables are not copied and the
+  // exec failure is reported back here rather than by the child
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init( &actions );
+  posix_spawn_file_actions_adddup2( &actions, pipefdStdOut[1], STDOUT_FILENO );
+  if( bPersistentApp )
   {
-    case -1:  // error
-      delete[] argsArr;
-      throw Exception( log, log.ERROR, "spawnScript: could not fork" );
-      break;
-    case 0: // child
-      {
-        // always capture stdout to the pipe pipefdStdOut. if not persistent
-        // then capture stderr to the same pipe
-        // if persistent capture stderr and stdin to their respective pipes
-        int retDup;
-        retDup = dup2( pipefdStdOut[1], STDOUT_FILENO );
-        if( retDup == -1 ) log.error( "spawnScript: dup2 pipefdStdOut[1] STDOUT_FILENO failed %s", strerror( errno ) );
-        if( bPersistentApp )
-        {
-          retDup = dup2( pipefdStdErr[1], STDERR_FILENO );
-          if( retDup == -1 ) log.error( "spawnScript: dup2 pipefdStdOut[1] STDOUT_FILENO failed %s", strerror( errno ) );
-          retDup = dup2( pipefdStdIn[0], STDIN_FILENO );
-          if( retDup == -1 ) log.error( "spawnScript: dup2 pipefdStdIn[0] STDIN_FILENO failed %s", strerror( errno ) );
-        } // else
-        else
-        {
-          retDup = dup2( pipefdStdOut[1], STDERR_FILENO );
-          if( retDup == -1 ) log.error( "spawnScript: dup2 pipefdStdOut[1] STDERR_FILENOfailed %s", strerror( errno ) );
-        } // if
-        pclose( pipefdStdIn[0] );
-        pclose( pipefdStdIn[1] );
-        pclose( pipefdStdOut[0] );
-        pclose( pipefdStdOut[1] );
-        pclose( pipefdStdErr[0] );
-        pclose( pipefdStdErr[1] );
-
-        // spawn the shell or command
-        res = execv( shell.c_str(), (char* const*)argsArr );
-        if( res == -1 )
-          log.error( "spawnScript: child error: %s", strerror( errno ) );
-        sleep( 1 );
-        exit( 1 );
-      }
-      break;
-    default:  // parent
-        pclose( pipefdStdOut[1] ); // parent reads from this side - [1] is the write side
-        pclose( pipefdStdErr[1] ); // parent reads from this side - [1] is the write side
-        pclose( pipefdStdIn[0] );  // parent writes to this pipe - [0] is the read side
-        if( bPersistentApp )
-        {
-          if( pQueueManagement != NULL ) pQueueManagement->genEvent( queueManagementEvent::QMAN_PSTARTUP );
-          if( pRecSock != NULL ) delete pRecSock;
-          pRecSock = new unixSocket( pipefdStdOut[0], unixSocket::ET_WORKER_PIPE, false, "pipefdStdOut" );
-          //          pRecSock->setNonblocking();
-          pRecSock->setPipe();
-          pRecSock->initPoll( 2 );
-          pRecSock->resetPoll();
-          pRecSock->addReadFd( pipefdStdOut[0] );
-          pRecSock->addReadFd( pipefdStdErr[0] );
-          pRecSock->setPollTimeout( 2000 );
-          log.info( log.LOGNORMAL, "spawnScript: pipefdStdIn:%d-%d pipefdStdOut:%d-%d pipefdStdErr:%d-%d childPid:%d", pipefdStdIn[0], pipefdStdIn[1], pipefdStdOut[0], pipefdStdOut[1], pipefdStdErr[0], pipefdStdErr[1], childPid );
-
-          // generate a startup info command event to the persistent app
-          baseEvent cmd( baseEvent::EV_COMMAND );
-          cmd.setCommand( baseEvent::CMD_PERSISTENT_APP );
-          cmd.addParam( "cmd", "startupinfo" );
-          cmd.addParam( "ownqueue", ownQueue );
-          cmd.addParam( "workerpid", pid );
-          //cmd.serialise( pipefdStdIn[1], baseEvent::FD_PIPE );
-          readWritePipe( &cmd );
-        } // if
-      break;
-  } // switch childPid
+    posix_spawn_file_actions_adddup2( &actions, pipefdStdErr[1], STDERR_FILENO );
+    posix_spawn_file_actions_adddup2( &actions, pipefdStdIn[0], STDIN_FILENO );
+  } // if
+  else
+    posix_spawn_file_actions_adddup2( &actions, pipefdStdOut[1], STDERR_FILENO );
+  posix_spawnattr_t attr;
+  posix_spawnattr_init( &attr );
+  sigset_t noSignals;
+  sigemptyset( &noSignals );
+  posix_spawnattr_setsigmask( &attr, &noSignals );
+  posix_spawnattr_setflags( &attr, POSIX_SPAWN_SETSIGMASK );
+
+  exitedChildPid = -1;
+  pid_t newPid = -1;
+  res = posix_spawn( &newPid, shell.c_str(), &actions, &attr, (char* const*)argsArr, environ );
+  posix_spawn_file_actions_destroy( &actions );
+  posix_spawnattr_destroy( &attr );
   delete[] argsArr;
+  if( res != 0 )
+  {
+    pclose( pipefdStdIn[0] );
+    pclose( pipefdStdIn[1] );
+    pclose( pipefdStdOut[0] );
+    pclose( pipefdStdOut[1] );
+    pclose( pipefdStdErr[0] );
+    pclose( pipefdStdErr[1] );
+    failureCause = "execFailure";
+    exitStatus = 127;
+    throw Exception( log, log.ERROR, "spawnScript: posix_spawn '%s' failed %s", shell.c_str(), strerror( res ) );
+  } // if
+  childPid = newPid;
+  struct timespec spawnEnd;
+  clock_gettime( CLOCK_MONOTONIC, &spawnEnd );
+  spawnUs = (spawnEnd.tv_sec-spawnStart.tv_sec)*1000000 + (spawnEnd.tv_nsec-spawnStart.tv_nsec)/1000;
+  if( spawnUs == 0 ) spawnUs = 1;     // 0 means nothing was spawned
+
+  pclose( pipefdStdOut[1] ); // parent reads from this side - [1] is the write side
+  pclose( pipefdStdErr[1] ); // parent reads from this side - [1] is the write side
+  pclose( pipefdStdIn[0] );  // parent writes to this pipe - [0] is the read side
+  if( bPersistentApp )
+  {
+    if( pQueueManagement != NULL ) pQueueManagement->genEvent( queueManagementEvent::QMAN_PSTARTUP );
+    if( pRecSock != NULL ) delete pRecSock;
+    pRecSock = new unixSocket( pipefdStdOut[0], unixSocket::ET_WORKER_PIPE, false, "pipefdStdOut" );
+    //          pRecSock->setNonblocking();
+    pRecSock->setPipe();
+    pRecSock->initPoll( 2 );
+    pRecSock->resetPoll();
+    pRecSock->addReadFd( pipefdStdOut[0] );
+    pRecSock->addReadFd( pipefdStdErr[0] );
+    pRecSock->setPollTimeout( 2000 );
+    log.info( log.LOGNORMAL, "spawnScript: pipefdStdIn:%d-%d pipefdStdOut:%d-%d pipefdStdErr:%d-%d childPid:%d", pipefdStdIn[0], pipefdStdIn[1], pipefdStdOut[0], pipefdStdOut[1], pipefdStdErr[0], pipefdStdErr[1], childPid );
+
+    // generate a startup info command event to the persistent app
+    baseEvent cmd( baseEvent::EV_COMMAND );
+    cmd.setCommand( baseEvent::CMD_PERSISTENT_APP );
+    cmd.addParam( "cmd", "startupinfo" );
+    cmd.addParam( "ownqueue", ownQueue );
+    cmd.addParam( "workerpid", pid );
+    if( pipelineDepth > 1 ) cmd.addParam( "pipelinedepth", pipelineDepth );
+    //cmd.serialise( pipefdStdIn[1], baseEvent::FD_PIPE );
+    readWritePipe( &cmd );
+
+    // a pipelined app may block writing its responses while we write requests - never block on its stdin
+    if( pipelineDepth > 1 )
+    {
+      int flags = fcntl( pipefdStdIn[1], F_GETFL, 0 );
+      if( (flags==-1) || (fcntl(pipefdStdIn[1],F_SETFL,flags|O_NONBLOCK)==-1) )
+        throw Exception( log, log.ERROR, "spawnScript: failed to make pipefdStdIn non blocking - %s", strerror(errno) );
+    } // if
+  } // if
 } // spawnScript
 
 /**
@@ -507,10 +572,7 @@ baseEvent* scriptExec::readWritePipe( baseEvent* pReq )
         } // if
         else if( fd == pipefdStdErr[0] )
         {
-          char line[16384];
-          int len = read( fd, line, 16383 );
-          line[len] = '\0';
-          log.warn( log.LOGMOSTLY ) << "readWritePipe: stderr output: " << line;
+          readStdErr( );
         } // else if
         else
         {
@@ -525,6 +587,80 @@ baseEvent* scriptExec::readWritePipe( baseEvent* pReq )
   return pEvent;
 } // readWritePipe
 
+/**
+ * writes a request to the persistent app without waiting for the response - the
+ * caller polls getStdOutFd and collects the responses with readPipeEvent.  what the pipe
+ * does not accept is buffered - the caller polls getStdInFd for writing while
+ * hasPendingInput and calls flushPipe once it is writable
+ * @param pReq - request object
+ * @exception if not in persistent mode or on failure to write
+ * **/
+void scriptExec::writePipe( baseEvent* pReq )
+{
+  if( !bPersistentApp || (pipefdStdIn[1]==-1) ) throw Exception( log, log.ERROR, "writePipe: not in persistent mode" );
+  if( !pendingInput.empty() )
+  {
+    // queue behind the frames that are still pending
+    pendingInput.append( pReq->serialiseToString() );
+    log.debug( log.LOGONOCCASION, "writePipe: '%s' busy - %u bytes pending", scriptCmd.c_str(), (unsigned int)pendingInput.length() );
+    return;
+  } // if
+
+  int ret = pReq->serialiseNonBlock( pipefdStdIn[1], baseEvent::FD_PIPE );
+  if( ret == -1 ) throw Exception( log, log.WARN, "writePipe: failed to write to '%s' - %s", scriptCmd.c_str(), strerror(errno) );
+  if( ret == 0 )
+  {
+    // keep the rest of the frame
+    pendingInput = pReq->serialiseToString().substr( pReq->getBytesSerialised() );
+    pReq->abandonSerialise();
+    log.debug( log.LOGONOCCASION, "writePipe: '%s' full - %u bytes pending", scriptCmd.c_str(), (unsigned int)pendingInput.length() );
+  } // if
+} // writePipe
+
+/**
+ * writes as much of the pending input as the stdin of the app accepts - call once
+ * getStdInFd is writable
+ * @return true once nothing is pending
+ * @exception on failure to write - the pending input is discarded
+ * **/
+bool scriptExec::flushPipe( )
+{
+  if( pendingInput.empty() ) return true;
+  int bytesWritten = write( pipefdStdIn[1], pendingInput.data(), pendingInput.length() );
+  if( bytesWritten == -1 )
+  {
+    if( (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR) ) return false;
+    pendingInput.clear();
+    throw Exception( log, log.WARN, "flushPipe: failed to write to '%s' - %s", scriptCmd.c_str(), strerror(errno) );
+  } // if
+  pendingInput.erase( 0, bytesWritten );
+  log.debug( log.LOGONOCCASION, "flushPipe: wrote %d bytes to '%s' %u pending", bytesWritten, scriptCmd.c_str(), (unsigned int)pendingInput.length() );
+  return pendingInput.empty();
+} // flushPipe
+
+/**
+ * reads a response from the persistent app once its stdout is readable
+ * @return the response or NULL if it is not complete yet
+ * @exception if not in persistent mode
+ * **/
+baseEvent* scriptExec::readPipeEvent( )
+{
+  if( !bPersistentApp || (pRecSock==NULL) ) throw Exception( log, log.ERROR, "readPipeEvent: not in persistent mode" );
+  return baseEvent::unSerialise( pRecSock );
+} // readPipeEvent
+
+/**
+ * logs what the persistent app wrote to stderr
+ * **/
+void scriptExec::readStdErr( )
+{
+  char line[16384];
+  int len = read( pipefdStdErr[0], line, 16383 );
+  if( len <= 0 ) return;
+  line[len] = '\0';
+  log.warn( log.LOGMOSTLY ) << "readWritePipe: stderr output: " << line;
+} // readStdErr
+
 /**
  * reads the stdio/stderr pipes until it closes
  * closes the write handle if it is not closed
@@ -573,6 +709,7 @@ bool scriptExec::waitForChildExit( )
   // close all open pipe handles
   pclose( pipefdStdIn[0] );
   pclose( pipefdStdIn[1] );
+  pendingInput.clear();
   pclose( pipefdStdOut[0] );
   pclose( pipefdStdOut[1] );
   pclose( pipefdStdErr[0] );
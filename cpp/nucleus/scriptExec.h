@@ -6,6 +6,10 @@
  @version 1.0.0		30/09/2009		Gerhardus Muller		Script created
  @version 1.2.0		21/08/2012		Gerhardus Muller		startup info command event for persistent apps
  @version 1.3.0		11/10/2012		Gerhardus Muller		finer grained reporting of the return status of a process for queue event management
+ @version 1.4.0		16/10/2026		agent		EV_PERL can run in an embedded interpreter
+ @version 1.5.0		16/10/2026		agent		posix_spawn launcher and spawn latency
+ @version 1.6.0		16/10/2026		agent		writePipe / readPipeEvent for pipelined persistent apps
+ @version 1.6.1		17/10/2026		agent		flushPipe for the input writePipe could not write without blocking
 
  @note
 
@@ -24,6 +28,7 @@
 
 class baseEvent;
 class queueManagementEvent;
+class perlExec;
 
 //class scriptExec : public event - geen idee hoekom nie
 class scriptExec : public object
@@ -52,13 +57,26 @@ class scriptExec : public object
     std::string getScriptCmd( )                                     {return scriptCmd;}
     void spawnScript( baseEvent* pEvent, bool bPersistent );
     baseEvent* readWritePipe( baseEvent* pReq );
+    void writePipe( baseEvent* pReq );
+    bool flushPipe( );
+    bool hasPendingInput( )                                         {return !pendingInput.empty();}
+    int getStdInFd( )                                               {return pipefdStdIn[1];}
+    baseEvent* readPipeEvent( );
+    void readStdErr( );
+    int getStdOutFd( )                                              {return pipefdStdOut[0];}
+    int getStdErrFd( )                                              {return pipefdStdErr[0];}
+    void setPipelineDepth( int depth )                              {pipelineDepth=depth;}    ///< announced to the persistent app in the startupinfo command
     bool waitForChildExit( );
     void setResourceLimit( int resource, unsigned long newLimit );
     void setResourceLimit( const std::string& resource, unsigned long newLimit );
     void setManagementObj( queueManagementEvent* theObj )           {pQueueManagement=theObj;}
+    void setPerlExec( perlExec* thePerlExec )                       {pPerlExec=thePerlExec;}
+    int getPerlCache( )                                             {return perlCache;}       ///< perlExec::ePerlCache of the last event
+    unsigned int getSpawnUs( )                                      {return spawnUs;}         ///< time taken to launch the last process in us - 0 if none was launched
   
   private:
     bool execScript( baseEvent* pEvent, std::string& resultLine );
+    bool runEmbedded( baseEvent* pEvent, std::string& resultLine );
     void parseStandardResponse( bool& bSuccess, const std::string& result );
     std::string buildCommandLine( const std::string& theScriptCmd, baseEvent* pEvent );
     std::string shellEscape( const std::string& str );
@@ -98,6 +116,11 @@ class scriptExec : public object
     int                             pipefdStdErr[2];    ///< child stderr
     unixSocket*                     pRecSock;           ///< socket for accepting incoming events
     queueManagementEvent*           pQueueManagement;   ///< class that generates queue management events
+    perlExec*                       pPerlExec;          ///< embedded interpreter for EV_PERL if configured - owned by the worker
+    int                             perlCache;          ///< perlExec::ePerlCache of the last event
+    unsigned int                    spawnUs;            ///< time from creating the pipes until posix_spawn returned for the last process
+    int                             pipelineDepth;      ///< events the worker may have outstanding with the persistent app
+    std::string                     pendingInput;       ///< frames for a pipelined app that its stdin did not accept yet
     bool                            bParseResponseForObject;  ///< true to try and parse the execution output for an object
 };	// class scriptExec
 
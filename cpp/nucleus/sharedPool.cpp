@@ -0,0 +1,199 @@
+/**
+ sharedPool - lends idle workers of the pool queues to the backlogged pool queues
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+ @version 1.1.0		16/10/2026		agent		bEmbeddedPerl has to match
+
+ @note
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#include <sstream>
+#include <algorithm>
+#include "nucleus/sharedPool.h"
+#include "nucleus/queueContainer.h"
+
+/**
+ * constructor
+ * **/
+sharedPool::sharedPool( )
+  : object( "sharedPool" )
+{
+} // sharedPool
+
+/**
+ * destructor - the queues are owned by the nucleus
+ * **/
+sharedPool::~sharedPool()
+{
+} // ~sharedPool
+
+/**
+ * Standard logging call - produces a generic text version of the sharedPool.
+ * **/
+std::string sharedPool::toString( )
+{
+  std::ostringstream oss;
+  oss << "sharedPool queues:" << members.size() << " loans:" << loans.size();
+  return oss.str();
+} // toString
+
+/**
+ * adds a queue if it takes part in the pool
+ * **/
+void sharedPool::addQueue( queueContainer* pQueue )
+{
+  if( !pQueue->isPoolMember() ) return;
+  if( std::find( members.begin(), members.end(), pQueue ) != members.end() ) return;
+  members.push_back( pQueue );
+  log.info( log.LOGMOSTLY, "addQueue: queue:'%s' weight:%d - %s", pQueue->getQueueName().c_str(), pQueue->getPoolWeight(), toString().c_str() );
+} // addQueue
+
+/**
+ * removes a queue and ends the loans it is party to
+ * **/
+void sharedPool::removeQueue( queueContainer* pQueue )
+{
+  poolQueueListT::iterator itQ = std::find( members.begin(), members.end(), pQueue );
+  if( itQ == members.end() ) return;
+  members.erase( itQ );
+
+  workerLoanMapIteratorT it = loans.begin();
+  while( it != loans.end() )
+  {
+    workerLoanMapIteratorT itNext = it;
+    itNext++;
+    if( (it->second.pLender == pQueue) || (it->second.pBorrower == pQueue) ) endLoan( it );
+    it = itNext;
+  } // while
+  log.info( log.LOGMOSTLY, "removeQueue: queue:'%s' - %s", pQueue->getQueueName().c_str(), toString().c_str() );
+} // removeQueue
+
+/**
+ * lends idle workers to the backlogged queues until either runs out - called once the
+ * nucleus has processed the ready events so the owners have fed their own workers first
+ * **/
+void sharedPool::balance( )
+{
+  if( members.size() < 2 ) return;
+
+  while( true )
+  {
+    queueContainer* pBorrower = NULL;
+    queueContainer* pLender = NULL;
+
+    // the backlogged queue furthest below its weighted share that has a lender
+    poolQueueListT::iterator itQ;
+    for( itQ = members.begin(); itQ != members.end(); itQ++ )
+    {
+      queueContainer* pQueue = *itQ;
+      if( !pQueue->canBorrow() ) continue;
+      if( pBorrower != NULL )
+      {
+        long long served = (long long)(pQueue->getTotalWorkers()+pQueue->getBorrowedWorkers())*pBorrower->getPoolWeight();
+        long long bestServed = (long long)(pBorrower->getTotalWorkers()+pBorrower->getBorrowedWorkers())*pQueue->getPoolWeight();
+        if( served > bestServed ) continue;
+        if( (served == bestServed) && (pQueue->getQueueLength() <= pBorrower->getQueueLength()) ) continue;
+      } // if
+      queueContainer* pCandidate = findLender( pQueue );
+      if( pCandidate == NULL ) continue;
+      pBorrower = pQueue;
+      pLender = pCandidate;
+    } // for
+    if( pBorrower == NULL ) return;
+
+    int pid = 0;
+    int fd = pLender->lendWorker( pBorrower, pid );
+    if( fd == -1 ) return;      // the borrower only had expired events - try again next time round
+    tWorkerLoan loan;
+    loan.pLender = pLender;
+    loan.pBorrower = pBorrower;
+    loan.pid = pid;
+    loans[fd] = loan;
+  } // while
+} // balance
+
+/**
+ * finds the compatible queue with the most workers it can lend
+ * @return the lender or NULL if none
+ * **/
+queueContainer* sharedPool::findLender( queueContainer* pBorrower )
+{
+  queueContainer* pLender = NULL;
+  int bestSpare = 0;
+  poolQueueListT::iterator itQ;
+  for( itQ = members.begin(); itQ != members.end(); itQ++ )
+  {
+    queueContainer* pQueue = *itQ;
+    if( (pQueue == pBorrower) || !pQueue->canLend() || !isCompatible(pQueue,pBorrower) ) continue;
+    int spare = pQueue->getTotalWorkers()-pQueue->getLentWorkers()-pQueue->getQueueDescriptor()->poolMin;
+    if( (pLender == NULL) || (spare > bestSpare) )
+    {
+      pLender = pQueue;
+      bestSpare = spare;
+    } // if
+  } // for
+  return pLender;
+} // findLender
+
+/**
+ * a worker forked for one queue can execute the events of another if the settings it
+ * picks up from its queue descriptor are the same
+ * **/
+bool sharedPool::isCompatible( queueContainer* pA, queueContainer* pB )
+{
+  tQueueDescriptor* pDescA = pA->getQueueDescriptor();
+  tQueueDescriptor* pDescB = pB->getQueueDescriptor();
+  return (pDescA->parseResponseForObject == pDescB->parseResponseForObject) &&
+         (pDescA->bRunPriviledged == pDescB->bRunPriviledged) &&
+         (pDescA->bBinarySections == pDescB->bBinarySections) &&
+         (pDescA->bEmbeddedPerl == pDescB->bEmbeddedPerl) &&
+         (pDescA->errorQueue == pDescB->errorQueue) &&
+         (pDescA->defaultScript == pDescB->defaultScript) &&
+         (pDescA->defaultUrl == pDescB->defaultUrl);
+} // isCompatible
+
+/**
+ * a worker returned - if it was on loan the loan ends before the lender feeds it
+ * @param fd - the worker fd
+ * **/
+void sharedPool::workerReturned( int fd )
+{
+  workerLoanMapIteratorT it = loans.find( fd );
+  if( it != loans.end() ) endLoan( it );
+} // workerReturned
+
+/**
+ * a worker exited - the lender writes the recovery entry for the event it was executing
+ * @param pid - the worker pid
+ * **/
+void sharedPool::workerExited( int pid )
+{
+  workerLoanMapIteratorT it;
+  for( it = loans.begin(); it != loans.end(); it++ )
+  {
+    if( it->second.pid == pid )
+    {
+      endLoan( it );
+      return;
+    } // if
+  } // for
+} // workerExited
+
+/**
+ * **/
+void sharedPool::endLoan( workerLoanMapIteratorT it )
+{
+  tWorkerLoan& loan = it->second;
+  log.debug( log.MIDLEVEL, "endLoan: worker pid:%d fd:%d back from queue:'%s' to queue:'%s'", loan.pid, it->first, loan.pBorrower->getQueueName().c_str(), loan.pLender->getQueueName().c_str() );
+  loan.pLender->endLoan( true );
+  loan.pBorrower->endLoan( false );
+  loans.erase( it );
+} // endLoan
@@ -0,0 +1,78 @@
+/**
+ sharedPool - lends idle workers of the pool queues to the backlogged pool queues
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ a queue takes part if nucleus.bSharedPool is set and it declares a poolWeight - persistent apps
+ and collection queues never do.  A worker is lent for a single event: the lender's idle worker
+ executes the next event of the borrower and on its return the lender's own queue is fed first,
+ so the worker is back with its owner as soon as the owner has work.  Between loans the worker
+ goes to the backlogged queue furthest below its weighted share - own plus borrowed workers
+ divided by poolWeight - with the longest queue breaking a tie.  The worker keeps the settings of
+ the queue it was forked for so workers are only lent between queues whose worker settings match
+ and the borrower's maxExecTime does not apply to it
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#if !defined( sharedPool_defined_ )
+#define sharedPool_defined_
+
+#include "utils/object.h"
+#include <map>
+#include <vector>
+
+class queueContainer;
+
+/** a worker on loan **/
+struct tWorkerLoan
+{
+  queueContainer*           pLender;
+  queueContainer*           pBorrower;
+  int                       pid;
+};
+
+typedef std::map<int,tWorkerLoan> workerLoanMapT;
+typedef workerLoanMapT::iterator workerLoanMapIteratorT;
+typedef std::vector<queueContainer*> poolQueueListT;
+
+class sharedPool : public object
+{
+  // Definitions
+  public:
+
+    // Methods
+  public:
+    sharedPool( );
+    virtual ~sharedPool();
+    virtual std::string toString ();
+    void addQueue( queueContainer* pQueue );
+    void removeQueue( queueContainer* pQueue );
+    void balance( );
+    void workerReturned( int fd );
+    void workerExited( int pid );
+    unsigned int getNumLoans( )                             {return loans.size();}
+
+  private:
+    queueContainer* findLender( queueContainer* pBorrower );
+    static bool isCompatible( queueContainer* pA, queueContainer* pB );
+    void endLoan( workerLoanMapIteratorT it );
+
+    // Properties
+  public:
+
+  protected:
+
+  private:
+    poolQueueListT                    members;                    ///< queues taking part in the pool
+    workerLoanMapT                    loans;                      ///< workers on loan keyed by the worker fd
+};	// class sharedPool
+
+#endif // !defined( sharedPool_defined_)
@@ -0,0 +1,223 @@
+/**
+ spillSegment - append-only file holding the tail of a queue that does not fit in memory
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#include <sstream>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "nucleus/spillSegment.h"
+#include "nucleus/baseEvent.h"
+#include "exception/Exception.h"
+
+/**
+ * constructor - creates and unlinks the segment file
+ * @param thePath - file name for the segment
+ * @param theMaxBytes - limit on the unread part of the segment, 0 for no limit
+ * @exception on failure to create the file
+ * **/
+spillSegment::spillSegment( const std::string& thePath, unsigned long long theMaxBytes )
+  : object( "spillSegment" ),
+    path( thePath ),
+    maxBytes( theMaxBytes )
+{
+  pMap = NULL;
+  mapOffset = 0;
+  mapLen = 0;
+  writeOffset = 0;
+  flushedOffset = 0;
+  readOffset = 0;
+  punchedOffset = 0;
+  numEvents = 0;
+  fd = open( path.c_str(), O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0600 );
+  if( fd == -1 ) throw Exception( log, log.ERROR, "spillSegment: failed to create '%s': %s", path.c_str(), strerror(errno) );
+  unlink( path.c_str() );
+  log.info( log.LOGMOSTLY, "spillSegment: created '%s' maxBytes:%llu", path.c_str(), maxBytes );
+} // spillSegment
+
+/**
+ * destructor - records that were not read are discarded
+ * **/
+spillSegment::~spillSegment()
+{
+  if( numEvents > 0 ) log.warn( log.LOGALWAYS, "~spillSegment: '%s' discarding %u events", path.c_str(), numEvents );
+  unmapWindow();
+  close( fd );
+} // ~spillSegment
+
+/**
+ * Standard logging call - produces a generic text version of the spillSegment.
+ * **/
+std::string spillSegment::toString( )
+{
+  std::ostringstream oss;
+  oss << "spillSegment '" << path << "' events:" << numEvents << " read:" << readOffset << " write:" << writeOffset << " flushed:" << flushedOffset;
+  return oss.str();
+} // toString
+
+/**
+ * appends an event - the segment keeps a serialised copy and the caller remains the owner of the event
+ * @return false if the event does not fit or the buffered records cannot be written
+ * **/
+bool spillSegment::append( baseEvent* pEvent )
+{
+  std::string& frame = pEvent->serialiseToString();
+  tRecordHeader header;
+  header.frameLen = frame.length();
+  header.queueTime = pEvent->getQueueTime();
+  if( (maxBytes > 0) && (getBytes()+sizeof(header)+header.frameLen > maxBytes) ) return false;
+
+  if( writeBuf.size() >= WRITE_BUFFER )
+  {
+    try
+    {
+      flush();
+    } // try
+    catch( Exception e )
+    {
+      return false;
+    } // catch
+  } // if
+
+  writeBuf.append( (const char*)&header, sizeof(header) );
+  writeBuf.append( frame );
+  writeOffset += sizeof(header)+header.frameLen;
+  numEvents++;
+  return true;
+} // append
+
+/**
+ * reads the next event in the order they were appended
+ * @return the event with its queue time restored or NULL if the segment is empty
+ * @exception on a write or mapping failure or a corrupt record - a corrupt record is skipped
+ * and if its header cannot be trusted the rest of the segment is discarded
+ * **/
+baseEvent* spillSegment::pop( )
+{
+  if( numEvents == 0 ) return NULL;
+
+  tRecordHeader header;
+  if( readOffset+sizeof(header) > flushedOffset ) flush();
+  mapWindow( readOffset, sizeof(header) );
+  memcpy( &header, pMap+(readOffset-mapOffset), sizeof(header) );
+  unsigned long long recordEnd = readOffset+sizeof(header)+header.frameLen;
+  if( recordEnd > writeOffset )
+  {
+    unsigned int numLost = numEvents;
+    reset();
+    throw Exception( log, log.ERROR, "pop: '%s' corrupt record header frameLen:%u - discarded %u events", path.c_str(), header.frameLen, numLost );
+  } // if
+
+  if( recordEnd > flushedOffset ) flush();
+  mapWindow( readOffset, sizeof(header)+header.frameLen );
+  const char* frame = pMap+(readOffset-mapOffset)+sizeof(header);
+  readOffset = recordEnd;
+  numEvents--;
+
+  baseEvent* pEvent = NULL;
+  try
+  {
+    pEvent = baseEvent::unSerialiseFromFrame( frame, header.frameLen );
+  } // try
+  catch( Exception e )
+  {
+    pEvent = NULL;
+  } // catch
+
+  // reclaim the space once the reader has caught up or has moved far enough along
+  if( numEvents == 0 )
+    reset();
+  else if( readOffset-punchedOffset >= PUNCH_INTERVAL )
+  {
+    unsigned long long punchEnd = readOffset & ~((unsigned long long)sysconf(_SC_PAGESIZE)-1);
+    if( fallocate( fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, punchedOffset, punchEnd-punchedOffset ) == -1 )
+      log.warn( log.LOGMOSTLY, "pop: '%s' failed to release %llu bytes: %s", path.c_str(), punchEnd-punchedOffset, strerror(errno) );
+    punchedOffset = punchEnd;
+  } // else if
+
+  if( pEvent == NULL ) throw Exception( log, log.ERROR, "pop: '%s' skipped a corrupt record of %u bytes", path.c_str(), header.frameLen );
+  pEvent->setQueueTime( header.queueTime );
+  return pEvent;
+} // pop
+
+/**
+ * writes the buffered records to the file
+ * @exception on a write failure - the part that was not written stays buffered
+ * **/
+void spillSegment::flush( )
+{
+  size_t written = 0;
+  while( written < writeBuf.size() )
+  {
+    ssize_t ret = pwrite( fd, writeBuf.data()+written, writeBuf.size()-written, flushedOffset );
+    if( ret == -1 )
+    {
+      if( errno == EINTR ) continue;
+      writeBuf.erase( 0, written );
+      throw Exception( log, log.ERROR, "flush: '%s' write failed: %s", path.c_str(), strerror(errno) );
+    } // if
+    written += ret;
+    flushedOffset += ret;
+  } // while
+  writeBuf.clear();
+} // flush
+
+/**
+ * empties the segment and truncates the file
+ * **/
+void spillSegment::reset( )
+{
+  unmapWindow();
+  if( ftruncate( fd, 0 ) == -1 ) log.warn( log.LOGMOSTLY, "reset: '%s' truncate failed: %s", path.c_str(), strerror(errno) );
+  writeBuf.clear();
+  writeOffset = 0;
+  flushedOffset = 0;
+  readOffset = 0;
+  punchedOffset = 0;
+  numEvents = 0;
+} // reset
+
+/**
+ * makes sure the mapping covers the given range - the range has to be flushed
+ * @exception on mapping failure
+ * **/
+void spillSegment::mapWindow( unsigned long long offset, size_t len )
+{
+  if( (pMap != NULL) && (offset >= mapOffset) && (offset+len <= mapOffset+mapLen) ) return;
+  unmapWindow();
+
+  unsigned long long alignedOffset = offset & ~((unsigned long long)sysconf(_SC_PAGESIZE)-1);
+  size_t newLen = offset-alignedOffset+len;
+  if( newLen < MAP_WINDOW ) newLen = MAP_WINDOW;
+  if( alignedOffset+newLen > flushedOffset ) newLen = flushedOffset-alignedOffset;   // never beyond the end of the file
+  void* p = mmap( NULL, newLen, PROT_READ, MAP_SHARED, fd, alignedOffset );
+  if( p == MAP_FAILED ) throw Exception( log, log.ERROR, "mapWindow: '%s' mmap of %u bytes at %llu failed: %s", path.c_str(), (unsigned int)newLen, alignedOffset, strerror(errno) );
+  madvise( p, newLen, MADV_SEQUENTIAL );
+  pMap = (char*)p;
+  mapOffset = alignedOffset;
+  mapLen = newLen;
+} // mapWindow
+
+/**
+ * **/
+void spillSegment::unmapWindow( )
+{
+  if( pMap == NULL ) return;
+  munmap( pMap, mapLen );
+  pMap = NULL;
+  mapLen = 0;
+} // unmapWindow
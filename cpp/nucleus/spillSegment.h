@@ -0,0 +1,84 @@
+/**
+ spillSegment - append-only file holding the tail of a queue that does not fit in memory
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ events are appended as a record - the record header (frame length and queue time) followed
+ by the serialised frame - through a write buffer and are read back in the same order from a
+ read-only mapping of the file that slides along as the segment is drained.  The file is
+ unlinked as soon as it is created so it never outlives the process; once all the records are
+ read the file is truncated and the disk space the reader has passed is released with
+ FALLOC_FL_PUNCH_HOLE while the writer keeps on appending
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ * **/
+
+#if !defined( spillSegment_defined_ )
+#define spillSegment_defined_
+
+#include "utils/object.h"
+#include <stdint.h>
+
+class baseEvent;
+
+class spillSegment : public object
+{
+  // Definitions
+  public:
+    static const size_t MAP_WINDOW = 4*1024*1024;           ///< bytes mapped for reading at a time
+    static const size_t WRITE_BUFFER = 256*1024;            ///< bytes buffered before they are written
+    static const unsigned long long PUNCH_INTERVAL = 64*1024*1024;  ///< bytes read before the space is released
+
+    /** record header - native byte order as the file never leaves the process **/
+    struct tRecordHeader
+    {
+      uint32_t                frameLen;
+      uint32_t                queueTime;
+    };
+
+    // Methods
+  public:
+    spillSegment( const std::string& thePath, unsigned long long theMaxBytes );
+    virtual ~spillSegment();
+    virtual std::string toString ();
+
+    bool append( baseEvent* pEvent );
+    baseEvent* pop( );
+    unsigned int size( )                                    {return numEvents;}
+    bool empty( )                                           {return numEvents==0;}
+    unsigned long long getBytes( )                          {return writeOffset-readOffset;}
+
+  private:
+    void flush( );
+    void reset( );
+    void mapWindow( unsigned long long offset, size_t len );
+    void unmapWindow( );
+
+    // Properties
+  public:
+
+  protected:
+
+  private:
+    std::string                       path;                 ///< file name - only used for logging once unlinked
+    int                               fd;                   ///< the segment file
+    unsigned long long                maxBytes;             ///< append fails once the unread part of the segment would exceed this
+    unsigned long long                writeOffset;          ///< end of the appended records including the write buffer
+    unsigned long long                flushedOffset;        ///< end of the records written to the file
+    unsigned long long                readOffset;           ///< start of the next record to read
+    unsigned long long                punchedOffset;        ///< the space before this offset has been released
+    unsigned int                      numEvents;            ///< records not yet read
+    std::string                       writeBuf;             ///< records appended but not yet written
+    char*                             pMap;                 ///< read mapping or NULL
+    unsigned long long                mapOffset;            ///< file offset of the mapping - page aligned
+    size_t                            mapLen;               ///< length of the mapping
+};	// class spillSegment
+
+#endif // !defined( spillSegment_defined_)
@@ -4,6 +4,10 @@
  $Id: straightQueue.cpp 2546 2012-08-28 20:54:42Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		10/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		expiry index - scanForExpiredEvents only visits expiring events and removes them from the queue
+ @version 1.2.0		16/10/2026		agent		priority levels with aging or weighted rounds and per level stats
+ @version 1.3.0		16/10/2026		agent		overflow spills to a spillSegment per level instead of dumping the queue
+ @version 1.4.0		16/10/2026		agent		events with the coalesce key of a queued event are collapsed into it
 
  @note
 
@@ -18,18 +22,26 @@
 #include "nucleus/optionsNucleus.h"
 #include "nucleus/recoveryLog.h"
 #include "nucleus/baseEvent.h"
+#include "nucleus/spillSegment.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 const char *const straightQueue::FROM = typeid( straightQueue ).name();
+unsigned int straightQueue::spillSeq = 0;
 
 /**
  * constructor
  * **/
 straightQueue::straightQueue( tQueueDescriptor* theDescriptor, recoveryLog* theRecoveryLog, bool bRecovery, const char* objName )
-  : baseQueue( theDescriptor, theRecoveryLog, bRecovery, "straightQueue" )
+  : baseQueue( theDescriptor, theRecoveryLog, bRecovery, objName )
 {
   listSize = 0;
+  memSize = 0;
   bExitWhenDone = false;
-  init();
+  init( theDescriptor );
 } // straightQueue
 
 /**
@@ -37,18 +49,90 @@ straightQueue::straightQueue( tQueueDescriptor* theDescriptor, recoveryLog* theR
  * **/
 straightQueue::~straightQueue( )
 {
-  log.info( log.MIDLEVEL, "~straightQueue:'%s' %d (%d) remaining events", queueName.c_str(), eventList.size(), listSize );
+  log.info( log.MIDLEVEL, "~straightQueue:'%s' %d remaining events %d in memory", queueName.c_str(), listSize, memSize );
+  for( int i = 0; i < MAX_PRIORITY_LEVELS; i++ )
+    delete levels[i].pSpill;
 } // ~straightQueue
 
 /**
- * init
+ * init - only a queue of type 'priority' has more than one level
  * **/
-void straightQueue::init( )
+void straightQueue::init( tQueueDescriptor* theDescriptor )
 {
   log.setAddPid( true );
-  log.info( log.LOGMOSTLY, "init: queue '%s', maxLength %d", queueName.c_str(), maxQueueLength );
+
+  numLevels = 1;
+  defaultPriority = 0;
+  agingInterval = 0;
+  bWeighted = false;
+  if( theDescriptor->type.compare("priority") == 0 )
+  {
+    numLevels = theDescriptor->priorityLevels;
+    if( numLevels < 1 ) numLevels = 1;
+    if( numLevels > MAX_PRIORITY_LEVELS ) numLevels = MAX_PRIORITY_LEVELS;
+    defaultPriority = theDescriptor->defaultPriority;
+    if( defaultPriority < 0 ) defaultPriority = 0;
+    if( defaultPriority >= numLevels ) defaultPriority = numLevels-1;
+    agingInterval = (theDescriptor->priorityAging>0)?theDescriptor->priorityAging:0;
+  } // if
+
+  for( int i = 0; i < MAX_PRIORITY_LEVELS; i++ )
+  {
+    levels[i].listSize = 0;
+    levels[i].pSpill = NULL;
+    levels[i].frontSeq = 0;
+    levels[i].backSeq = 0;
+    levels[i].weight = 1;
+    levels[i].credit = 0;
+  } // for
+
+  // a comma separated list of weights starting at level 0 - missing weights default to 1
+  if( (numLevels > 1) && !theDescriptor->priorityWeights.empty() )
+  {
+    bWeighted = true;
+    const char* p = theDescriptor->priorityWeights.c_str();
+    for( int i = 0; (i < numLevels) && (*p != '\0'); i++ )
+    {
+      int weight = atoi( p );
+      levels[i].weight = (weight>0)?weight:1;
+      p = strchr( p, ',' );
+      if( p == NULL ) break;
+      p++;
+    } // for
+  } // if
+  spillMaxBytes = (theDescriptor->spillMaxMB>0)?(unsigned long long)theDescriptor->spillMaxMB*1024*1024:0;
+  spillDir = pOptionsNucleus->spillDir;
+
+  coalescePolicy = COALESCE_NONE;
+  if( theDescriptor->coalescePolicy.compare("first") == 0 )
+    coalescePolicy = COALESCE_FIRST;
+  else if( theDescriptor->coalescePolicy.compare("last") == 0 )
+    coalescePolicy = COALESCE_LAST;
+  else if( theDescriptor->coalescePolicy.compare("append") == 0 )
+    coalescePolicy = COALESCE_APPEND;
+  else if( !theDescriptor->coalescePolicy.empty() )
+    log.warn( log.LOGALWAYS, "init: queue '%s' coalescePolicy '%s' not recognised - not coalescing", queueName.c_str(), theDescriptor->coalescePolicy.c_str() );
+  resetStats();
+
+  log.info( log.LOGMOSTLY, "init: queue '%s', maxLength %d, levels %d, defaultPriority %d, aging %us, weighted %d, spillMaxBytes %llu, coalesce %d", queueName.c_str(), maxQueueLength, numLevels, defaultPriority, agingInterval, bWeighted, spillMaxBytes, coalescePolicy );
 } // init
 
+/**
+ * resets the stats
+ * **/
+void straightQueue::resetStats( )
+{
+  baseQueue::resetStats();
+  numSpilledEvents = 0;
+  numCoalesced = 0;
+  for( int i = 0; i < numLevels; i++ )
+  {
+    levels[i].numDequeued = 0;
+    levels[i].accWaitTime = 0;
+    levels[i].maxWaitTime = 0;
+  } // for
+} // resetStats
+
 /**
  * retrieves the next event from the queue to be executed
  * @param fd is ignored for the straight queue
@@ -68,13 +152,14 @@ baseEvent* straightQueue::popAvailableEvent( int fd )
     return pCommand;
   } // if
 
-  // retrieve an event from the queue
+  // retrieve an event from the queue - expired events are normally gone already but the
+  // expiry scan may not have run yet
   baseEvent* pEvent = NULL;
   do
   {
     pEvent = popEvent();
     pEvent = checkIfEventIsExpired( pEvent );
-  } while( (pEvent == NULL) && !eventList.empty() );
+  } while( (pEvent == NULL) && (memSize > 0) );
 
   // updateQueuedStats( pEvent );
   if( pEvent == NULL )
@@ -89,87 +174,510 @@ baseEvent* straightQueue::popAvailableEvent( int fd )
  * **/
 void straightQueue::queueEvent( baseEvent* pEvent )
 {
+  if( (coalescePolicy != COALESCE_NONE) && coalesceEvent( pEvent ) ) return;
+
+  int levelNum = levelForEvent( pEvent );
+  tPriorityLevel& level = levels[levelNum];
+
+  // once a level has spilled its newer events follow the spilled ones to keep the order
+  if( !bRecoveryProcess && (spillMaxBytes > 0) && ((memSize >= maxQueueLength) || ((level.pSpill != NULL) && !level.pSpill->empty())) )
+  {
+    if( spillEvent( levelNum, pEvent ) ) return;
+    if( spillMaxBytes > 0 )
+    { // the segment is full
+      dumpEvent( pEvent, "overflow" );
+      return;
+    } // if
+  } // if
   checkQueueOverflow( );
 
   // now queue
-  eventList.push_front( pEvent );
+  pushEvent( levelNum, pEvent );
   listSize++;
-  log.info( log.MIDLEVEL ) << "queueEvent: queue:'" << queueName << "' qlen:" << listSize << " queued event: " << pEvent->toString( );
+  log.info( log.MIDLEVEL ) << "queueEvent: queue:'" << queueName << "' qlen:" << listSize << " level:" << levelNum << " queued event: " << pEvent->toString( );
 } // queueEvent
 
 /**
- * pops a single event from the eventList
- * @param the queue from which to retrieve
+ * places an event at the front of a level in memory and indexes it if it can expire
+ * listSize is left to the caller as the event can come from the spill segment
+ * **/
+void straightQueue::pushEvent( int levelNum, baseEvent* pEvent )
+{
+  tPriorityLevel& level = levels[levelNum];
+  unsigned long long seq = level.frontSeq++;
+  level.eventList.push_front( pEvent );
+  level.listSize++;
+  memSize++;
+
+  // index it if it can expire
+  unsigned int expiryTime = pEvent->getExpiryTime();
+  if( expiryTime != 0 ) indexExpiry( levelNum, seq, expiryTime );
+  if( coalescePolicy != COALESCE_NONE ) indexCoalesceKey( levelNum, seq, pEvent );
+} // pushEvent
+
+/**
+ * adds an entry to the expiry index
+ * **/
+void straightQueue::indexExpiry( int levelNum, unsigned long long seq, unsigned int expiryTime )
+{
+  tExpiryEntry entry;
+  entry.expiryTime = expiryTime;
+  entry.level = levelNum;
+  entry.seq = seq;
+  expiryIndex.push_back( entry );
+  std::push_heap( expiryIndex.begin(), expiryIndex.end(), expiresLater );
+  if( expiryIndex.size() > 2*(size_t)memSize+1024 ) compactExpiryIndex();
+} // indexExpiry
+
+/**
+ * records the place of an event with a coalesce key unless the key already belongs to a
+ * queued event
+ * **/
+void straightQueue::indexCoalesceKey( int levelNum, unsigned long long seq, baseEvent* pEvent )
+{
+  std::string& key = pEvent->getCoalesceKey();
+  if( key.empty() ) return;
+  tCoalesceEntry entry;
+  entry.level = levelNum;
+  entry.seq = seq;
+  std::pair<coalesceIndexT::iterator,bool> ret = coalesceIndex.insert( std::make_pair( key, entry ) );
+  if( !ret.second && !isCoalesceEntryValid( ret.first->second ) ) ret.first->second = entry;
+  if( coalesceIndex.size() > 2*(size_t)memSize+1024 ) compactCoalesceIndex();
+} // indexCoalesceKey
+
+/**
+ * @return true if the entry still points at a queued event - sequence numbers are never
+ * reused so the place is either the event or NULL once it expired in place
+ * **/
+bool straightQueue::isCoalesceEntryValid( const tCoalesceEntry& entry )
+{
+  tPriorityLevel& level = levels[entry.level];
+  if( (entry.seq < level.backSeq) || (entry.seq >= level.frontSeq) ) return false;
+  return level.eventList[level.frontSeq-1-entry.seq] != NULL;
+} // isCoalesceEntryValid
+
+/**
+ * drops the entries of events that have left the queue
+ * **/
+void straightQueue::compactCoalesceIndex( )
+{
+  size_t numEntries = coalesceIndex.size();
+  coalesceIndexT::iterator it = coalesceIndex.begin();
+  while( it != coalesceIndex.end() )
+  {
+    if( isCoalesceEntryValid( it->second ) )
+      it++;
+    else
+      it = coalesceIndex.erase( it );
+  } // while
+  log.debug( log.MIDLEVEL, "compactCoalesceIndex: queue:'%s' %u entries reduced to %u", queueName.c_str(), (unsigned int)numEntries, (unsigned int)coalesceIndex.size() );
+} // compactCoalesceIndex
+
+/**
+ * collapses an event into the queued event with the same coalesce key
+ * @return true if the event was collapsed - the dropped event has been released
+ * **/
+bool straightQueue::coalesceEvent( baseEvent* pEvent )
+{
+  std::string& key = pEvent->getCoalesceKey();
+  if( key.empty() ) return false;
+  coalesceIndexT::iterator it = coalesceIndex.find( key );
+  if( it == coalesceIndex.end() ) return false;
+  if( !isCoalesceEntryValid( it->second ) )
+  {
+    coalesceIndex.erase( it );
+    return false;
+  } // if
+
+  int levelNum = it->second.level;
+  unsigned long long seq = it->second.seq;
+  tPriorityLevel& level = levels[levelNum];
+  baseEvent*& pQueued = level.eventList[level.frontSeq-1-seq];
+  baseEvent* pDropped = pEvent;
+  if( coalescePolicy == COALESCE_LAST )
+  { // the new event takes the place and the queue time of the queued one
+    pEvent->setQueueTime( pQueued->getQueueTime() );
+    pDropped = pQueued;
+    pQueued = pEvent;
+    unsigned int expiryTime = pEvent->getExpiryTime();
+    if( expiryTime != 0 ) indexExpiry( levelNum, seq, expiryTime );
+  } // if
+  else if( coalescePolicy == COALESCE_APPEND )
+  {
+    try
+    {
+      pQueued->mergeScriptParams( pEvent );
+    } // try
+    catch( Exception e )
+    { // queue it separately
+      return false;
+    } // catch
+  } // else if
+
+  numCoalesced++;
+  log.debug( log.MIDLEVEL ) << "coalesceEvent: queue:'" << queueName << "' key:'" << key << "' policy:" << coalescePolicy << " dropped: " << pDropped->toString( );
+  sendResult( pDropped, false, std::string(), std::string(), std::string(), std::string("coalesced"), std::string() );
+  baseEvent::release( pDropped );
+  return true;
+} // coalesceEvent
+
+/**
+ * appends an event to the spill segment of its level - the segment is created on first use
+ * and a failure to create it disables spilling for the queue
+ * @return true if the event was spilled and released
+ * **/
+bool straightQueue::spillEvent( int levelNum, baseEvent* pEvent )
+{
+  tPriorityLevel& level = levels[levelNum];
+  if( level.pSpill == NULL )
+  {
+    char name[64];
+    sprintf( name, ".%d.%u.%d.spill", getpid(), spillSeq++, levelNum );
+    std::string path = spillDir + "q_" + queueName + name;
+    mkdir( spillDir.c_str(), S_IRWXU );     // fails harmlessly if it exists
+    try
+    {
+      level.pSpill = new spillSegment( path, spillMaxBytes );
+    } // try
+    catch( Exception e )
+    {
+      log.error( "spillEvent: queue '%s' spilling disabled - failed to create the segment '%s'", queueName.c_str(), path.c_str() );
+      spillMaxBytes = 0;
+      return false;
+    } // catch
+  } // if
+
+  if( !level.pSpill->append( pEvent ) ) return false;
+  if( level.pSpill->size() == 1 ) log.warn( log.LOGMOSTLY, "spillEvent: queue '%s' level %d started spilling memSize:%u", queueName.c_str(), levelNum, memSize );
+  log.debug( log.MIDLEVEL ) << "spillEvent: queue:'" << queueName << "' level:" << levelNum << " spilled:" << level.pSpill->size() << " event: " << pEvent->toString( );
+  baseEvent::release( pEvent );
+  listSize++;
+  numSpilledEvents++;
+  return true;
+} // spillEvent
+
+/**
+ * pages spilled events of a level back into memory once the queue has drained to half of
+ * maxQueueLength - a level without events in memory always gets at least one
+ * **/
+void straightQueue::refillLevel( int levelNum )
+{
+  tPriorityLevel& level = levels[levelNum];
+  if( (level.pSpill == NULL) || level.pSpill->empty() ) return;
+  if( (level.listSize > 0) && (memSize > maxQueueLength/2) ) return;
+
+  unsigned int numPaged = 0;
+  while( !level.pSpill->empty() && ((memSize < maxQueueLength) || (level.listSize == 0)) )
+  {
+    unsigned int numSpilled = level.pSpill->size();
+    try
+    {
+      pushEvent( levelNum, level.pSpill->pop() );
+      numPaged++;
+    } // try
+    catch( Exception e )
+    { // a corrupt record is skipped - give up for now if the segment could not be read at all
+      unsigned int numLost = numSpilled-level.pSpill->size();
+      listSize -= numLost;
+      log.error( "refillLevel: queue '%s' level %d lost %u spilled events", queueName.c_str(), levelNum, numLost );
+      if( numLost == 0 ) break;
+    } // catch
+  } // while
+  log.info( log.LOGMOSTLY, "refillLevel: queue '%s' level %d paged in %u events, %u remain spilled, memSize:%u", queueName.c_str(), levelNum, numPaged, level.pSpill->size(), memSize );
+} // refillLevel
+
+/**
+ * dumps a single event to the recovery log
+ * **/
+void straightQueue::dumpEvent( baseEvent* pEvent, const char* reason )
+{
+  straightQueueT single( 1, pEvent );
+  dumpList( &single, reason );
+} // dumpEvent
+
+/**
+ * @return the level the event is queued on - its priority clamped to the available levels
+ * **/
+int straightQueue::levelForEvent( baseEvent* pEvent )
+{
+  if( numLevels == 1 ) return 0;
+  int priority = pEvent->getPriority();
+  if( priority < 0 ) return defaultPriority;
+  if( priority >= numLevels ) return numLevels-1;
+  return priority;
+} // levelForEvent
+
+/**
+ * pages in the levels that have spilled events but none in memory - a level spills as soon
+ * as the queue as a whole is full so it can have spilled without ever holding an event
+ * **/
+void straightQueue::refillDrainedLevels( )
+{
+  if( memSize == listSize ) return;
+  for( int i = 0; i < numLevels; i++ )
+    if( levels[i].listSize == 0 ) refillLevel( i );
+} // refillDrainedLevels
+
+/**
+ * selects the level to serve next
+ * @return the level or -1 if the queue is empty
+ * **/
+int straightQueue::selectLevel( )
+{
+  refillDrainedLevels( );
+  if( memSize == 0 ) return -1;
+  if( numLevels == 1 ) return 0;
+
+  if( bWeighted )
+  { // the highest level with events and credit left in this round - start a new round once none has
+    for( int round = 0; round < 2; round++ )
+    {
+      for( int i = numLevels-1; i >= 0; i-- )
+        if( (levels[i].listSize > 0) && (levels[i].credit > 0) ) return i;
+      for( int i = 0; i < numLevels; i++ )
+        levels[i].credit = levels[i].weight;
+    } // for
+    return -1;
+  } // if
+
+  // strict priority with the head of each level promoted by its age
+  int selected = -1;
+  unsigned int selectedRank = 0;
+  for( int i = numLevels-1; i >= 0; i-- )
+  {
+    if( levels[i].listSize == 0 ) continue;
+    unsigned int rank = i;
+    if( agingInterval > 0 )
+    {
+      unsigned int queueTime = levels[i].eventList.back()->getQueueTime();
+      if( now > queueTime ) rank += (now-queueTime)/agingInterval;
+    } // if
+    if( (selected == -1) || (rank > selectedRank) )
+    {
+      selected = i;
+      selectedRank = rank;
+    } // if
+  } // for
+  return selected;
+} // selectLevel
+
+/**
+ * pops a single event from the selected level and updates the level's stats
  * @return the next event on the queue or NULL
  * **/
 baseEvent* straightQueue::popEvent( )
 {
-  if( eventList.empty() ) return NULL;
-  baseEvent* pEvent = eventList.back();
-  eventList.pop_back();
+  int levelNum = selectLevel();
+  if( levelNum < 0 ) return NULL;
+  tPriorityLevel& level = levels[levelNum];
+
+  baseEvent* pEvent = level.eventList.back();
+  unsigned long long seq = level.backSeq;
+  level.eventList.pop_back();
+  level.backSeq++;
+  level.listSize--;
+  memSize--;
   listSize--;
+  if( level.credit > 0 ) level.credit--;
+  if( !coalesceIndex.empty() )
+  {
+    coalesceIndexT::iterator it = coalesceIndex.find( pEvent->getCoalesceKey() );
+    if( (it != coalesceIndex.end()) && (it->second.level == (unsigned int)levelNum) && (it->second.seq == seq) ) coalesceIndex.erase( it );
+  } // if
+  trimLevel( level );
+  if( memSize == 0 )
+  {
+    expiryIndex.clear();
+    coalesceIndex.clear();
+  } // if
+  refillLevel( levelNum );
+
+  unsigned int queueTime = pEvent->getQueueTime();
+  unsigned int waitTime = (now>queueTime)?now-queueTime:0;
+  level.numDequeued++;
+  level.accWaitTime += waitTime;
+  if( waitTime > level.maxWaitTime ) level.maxWaitTime = waitTime;
   return pEvent;
 } // popEvent
 
+/**
+ * drops the places of expired events from the back of a level - an empty level is reset
+ * **/
+void straightQueue::trimLevel( tPriorityLevel& level )
+{
+  if( level.listSize == 0 )
+  {
+    level.eventList.clear();
+    level.backSeq = level.frontSeq;
+    return;
+  } // if
+  while( !level.eventList.empty() && (level.eventList.back() == NULL) )
+  {
+    level.eventList.pop_back();
+    level.backSeq++;
+  } // while
+} // trimLevel
+
+/**
+ * trims all the levels - once no more events are held in memory the index is reset as well
+ * spilled events are paged in for levels that have drained
+ * **/
+void straightQueue::trimExpired( )
+{
+  for( int i = 0; i < numLevels; i++ )
+    trimLevel( levels[i] );
+  if( memSize == 0 )
+  {
+    expiryIndex.clear();
+    coalesceIndex.clear();
+  } // if
+  for( int i = 0; i < numLevels; i++ )
+    refillLevel( i );
+} // trimExpired
+
+/**
+ * rebuilds the expiry index with only the entries of events that are still queued
+ * **/
+void straightQueue::compactExpiryIndex( )
+{
+  size_t numEntries = expiryIndex.size();
+  expiryIndexT::iterator it = expiryIndex.begin();
+  expiryIndexT::iterator dest = expiryIndex.begin();
+  for( ; it != expiryIndex.end(); it++ )
+  {
+    tPriorityLevel& level = levels[it->level];
+    if( (it->seq >= level.backSeq) && (level.eventList[level.frontSeq-1-it->seq] != NULL) )
+      *dest++ = *it;
+  } // for
+  expiryIndex.erase( dest, expiryIndex.end() );
+  std::make_heap( expiryIndex.begin(), expiryIndex.end(), expiresLater );
+  log.debug( log.MIDLEVEL, "compactExpiryIndex: queue:'%s' %u entries reduced to %u", queueName.c_str(), (unsigned int)numEntries, (unsigned int)expiryIndex.size() );
+} // compactExpiryIndex
+
 /**
  * checks overflow on queue - if so dump to the recoveryLog
  * **/
 void straightQueue::checkQueueOverflow()
 {
   if( bRecoveryProcess ) return;  // allow the queue to take all the events for recovery
-  if( listSize >= maxQueueLength )
+  if( memSize >= maxQueueLength )
     dumpQueue( "overflow" );
 } // checkQueueOverflow
 
 /**
- * dumps the list to the recovery log
+ * dumps the list and the spilled events to the recovery log
  * expired events are not dumped
  * @param reason
  * **/
 void straightQueue::dumpQueue( const char* reason )
 {
-  int numProcessed = dumpList( &eventList, reason );
-  listSize -= numProcessed;
+  for( int i = 0; i < numLevels; i++ )
+  {
+    int numProcessed = dumpList( &levels[i].eventList, reason );
+    levels[i].listSize -= numProcessed;
+    memSize -= numProcessed;
+    listSize -= numProcessed;
+    if( levels[i].pSpill != NULL ) dumpSpill( levels[i], reason );
+  } // for
+  trimExpired();
 } // dumpQueue
 
 /**
- * scan list for expired events and expire these
+ * dumps the spilled events of a level to the recovery log in batches
+ * @return the number of events dumped
  * **/
-void straightQueue::scanForExpiredEvents( )
+int straightQueue::dumpSpill( tPriorityLevel& level, const char* reason )
 {
-  straightQueueIteratorT p = eventList.begin();
-  while( p != eventList.end() )
+  int numProcessed = 0;
+  bool bReadFailed = false;
+  while( !level.pSpill->empty() && !bReadFailed )
   {
-    // only expire once - it is inefficient to try and remove expired events from the queue and therefor they
-    // are left in the queue in an expired state and will be discarded when trying to feed them
-    if( !(*p)->hasBeenExpired() )
+    straightQueueT batch;
+    while( !level.pSpill->empty() && (batch.size() < 1000) )
     {
-      if( (*p)->isExpired(now) )
+      unsigned int numSpilled = level.pSpill->size();
+      try
       {
-        sendResult( *p, false, std::string(), std::string(), std::string(), std::string("expired"), std::string() );
-        (*p)->expire();
-        numExpiredEvents++;
-        log.warn( log.LOGMOSTLY ) << "scanForExpiredEvents: queue '" << queueName << "' expired event (queued for " << (now-(*p)->getQueueTime()) << "s lag " << (now-(*p)->getExpiryTime()) << "s): " << (*p)->toString();
-      } // if
-      else if( log.wouldLog( log.LOGSELDOM ) )
+        batch.push_front( level.pSpill->pop() );
+      } // try
+      catch( Exception e )
       {
-        log.debug( log.LOGMOSTLY ) << "scanForExpiredEvents: queue '" << queueName << "' event ok (queued for " << (now-(*p)->getQueueTime()) <<  "s): " << (*p)->toString();
-      } // else if
-    } // if !hasBeenExpired
-    p++;
+        log.error( "dumpSpill: queue '%s' lost %u spilled events", queueName.c_str(), numSpilled-level.pSpill->size() );
+        if( numSpilled == level.pSpill->size() )
+        {
+          bReadFailed = true;
+          break;
+        } // if
+      } // catch
+      listSize -= numSpilled-level.pSpill->size();
+    } // while
+    numProcessed += dumpList( &batch, reason );
+  } // while
+  return numProcessed;
+} // dumpSpill
+
+/**
+ * expires the events whose expiry time has passed - only the expiring events are visited
+ * and they are removed from the queue
+ * **/
+void straightQueue::scanForExpiredEvents( )
+{
+  int numExpired = 0;
+  while( !expiryIndex.empty() && (expiryIndex.front().expiryTime < now) )
+  {
+    tPriorityLevel& level = levels[expiryIndex.front().level];
+    unsigned long long seq = expiryIndex.front().seq;
+    std::pop_heap( expiryIndex.begin(), expiryIndex.end(), expiresLater );
+    expiryIndex.pop_back();
+    if( seq < level.backSeq ) continue;   // already left the queue
+
+    baseEvent*& pEvent = level.eventList[level.frontSeq-1-seq];
+    if( (pEvent == NULL) || !pEvent->isExpired(now) ) continue;
+    sendResult( pEvent, false, std::string(), std::string(), std::string(), std::string("expired"), std::string() );
+    pEvent->expire();
+    numExpiredEvents++;
+    numExpired++;
+    log.warn( log.LOGMOSTLY ) << "scanForExpiredEvents: queue '" << queueName << "' expired event (queued for " << (now-pEvent->getQueueTime()) << "s lag " << (now-pEvent->getExpiryTime()) << "s): " << pEvent->toString();
+    baseEvent::release( pEvent );
+    pEvent = NULL;
+    level.listSize--;
+    memSize--;
+    listSize--;
   } // while
+
+  if( numExpired > 0 )
+  {
+    trimExpired();
+    log.info( log.MIDLEVEL, "scanForExpiredEvents: queue '%s' expired %d events qlen:%u", queueName.c_str(), numExpired, listSize );
+  } // if
 } // scanForExpiredEvents
 
 /**
- * produces a csv version of the queue status and statistics
+ * produces a csv version of the queue status and statistics - a priority queue adds the
+ * depth, number dequeued, mean and max wait time for each level
  * **/
 std::string& straightQueue::getStatus( )
 {
   char str[128];
-  sprintf( str, "%u,%u,%d", listSize, maxQueueLength, numExpiredEvents );
-  
-  resetStats();
+  sprintf( str, "%u,%u,%d,%u,%u", listSize, maxQueueLength, numExpiredEvents, listSize-memSize, numSpilledEvents );
   statusStr = str;
+  if( coalescePolicy != COALESCE_NONE )
+  {
+    sprintf( str, ",%u", numCoalesced );
+    statusStr.append( str );
+  } // if
+  if( numLevels > 1 )
+  {
+    for( int i = 0; i < numLevels; i++ )
+    {
+      tPriorityLevel& level = levels[i];
+      float meanWait = (level.numDequeued>0)?(float)level.accWaitTime/level.numDequeued:0;
+      sprintf( str, ",%u,%u,%f,%u", level.listSize, level.numDequeued, meanWait, level.maxWaitTime );
+      statusStr.append( str );
+    } // for
+  } // if
+
+  resetStats();
   return statusStr;
 } // getStatus
 
@@ -178,6 +686,16 @@ std::string& straightQueue::getStatus( )
  * **/
 std::string& straightQueue::getStatusKey( )
 {
-  statusStrKey = "qSize,qMax,numExp";
+  statusStrKey = "qSize,qMax,numExp,qSpilled,numSpilled";
+  if( coalescePolicy != COALESCE_NONE ) statusStrKey.append( ",numCoalesced" );
+  if( numLevels > 1 )
+  {
+    char str[128];
+    for( int i = 0; i < numLevels; i++ )
+    {
+      sprintf( str, ",p%dSize,p%dNum,p%dMeanWait,p%dMaxWait", i, i, i, i );
+      statusStrKey.append( str );
+    } // for
+  } // if
   return statusStrKey;
 } // getStatusKey
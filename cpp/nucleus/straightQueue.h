@@ -4,8 +4,44 @@
  $Id: straightQueue.h 2547 2012-08-30 18:36:42Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		10/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		expiry index
+ @version 1.2.0		16/10/2026		agent		priority levels
+ @version 1.3.0		16/10/2026		agent		overflow spills to disk
+ @version 1.4.0		16/10/2026		agent		getQueueLength
+ @version 1.5.0		16/10/2026		agent		coalescing of events by coalesceKey
 
  @note
+ events that can expire are indexed in a min-heap on expiryTime so a scan only touches the
+ events that actually expire.  The events are numbered in the order they are queued; as
+ events are only added at the front and removed from the back the number locates the event
+ in eventList and an expired event is released immediately, leaving a NULL in its place.
+ Index entries for events that have left the queue are discarded lazily
+
+ a queue of type 'priority' keeps a FIFO per priority level (up to MAX_PRIORITY_LEVELS, the
+ highest level is the most urgent).  Events are placed by their part2 priority or the queue's
+ defaultPriority.  The next event is taken from the highest non-empty level unless
+ - priorityWeights are configured: the levels are served in weighted rounds - each level
+   gets its weight in events per round
+ - otherwise priorityAging (seconds) promotes the head of a level by one level for every
+   interval it has waited so the lower levels cannot starve
+ both only look at the head of each level so enqueue and dequeue stay O(1) for a fixed
+ number of levels.  A 'straight' queue is a priority queue with a single level
+
+ once maxQueueLength events are held in memory further events are appended to a spillSegment
+ per level rather than dumping the queue to the recovery log.  While a level has spilled events
+ new events for the level follow them to disk so the order is kept; the spilled events are paged
+ back in as the level drains below half of maxQueueLength.  Only once the segment reaches
+ spillMaxMB (0, the default, disables spilling) are overflowing events dumped to the recovery log.
+ Spilling trades durability for keeping the queue: the segment is unlinked when it is created so
+ the spilled events are lost if the nucleus crashes or is killed, while a dump to the recovery
+ log survives and can be replayed with txProcRecover
+
+ with a coalescePolicy an event carrying a part2 coalesceKey is collapsed into the event with the
+ same key that is held in memory: 'first' drops the new event, 'last' puts the new event in the
+ place of the queued one and 'append' merges the script parameters of the new event into the
+ queued one.  The key maps to the level and sequence number of the event in a hash index so
+ the lookup is O(1); like the expiry index, entries of events that have left the queue are
+ discarded lazily.  Spilled events are not indexed until they are paged back in
 
  @todo
  
@@ -19,15 +55,52 @@
 
 #include "nucleus/baseQueue.h"
 #include "nucleus/queueContainer.h"
+#include <vector>
+#include <unordered_map>
 
 class recoveryLog;
 class baseEvent;
+class spillSegment;
+
+/** an entry in the expiry index - level and seq identify the position of the event **/
+struct tExpiryEntry
+{
+  unsigned int              expiryTime;
+  unsigned int              level;
+  unsigned long long        seq;
+};
+typedef std::vector<tExpiryEntry> expiryIndexT;
+
+/** the place of the queued event with a coalesce key **/
+struct tCoalesceEntry
+{
+  unsigned int              level;
+  unsigned long long        seq;
+};
+typedef std::unordered_map<std::string,tCoalesceEntry> coalesceIndexT;
+
+/** a priority level - a FIFO with its scheduling state and wait time stats **/
+struct tPriorityLevel
+{
+  straightQueueT            eventList;      // NULL where an event has been expired in place - never at the back
+  unsigned int              listSize;       // number of events of the level in memory
+  spillSegment*             pSpill;         // events that follow the ones in memory - created on the first overflow
+  unsigned long long        frontSeq;       // sequence number of the next event pushed to the front
+  unsigned long long        backSeq;        // sequence number of the event at the back
+  unsigned int              weight;         // events per round for weighted scheduling
+  unsigned int              credit;         // events left in the current round
+  unsigned int              numDequeued;    // events taken from the level since the stats were reset
+  unsigned int              accWaitTime;    // accumulative time in the queue of numDequeued
+  unsigned int              maxWaitTime;    // max time in the queue of numDequeued
+};
 
 class straightQueue : public baseQueue
 {
   // Definitions
   public:
     static const char *const FROM;
+    static const int MAX_PRIORITY_LEVELS = 8;
+    enum eCoalescePolicy { COALESCE_NONE=0, COALESCE_FIRST=1, COALESCE_LAST=2, COALESCE_APPEND=3 };
 
     // Methods
   public:
@@ -36,6 +109,7 @@ class straightQueue : public baseQueue
 
     virtual bool canExecuteEventDirectly( baseEvent* pEvent )   {return listSize==0;}
     virtual bool isQueueEmpty( )                                {return !bExitWhenDone && (listSize==0);}
+    virtual unsigned int getQueueLength( )                      {return listSize;}
     virtual baseEvent* popAvailableEvent( int fd );
     virtual void queueEvent( baseEvent* pEvent );
 
@@ -44,12 +118,30 @@ class straightQueue : public baseQueue
     virtual void dumpQueue( const char* reason );
     virtual std::string& getStatus();
     virtual std::string& getStatusKey( );
+    virtual void resetStats();
     
 
   private:
-    void init( );
+    void init( tQueueDescriptor* theDescriptor );
     baseEvent* popEvent( );
+    int levelForEvent( baseEvent* pEvent );
+    void pushEvent( int levelNum, baseEvent* pEvent );
+    bool spillEvent( int levelNum, baseEvent* pEvent );
+    void refillLevel( int levelNum );
+    void refillDrainedLevels( );
+    int dumpSpill( tPriorityLevel& level, const char* reason );
+    void dumpEvent( baseEvent* pEvent, const char* reason );
+    int selectLevel( );
     void checkQueueOverflow( );
+    void trimLevel( tPriorityLevel& level );
+    void trimExpired( );
+    void compactExpiryIndex( );
+    static bool expiresLater( const tExpiryEntry& a, const tExpiryEntry& b )  {return a.expiryTime>b.expiryTime;}
+    bool coalesceEvent( baseEvent* pEvent );
+    void indexCoalesceKey( int levelNum, unsigned long long seq, baseEvent* pEvent );
+    bool isCoalesceEntryValid( const tCoalesceEntry& entry );
+    void compactCoalesceIndex( );
+    void indexExpiry( int levelNum, unsigned long long seq, unsigned int expiryTime );
 
   protected:
 
@@ -57,8 +149,21 @@ class straightQueue : public baseQueue
   public:
 
   protected:
-    straightQueueT                    eventList;            ///< list of events that can be serviced
-    unsigned int                      listSize;             ///< current size of the event list
+    tPriorityLevel                    levels[MAX_PRIORITY_LEVELS];  ///< the FIFO per priority level - only numLevels are used
+    int                               numLevels;            ///< number of priority levels - 1 for a straight queue
+    int                               defaultPriority;      ///< level for events without a priority
+    unsigned int                      agingInterval;        ///< seconds of waiting that promote the head of a level by one level - 0 disables
+    bool                              bWeighted;            ///< levels are served in weighted rounds rather than by priority
+    unsigned int                      listSize;             ///< current number of events across the levels including the spilled events
+    unsigned int                      memSize;              ///< number of events held in memory
+    unsigned long long                spillMaxBytes;        ///< limit on the size of a level's spill segment - 0 disables spilling
+    std::string                       spillDir;             ///< directory for the spill segments
+    unsigned int                      numSpilledEvents;     ///< number of events spilled since the stats were reset
+    static unsigned int               spillSeq;             ///< makes the spill segment names unique in the process
+    expiryIndexT                      expiryIndex;          ///< min-heap on expiryTime of the queued events that can expire
+    eCoalescePolicy                   coalescePolicy;       ///< what happens to an event with the coalesce key of a queued event
+    coalesceIndexT                    coalesceIndex;        ///< coalesce key to the place of the queued event
+    unsigned int                      numCoalesced;         ///< number of events collapsed since the stats were reset
     bool                              bExitWhenDone;        ///< shutdown procedure for persistent apps
 
   private:
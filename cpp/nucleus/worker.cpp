@@ -13,6 +13,13 @@
  @version 1.5.2		25/02/2013		Gerhardus Muller		return event serialised without checking its return value
  @version 1.6.0		05/06/2013		Gerhardus Muller		support for FD_CLOEXEC
  @version 1.7.0		20/06/2013		Gerhardus Muller		support for the fdsToRemainOpen list and reopening the recoveryLog
+ @version 1.8.0		16/10/2026		agent		done events use the binary section encoding if the queue has bBinarySections
+ @version 1.9.0		16/10/2026		agent		EV_PERL in an embedded interpreter if the queue has bEmbeddedPerl; the done event reports its cache hits
+ @version 1.10.0		16/10/2026		agent		the done event reports the spawn latency
+ @version 1.11.0		16/10/2026		agent		pipelined persistent apps - events are written to the app as they arrive and the responses matched on their pipelineRef
+ @version 1.11.1		17/10/2026		agent		never blocks writing to a pipelined app - input it does not accept is flushed once its stdin is writable while its responses are still read
+ @version 1.11.2		17/10/2026		agent		the copy of a command kept in the pipeline is read back from the frame written to the app
+ @version 1.11.2		17/10/2026		agent		the fds the worker keeps open are close-on-exec so that they do not leak into the scripts it spawns
 
  @note
 
@@ -30,6 +37,7 @@
 #include <unistd.h>
 #include <sys/resource.h>
 #include <dirent.h>
+#include <poll.h>
 #include "boost/regex.hpp"
 #include "boost/tokenizer.hpp"
 #include "src/options.h"
@@ -37,6 +45,7 @@
 #include "nucleus/workerDescriptor.h"
 #include "nucleus/urlRequest.h"
 #include "nucleus/scriptExec.h"
+#include "nucleus/perlExec.h"
 #include "nucleus/recoveryLog.h"
 #include "nucleus/queueManagementEvent.h"
 #include "utils/utils.h"
@@ -62,6 +71,9 @@ worker::worker( )
   pid = 0;
   pUrlRequest = NULL;
   pScriptExec = NULL;
+  pPerlExec = NULL;
+  perlCache = perlExec::CACHE_NONE;
+  spawnUs = 0;
   bRecoveryProcess = false;
   theRecoveryLog = NULL;
   pQueueManagement = NULL;
@@ -71,6 +83,11 @@ worker::worker( )
   elapsedTime = 0;
   bPersistentApp = false;
   bExitWhenDone = false;
+  bPipelined = false;
+  bShutdownPending = false;
+  bAppClosed = false;
+  bRepoll = false;
+  lastPipelineRef = 0;
   maxTimeToRun = 0;
   numHits = 0;
 }	// worker
@@ -113,17 +130,25 @@ worker::worker( tQueueDescriptor* theQueueDescriptor, int theFd, recoveryLog* re
   sprintf( name, "workerFd%d", fd );
   pRecSock = new unixSocket( fd, unixSocket::ET_QUEUE_EVENT, false, name );
   pRecSock->setNonblocking( );
-  pRecSock->initPoll( 2 );
+  pRecSock->initPoll( 5 );        // room for the stdin, stdout and stderr of a pipelined persistent app
   pRecSock->addReadFd( fd );
   pRecSock->addReadFd( signalFd[1] );
 
   pUrlRequest = NULL;
   pScriptExec = NULL;
+  pPerlExec = NULL;
+  perlCache = perlExec::CACHE_NONE;
+  spawnUs = 0;
   pQueueManagement = NULL;
   bWroteRecovery = false;
   elapsedTime = 0;
   bPersistentApp = false;
   bExitWhenDone = false;
+  bPipelined = false;
+  bShutdownPending = false;
+  bAppClosed = false;
+  bRepoll = false;
+  lastPipelineRef = 0;
   numHits = 0;
 
   if( !pContainerDesc->defaultScript.empty() )
@@ -153,10 +178,13 @@ worker::~worker()
       pScriptExec->waitForChildExit();
     } // if( childPid
   } // if( bPersistentApp
+  for( pipelineMapIteratorT it = pipeline.begin(); it != pipeline.end(); it++ )
+    delete it->second.pEvent;
   if( pSignalSock != NULL ) delete pSignalSock;
   if( pRecSock != NULL ) delete pRecSock;
   if( pUrlRequest != NULL ) delete pUrlRequest;
   if( pScriptExec != NULL ) delete pScriptExec;
+  if( pPerlExec != NULL ) delete pPerlExec;
   if( pQueueManagement != NULL ) delete pQueueManagement;
 }	// ~worker
 
@@ -243,12 +271,17 @@ void worker::sendResult( baseEvent* pEvent, bool bSuccess, const std::string& re
 
 /**
  * sends a done message back to the parent
+ * @param pipelineRef - the pipelineRef the nucleus gave the event if the worker is pipelined
  * **/
-void worker::sendDone( )
+void worker::sendDone( unsigned int pipelineRef )
 {
   baseEvent done( baseEvent::EV_WORKER_DONE );
   done.setElapsedTime( elapsedTime );
+  if( pipelineRef != 0 ) done.setPipelineRef( pipelineRef );
   done.setRecoveryEvent( bWroteRecovery );
+  if( perlCache != perlExec::CACHE_NONE ) done.setPerlCache( perlCache );
+  if( spawnUs != 0 ) done.setSpawnUs( spawnUs );
+  if( pContainerDesc->bBinarySections ) done.setSectionEncoding( baseEvent::SECTION_BINARY );
   done.serialise( fd );
   log.debug( log.LOGNORMAL, "sendDone:'%s' fd:%d", done.toString().c_str(), fd );
 } // sendDone
@@ -340,6 +373,26 @@ void worker::main( )
       log.warn( log.LOGALWAYS, "main: failed to permanently drop priviledges" );
   } // else
 
+  // the interpreter is created once the priviledges are dropped so the preloaded modules run with the same rights as the scripts
+  if( pContainerDesc->bEmbeddedPerl && persistentApp.empty() )
+  {
+    if( !perlExec::isAvailable() )
+      log.warn( log.LOGALWAYS, "main: bEmbeddedPerl is set but txProc was built without EMBEDDED_PERL - spawning perl" );
+    else
+    {
+      try
+      {
+        pPerlExec = new perlExec( queueName, pContainerDesc->perlPreload );
+        pScriptExec->setPerlExec( pPerlExec );
+      } // try
+      catch( Exception e )
+      {
+        pPerlExec = NULL;
+        log.warn( log.LOGALWAYS, "main: no embedded perl - spawning perl" );
+      } // catch
+    } // else
+  } // if
+
   // check if we are required to run a persistent app
   if( !persistentApp.empty() )
   {
@@ -385,10 +438,17 @@ void worker::main( )
     persistentScript.setScriptName( persistentApp );
     log.info( log.LOGMOSTLY, "main: command:'%s' %s", persistentApp.c_str(), persistentParams.c_str() );
     bPersistentApp = true;
+    bPipelined = (pContainerDesc->pipelineDepth > 1);
+    if( bPipelined )
+    {
+      log.info( log.LOGMOSTLY, "main: pipelined with up to %d events in flight", pContainerDesc->pipelineDepth );
+      pScriptExec->setPipelineDepth( pContainerDesc->pipelineDepth );
+    } // if
 
     try
     {
       pScriptExec->spawnScript( &persistentScript, true );
+      if( bPipelined ) pollApp();
     } // try
     catch( Exception e )
     {
@@ -405,6 +465,8 @@ void worker::main( )
     try
     {
       bWroteRecovery = false;
+      perlCache = perlExec::CACHE_NONE;
+      spawnUs = 0;
       bool bReady = false;
       try
       {
@@ -444,12 +506,21 @@ void worker::main( )
                 if( pEvent->getCommand() == baseEvent::CMD_SHUTDOWN )
                 {
                   log.info( log.LOGALWAYS, "main: CMD_SHUTDOWN" );
-                  if( bPersistentApp )
+                  if( bPipelined && !pipeline.empty() )
                   {
-                    kill( pScriptExec->getChildPid(), SIGTERM );
-                    pScriptExec->waitForChildExit();
+                    // the app is stopped once the events in flight are done
+                    log.info( log.LOGALWAYS, "main: CMD_SHUTDOWN waiting for %u events in flight", (unsigned int)pipeline.size() );
+                    bShutdownPending = true;
                   } // if
-                  bRunning = false;
+                  else
+                  {
+                    if( bPersistentApp )
+                    {
+                      kill( pScriptExec->getChildPid(), SIGTERM );
+                      pScriptExec->waitForChildExit();
+                    } // if
+                    bRunning = false;
+                  } // else
                 } // if
                 else if( pEvent->getCommand() == baseEvent::CMD_WORKER_CONF )
                 {
@@ -461,7 +532,10 @@ void worker::main( )
                   if( bPersistentApp )
                   {
                     if( pEvent->getCommand() == baseEvent::CMD_EXIT_WHEN_DONE ) bExitWhenDone = true;
-                    process( pEvent );
+                    if( bPipelined )
+                      submitToApp( pEvent, true );    // the worker still acts on the command below
+                    else
+                      process( pEvent );
                   } // if
                   if( pEvent->getCommand() == baseEvent::CMD_STATS ) 
                   {
@@ -479,6 +553,7 @@ void worker::main( )
                     log.debug( log.MIDLEVEL, "main: CMD_REOPEN_LOG" );
                     log.reopenLogfile();
                     theRecoveryLog->reOpen();
+                    closeOnExecFileHandles();
                   } // if
                   else if( pEvent->getCommand() == baseEvent::CMD_END_OF_QUEUE )
                   {
@@ -495,7 +570,13 @@ void worker::main( )
                   log.info( log.MIDLEVEL ) << "main: received event1:" << pEvent->toStringBrief();
 
                 // process the event
-                if( !pEvent->isExpired() )
+                if( bPipelined && !pEvent->isExpired() )
+                {
+                  // done once the app responds
+                  submitToApp( pEvent, false );
+                  pEvent = NULL;
+                } // if
+                else if( !pEvent->isExpired() )
                 {
                   process( pEvent );
 
@@ -515,7 +596,7 @@ void worker::main( )
                 } // else
 
                 // indicate we are done - we don't send done events for commands - the worker is not first removed from the idle queue
-                sendDone();
+                if( pEvent != NULL ) sendDone( pEvent->getPipelineRef() );
               } // else
 
               delete pEvent;
@@ -530,7 +611,14 @@ void worker::main( )
             {
               if( bPersistentApp )
               {
+                if( bPipelined ) drainApp();    // responses written before the app exited
                 pScriptExec->waitForChildExit();
+                if( bPipelined )
+                {
+                  failPipeline( "exception: persistent app exited" );
+                  bRepoll = true;
+                  if( bShutdownPending ) bRunning = false;
+                } // if
                 if( bExitWhenDone )
                 {
                   bRunning = false;
@@ -545,7 +633,7 @@ void worker::main( )
                   // if( pScriptExec->getTermSignal() != SIGTERM )
                   // this problem is handled in workerPool - it checks if the worker was busy in its
                   // reconing and only pushes it onto the idle list if it was busy
-                  sendDone(); // its a reasonable assumption that the child was busy when dying
+                  if( !bPipelined ) sendDone(); // its a reasonable assumption that the child was busy when dying
                   pQueueManagement->genEvent( queueManagementEvent::QMAN_PDIED );
                   try
                   {
@@ -558,6 +646,7 @@ void worker::main( )
                       throw Exception( log, log.ERROR, "main: sigprocmask returned -1" );
 
                     pScriptExec->spawnScript( &persistentScript, true );
+                    bAppClosed = false;
                     sleep(pOptionsNucleus->persistentAppRespawnDelay); // dont flood the system with respawns
                     if( sigprocmask( SIG_SETMASK, &oldmask, &blockmask ) < 0 )
                       throw Exception( log, log.ERROR, "main: sigprocmask1 returned -1" );
@@ -575,9 +664,42 @@ void worker::main( )
             else
               log.warn( log.LOGALWAYS, "main: signalFd[1] not recognising command:%d", (int)theCommand );
           } // if( fd == signalFd[1]
+          else if( bPipelined && (newFd == pScriptExec->getStdOutFd()) )
+          {
+            readAppResponse();
+          } // else if
+          else if( bPipelined && (newFd == pScriptExec->getStdErrFd()) )
+          {
+            pScriptExec->readStdErr();
+          } // else if
+          else if( bPipelined && (newFd == pScriptExec->getStdInFd()) )
+          {
+            try
+            {
+              if( pScriptExec->flushPipe() ) bRepoll = true;   // stop polling for writing
+            } // try
+            catch( Exception e )
+            {
+              // the events written in part fail once the app exits
+              bRepoll = true;
+            } // catch
+          } // else if
           else
             log.warn( log.LOGALWAYS, "main: fd:%d not handled", newFd );
         } // while fd = pRecSock->getNextFd
+
+        // stop polling the app once it has closed its pipes - the poll set is only changed once all the
+        // ready fds are processed
+        if( bPipelined )
+        {
+          int errorFd = pRecSock->getLastErrorFd();
+          if( (errorFd > -1) && ((errorFd == pScriptExec->getStdOutFd()) || (errorFd == pScriptExec->getStdErrFd()) || (errorFd == pScriptExec->getStdInFd())) )
+          {
+            bAppClosed = true;
+            bRepoll = true;
+          } // if
+          if( bRepoll ) pollApp();
+        } // if
       } // if( bReady
       else
         log.warn( log.LOGALWAYS, "main: waitForEvent returned with no fd's available" );
@@ -590,7 +712,7 @@ void worker::main( )
         std::string mess( "exception: " );
         mess += e.getMessage();
         sendResult( pEvent, false, mess );
-        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone();
+        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone( pEvent->getPipelineRef() );
         delete pEvent;
         pEvent = NULL;
       } // if
@@ -606,7 +728,7 @@ void worker::main( )
         std::string mess( "exception: " );
         mess += e.what();
         sendResult( pEvent, false, mess );
-        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone();
+        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone( pEvent->getPipelineRef() );
         delete pEvent;
         pEvent = NULL;
       } // if
@@ -621,7 +743,7 @@ void worker::main( )
         std::string mess( "exception: " );
         mess += e.what();
         sendResult( pEvent, false, mess );
-        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone();
+        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone( pEvent->getPipelineRef() );
         delete pEvent;
         pEvent = NULL;
       } // if
@@ -635,7 +757,7 @@ void worker::main( )
         log.error() << "main: caught unknown exception:" << " event:" << pEvent->toString();
         std::string mess( "exception: " );
         sendResult( pEvent, false, mess );
-        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone();
+        if( pEvent->getType() != baseEvent::EV_COMMAND ) sendDone( pEvent->getPipelineRef() );
         delete pEvent;
         pEvent = NULL;
       } // if
@@ -705,33 +827,7 @@ void worker::process( baseEvent* pEvent )
 
     if( pReturn != NULL )
     {
-      // if the return type is EV_RESULT we can derive the success of the operation
-      if( pReturn->getType() == baseEvent::EV_RESULT )
-      {
-        bool bSuccess = pReturn->isSuccess();
-        logForRecovery( pEvent, bSuccess, pScriptExec->getFailureCause() );
-      } // if
-
-      int returnFd = pEvent->getReturnFd();
-      if( (returnFd!= -1) && !bRecoveryProcess )
-      {
-        pEvent->shiftReturnFd();  // drop the return fd that we have just used
-        pReturn->setReturnFd( pEvent->getFullReturnFd() );
-        int retVal = pReturn->serialise( returnFd );
-        if( retVal > -1 )
-          log.info( log.LOGNORMAL ) << "sendResult to fd:" << returnFd << " bytes:" << retVal << " - " << pReturn->toString();
-        else
-          log.warn( log.LOGMOSTLY ) << "sendResult failed to fd:" << returnFd << " err:" << strerror(errno) << " - " << pReturn->toString();
-      } // if
-      else
-      {
-        if( !pReturn->getFullDestQueue().empty())
-        {
-          pReturn->serialise( nucleusFd );
-          if( log.wouldLog(log.MIDLEVEL) ) log.info( log.MIDLEVEL ) << "process:" << pReturn->toString();
-        } // if
-      } // if
-
+      routeAppResponse( pEvent, pReturn );
       delete pReturn;
     } // if pReturn
   } // if( bPersistentApp
@@ -750,6 +846,8 @@ void worker::process( baseEvent* pEvent )
       {
         pScriptExec->setFailureCause( e.getMessage() );
       } // catch
+      perlCache = pScriptExec->getPerlCache();
+      spawnUs = pScriptExec->getSpawnUs();
       sendResult( pEvent, bSuccess, result, pScriptExec->getErrorString(), pScriptExec->getTraceTimestamp(), pScriptExec->getFailureCause(), pScriptExec->getSystemParam(), pResult );
       logForRecovery( pEvent, bSuccess, pScriptExec->getFailureCause() );
       if( pResult != NULL ) delete pResult;
@@ -783,6 +881,194 @@ void worker::process( baseEvent* pEvent )
 
   elapsedTime = time(NULL) - timeStarted;
 } // process
+
+/**
+ * hands the response of the persistent app to the return path of the event or failing
+ * that to the nucleus if it has a destination queue
+ * @param pEvent - the event the app responded to
+ * @param pReturn - the response
+ * **/
+void worker::routeAppResponse( baseEvent* pEvent, baseEvent* pReturn )
+{
+  // if the return type is EV_RESULT we can derive the success of the operation
+  if( pReturn->getType() == baseEvent::EV_RESULT )
+  {
+    bool bSuccess = pReturn->isSuccess();
+    logForRecovery( pEvent, bSuccess, pScriptExec->getFailureCause() );
+  } // if
+
+  int returnFd = pEvent->getReturnFd();
+  if( (returnFd!= -1) && !bRecoveryProcess )
+  {
+    pEvent->shiftReturnFd();  // drop the return fd that we have just used
+    pReturn->setReturnFd( pEvent->getFullReturnFd() );
+    int retVal = pReturn->serialise( returnFd );
+    if( retVal > -1 )
+      log.info( log.LOGNORMAL ) << "sendResult to fd:" << returnFd << " bytes:" << retVal << " - " << pReturn->toString();
+    else
+      log.warn( log.LOGMOSTLY ) << "sendResult failed to fd:" << returnFd << " err:" << strerror(errno) << " - " << pReturn->toString();
+  } // if
+  else
+  {
+    if( !pReturn->getFullDestQueue().empty())
+    {
+      pReturn->serialise( nucleusFd );
+      if( log.wouldLog(log.MIDLEVEL) ) log.info( log.MIDLEVEL ) << "process:" << pReturn->toString();
+    } // if
+  } // if
+} // routeAppResponse
+
+/**
+ * writes an event to the pipelined persistent app without waiting for its response - the
+ * event is tagged with a pipelineRef of the worker that the app copies into the response
+ * @param pEvent - the event - owned by the pipeline once written unless bKeepCopy
+ * @param bKeepCopy - the pipeline keeps a copy of the event and the caller retains it
+ * @exception on failure to write to the app - the event keeps the pipelineRef of the nucleus
+ * **/
+void worker::submitToApp( baseEvent* pEvent, bool bKeepCopy )
+{
+  tPipelineEntry entry;
+  entry.bCommand = (pEvent->getType() == baseEvent::EV_COMMAND);
+  entry.nucleusRef = entry.bCommand?0:pEvent->getPipelineRef();
+  entry.timeStarted = time( NULL );
+  if( ++lastPipelineRef == 0 ) lastPipelineRef = 1;   // 0 is no pipelineRef
+  pEvent->setPipelineRef( lastPipelineRef );
+  try
+  {
+    pScriptExec->writePipe( pEvent );
+  } // try
+  catch( Exception e )
+  {
+    pEvent->setPipelineRef( entry.nucleusRef );
+    throw;
+  } // catch
+  if( bKeepCopy )
+  {
+    // the copy constructor of baseEvent copies nothing - the frame just written holds all of it
+    std::string& frame = pEvent->serialiseToString();
+    entry.pEvent = baseEvent::unSerialiseFromFrame( frame.c_str(), frame.length() );
+  } // if
+  else
+    entry.pEvent = pEvent;
+  pipeline[lastPipelineRef] = entry;
+  if( pScriptExec->hasPendingInput() ) bRepoll = true;   // poll the stdin of the app for writing
+  log.debug( log.LOGNORMAL, "submitToApp: pipelineRef:%u nucleusRef:%u in flight:%u", lastPipelineRef, entry.nucleusRef, (unsigned int)pipeline.size() );
+} // submitToApp
+
+/**
+ * reads a response of the pipelined persistent app, routes it and reports the event it
+ * belongs to done.  an app that does not copy the pipelineRef into its responses is
+ * assumed to respond in order
+ * @return false if no complete response was available
+ * **/
+bool worker::readAppResponse( )
+{
+  baseEvent* pReturn = pScriptExec->readPipeEvent();
+  if( pReturn == NULL ) return false;
+
+  unsigned int ref = pReturn->getPipelineRef();
+  pipelineMapIteratorT it = (ref!=0)?pipeline.find( ref ):pipeline.begin();
+  if( it == pipeline.end() )
+  {
+    log.warn( log.LOGMOSTLY ) << "readAppResponse: no event in flight for pipelineRef:" << ref << " - " << pReturn->toString();
+    if( !pReturn->getFullDestQueue().empty() ) pReturn->serialise( nucleusFd );
+    delete pReturn;
+    return true;
+  } // if
+
+  tPipelineEntry entry = it->second;
+  pipeline.erase( it );
+  bWroteRecovery = false;
+  try
+  {
+    routeAppResponse( entry.pEvent, pReturn );
+  } // try
+  catch( Exception e )
+  {
+    log.error() << "readAppResponse: caught exception:" << e.getMessage() << " event:" << entry.pEvent->toString();
+  } // catch
+  delete pReturn;
+
+  if( !entry.bCommand )
+  {
+    elapsedTime = time( NULL ) - entry.timeStarted;
+    sendDone( entry.nucleusRef );
+  } // if
+  delete entry.pEvent;
+
+  if( bShutdownPending && pipeline.empty() )
+  {
+    log.info( log.LOGALWAYS, "readAppResponse: events in flight done - completing CMD_SHUTDOWN" );
+    if( pScriptExec->getChildPid() > 0 )
+    {
+      kill( pScriptExec->getChildPid(), SIGTERM );
+      pScriptExec->waitForChildExit();
+    } // if
+    bRunning = false;
+  } // if
+  return true;
+} // readAppResponse
+
+/**
+ * collects the responses the pipelined app wrote before it exited
+ * **/
+void worker::drainApp( )
+{
+  if( bAppClosed || (pScriptExec->getStdOutFd() == -1) ) return;
+  struct pollfd pollOut;
+  pollOut.fd = pScriptExec->getStdOutFd();
+  pollOut.events = POLLIN;
+  try
+  {
+    while( !pipeline.empty() && (poll( &pollOut, 1, 0 ) > 0) && (pollOut.revents & POLLIN) )
+    {
+      if( !readAppResponse() ) break;
+    } // while
+  } // try
+  catch( Exception e )
+  {
+    log.warn( log.LOGMOSTLY, "drainApp: %s", e.getMessage() );
+  } // catch
+} // drainApp
+
+/**
+ * fails the events still in flight once the pipelined app has exited
+ * @param reason - reported in the result of each event
+ * **/
+void worker::failPipeline( const std::string& reason )
+{
+  if( !pipeline.empty() ) log.warn( log.LOGALWAYS, "failPipeline: %u events in flight - %s", (unsigned int)pipeline.size(), reason.c_str() );
+  for( pipelineMapIteratorT it = pipeline.begin(); it != pipeline.end(); it++ )
+  {
+    tPipelineEntry& entry = it->second;
+    if( !entry.bCommand )
+    {
+      sendResult( entry.pEvent, false, reason );
+      elapsedTime = time( NULL ) - entry.timeStarted;
+      sendDone( entry.nucleusRef );
+    } // if
+    delete entry.pEvent;
+  } // for
+  pipeline.clear();
+} // failPipeline
+
+/**
+ * rebuilds the poll set of a pipelined worker - its own sockets plus the stdout and stderr
+ * of the persistent app while it has them open and its stdin while input is pending
+ * **/
+void worker::pollApp( )
+{
+  pRecSock->resetPoll();
+  pRecSock->addReadFd( fd );
+  pRecSock->addReadFd( signalFd[1] );
+  if( !bAppClosed && (pScriptExec->getStdOutFd() != -1) )
+  {
+    pRecSock->addReadFd( pScriptExec->getStdOutFd() );
+    pRecSock->addReadFd( pScriptExec->getStdErrFd() );
+    if( pScriptExec->hasPendingInput() ) pRecSock->addWriteFd( pScriptExec->getStdInFd() );
+  } // if
+  bRepoll = false;
+} // pollApp
     
 /**
  * close the unwanted file handles (sockets and files)
@@ -841,8 +1127,34 @@ void worker::closeOpenFileHandles( )
   } // else
 
   theRecoveryLog->reOpen();
+  closeOnExecFileHandles();
 } // closeOpenFileHandles
 
+/**
+ * sets FD_CLOEXEC on every fd other than stdin/out/err - the log files, recovery log and
+ * sockets that the worker keeps open are not inherited by the scripts it spawns.  to be
+ * repeated whenever the logs are reopened
+ * **/
+void worker::closeOnExecFileHandles( )
+{
+  DIR *dir;
+  struct dirent *ent;
+
+  if( (dir=opendir("/proc/self/fd/")) == NULL )
+  {
+    log.warn( log.LOGALWAYS, "closeOnExecFileHandles failed to open /proc/self/fd:%s", strerror(errno) );
+    return;
+  } // if
+
+  int dirFd = dirfd( dir );
+  while( (ent=readdir(dir)) != NULL)
+  {
+    int openFd = atoi( ent->d_name );
+    if( (openFd > 2) && (openFd != dirFd) ) unixSocket::setCloseOnExec( true, openFd );
+  } // while
+  closedir( dir );
+} // closeOnExecFileHandles
+
 /**
  Standard logging call - produces a generic text version of the worker.
  Memory allocation / deleting is handled by this worker.
@@ -871,6 +1183,11 @@ void worker::dumpHttp( const std::string& time )
     pEvent->addParam( "wRecoveryCount", count );
     pEvent->addParam( "numHits", numHits );
     if( bPersistentApp ) pEvent->addParam( "persistentApp", persistentApp );
+    if( pPerlExec != NULL )
+    {
+      pEvent->addParam( "perlHits", pPerlExec->getNumHits() );
+      pEvent->addParam( "perlCompiles", pPerlExec->getNumCompiles() );
+    } // if
     pEvent->serialise( nucleusFd );
     delete pEvent;
   } // if
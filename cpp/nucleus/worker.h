@@ -4,8 +4,17 @@
  $Id: worker.h 2880 2013-06-06 15:39:03Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		29/09/2009		Gerhardus Muller		Script created
+ @version 1.1.0		16/10/2026		agent		embedded perl executor
+ @version 1.2.0		16/10/2026		agent		spawn latency of the current event
+ @version 1.3.0		16/10/2026		agent		pipelined persistent apps with several events in flight
+ @version 1.3.1		17/10/2026		agent		the stdin of a pipelined app is polled for writing while input is pending
+ @version 1.3.2		17/10/2026		agent		closeOnExecFileHandles
 
  @note
+ with a pipelineDepth above 1 a persistent app is written every event as it arrives and its stdout
+ and stderr are polled along with the worker's own sockets.  The worker tags each event with a
+ pipelineRef of its own that the app copies into its response; the done event of an event carries
+ the pipelineRef the nucleus gave it
 
  @todo
  
@@ -22,12 +31,26 @@
 #include "nucleus/optionsNucleus.h"
 #include "nucleus/baseEvent.h"
 #include "nucleus/queueContainer.h"
+#include <map>
 
 class urlRequest;
 class scriptExec;
+class perlExec;
 class recoveryLog;
 class queueManagementEvent;
 
+/** an event written to a pipelined persistent app that has not responded yet **/
+struct tPipelineEntry
+{
+  baseEvent*                pEvent;
+  unsigned int              nucleusRef;       ///< pipelineRef given by the nucleus - goes back in the done event
+  int                       timeStarted;
+  bool                      bCommand;         ///< commands do not get a done event
+};
+
+typedef std::map<unsigned int,tPipelineEntry> pipelineMapT;
+typedef pipelineMapT::iterator pipelineMapIteratorT;
+
 class worker : public object
 {
   // Definitions
@@ -52,9 +75,16 @@ class worker : public object
   private:
     void logForRecovery( baseEvent* pEvent, bool bSuccess, const std::string& error );
     void process( baseEvent* pEvent );
+    void routeAppResponse( baseEvent* pEvent, baseEvent* pReturn );
+    void submitToApp( baseEvent* pEvent, bool bKeepCopy );
+    bool readAppResponse( );
+    void drainApp( );
+    void failPipeline( const std::string& reason );
+    void pollApp( );
     void sendResult( baseEvent* pEvent, bool bSuccess, const std::string& result, const std::string& errorString=std::string(), const std::string& traceTimestamp=std::string(), const std::string& failureCause=std::string(), const std::string& systemParam=std::string(), baseEvent* pResult=NULL );
-    void sendDone( );
+    void sendDone( unsigned int pipelineRef=0 );
     void closeOpenFileHandles( );
+    void closeOnExecFileHandles( );
     void dumpHttp( const std::string& time );
     void reconfigure( baseEvent* pCommand );
     static void sendSignalCommand( baseEvent::eCommandType command );
@@ -78,6 +108,12 @@ class worker : public object
     bool                        bWroteRecovery;       ///< true if a recovery event was generated
     bool                        bPersistentApp;       ///< true if we are in persistent mode
     bool                        bExitWhenDone;        ///< received an exit when done command - only useful if running a persistent app
+    bool                        bPipelined;           ///< persistent app with more than one event in flight
+    bool                        bShutdownPending;     ///< CMD_SHUTDOWN received while events were in flight with the pipelined app
+    bool                        bAppClosed;           ///< the pipelined app closed one of its pipes - not polled until it is respawned
+    bool                        bRepoll;              ///< the app's pipes changed - the poll set is rebuilt once the ready fds are processed
+    unsigned int                lastPipelineRef;      ///< pipelineRef of the last event written to the pipelined app
+    pipelineMapT                pipeline;             ///< events in flight with the pipelined app keyed by pipelineRef
     int                         signalFd[2];          ///< unix domain socket to submit signal events to the parent process - parent listens on [1]
     int                         fd;                   ///< file descriptor of unix domain socket on which the worker should listen for instructions
     int                         nucleusFd;            ///< nucleus process file descriptor
@@ -89,6 +125,9 @@ class worker : public object
     unixSocket*                 pRecSock;             ///< socket for receiving events
     unixSocket*                 pSignalSock;          ///< socket for received signal events
     urlRequest*                 pUrlRequest;          ///< object used for URL requests / notifications
+    perlExec*                   pPerlExec;            ///< embedded interpreter for EV_PERL if the queue has bEmbeddedPerl
+    int                         perlCache;            ///< perlExec::ePerlCache of the current event - reported in the done event
+    unsigned int                spawnUs;              ///< time taken to launch the process of the current event - reported in the done event if non 0
     queueManagementEvent*       pQueueManagement;     ///< class that generates queue management events
     std::string                 queueName;            ///< queue name
     std::string                 persistentApp;        ///< persistent app to keep running if not empty - after initial parsing it is for logging only
@@ -8,6 +8,11 @@
  @version 1.2.0		23/08/2012		Gerhardus Muller		added a queue member
  @version 1.3.0		30/08/2012		Gerhardus Muller		made provision for a default url, default script and queue management events
  @version 1.4.0		05/06/2013		Gerhardus Muller		support for FD_CLOEXEC
+ @version 1.5.0		16/10/2026		agent		events and commands are sent in the binary section encoding if the queue has bBinarySections
+ @version 1.6.0		16/10/2026		agent		the last event is returned to the baseEvent pool
+ @version 1.7.0		16/10/2026		agent		events and commands go through the network outbound buffer for sendFd
+ @version 1.8.0		16/10/2026		agent		a pipelined worker has several events in flight, each kept for recovery until its done event
+ @version 1.8.1		17/10/2026		agent		an event that cannot be sent is left to the recovery log and the worker stays idle
 
  @note
 
@@ -29,6 +34,7 @@
 #include "nucleus/worker.h"
 #include "nucleus/recoveryLog.h"
 #include "nucleus/queueManagementEvent.h"
+#include "nucleus/network.h"
 #include "src/options.h"
 
 const char *const workerDescriptor::FROM = typeid( workerDescriptor ).name();
@@ -69,6 +75,7 @@ workerDescriptor::workerDescriptor( tQueueDescriptor* theQueueDescriptor, recove
   if( !pContainerDesc->bBlockingWorkerSocket ) pSendSock->setNonblocking();  // it is a problem either way if the socket to the worker blocks unless the packet is very large
   sendFd = fd[0];
   pLastEvent = NULL;
+  lastPipelineRef = 0;
   startTime = 0;
   pQueue = NULL;
   pQueueManagement = new queueManagementEvent( this, pContainerDesc, nucleusFd );
@@ -81,9 +88,11 @@ workerDescriptor::~workerDescriptor()
 {
   dump( "~workerDescriptor " );
   if( pSendSock != NULL ) delete pSendSock;
+  network::dropOutBuffer( sendFd );
   if( fd[0] != 0 ) close( fd[0] );
   if( fd[1] != 0 ) close( fd[1] );
-  if( pLastEvent != NULL ) delete pLastEvent;
+  baseEvent::release( pLastEvent );
+  releaseInFlight();
   if( pQueue != NULL ) delete pQueue;
   if( pQueueManagement != NULL ) delete pQueueManagement;
 }	// ~workerDescriptor
@@ -99,6 +108,7 @@ int workerDescriptor::forkChild( )
   bSIGTERM = false;
   bBusy = false;
   recoveryReason = "worker_crash";
+  network::dropOutBuffer( sendFd );   // whatever was meant for the previous child
 
   if( ( pid = fork( ) ) < 0 )
     throw Exception( log, log.ERROR, "forkChild: failed to fork %s - %s", strerror(errno), toString().c_str(), strerror(errno) );
@@ -148,13 +158,14 @@ void workerDescriptor::shutdownChild( )
 {
   if( pLastEvent != NULL ) 
   {
-    delete pLastEvent;
+    baseEvent::release( pLastEvent );
     pLastEvent = NULL;
   }
   log.info( log.LOGALWAYS, "shutdownChild: pid=%d", pid );
   // update the startTime if not busy so that we do not accidently have a maintenance job kill
   // the worker before it has had a chance to run
-  if( !bBusy ) startTime = time( NULL );
+  if( !isExecuting() ) startTime = time( NULL );
+  releaseInFlight();
   recoveryReason = "CMD_SHUTDOWN";
   bChildInShutdown = true;
   sendCommandToChild( baseEvent::CMD_SHUTDOWN );
@@ -170,9 +181,10 @@ void workerDescriptor::termChild( )
 {
   if( pLastEvent != NULL ) 
   {
-    delete pLastEvent;
+    baseEvent::release( pLastEvent );
     pLastEvent = NULL;
   }
+  releaseInFlight();
     
   if( bSIGTERM ) return;
   log.info( log.LOGALWAYS, "termChild: pid=%d", pid );
@@ -202,9 +214,10 @@ void workerDescriptor::ripCarpet( )
 {
   if( pLastEvent != NULL ) 
   {
-    delete pLastEvent;
+    baseEvent::release( pLastEvent );
     pLastEvent = NULL;
   }
+  releaseInFlight();
     
   log.info( log.LOGALWAYS, "ripCarpet: pid=%d", pid );
   recoveryReason = "RIPPED";
@@ -233,7 +246,8 @@ void workerDescriptor::sendCommandToChild( baseEvent::eCommandType command )
 
   baseEvent* pEvent = new baseEvent( baseEvent::EV_COMMAND );
   pEvent->setCommand( command );
-  pEvent->serialise( sendFd );
+  if( pContainerDesc->bBinarySections ) pEvent->setSectionEncoding( baseEvent::SECTION_BINARY );
+  network::sendEvent( sendFd, pEvent );
   delete pEvent;
 } // sendCommandToChild
 
@@ -243,7 +257,8 @@ void workerDescriptor::sendCommandToChild( baseEvent::eCommandType command )
  * **/
 void workerDescriptor::sendCommandToChild( baseEvent* pCommand )
 {
-  pCommand->serialise( sendFd );
+  if( pContainerDesc->bBinarySections ) pCommand->setSectionEncoding( baseEvent::SECTION_BINARY );
+  network::sendEvent( sendFd, pCommand );
 } // sendCommandToChild
 
 /**
@@ -265,43 +280,117 @@ void workerDescriptor::exitWhenDone( )
 } // exitWhenDone
 
 /**
- * writes a recovery event if there is a valid previous event
+ * writes a recovery event if there is a valid previous event or events in flight
  * **/
 void workerDescriptor::writeRecoveryEntry( )
 {
   if( pLastEvent != NULL )
   {
-    if( !pLastEvent->isRetryExceeded() )
-    {
-      pLastEvent->incRetryCounter();
-      if( theRecoveryLog != NULL )
-        theRecoveryLog->writeEntry( pLastEvent, recoveryReason.c_str(), FROM, TO_WORKER );
-      else
-        log.warn( log.LOGALWAYS ) << "writeRecoveryEntry: (theRecoveryLog is NULL) failed for " << pLastEvent->toString();
-    } // if
-    else
-      log.warn( log.LOGALWAYS )  << "writeRecoveryEntry: retries exceeded dumping event " << pLastEvent->toString();
-
-    delete pLastEvent;
+    writeRecoveryEntry( pLastEvent );
+    baseEvent::release( pLastEvent );
     pLastEvent = NULL;
   } // if
+
+  for( inFlightMapIteratorT it = inFlight.begin(); it != inFlight.end(); it++ )
+  {
+    writeRecoveryEntry( it->second.pEvent );
+    baseEvent::release( it->second.pEvent );
+  } // for
+  inFlight.clear();
 } // writeRecoveryEntry
 
 /**
- * submits an event to the worker for processing
+ * writes a recovery event for a single event unless its retries are exceeded
+ * @param pEvent - the event the worker did not complete
  * **/
-void workerDescriptor::submitEvent( baseEvent* pEvent, unsigned int now )
+void workerDescriptor::writeRecoveryEntry( baseEvent* pEvent )
 {
-  if( pLastEvent != NULL ) delete pLastEvent;   // drop previous backup
-  startTime = now;
-  bSIGTERM = false;     // this gets set by the maximum execution timeout logic and does not necessarily term the worker - it does however try to terminate the worker's forked task
-  recoveryReason = "";
+  if( !pEvent->isRetryExceeded() )
+  {
+    pEvent->incRetryCounter();
+    if( theRecoveryLog != NULL )
+      theRecoveryLog->writeEntry( pEvent, recoveryReason.c_str(), FROM, TO_WORKER );
+    else
+      log.warn( log.LOGALWAYS ) << "writeRecoveryEntry: (theRecoveryLog is NULL) failed for " << pEvent->toString();
+  } // if
+  else
+    log.warn( log.LOGALWAYS )  << "writeRecoveryEntry: retries exceeded dumping event " << pEvent->toString();
+} // writeRecoveryEntry
+
+/**
+ * drops the backups of the events in flight
+ * **/
+void workerDescriptor::releaseInFlight( )
+{
+  for( inFlightMapIteratorT it = inFlight.begin(); it != inFlight.end(); it++ )
+    baseEvent::release( it->second.pEvent );
+  inFlight.clear();
+} // releaseInFlight
+
+/**
+ * submits an event to the worker for processing - a pipelined worker gets the event tagged
+ * with a pipelineRef that comes back in its done event
+ * @return false if the event could not be sent - it has been written to the recovery log
+ * as ser_fail and is released, the worker is left as it was and is to go back on the idle list
+ * **/
+bool workerDescriptor::submitEvent( baseEvent* pEvent, unsigned int now )
+{
+  bool bPipelined = isPipelined();
+  if( !bPipelined )
+  {
+    baseEvent::release( pLastEvent );           // drop previous backup
+    pLastEvent = NULL;
+  } // if
+  else
+  {
+    if( ++lastPipelineRef == 0 ) lastPipelineRef = 1;   // 0 is no pipelineRef
+    pEvent->setPipelineRef( lastPipelineRef );
+  } // else
   char trace[64]; snprintf( trace, 64, "tt-%s;", log.getTimestamp() );
   pEvent->appendTrace( trace );
-  pEvent->serialise( sendFd );
-  pLastEvent = pEvent;                          // keep in case process dies
+  if( pContainerDesc->bBinarySections ) pEvent->setSectionEncoding( baseEvent::SECTION_BINARY );
+  if( network::sendEvent( sendFd, pEvent ) == -1 )
+  {
+    log.warn( log.LOGALWAYS, "submitEvent: failed to send to worker pid:%d fd:%d - event left to the recovery log", pid, sendFd );
+    baseEvent::release( pEvent );
+    return false;
+  } // if
+
+  bSIGTERM = false;     // this gets set by the maximum execution timeout logic and does not necessarily term the worker - it does however try to terminate the worker's forked task
+  recoveryReason = "";
+  if( bPipelined )
+  {
+    if( inFlight.empty() ) startTime = now;     // start of the oldest event in flight
+    tInFlightEvent entry;
+    entry.pEvent = pEvent;
+    entry.startTime = now;
+    inFlight[lastPipelineRef] = entry;          // keep in case process dies
+  } // if
+  else
+  {
+    startTime = now;
+    pLastEvent = pEvent;                        // keep in case process dies
+  } // else
+  return true;
 } // submitEvent
 
+/**
+ * a pipelined worker reports every event done with its pipelineRef - drops the backup of
+ * the event and moves the start time on to the oldest event still in flight
+ * @param pDone - the EV_WORKER_DONE event
+ * @return false if the event was not in flight
+ * **/
+bool workerDescriptor::eventDone( baseEvent* pDone )
+{
+  if( !isPipelined() ) return true;
+  inFlightMapIteratorT it = inFlight.find( pDone->getPipelineRef() );
+  if( it == inFlight.end() ) return false;
+  baseEvent::release( it->second.pEvent );
+  inFlight.erase( it );
+  if( !inFlight.empty() ) startTime = inFlight.begin()->second.startTime;
+  return true;
+} // eventDone
+
 /**
  Standard logging call - produces a generic text version of the workerDescriptor.
  Memory allocation / deleting is handled by this workerDescriptor.
@@ -312,6 +401,7 @@ std::string workerDescriptor::toString( )
   std::ostringstream oss;
   oss << this << " fd:" << fd[0] << "," << fd[1] << " pid:" << pid << (bBusy?" busy":" not busy") << (bChildInShutdown?" in shutdown ":" ") << (bSIGTERM?recoveryReason.c_str():"");
   oss << " startTime:" << startTime;
-  if( bBusy && (startTime>0)) oss << " executing for:" << (time(NULL)-startTime) << "s";
+  if( isPipelined() ) oss << " inFlight:" << inFlight.size();
+  if( isExecuting() && (startTime>0)) oss << " executing for:" << (time(NULL)-startTime) << "s";
 	return oss.str();
 }	// toString
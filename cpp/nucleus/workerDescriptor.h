@@ -5,8 +5,12 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		29/09/2009		Gerhardus Muller		Script created
  @version 1.1.0		23/08/2012		Gerhardus Muller		added a queue member
+ @version 1.2.0		16/10/2026		agent		events in flight for a pipelined persistent app
+ @version 1.2.1		17/10/2026		agent		submitEvent reports an event that could not be sent
 
  @note
+ with a pipelineDepth above 1 the worker stays on the idle list of the pool until it has pipelineDepth
+ events in flight - bBusy then means it is off the idle list and isExecuting tells if it has work
 
  @todo
  
@@ -23,11 +27,22 @@
 #include "nucleus/baseEvent.h"
 #include "nucleus/baseQueue.h"
 #include "nucleus/queueContainer.h"
+#include <map>
 
 class worker;
 class recoveryLog;
 class queueManagementEvent;
 
+/** an event submitted to a pipelined worker that is not done yet **/
+struct tInFlightEvent
+{
+  baseEvent*                pEvent;
+  unsigned int              startTime;
+};
+
+typedef std::map<unsigned int,tInFlightEvent> inFlightMapT;
+typedef inFlightMapT::iterator inFlightMapIteratorT;
+
 class workerDescriptor : object
 {
   // Definitions
@@ -48,12 +63,17 @@ class workerDescriptor : object
     void termChild( );
     void killChild( );
     void ripCarpet( );
-    void submitEvent( baseEvent* pEvent, unsigned int now );
+    bool submitEvent( baseEvent* pEvent, unsigned int now );
+    bool eventDone( baseEvent* pDone );
     void setPid( int newPid )         {pid = newPid;}
     int  getPid( )                    {return pid;}
     int  getFd( )                     {return fd[0];}
     int  getFd1( )                    {return fd[1];}
     bool isBusy( )                    {return bBusy;}
+    bool isPipelined( )               {return pContainerDesc->pipelineDepth>1;}
+    bool hasCapacity( )               {return isPipelined()&&(inFlight.size()<(unsigned int)pContainerDesc->pipelineDepth);}   ///< can take another event while executing
+    bool isExecuting( )               {return bBusy||!inFlight.empty();}
+    unsigned int getNumInFlight( )    {return inFlight.size();}
     void setBusy( bool state )        {bBusy=state;}
     unixSocket* getSock( )            {return pSendSock;}
     bool isTerminal( )                {return bChildInShutdown;}
@@ -68,6 +88,8 @@ class workerDescriptor : object
     baseQueue* getQueue()             {return pQueue;}
 
   private:
+    void writeRecoveryEntry( baseEvent* pEvent );
+    void releaseInFlight( );
 
     // Properties
   public:
@@ -90,6 +112,8 @@ class workerDescriptor : object
     worker*                     pWorker;              ///< contains the child object
     baseQueue*                  pQueue;               ///< associated queue if relevant - is deleted in the destructor if not NULL
     baseEvent*                  pLastEvent;           ///< kept for recovery purposes
+    inFlightMapT                inFlight;             ///< events submitted to a pipelined worker keyed by their pipelineRef - kept for recovery purposes
+    unsigned int                lastPipelineRef;      ///< pipelineRef of the last event submitted
     queueManagementEvent*       pQueueManagement;     ///< class that generates queue management events
     std::string                 recoveryReason;       ///< reason for the recovery event
     std::string                 persistentApp;        ///< persistent app to keep running if not empty
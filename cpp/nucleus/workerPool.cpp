@@ -9,6 +9,12 @@
  @version 2.0.0		16/08/2012		Gerhardus Muller		support for individually addressable workers; propagation of dynamic execTimeLimit to the actual worker
  @version 2.1.0		03/09/2012		Gerhardus Muller		queue management events
  @version 2.2.0		04/09/2012		Gerhardus Muller		getNextFd to return associated unixSocket as well
+ @version 2.3.0		16/10/2026		agent		executeEvent split into updateQueueStats and submitToIdleWorker for the shared pool
+ @version 2.4.0		16/10/2026		agent		load sample and countShuttingDown for the autoscaler
+ @version 2.5.0		16/10/2026		agent		embedded perl cache hits and compiles in the status for bEmbeddedPerl queues
+ @version 2.6.0		16/10/2026		agent		spawn latency count, mean, max and histogram in the status of non persistent queues
+ @version 2.7.0		16/10/2026		agent		a pipelined worker goes back on the idle list while it has room for more events; events in flight in the status
+ @version 2.7.1		17/10/2026		agent		a worker the event could not be sent to goes back on the idle list
 
  @note
  vir addressable workers:
@@ -27,6 +33,7 @@
 	Copyright Notice
  * **/
 
+#include <string.h>
 #include "nucleus/workerPool.h"
 #include "nucleus/baseEvent.h"
 #include "nucleus/workerDescriptor.h"
@@ -34,7 +41,11 @@
 #include "nucleus/optionsNucleus.h"
 #include "nucleus/recoveryLog.h"
 #include "nucleus/queueContainer.h"
+
+/** upper bounds in us of the spawn latency buckets - the last bucket takes the rest **/
+static const unsigned int spawnBucketUs[workerPool::NUM_SPAWN_BUCKETS-1] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
 #include "nucleus/queueManagementEvent.h"
+#include "nucleus/perlExec.h"
 #include "src/options.h"
 
 /**
@@ -56,6 +67,8 @@ workerPool::workerPool( struct tQueueDescriptor* theQueueDescriptor, recoveryLog
   else
     bPersistentApp = true;
 
+  memset( &loadSample, 0, sizeof(loadSample) );
+
   pQueueManagement = new queueManagementEvent( pContainerDesc, nucleusFd );
   init();
 } // workerPool
@@ -122,6 +135,12 @@ void workerPool::reopenLogfile( )
 void workerPool::resetStats( )
 {
   numRecoveryEvents = 0;
+  numPerlHits = 0;
+  numPerlCompiles = 0;
+  countSpawns = 0;
+  accSpawnUs = 0;
+  maxSpawnUs = 0;
+  memset( spawnHist, 0, sizeof(spawnHist) );
   accQueueTime = 0;
   maxQueueTime = 0;
   countQueueEvents = 0;
@@ -142,20 +161,48 @@ void workerPool::executeEvent( baseEvent* pEvent )
   if( pEvent == NULL ) throw new Exception( log, log.WARN, "executeEvent: pEvent is NULL" );
   if( !anyAvailableWorkers() )  throw new Exception( log, log.WARN, "executeEvent: no available workers" );
 
-  // accumulate the queuing stats
+  updateQueueStats( pEvent );
+  submitToIdleWorker( pEvent );
+} // executeEvent
+
+/**
+ * accumulates the queuing stats for an event taken off the queue
+ * **/
+void workerPool::updateQueueStats( baseEvent* pEvent )
+{
   unsigned int timeInQueue = now - pEvent->getQueueTime();
   accQueueTime += timeInQueue;
   if( timeInQueue > maxQueueTime ) maxQueueTime = timeInQueue;
   countQueueEvents++;
+  loadSample.accQueueTime += timeInQueue;
+  if( timeInQueue > loadSample.maxQueueTime ) loadSample.maxQueueTime = timeInQueue;
+  loadSample.countQueueEvents++;
+} // updateQueueStats
 
+/**
+ * hands the event to the next idle worker - the queuing stats are left to the caller
+ * which is the queue the event came from if the worker is lent to it
+ * @return the fd of the worker or -1 if the event could not be sent - it is then left to the
+ * recovery log and the worker stays idle
+ * **/
+int workerPool::submitToIdleWorker( baseEvent* pEvent )
+{
   workerDescriptor* pWorker = getIdleWorkerByPid( -1 );
-  pWorker->submitEvent( pEvent, now );
-  pWorker->setBusy( true );
+  if( !pWorker->submitEvent( pEvent, now ) )
+  {
+    addIdleWorkersEntry( pWorker->getPid(), pWorker );
+    return -1;
+  } // if
+  if( pWorker->hasCapacity() )
+    addIdleWorkersEntry( pWorker->getPid(), pWorker );    // a pipelined worker takes events until it has pipelineDepth in flight
+  else
+    pWorker->setBusy( true );
   if( log.wouldLog( log.LEVEL6 ) )
     log.info( log.MIDLEVEL ) << "executeEvent: given event to worker " << pWorker->getPid() << ", " << pEvent->toString();
   else
     log.info( log.MIDLEVEL ) << "executeEvent: given event to worker " << pWorker->getPid() << ", '" << pEvent->typeToString() << "'";
-} // executeEvent
+  return pWorker->getFd();
+} // submitToIdleWorker
 
 /**
  * updates the max execution time
@@ -524,7 +571,7 @@ bool workerPool::isIdle( )
     } // else
   } // if
   else
-    return countIdle(true)==totalWorkers; // very conservative, slow and only for debugging
+    return (countIdle(true)==totalWorkers) && (countInFlight()==0); // very conservative, slow and only for debugging
     // return countIdle(false)==totalWorkers; - speed does not matter as it is only invoked on shutdown
 } // isIdle
 
@@ -581,8 +628,9 @@ void workerPool::releaseWorker( int fd, baseEvent* pEvent )
       if( pEvent->getType() == baseEvent::EV_WORKER_DONE )
       {
         // if the worker is not busy assume it was a persistent process and killed
-        // to reload
-        if( pWorker->isBusy() && !pWorker->isTerminal() )
+        // to reload.  a pipelined worker is busy only while it has no room for another event
+        pWorker->eventDone( pEvent );
+        if( pWorker->isBusy() && !pWorker->isTerminal() && (!pWorker->isPipelined() || pWorker->hasCapacity()) )
         {
           pWorker->setBusy( false );
           addIdleWorkersEntry( pWorker->getPid(), pWorker );
@@ -611,13 +659,73 @@ void workerPool::updateStats( baseEvent* pDone )
   accExecTime += elapsedTime;
   if( elapsedTime > maxExecTime ) maxExecTime = elapsedTime;
   countExecEvents++;
+  loadSample.accExecTime += elapsedTime;
+  loadSample.countExecEvents++;
 
   if( pDone->getRecoveryEvent() ) 
     numRecoveryEvents++;
+
+  if( pContainerDesc->bEmbeddedPerl )
+  {
+    int perlCache = pDone->getPerlCache();
+    if( perlCache == perlExec::CACHE_HIT )
+      numPerlHits++;
+    else if( perlCache == perlExec::CACHE_COMPILE )
+      numPerlCompiles++;
+  } // if
+
+  unsigned int spawnUs = pDone->getSpawnUs();
+  if( spawnUs > 0 )
+  {
+    countSpawns++;
+    accSpawnUs += spawnUs;
+    if( spawnUs > maxSpawnUs ) maxSpawnUs = spawnUs;
+    int bucket = 0;
+    while( (bucket < NUM_SPAWN_BUCKETS-1) && (spawnUs > spawnBucketUs[bucket]) ) bucket++;
+    spawnHist[bucket]++;
+  } // if
 } // updateStats
 
 /**
- * finds and kills any worker overrunning its execution time
+ * returns the times accumulated since the previous call and starts a new sample
+ * @param sample - out parameter
+ * **/
+void workerPool::takeLoadSample( tLoadSample& sample )
+{
+  sample = loadSample;
+  memset( &loadSample, 0, sizeof(loadSample) );
+} // takeLoadSample
+
+/**
+ * counts the workers that have been told to shut down but have not exited yet
+ * **/
+int workerPool::countShuttingDown( )
+{
+  int count = 0;
+  workerMapIteratorT it;
+  for( it = workers.begin(); it != workers.end(); it++ )
+  {
+    workerDescriptor* pWorker = it->second;
+    if( pWorker->isTerminal() ) count++;
+  } // for
+  return count;
+} // countShuttingDown
+
+/**
+ * counts the events in flight on pipelined workers
+ * **/
+unsigned int workerPool::countInFlight( )
+{
+  unsigned int count = 0;
+  workerMapIteratorT it;
+  for( it = workers.begin(); it != workers.end(); it++ )
+    count += it->second->getNumInFlight();
+  return count;
+} // countInFlight
+
+/**
+ * finds and kills any worker overrunning its execution time - for a pipelined worker
+ * it is the oldest event in flight that counts
  * **/
 void workerPool::checkOverrunningWorkers( )
 {
@@ -627,9 +735,10 @@ void workerPool::checkOverrunningWorkers( )
   for( it = workers.begin(); it != workers.end(); it++ )
   {
     workerDescriptor* pWorker = it->second;
-    if( pWorker->isBusy() && ((now-pWorker->getStartTime())>execTimeLimit) )
+    if( pWorker->isExecuting() && ((now-pWorker->getStartTime())>execTimeLimit) )
     {
       log.warn( log.LOGALWAYS, "checkOverrunningWorkers: killing %s", pWorker->toString().c_str() );
+      if( !pWorker->isBusy() ) deleteIdleWorkersEntry( pWorker->getPid() );   // termChild takes it off the idle list
       // first time round send the child a SIGTERM, second time round a SIGKILL
       if( pWorker->isKilled() )
         pWorker->killChild();
@@ -638,7 +747,7 @@ void workerPool::checkOverrunningWorkers( )
     } // if
     else
     {
-      if( log.wouldLog( log.LOGONOCCASION ) && pWorker->isBusy() )
+      if( log.wouldLog( log.LOGONOCCASION ) && pWorker->isExecuting() )
         log.info( log.LOGALWAYS, "checkOverrunningWorkers: worker OK::%s execTimeLimit:%d", pWorker->toString().c_str(), execTimeLimit );
     } // else
   } // 
@@ -653,9 +762,30 @@ std::string& workerPool::getStatus( )
   float meanExecTime = (countExecEvents>0)?(float)accExecTime/countExecEvents:0;
   float meanQueue = (countQueueEvents>0)?(float)accQueueTime/countQueueEvents:0;
   sprintf( str, "%u,%u,%u,%f,%u,%u,%f,%d,%u",execTimeLimit,countExecEvents,maxExecTime,meanExecTime,countQueueEvents,maxQueueTime,meanQueue,totalWorkers,(unsigned int)idleWorkersSize() );
+  statusStr = str;
+  if( pContainerDesc->bEmbeddedPerl )
+  {
+    sprintf( str, ",%u,%u", numPerlHits, numPerlCompiles );
+    statusStr.append( str );
+  } // if
+  if( pContainerDesc->pipelineDepth > 1 )
+  {
+    sprintf( str, ",%u", countInFlight() );
+    statusStr.append( str );
+  } // if
+  if( pContainerDesc->persistentApp.empty() )
+  {
+    float meanSpawnUs = (countSpawns>0)?(float)accSpawnUs/countSpawns:0;
+    sprintf( str, ",%u,%f,%u,", countSpawns, meanSpawnUs, maxSpawnUs );
+    statusStr.append( str );
+    for( int i = 0; i < NUM_SPAWN_BUCKETS; i++ )
+    {
+      sprintf( str, (i==0)?"%u":"/%u", spawnHist[i] );
+      statusStr.append( str );
+    } // for
+  } // if
 
   resetStats();
-  statusStr = str;
   return statusStr;
 } // getStatus
 
@@ -665,5 +795,8 @@ std::string& workerPool::getStatus( )
 std::string& workerPool::getStatusKey( )
 {
   statusStrKey = "timeLimit,cntExec,mxExec,mnExec,cntQ,mxQ,mnQ,cntW,idleW";
+  if( pContainerDesc->bEmbeddedPerl ) statusStrKey.append( ",perlHits,perlCompiles" );
+  if( pContainerDesc->pipelineDepth > 1 ) statusStrKey.append( ",inFlight" );
+  if( pContainerDesc->persistentApp.empty() ) statusStrKey.append( ",spawnCnt,spawnMnUs,spawnMxUs,spawnHist" );
   return statusStrKey;
 } // getStatusKey
@@ -5,6 +5,11 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		10/09/2008		Gerhardus Muller		Script created
  @version 2.0.0		16/08/2012		Gerhardus Muller		support for individually addressable workers
+ @version 2.1.0		16/10/2026		agent		updateQueueStats and submitToIdleWorker for events lent through the shared pool
+ @version 2.2.0		16/10/2026		agent		load sample for the autoscaler
+ @version 2.3.0		16/10/2026		agent		embedded perl cache counters
+ @version 2.4.0		16/10/2026		agent		spawn latency histogram
+ @version 2.5.0		16/10/2026		agent		pipelined persistent app workers stay idle until they have pipelineDepth events in flight
 
  @note
 
@@ -35,10 +40,21 @@ typedef idleWorkersT::iterator idleWorkersIteratorT;
 typedef std::map<int,workerDescriptor*> workerMapT;
 typedef workerMapT::iterator workerMapIteratorT;
 
+/** queue and execution times since the autoscaler last looked - independent of the stats reset **/
+struct tLoadSample
+{
+  unsigned int              accQueueTime;
+  unsigned int              maxQueueTime;
+  unsigned int              countQueueEvents;
+  unsigned int              accExecTime;
+  unsigned int              countExecEvents;
+};
+
 class workerPool : public object
 {
   // Definitions
   public:
+    static const int NUM_SPAWN_BUCKETS = 9;               ///< spawn latency buckets - see spawnBucketUs
 
     // Methods
   public:
@@ -49,6 +65,8 @@ class workerPool : public object
     virtual int anyAvailableWorkers( int fd )                           {return idleWorkers.empty()?-1:fd;}
     virtual bool anyAvailableWorkers( )                                 {return !idleWorkers.empty();}
     virtual void executeEvent( baseEvent* pEvent );
+    void updateQueueStats( baseEvent* pEvent );
+    int  submitToIdleWorker( baseEvent* pEvent );
     void resetItFd()                                                    {itFd=workerFds.begin();}
     int getNextFd( int& pid, unixSocket*& pSocket );
     virtual void resetIdleIt()                                          {;}                                   ///< not used for the normal workerPool
@@ -73,6 +91,9 @@ class workerPool : public object
     void exitWhenDone( );
     bool isPersistentApp( )                                             {return bPersistentApp;}
     int  getTotalWorkers( )                                             {return totalWorkers;}
+    int  countShuttingDown( );
+    unsigned int countInFlight( );
+    void takeLoadSample( tLoadSample& sample );
     void reopenLogfile( );
 
   private:
@@ -107,9 +128,16 @@ class workerPool : public object
     unsigned int                      countExecEvents;      ///< number of events counted
     unsigned int                      maxExecTime;          ///< max time a worker was executing
     unsigned int                      numRecoveryEvents;    ///< as the name suggests
+    unsigned int                      numPerlHits;          ///< EV_PERL events that found their script compiled in the embedded interpreter
+    unsigned int                      numPerlCompiles;      ///< EV_PERL events that had to compile their script
+    unsigned int                      countSpawns;          ///< number of events that launched a process
+    unsigned int                      accSpawnUs;           ///< accumulated spawn latency in us
+    unsigned int                      maxSpawnUs;           ///< max spawn latency in us
+    unsigned int                      spawnHist[NUM_SPAWN_BUCKETS]; ///< spawn latency histogram
     unsigned int                      accQueueTime;         ///< accumulative time in queue
     unsigned int                      maxQueueTime;         ///< max queue time
     unsigned int                      countQueueEvents;     ///< number of queued events
+    tLoadSample                       loadSample;           ///< times since the last takeLoadSample
     bool                              bRecoveryProcess;     ///< recoveryProcess
     int                               nucleusFd;            ///< nucleus process fd
 
@@ -8,6 +8,10 @@
  * Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  * @version 1.0.0		01/12/2009		Gerhardus Muller		mirrors v 1.0.0 of baseEvent.cpp - protocol v3.0
  * @version 1.0.1		22/04/2010		Gerhardus Muller		replace CMD_DUMMY_1 with CMD_END_OF_QUEUE
+ * @version 1.1.0		16/10/2026		agent		added EV_BATCH and submitBatch
+ * @version 1.2.0		16/10/2026		agent		added readyTime
+ * @version 1.3.0		16/10/2026		agent		added priority
+ * @version 1.4.0		16/10/2026		agent		added coalesceKey
  *
  * **/
 
@@ -86,13 +90,17 @@ class txProc
       {
         $this->eventType = 10;
       } # elseif
+      elseif( $val == 'EV_BATCH' )
+      {
+        $this->eventType = 11;
+      } # elseif
       else
       {
         trace( "TxProc::command unknown command '$val'", TRACE_WARN );
       } # else
     } # if
     $textVal = array('EV_UNKNOWN','EV_BASE','EV_SCRIPT','EV_PERL','EV_BIN',
-      'EV_URL','EV_RESULT','EV_WORKER_DONE','EV_COMMAND', 'EV_REPLY','EV_ERROR');
+      'EV_URL','EV_RESULT','EV_WORKER_DONE','EV_COMMAND', 'EV_REPLY','EV_ERROR','EV_BATCH');
     return $textVal[$this->eventType];
   } # eventType
   public function reference( )
@@ -117,7 +125,7 @@ class txProc
     return $this->part1['destQueue'];
   } # sub destQueue
 
-  # part2 properties - trace,traceTimestamp,expiryTime,lifetime,retries
+  # part2 properties - trace,traceTimestamp,expiryTime,lifetime,retries,readyTime,priority,coalesceKey
   public function trace( )
   {
     if( func_num_args() == 1 )
@@ -148,6 +156,24 @@ class txProc
       $this->part2['retries'] = func_get_arg(0);
     return $this->part2['retries'];
   } # public function retries
+  public function readyTime( )
+  {
+    if( func_num_args() == 1 )
+      $this->part2['readyTime'] = (int)func_get_arg(0);
+    return $this->part2['readyTime'];
+  } # public function readyTime
+  public function priority( )
+  {
+    if( func_num_args() == 1 )
+      $this->part2['priority'] = (int)func_get_arg(0);
+    return $this->part2['priority'];
+  } # public function priority
+  public function coalesceKey( )
+  {
+    if( func_num_args() == 1 )
+      $this->part2['coalesceKey'] = (string)func_get_arg(0);
+    return $this->part2['coalesceKey'];
+  } # public function coalesceKey
 
   # sysParams - bStandardResponse,command,url,scriptName,result,bSuccess,bExpectReply,
   # errorString,failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent
@@ -716,5 +742,108 @@ class txProc
 
     return array($retVal,$errorString);
   } // serialise
+
+  /**
+   * submits a list of events as a single EV_BATCH frame - on a stream socket the events are
+   * acknowledged with one aggregate result rather than a result per event
+   * datagram sockets provide no acknowledgement so the events are submitted individually
+   * @param $events - array of txProc objects
+   * @param $socket,$unixdomainPath,$serverName,$serverService - as for serialise
+   * @param $reference - optional reference for the batch
+   * @return ((0 fail, 1 success, 2 expect responses),error string,results) - results has a '1' or '0' per event
+   * **/
+  public static function submitBatch( $events,$socket,$unixdomainPath,$serverName,$serverService,$reference=NULL )
+  {
+    $retVal = 0;
+    $errorString = '';
+    $results = '';
+
+    # no acknowledgement on a datagram socket
+    if( !isset($socket) && isset($unixdomainPath) )
+    {
+      $numFailed = 0;
+      foreach( $events as $event )
+      {
+        list($retVal,$errorString) = $event->serialise( NULL,$unixdomainPath,$serverName,$serverService );
+        $results .= $retVal?'1':'0';
+        if( !$retVal ) $numFailed++;
+      } // foreach
+      if( $numFailed ) return array(0,"txProc::submitBatch $numFailed of ".count($events)." events failed - last error: $errorString",$results);
+      return array(1,'',$results);
+    } // if
+
+    $batch = new txProc( 'EV_BATCH' );
+    if( isset($reference) ) $batch->reference( $reference );
+    $batch->addParam( 'count', count($events) );
+    $payload = $batch->serialiseToString();
+    foreach( $events as $event ) $payload .= $event->serialiseToString();
+    if($batch->beVerbose) trace( "txProc::submitBatch: events:".count($events)." len:".strlen($payload), TRACE_DEBUG );
+
+    $bLocalSocketCreated = 1;
+    if( isset($socket) )
+    {
+      $batch->bStreamSocket = 1;
+      $bLocalSocketCreated = 0;
+    } // if
+    else
+    {
+      list($socket,$err) = $batch->createSocket( NULL,$serverName,$serverService );
+      if( $socket === false ) return array($socket,$err,$results);
+    } // else isset socket
+
+    list($retVal,$errorString) = $batch->readGreeting( $socket );
+    if( !$retVal )
+    {
+      if( $bLocalSocketCreated ) socket_close($socket);
+      return array($retVal,$errorString,$results);
+    } #if
+
+    # send the envelope and its members - a large batch may take more than one write
+    $written = 0;
+    $payloadLen = strlen( $payload );
+    while( $written < $payloadLen )
+    {
+      $ret = socket_write( $socket, substr($payload,$written) );
+      if( $ret === FALSE ) break;
+      $written += $ret;
+    } // while
+    if( $written < $payloadLen )
+    {
+      $errorString = "txProc::submitBatch send failed after $written of $payloadLen bytes - ".socket_strerror(socket_last_error());
+      if( $bLocalSocketCreated ) socket_close($socket);
+      return array(0,$errorString,$results);
+    } // if
+
+    # a single aggregate result for the whole batch
+    list($reply,$err) = self::unSerialise( $socket );
+    if( !$reply )
+    {
+      $retVal = 0;
+      $errorString = $err;
+    } // if
+    else
+    {
+      $results = $reply->getParam( 'results' );
+      if( !isset($results) ) $results = '';
+      if( $reply->bSuccess() )
+      {
+        $retVal = 1+$reply->bExpectReply();
+      } // if
+      else
+      {
+        $retVal = 0;
+        $errorString = "txProc::submitBatch ".$reply->getParam('numFailed')." of ".$reply->getParam('count')." events failed";
+      } // else
+    } // else
+
+    # cleanup if required
+    if( $bLocalSocketCreated )
+    {
+      socket_close( $socket );
+      $socket = 0;
+    } // if
+
+    return array($retVal,$errorString,$results);
+  } // submitBatch
 } // class txProc
 ?>
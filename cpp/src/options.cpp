@@ -6,6 +6,7 @@
  @version 1.0.0		10/11/2009		Gerhardus Muller		Script created
  @version 1.1.0		20/03/2012		Gerhardus Muller		Added the max data gram size to the version string
  @version 1.2.0		25/07/2012		Gerhardus Muller		added buildtime/buildno
+ @version 1.3.0		16/10/2026		agent		nucleusShards and shardQueues
 
  @note
 
@@ -25,6 +26,8 @@
 #include "utils/unixSocket.h"
 #include <fstream>
 #include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
 
 const char* options::APP_BASE_NAME = "txProc";
 
@@ -126,6 +129,8 @@ bool options::parseOptions( int ac, char* av[] )
       ("main.statsChildrenAddress", po::value<std::string>(&statsChildrenAddress), "comma separated list of children slaved to this server for stats purposes - can be either server names or IP addresses, leave blank to disable")
       ("main.statsChildrenService", po::value<std::string>(&statsChildrenService)->default_value("mserver"), "children stats service - either a /etc/service entry or a port number")
       ("main.defaultQueue", po::value<std::string>(&defaultQueue)->default_value("default"), "default queue for event processing")
+      ("main.nucleusShards", po::value<int>(&nucleusShards)->default_value(1), "number of nucleus processes the queues are partitioned across")
+      ("main.shardQueues", po::value<std::string>(&shardQueues), "comma separated list of qname:shard pinning queues to a nucleus shard - the other queues are placed by a hash of their name")
       ("main.nonucleus", "Do not start the nucleus")
       ("main.nosocket", "Do not start the socket process")
       ("networkIf.packetSuccessReply", po::value<std::string>(&packetSuccessReply)->default_value("phpProcessedSuccess"), "reply written as result:value on a socket as a result of processing (dispatching) successfully")
@@ -168,6 +173,9 @@ bool options::parseOptions( int ac, char* av[] )
     if( vm.count("flushlogs") ) bFlushLogs = true;
     if( vm.count("main.nonucleus") ) bStartNucleus = false;
     if( vm.count("main.nosocket") ) bStartSocket = false;
+    if( nucleusShards < 1 ) nucleusShards = 1;
+    if( nucleusShards > MAX_NUCLEUS_SHARDS ) nucleusShards = MAX_NUCLEUS_SHARDS;
+    parseShardQueues( );
     
     if( vm.count("help") ) 
     {
@@ -261,3 +269,45 @@ std::string options::displayOptions( )
 
 	return oss.str();
 } // displayOptions
+
+/**
+ * builds shardMap from shardQueues - entries with an invalid shard are ignored
+ * **/
+void options::parseShardQueues( )
+{
+  shardMap.clear();
+  std::string::size_type start = 0;
+  while( start < shardQueues.length() )
+  {
+    std::string::size_type end = shardQueues.find( ',', start );
+    if( end == std::string::npos ) end = shardQueues.length();
+    std::string entry( shardQueues, start, end-start );
+    std::string::size_type colon = entry.find( ':' );
+    int shard = (colon!=std::string::npos)?atoi( entry.c_str()+colon+1 ):-1;
+    if( (shard >= 0) && (shard < nucleusShards) )
+      shardMap[entry.substr( 0, colon )] = shard;
+    else
+      log.warn( log.LOGALWAYS, "parseShardQueues: ignoring '%s' - nucleusShards is %d", entry.c_str(), nucleusShards );
+    start = end+1;
+  } // while
+} // parseShardQueues
+
+/**
+ * the nucleus shard that owns a queue
+ * @param queueName - without a sub queue
+ * @return the shard in the range 0 to nucleusShards-1
+ * **/
+int options::getQueueShard( const std::string& queueName )
+{
+  if( nucleusShards < 2 ) return 0;
+  std::map<std::string,int>::iterator it = shardMap.find( queueName );
+  if( it != shardMap.end() ) return it->second;
+
+  uint32_t hash = 2166136261u;
+  for( std::string::size_type i = 0; i < queueName.length(); i++ )
+  {
+    hash ^= (unsigned char)queueName[i];
+    hash *= 16777619u;
+  } // for
+  return hash % nucleusShards;
+} // getQueueShard
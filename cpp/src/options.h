@@ -5,8 +5,12 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		10/11/2009		Gerhardus Muller		Script created
  @version 1.1.0		25/07/2012		Gerhardus Muller		added buildtime/buildno
+ @version 1.2.0		16/10/2026		agent		nucleusShards, shardQueues and getQueueShard
 
  @note
+ with nucleusShards > 1 the queues are partitioned across that many nucleus processes.  A queue
+ belongs to the shard it is pinned to in shardQueues, otherwise to the FNV-1a hash of its name
+ modulo nucleusShards - getQueueShard is used by all the processes so they agree on the owner
 
  @todo
  
@@ -20,6 +24,7 @@
 
 #include "logging/logger.h"
 #include <boost/program_options.hpp>
+#include <map>
 namespace po = boost::program_options;
 
 class options
@@ -27,6 +32,7 @@ class options
   // Definitions
   public:
     static const int DEF_OUTPUT_WIDTH = 100;
+    static const int MAX_NUCLEUS_SHARDS = 32;
     static const char* APP_BASE_NAME;
 
     // Methods
@@ -38,11 +44,13 @@ class options
     bool parseOptions( int ac, char* av[] );
     void logOptions( );
     bool bGetBDaemon( )                   { return bDaemon; }
+    int getQueueShard( const std::string& queueName );
 
   protected:
 
   private:
     std::string displayOptions( );
+    void parseShardQueues( );
 
     // Properties
   public:
@@ -58,6 +66,7 @@ class options
     int                         statsInterval;            ///< stats interval in seconds
     int                         statsHourStart;           ///< hour in the day to start recording stats
     int                         statsHourStop;            ///< hour in the day to stop recording stats
+    int                         nucleusShards;            ///< number of nucleus processes the queues are partitioned across
 
     std::string                 statsUrl;               ///< url for stats reporting
     std::string                 statsChildrenAddress;   ///< comma separated list of children slaved to this server for stats purposes - can be either server names or IP addresses, leave blank to disable
@@ -72,6 +81,7 @@ class options
     std::string                 configFile;             ///< config file to use
     std::string                 pidName;                ///< name of the pid file to use
     std::string                 defaultQueue;           ///< default queue for event processing
+    std::string                 shardQueues;            ///< comma separated list of qname:shard pinning queues to a nucleus shard
     std::string                 buildNo;                ///< executable build number
     std::string                 buildTime;              ///< executable build time
     bool                        bDaemon;                ///< run as a daemon
@@ -87,6 +97,7 @@ class options
 
   private:
     po::variables_map           vm;                 ///< variable map holding all config options
+    std::map<std::string,int>   shardMap;           ///< queues pinned to a shard - parsed from shardQueues
 };	// class options
 
 extern options* pOptions;
@@ -24,6 +24,9 @@
  @version 1.3.0 	05/06/2013    Gerhardus Muller    createSocketPair prototype changed - not closing upper level sockets
  @version 1.4.0		20/06/2013		Gerhardus Muller		theNetworkIf for the fdsToRemainOpen list
  @version 1.5.0		06/11/2013		Gerhardus Muller		compilation under debian
+ @version 1.6.0		16/10/2026		agent		forks a nucleus process per shard (main.nucleusShards)
+ @version 1.6.1		17/10/2026		agent		a socket per shard that only the nucleus writes to the networkIf on
+ @version 1.6.2		17/10/2026		agent		a socket per pair of shards for the events they pass to each other
 
  @note
 
@@ -69,6 +72,8 @@ txProc::txProc( int theArgc, char* theArgv[] )
 {
   memset( mainFd, 0, sizeof( mainFd ) );
   memset( nucleusFd, 0, sizeof( nucleusFd ) );
+  memset( nucleusReturnFd, 0, sizeof( nucleusReturnFd ) );
+  memset( shardLinkFd, 0, sizeof( shardLinkFd ) );
   memset( networkIfFd, 0, sizeof( networkIfFd ) );
   memset( signalFd, 0, sizeof( signalFd ) );
   pRecSock = NULL;
@@ -76,7 +81,8 @@ txProc::txProc( int theArgc, char* theArgv[] )
   pNucleus = NULL;
   pNetworkIf = NULL;
   pRecoveryLog = NULL;
-  nucleusPid = 0;
+  memset( nucleusPid, 0, sizeof( nucleusPid ) );
+  numShards = 1;
   networkIfPid = 0;
   pid = getpid( );
   argc = theArgc;
@@ -107,8 +113,15 @@ txProc::~txProc()
 
   if( mainFd[0] != 0 ) close( mainFd[0] );
   if( mainFd[1] != 0 ) close( mainFd[1] );
-  if( nucleusFd[0] != 0 ) close( nucleusFd[0] );
-  if( nucleusFd[1] != 0 ) close( nucleusFd[1] );
+  for( int i = 0; i < numShards; i++ )
+  {
+    if( nucleusFd[i][0] != 0 ) close( nucleusFd[i][0] );
+    if( nucleusFd[i][1] != 0 ) close( nucleusFd[i][1] );
+    if( nucleusReturnFd[i][0] != 0 ) close( nucleusReturnFd[i][0] );
+    if( nucleusReturnFd[i][1] != 0 ) close( nucleusReturnFd[i][1] );
+    for( int j = 0; j < numShards; j++ )
+      if( shardLinkFd[i][j] != 0 ) close( shardLinkFd[i][j] );
+  } // for
   if( networkIfFd[0] != 0 ) close( networkIfFd[0] );
   if( networkIfFd[1] != 0 ) close( networkIfFd[1] );
   if( signalFd[0] != 0 ) close( signalFd[0] );
@@ -125,7 +138,8 @@ txProc::~txProc()
 std::string txProc::toString( )
 {
   std::ostringstream oss;
-  oss << typeid(*this).name() << " pid " << getpid( ) << " nucleus pid " << nucleusPid;
+  oss << typeid(*this).name() << " pid " << getpid( ) << " nucleus pid";
+  for( int i = 0; i < numShards; i++ ) oss << " " << nucleusPid[i];
 	return oss.str();
 }	// toString
 
@@ -136,10 +150,37 @@ void txProc::init( )
 {
   log.info( log.LOGALWAYS ) << "init: txProc - build no " << buildno << " build time " << buildtime;
   unixSocket::createSocketPair( mainFd, "mainFd", false );
-  unixSocket::createSocketPair( nucleusFd, "nucleusFd", false );
+  // a recovery replays into a single nucleus that owns all the queues
+  numShards = pOptions->recoverFile.empty()?pOptions->nucleusShards:1;
+  for( int i = 0; i < numShards; i++ )
+  {
+    char label[32];
+    sprintf( label, "nucleusFd%d", i );
+    unixSocket::createSocketPair( nucleusFd[i], label, false );
+    nucleusWriteFds.push_back( nucleusFd[i][0] );
+    // the workers share networkIfFd - the nucleus writes without blocking and may leave a part
+    // frame to be completed later so it gets a stream of its own
+    sprintf( label, "nucleusReturnFd%d", i );
+    unixSocket::createSocketPair( nucleusReturnFd[i], label );
+    nucleusReturnReadFds.push_back( nucleusReturnFd[i][1] );
+    log.info( log.LOGALWAYS, "init: shard %d nucleusFd %d %d nucleusReturnFd %d %d", i, nucleusFd[i][0], nucleusFd[i][1], nucleusReturnFd[i][0], nucleusReturnFd[i][1] );
+  } // for
+  // events passed between two shards go on a socket of their own for the same reason
+  for( int i = 0; i < numShards; i++ )
+  {
+    for( int j = i+1; j < numShards; j++ )
+    {
+      char label[32];
+      int link[2];
+      sprintf( label, "shardLinkFd%d.%d", i, j );
+      unixSocket::createSocketPair( link, label );
+      shardLinkFd[i][j] = link[0];
+      shardLinkFd[j][i] = link[1];
+    } // for
+  } // for
   unixSocket::createSocketPair( networkIfFd, "networkIfFd", false );
   unixSocket::createSocketPair( signalFd, "signalFd" );
-  log.info( log.LOGALWAYS, "init: txProc %d %d nucleusFd %d %d networkIfFd %d %d signalFd %d %d", mainFd[0], mainFd[1], nucleusFd[0], nucleusFd[1], networkIfFd[0], networkIfFd[1], signalFd[0], signalFd[1] );
+  log.info( log.LOGALWAYS, "init: txProc %d %d numShards %d networkIfFd %d %d signalFd %d %d", mainFd[0], mainFd[1], numShards, networkIfFd[0], networkIfFd[1], signalFd[0], signalFd[1] );
   pRecoveryLog = new recoveryLog( pOptions->logBaseDir.c_str(), false, pOptions->logrotatePath, pOptions->runAsUser, pOptions->logGroup, pOptions->logFilesToKeep ); // do not rotate here as well
   baseEvent::theRecoveryLog = pRecoveryLog;
   
@@ -171,14 +212,14 @@ void txProc::recover( )
   try
   {
     init( );
-    forkNucleus( true );
+    forkNucleus( 0, true );
     
     bool bResult = dropPriviledge( pOptions->runAsUser.c_str() );
     if( !bResult )
       throw Exception( log, log.ERROR, "recover: failed to drop priviledges to user %s", pOptions->runAsUser.c_str() );
 
     sleep( 1 ); // give time for the nucleus to start
-    pRecoveryLog->initRecovery( pOptions->recoverFile.c_str(), nucleusFd[0] );
+    pRecoveryLog->initRecovery( pOptions->recoverFile.c_str(), nucleusFd[0][0] );
 
     while( bRunning && pRecoveryLog->recover() )
     {
@@ -203,7 +244,7 @@ void txProc::recover( )
   bRunning = false;
   bAutoFork = false;
   
-  while( nucleusPid != 0 )
+  while( isNucleusRunning( ) )
   {
     if( !handleChildDone( ) )
       sleep( 1 );
@@ -295,19 +336,23 @@ void txProc::main( )
   {
     init( );
 #ifdef BFORK
-    if( pOptions->bStartNucleus ) forkNucleus( false );
+    if( pOptions->bStartNucleus )
+    {
+      for( int i = 0; i < numShards; i++ )
+        forkNucleus( i );
+    } // if
     if( pOptions->bStartSocket ) forkNetworkIf( );
 #else
     // used for valgrind testing
 #if 1
-    pNucleus = new nucleus( nucleusFd, mainFd[0], pRecoveryLog, false, argc, argv, networkIfFd[0] );
+    pNucleus = new nucleus( nucleusFd[0], mainFd[0], pRecoveryLog, false, argc, argv, networkIfFd[0], nucleusReturnFd[0][0], 0, getShardLinks( 0 ) );
     pNucleus->init();
     pNucleus->main();
     log.info( log.LOGALWAYS, "forkNucleus: pNucleus->main returned" );
     delete pNucleus;
     pNucleus = NULL;
 #else
-    pNetworkIf = new networkIf( networkIfFd, nucleusFd[0], mainFd[0], pRecoveryLog, argc, argv );
+    pNetworkIf = new networkIf( networkIfFd, nucleusWriteFds, nucleusReturnReadFds, mainFd[0], pRecoveryLog, argc, argv );
     pNetworkIf->main( );
     log.info( log.LOGALWAYS, "main: pNetworkIf->main returned" );
     delete pNetworkIf;
@@ -422,7 +467,8 @@ void txProc::main( )
                       bAutoFork = false;
                     } // if
                     if( networkIfPid > 0 ) sendCommandToChild( baseEvent::CMD_SHUTDOWN, networkIfFd[0] );
-                    if( nucleusPid > 0 ) sendCommandToChild( baseEvent::CMD_EXIT_WHEN_DONE, nucleusFd[0] );
+                    for( int i = 0; i < numShards; i++ )
+                      if( nucleusPid[i] > 0 ) sendCommandToChild( baseEvent::CMD_EXIT_WHEN_DONE, nucleusFd[i][0] );
                   } // if( CMD_SHUTDOWN
                   else if( pEvent->getCommand( ) == baseEvent::CMD_MAIN_CONF ) 
                   {
@@ -470,7 +516,7 @@ void txProc::main( )
       // signal the nucleus to exit when done
       if( termTime > 0 )
       {
-        if( nucleusPid > 0 )
+        if( isNucleusRunning( ) )
         {
           bRunning = false;
           log.info( log.LOGALWAYS, "main: exiting" );
@@ -612,8 +658,8 @@ void txProc::sendCommandToChildren( baseEvent::eCommandType command )
  * **/
 void txProc::sendCommandToChildren( baseEvent* pCommand )
 {
-  if( nucleusPid != 0 ) 
-    pCommand->serialise( nucleusFd[0] );
+  for( int i = 0; i < numShards; i++ )
+    if( nucleusPid[i] != 0 ) pCommand->serialise( nucleusFd[i][0] );
   if( networkIfPid != 0 ) 
     pCommand->serialise( networkIfFd[0] );
 } // sendCommandToChildren
@@ -625,8 +671,8 @@ void txProc::sendCommandToChildren( baseEvent* pCommand )
 void txProc::signalChildren( int sig )
 {
   log.debug( log.LOGNORMAL, "signalChildren sig %s", strsignal( sig ) );
-  if( nucleusPid != 0 ) 
-    kill( nucleusPid, sig );
+  for( int i = 0; i < numShards; i++ )
+    if( nucleusPid[i] != 0 ) kill( nucleusPid[i], sig );
   if( networkIfPid != 0 ) 
     kill( networkIfPid, sig );
 } // signalChildren
@@ -671,13 +717,14 @@ bool txProc::handleChildDone( )
       bChildExited = true;
       
       // auto restart
+      int shard = findNucleusShard( childPid );
       if( bAutoFork )
       {
-        if( childPid == nucleusPid ) 
+        if( shard != -1 ) 
         {
-          log.warn( log.LOGALWAYS, "handleChildDone: about to restart nucleus" );
-          nucleusPid = 0;
-          forkNucleus( );
+          log.warn( log.LOGALWAYS, "handleChildDone: about to restart nucleus shard %d", shard );
+          nucleusPid[shard] = 0;
+          forkNucleus( shard );
         } // if(
         else if( childPid == networkIfPid ) 
         {
@@ -690,10 +737,10 @@ bool txProc::handleChildDone( )
       } // if( bRunning
       else
       {
-        if( childPid == nucleusPid ) 
+        if( shard != -1 ) 
         {
-          log.warn( log.LOGALWAYS, "handleChildDone: nucleus exited" );
-          nucleusPid = 0;
+          log.warn( log.LOGALWAYS, "handleChildDone: nucleus shard %d exited", shard );
+          nucleusPid[shard] = 0;
         } // if(
         else if( childPid == networkIfPid ) 
         {
@@ -724,8 +771,8 @@ void txProc::waitForChildrenToExit( )
   {
     if( pid > 0 )
     {
-      if( pid == nucleusPid ) 
-        log.info( log.LOGALWAYS, "waitForChildrenToExit: nucleus exited" );
+      if( findNucleusShard( pid ) != -1 ) 
+        log.info( log.LOGALWAYS, "waitForChildrenToExit: nucleus shard %d exited", findNucleusShard( pid ) );
       else if( pid == networkIfPid ) 
         log.info( log.LOGALWAYS, "waitForChildrenToExit: networkIf exited" );
       else
@@ -736,20 +783,21 @@ void txProc::waitForChildrenToExit( )
 } // waitForChildrenToExit
 
 /**
- * fork the nucleus process
+ * fork a nucleus process
+ * @param shard - index of the shard the process serves
  * @param bRecovery - true if it is a recovery instance
  * **/
-void txProc::forkNucleus( bool bRecovery )
+void txProc::forkNucleus( int shard, bool bRecovery )
 {
-  if( ( nucleusPid = fork( ) ) < 0 )
-    log.error( "forkNucleus: failed to fork" );
-  else if( nucleusPid == 0 )   // child
+  if( ( nucleusPid[shard] = fork( ) ) < 0 )
+    log.error( "forkNucleus: failed to fork shard %d", shard );
+  else if( nucleusPid[shard] == 0 )   // child
   {
     try
     {
       // the new and main() has to be in a try / catch otherwise an uncaught
       // exception kills the other children as well
-      pNucleus = new nucleus( nucleusFd, mainFd[0], pRecoveryLog, bRecovery, argc, argv, networkIfFd[0] );
+      pNucleus = new nucleus( nucleusFd[shard], mainFd[0], pRecoveryLog, bRecovery, argc, argv, networkIfFd[0], nucleusReturnFd[shard][0], shard, getShardLinks( shard ) );
       pNucleus->init();
       pNucleus->main();
       log.info( log.LOGALWAYS, "forkNucleus: pNucleus->main returned" );
@@ -774,10 +822,44 @@ void txProc::forkNucleus( bool bRecovery )
   } // if child
   else  // parent
   {
-    log.info( log.LOGALWAYS, "forkNucleus: nucleus has pid %d fd %d, %d", nucleusPid, nucleusFd[0], nucleusFd[1] );
+    log.info( log.LOGALWAYS, "forkNucleus: nucleus shard %d has pid %d fd %d, %d", shard, nucleusPid[shard], nucleusFd[shard][0], nucleusFd[shard][1] );
   } // else parent
 } // forkNucleus
 
+/**
+ * @param shard
+ * @return the sockets a nucleus shard passes events to the other shards on - its own event socket
+ * at the index of the shard
+ * **/
+std::vector<int> txProc::getShardLinks( int shard )
+{
+  std::vector<int> links;
+  for( int i = 0; i < numShards; i++ )
+    links.push_back( (i==shard)?nucleusFd[shard][0]:shardLinkFd[shard][i] );
+  return links;
+} // getShardLinks
+
+/**
+ * @param childPid
+ * @return the shard of the nucleus process or -1 if it is not a nucleus
+ * **/
+int txProc::findNucleusShard( int childPid )
+{
+  for( int i = 0; i < numShards; i++ )
+    if( (nucleusPid[i] != 0) && (nucleusPid[i] == childPid) ) return i;
+  return -1;
+} // findNucleusShard
+
+/**
+ * @return true if any of the nucleus processes is running
+ * **/
+bool txProc::isNucleusRunning( )
+{
+  for( int i = 0; i < numShards; i++ )
+    if( nucleusPid[i] != 0 ) return true;
+  return false;
+} // isNucleusRunning
+
 /**
  * fork the networkIf process
  * **/
@@ -791,7 +873,7 @@ void txProc::forkNetworkIf( )
     {
       // the new and main() has to be in a try / catch otherwise an uncaught
       // exception kills the other children as well
-      pNetworkIf = new networkIf( networkIfFd, nucleusFd[0], mainFd[0], pRecoveryLog, argc, argv );
+      pNetworkIf = new networkIf( networkIfFd, nucleusWriteFds, nucleusReturnReadFds, mainFd[0], pRecoveryLog, argc, argv );
       pNetworkIf->main( );
       log.info( log.LOGALWAYS, "forkNetworkIf: pNetworkIf->main returned" );
       delete pNetworkIf;
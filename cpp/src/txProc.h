@@ -4,6 +4,9 @@
  $Id: txProc.h 124 2009-11-18 12:57:58Z gerhardus $
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0   02/01/2009    Gerhardus Muller    script created
+ @version 1.1.0   16/10/2026    agent    a nucleus process per shard
+ @version 1.1.1   17/10/2026    agent    a socket per shard that only the nucleus writes to the networkIf on
+ @version 1.1.2   17/10/2026    agent    a socket per pair of shards
 
  @note
 
@@ -20,6 +23,7 @@
 #include "../src/options.h"
 #include "utils/unixSocket.h"
 #include "nucleus/baseEvent.h"
+#include <vector>
 
 class nucleus;
 class networkIf;
@@ -49,7 +53,10 @@ class txProc : public object
     void init( );
     bool handleChildDone( );
     void forkSocket( );
-    void forkNucleus( bool bRecovery=false );
+    void forkNucleus( int shard, bool bRecovery=false );
+    int  findNucleusShard( int childPid );
+    std::vector<int> getShardLinks( int shard );
+    bool isNucleusRunning( );
     void forkNetworkIf( );
     void waitForChildrenToExit( );
     bool dropPriviledge( const char* user );
@@ -80,8 +87,13 @@ class txProc : public object
     int                     networkIfPid;         ///< networkIf process PID
     int                     networkIfFd[2];       ///< unix domain socket to submit events to the networkIf process - networkIf reads the [1] side
     networkIf*              pNetworkIf;           ///< networkIf object
-    int                     nucleusPid;           ///< nucleus process PID
-    int                     nucleusFd[2];         ///< unix domain socket to submit events to the nucleus - the nucleus listens on [1]
+    int                     numShards;            ///< number of nucleus processes - 1 for a recovery
+    int                     nucleusPid[options::MAX_NUCLEUS_SHARDS];    ///< nucleus process PID per shard
+    int                     nucleusFd[options::MAX_NUCLEUS_SHARDS][2];  ///< unix domain socket per shard to submit events to the nucleus - the nucleus listens on [1]
+    std::vector<int>        nucleusWriteFds;      ///< the [0] side of nucleusFd for each shard
+    int                     nucleusReturnFd[options::MAX_NUCLEUS_SHARDS][2];  ///< unix domain socket per shard for the nucleus to write results and commands to the networkIf - only the nucleus writes [0], the networkIf reads [1]
+    std::vector<int>        nucleusReturnReadFds; ///< the [1] side of nucleusReturnFd for each shard
+    int                     shardLinkFd[options::MAX_NUCLEUS_SHARDS][options::MAX_NUCLEUS_SHARDS];  ///< unix domain socket per pair of shards - shard i writes to and reads from [i][j] to pass events to shard j
     int                     signalFd[2];          ///< unix domain socket to submit signal events to the txProc parent process - txProc listens on [1] - now using the external socket
     nucleus*                pNucleus;             ///< nucleus object
     recoveryLog*            pRecoveryLog;         ///< recovery log
@@ -0,0 +1,237 @@
+/**
+ eventBench - serialise / unserialise throughput of the event codec
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+ @version 1.1.0		16/10/2026		agent		serialise / unserialise throughput of the event shapes against libtxevent.a
+
+ @note
+ built with 'make bench' in bin/ against libtxevent.a.  Each event shape is run through
+ serialiseToString, unSerialiseFromString, a getter on an unserialised event and a
+ round trip over a socketpair, with json and binary sections.  The lifecycle of an event in
+ the nucleus - unserialise, build and serialise the result, free both - is run with the
+ event pool and with plain new/delete.
+ usage: eventBench [iterations]
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include "src/options.h"
+#include "application/baseEvent.h"
+#include "application/recoveryLog.h"
+#include "exception/Exception.h"
+
+// supplied by the executable rather than the library
+options* pOptions = NULL;
+void recoveryLog::writeEntry( baseEvent* theEvent, const char* error, const char* from, const char* to ) {}
+
+static double now( )
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec+tv.tv_usec/1e6;
+} // now
+
+/**
+ * a command as sent by the scripts to txProc
+ * **/
+static baseEvent* makeCommand( )
+{
+  baseEvent* pEvent = new baseEvent( baseEvent::EV_COMMAND );
+  pEvent->setCommand( baseEvent::CMD_STATS );
+  pEvent->addParam( "time", "1476640000" );
+  return pEvent;
+} // makeCommand
+
+/**
+ * a typical queued script event with a reference, trace and a handful of parameters
+ * **/
+static baseEvent* makeScript( )
+{
+  baseEvent* pEvent = new baseEvent( baseEvent::EV_PERL, "default" );
+  pEvent->setRef( "ref-000123456" );
+  pEvent->setScriptName( "/usr/local/txProc/scripts/process.pl" );
+  pEvent->setLifetime( 3600 );
+  pEvent->setTrace( "networkIf:nucleus" );
+  pEvent->addScriptParam( "account=1234" );
+  pEvent->addScriptParam( "msisdn=27821234567" );
+  pEvent->addScriptParam( "action=notify" );
+  return pEvent;
+} // makeScript
+
+/**
+ * a url event carrying a couple of kilobytes of named parameters
+ * **/
+static baseEvent* makeUrl( )
+{
+  baseEvent* pEvent = new baseEvent( baseEvent::EV_URL, "http" );
+  pEvent->setRef( "ref-000123457" );
+  pEvent->setUrl( "http://localhost/notify.php" );
+  pEvent->setExpiryTime( 1476643600 );
+  char name[32];
+  for( int i = 0; i < 40; i++ )
+  {
+    sprintf( name, "param%02d", i );
+    pEvent->addParam( name, std::string( 40, 'a'+i%26 ) );
+    sprintf( name, "count%02d", i );
+    pEvent->addParam( name, i*1000 );
+  } // for
+  return pEvent;
+} // makeUrl
+
+/**
+ * runs one shape through the codec
+ * **/
+static void bench( const char* shape, baseEvent* pEvent, baseEvent::eSectionType encoding, int iterations )
+{
+  pEvent->setSectionEncoding( encoding );
+  const char* encName = (encoding==baseEvent::SECTION_BINARY)?"binary":"json";
+  std::string frame = pEvent->serialiseToString();
+
+  // serialise after a change to part1 - the other sections are reused as encoded
+  double start = now();
+  for( int i = 0; i < iterations; i++ )
+  {
+    pEvent->setRef( pEvent->getRef() );
+    pEvent->serialiseToString();
+  } // for
+  double serialiseRate = iterations/(now()-start);
+
+  // unserialise and read one field as the nucleus does
+  start = now();
+  for( int i = 0; i < iterations; i++ )
+  {
+    baseEvent* p = baseEvent::unSerialiseFromString( frame );
+    p->getDestQueue();
+    delete p;
+  } // for
+  double unSerialiseRate = iterations/(now()-start);
+
+  // forward over a socket - unSerialise from the receive buffer and write the frame on
+  int sv[2];
+  unixSocket::createSocketPair( sv, "eventBench" );
+  unixSocket rxSock( sv[1], unixSocket::ET_QUEUE_EVENT );
+  rxSock.setNonblocking();
+  rxSock.setReadAhead( true );
+  int batch = 16;   // frames written before they are read back - stays within the socket buffer as nothing reads concurrently
+  int numRx = 0;
+  start = now();
+  while( numRx < iterations )
+  {
+    for( int i = 0; i < batch; i++ ) pEvent->serialise( sv[0] );
+    for( int i = 0; i < batch; i++ )
+    {
+      baseEvent* p = baseEvent::unSerialise( &rxSock );
+      if( p == NULL ) break;
+      numRx++;
+      baseEvent::release( p );
+    } // for
+  } // while
+  double socketRate = numRx/(now()-start);
+  close( sv[0] );
+
+  printf( "%-8s %-6s %6u bytes  serialise %9.0f/s  unSerialise %9.0f/s  socket %9.0f/s\n", shape, encName, (unsigned)frame.length(), serialiseRate, unSerialiseRate, socketRate );
+} // bench
+
+/**
+ * unserialises the frames of pEvent from a socket, builds and serialises a result as
+ * nucleus::sendResult does and frees both events
+ * @param bPooled - release to the pool or delete - with an empty pool acquire allocates
+ * @return events per second
+ * **/
+static double lifecycle( baseEvent* pEvent, bool bPooled, int iterations )
+{
+  baseEvent::clearPool();
+  int sv[2];
+  unixSocket::createSocketPair( sv, "eventBench" );
+  unixSocket rxSock( sv[1], unixSocket::ET_QUEUE_EVENT );
+  rxSock.setNonblocking();
+  rxSock.setReadAhead( true );
+  int batch = 32;   // frames written before they are read back - stays within the socket buffer as nothing reads concurrently
+  int numRx = 0;
+  double start = now();
+  while( numRx < iterations )
+  {
+    for( int i = 0; i < batch; i++ ) pEvent->serialise( sv[0] );
+    for( int i = 0; i < batch; i++ )
+    {
+      baseEvent* p = baseEvent::unSerialise( &rxSock );
+      if( p == NULL ) break;
+      numRx++;
+      p->getLifetime();
+      p->getDestQueue();
+      baseEvent* pReturn = baseEvent::acquire( baseEvent::EV_RESULT );
+      pReturn->setSuccess( true );
+      pReturn->setResult( "ok" );
+      pReturn->setRef( p->getRef() );
+      pReturn->setTrace( p->getTrace() );
+      pReturn->serialiseToString();
+      if( bPooled )
+      {
+        baseEvent::release( pReturn );
+        baseEvent::release( p );
+      } // if
+      else
+      {
+        delete pReturn;
+        delete p;
+      } // else
+    } // for
+  } // while
+  double rate = numRx/(now()-start);
+  close( sv[0] );
+  baseEvent::clearPool();
+  return rate;
+} // lifecycle
+
+/**
+ * the lifecycle of one shape with the pool and with new/delete
+ * **/
+static void benchPool( const char* shape, baseEvent* pEvent, baseEvent::eSectionType encoding, int iterations )
+{
+  pEvent->setSectionEncoding( encoding );
+  const char* encName = (encoding==baseEvent::SECTION_BINARY)?"binary":"json";
+  double newRate = lifecycle( pEvent, false, iterations );
+  double poolRate = lifecycle( pEvent, true, iterations );
+  printf( "%-8s %-6s lifecycle new/delete %9.0f/s  pool %9.0f/s  %+.0f%%\n", shape, encName, newRate, poolRate, (poolRate/newRate-1)*100 );
+} // benchPool
+
+int main( int argc, char* argv[] )
+{
+  int iterations = (argc>1)?atoi( argv[1] ):100000;
+  if( iterations <= 0 ) iterations = 100000;
+  logger& log = logger::getInstance( "eventBench" );
+  log.setDefaultLevel( loggerDefs::MINLEVEL );
+  logger::setLogStdErr( true );
+
+  try
+  {
+    baseEvent* shapes[] = { makeCommand(), makeScript(), makeUrl() };
+    const char* names[] = { "command", "script", "url" };
+    for( int i = 0; i < 3; i++ )
+    {
+      bench( names[i], shapes[i], baseEvent::SECTION_JSON, iterations );
+      bench( names[i], shapes[i], baseEvent::SECTION_BINARY, iterations );
+      benchPool( names[i], shapes[i], baseEvent::SECTION_JSON, iterations );
+      benchPool( names[i], shapes[i], baseEvent::SECTION_BINARY, iterations );
+      delete shapes[i];
+    } // for
+    baseEvent::clearPool();
+  } // try
+  catch( Exception e )
+  {
+    fprintf( stderr, "eventBench: %s\n", e.getMessage() );
+    return 1;
+  } // catch
+  return 0;
+} // main
@@ -0,0 +1,136 @@
+/**
+ frameCodecTest - checks frameCodec against the sprintf / sscanf formats it replaced
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ built and run with 'make test' in bin/.  Every header frameCodec encodes has to match what
+ the old sprintf produced byte for byte and decode to what the old sscanf parsed.  Exits non
+ zero on a mismatch.
+ usage: frameCodecTest
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "src/options.h"
+#include "application/frameCodec.h"
+#include "application/baseEvent.h"
+#include "application/recoveryLog.h"
+
+// supplied by the executable rather than the library
+options* pOptions = NULL;
+void recoveryLog::writeEntry( baseEvent* theEvent, const char* error, const char* from, const char* to ) {}
+
+static int numFailed = 0;
+
+static void check( bool bOk, const char* what )
+{
+  if( !bOk ) printf( "FAIL %s\n", what );
+  if( !bOk ) numFailed++;
+} // check
+
+/**
+ * encodes and decodes a frame header and compares it with the old formats
+ * **/
+static void checkFrameHeader( unsigned payloadLen )
+{
+  char what[64];
+  sprintf( what, "frame header len:%u", payloadLen );
+
+  char oldHeader[64];
+  int oldLen = sprintf( oldHeader, "%s%s:%06u\n", baseEvent::FRAME_HEADER, baseEvent::PROTOCOL_VERSION_NUMBER, payloadLen );
+  char header[frameCodec::FRAME_HEADER_LEN+1];
+  int len = frameCodec::encodeFrameHeader( header, payloadLen );
+  header[len] = '\0';
+  check( (len==oldLen) && (strcmp(header,oldHeader)==0), what );
+
+  std::string headerTemplate = std::string( baseEvent::FRAME_HEADER ) + baseEvent::PROTOCOL_VERSION_NUMBER + ":%u";
+  unsigned oldPacketLen = 0;
+  int numParsed = sscanf( oldHeader, headerTemplate.c_str(), &oldPacketLen );
+  unsigned packetLen = 0;
+  bool bDecoded = frameCodec::decodeFrameHeader( oldHeader, packetLen );
+  check( (numParsed==1) && bDecoded && (packetLen==oldPacketLen) && (packetLen==payloadLen), what );
+} // checkFrameHeader
+
+/**
+ * encodes and decodes a block header and compares it with the old formats
+ * **/
+static void checkBlockHeader( const unsigned types[frameCodec::NUM_SECTIONS], const unsigned sizes[frameCodec::NUM_SECTIONS] )
+{
+  char what[96];
+  sprintf( what, "block header %u,%u,%u,%u,%u,%u,%u,%u", types[0], sizes[0], types[1], sizes[1], types[2], sizes[2], types[3], sizes[3] );
+
+  char oldHeader[64];
+  int oldLen = sprintf( oldHeader, "%02u,%u,%06u,%u,%06u,%u,%06u,%u,%06u\n", 4, types[0], sizes[0], types[1], sizes[1], types[2], sizes[2], types[3], sizes[3] );
+  char header[frameCodec::BLOCK_HEADER_LEN+1];
+  int len = frameCodec::encodeBlockHeader( header, types, sizes );
+  header[len] = '\0';
+  check( (len==oldLen) && (strcmp(header,oldHeader)==0), what );
+
+  unsigned oldNum, oldTypes[frameCodec::NUM_SECTIONS], oldSizes[frameCodec::NUM_SECTIONS];
+  int numParams = sscanf( oldHeader, "%02u,%1u,%06u,%1u,%06u,%1u,%06u,%1u,%06u\n", &oldNum, &oldTypes[0], &oldSizes[0], &oldTypes[1], &oldSizes[1], &oldTypes[2], &oldSizes[2], &oldTypes[3], &oldSizes[3] );
+  unsigned numSections, newTypes[frameCodec::NUM_SECTIONS], newSizes[frameCodec::NUM_SECTIONS];
+  bool bOk = (numParams==9) && frameCodec::decodeBlockHeader( oldHeader, numSections, newTypes, newSizes ) && (numSections==oldNum);
+  for( int i = 0; bOk && (i < frameCodec::NUM_SECTIONS); i++ )
+    bOk = (newTypes[i]==oldTypes[i]) && (newSizes[i]==oldSizes[i]) && (newSizes[i]==sizes[i]);
+  check( bOk, what );
+} // checkBlockHeader
+
+/**
+ * headers that the decoder has to reject
+ * **/
+static void checkMalformed( )
+{
+  unsigned v;
+  check( !frameCodec::decodeFrameHeader( "#frameNewframe#v3.0:00a123\n", v ), "malformed: non digit in the frame length" );
+  check( !frameCodec::decodeFrameHeader( "#frameNewframe#v2.0:000123\n", v ), "malformed: wrong protocol version" );
+  check( !frameCodec::decodeFrameHeader( "#frameNewframe#v3.0:123\n", v ), "malformed: short frame length" );
+  check( !frameCodec::decodeFrameHeader( "#frameNewf", v ), "malformed: truncated marker" );
+
+  unsigned numSections, types[frameCodec::NUM_SECTIONS], sizes[frameCodec::NUM_SECTIONS];
+  check( !frameCodec::decodeBlockHeader( "04,0,000010,0,000000,0,000000,0000000\n", numSections, types, sizes ), "malformed: block header missing a comma" );
+  check( !frameCodec::decodeBlockHeader( "04,0,000010,0,000000,0,000000,0,0000\n", numSections, types, sizes ), "malformed: short block header" );
+  check( !frameCodec::decodeBlockHeader( "04,0,000010,0,000000,0,000000,0,000000", numSections, types, sizes ), "malformed: block header without its terminator" );
+} // checkMalformed
+
+int main( int argc, char* argv[] )
+{
+  const unsigned lengths[] = { 0, 1, 9, 10, 26, 27, 39, 99999, 100000, 123456, 999998, 999999 };
+  for( unsigned i = 0; i < sizeof(lengths)/sizeof(lengths[0]); i++ )
+    checkFrameHeader( lengths[i] );
+
+  const unsigned zeroTypes[] = { 0, 0, 0, 0 };
+  const unsigned zeroSizes[] = { 0, 0, 0, 0 };
+  const unsigned maxTypes[] = { 9, 9, 9, 9 };
+  const unsigned maxSizes[] = { 999999, 999999, 999999, 999999 };
+  checkBlockHeader( zeroTypes, zeroSizes );
+  checkBlockHeader( maxTypes, maxSizes );
+
+  srandom( 1 );
+  for( int i = 0; i < 100000; i++ )
+  {
+    checkFrameHeader( random()%(frameCodec::MAX_LEN+1) );
+    unsigned types[frameCodec::NUM_SECTIONS], sizes[frameCodec::NUM_SECTIONS];
+    for( int j = 0; j < frameCodec::NUM_SECTIONS; j++ )
+    {
+      types[j] = random()%10;
+      sizes[j] = random()%(frameCodec::MAX_LEN+1);
+    } // for
+    checkBlockHeader( types, sizes );
+  } // for
+
+  checkMalformed( );
+
+  printf( "frameCodecTest: %d failed\n", numFailed );
+  return (numFailed==0)?0:1;
+} // main
@@ -0,0 +1,158 @@
+/**
+ queueTest - regression checks for the straightQueue priority levels and spilling
+
+ $Id$
+ Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes.
+ @version 1.0.0		16/10/2026		agent		Script created
+
+ @note
+ built and run with 'make test' in bin/.  The queue logs and spill segments go to a
+ directory under /tmp that is removed afterwards.  Exits non zero on the first failure.
+ usage: queueTest
+
+ @todo
+
+ @bug
+
+	Copyright Notice
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "src/options.h"
+#include "nucleus/optionsNucleus.h"
+#include "nucleus/queueContainer.h"
+#include "nucleus/straightQueue.h"
+#include "application/baseEvent.h"
+#include "application/recoveryLog.h"
+#include "exception/Exception.h"
+
+// supplied by the executable rather than the library
+options* pOptions = NULL;
+optionsNucleus* pOptionsNucleus = NULL;
+static int numRecovered = 0;
+void recoveryLog::writeEntry( baseEvent* theEvent, const char* error, const char* from, const char* to ) {numRecovered++;}
+
+static int numFailed = 0;
+
+static void check( bool bOk, const char* what )
+{
+  printf( "%s %s\n", bOk?"ok  ":"FAIL", what );
+  if( !bOk ) numFailed++;
+} // check
+
+/**
+ * a priority queue descriptor with spilling enabled
+ * **/
+static void initDescriptor( tQueueDescriptor& desc, const char* name, int maxLength )
+{
+  desc.name = name;
+  desc.type = "priority";
+  desc.maxLength = maxLength;
+  desc.priorityLevels = 3;
+  desc.defaultPriority = 0;
+  desc.priorityAging = 0;
+  desc.spillMaxMB = 1;
+} // initDescriptor
+
+static baseEvent* makeEvent( int priority, int seq )
+{
+  baseEvent* pEvent = new baseEvent( baseEvent::EV_PERL, "q" );
+  pEvent->setPriority( priority );
+  char ref[32];
+  sprintf( ref, "%d-%d", priority, seq );
+  pEvent->setRef( ref );
+  return pEvent;
+} // makeEvent
+
+/**
+ * memory full of level 0 events - level 2 arrivals spill without anything of level 2 in
+ * memory and have to be served first and the queue has to drain completely
+ * **/
+static void testSpilledLevelWithoutMemory( )
+{
+  tQueueDescriptor desc;
+  initDescriptor( desc, "spillLevel", 4 );
+  straightQueue queue( &desc, NULL, false );
+  queue.setTime( time(NULL) );
+
+  for( int i = 0; i < 4; i++ ) queue.queueEvent( makeEvent(0,i) );
+  for( int i = 0; i < 3; i++ ) queue.queueEvent( makeEvent(2,i) );
+
+  baseEvent* pEvent = queue.popAvailableEvent( -1 );
+  check( (pEvent!=NULL) && (pEvent->getPriority()==2), "spilled level: the urgent event is served first" );
+  delete pEvent;
+
+  int numPopped = 1;
+  int numUrgent = 1;
+  while( (pEvent=queue.popAvailableEvent(-1)) != NULL )
+  {
+    if( (pEvent->getPriority()==2) && (numPopped==numUrgent) ) numUrgent++;
+    numPopped++;
+    delete pEvent;
+    if( numPopped > 7 ) break;
+  } // while
+  check( numUrgent == 3, "spilled level: all the urgent events ahead of the bulk" );
+  check( numPopped == 7, "spilled level: every event popped" );
+  check( queue.isQueueEmpty(), "spilled level: queue empty afterwards" );
+} // testSpilledLevelWithoutMemory
+
+/**
+ * spilled events keep their order within a level
+ * **/
+static void testSpillOrder( )
+{
+  tQueueDescriptor desc;
+  initDescriptor( desc, "spillOrder", 2 );
+  desc.priorityLevels = 1;
+  desc.type = "straight";
+  straightQueue queue( &desc, NULL, false );
+  queue.setTime( time(NULL) );
+
+  for( int i = 0; i < 6; i++ ) queue.queueEvent( makeEvent(0,i) );
+  bool bInOrder = true;
+  for( int i = 0; i < 6; i++ )
+  {
+    baseEvent* pEvent = queue.popAvailableEvent( -1 );
+    char ref[32];
+    sprintf( ref, "0-%d", i );
+    if( (pEvent==NULL) || (pEvent->getRef().compare(ref)!=0) ) bInOrder = false;
+    delete pEvent;
+  } // for
+  check( bInOrder, "spill order: first in first out across the segment" );
+  check( queue.isQueueEmpty(), "spill order: queue empty afterwards" );
+} // testSpillOrder
+
+int main( int argc, char* argv[] )
+{
+  char dir[] = "/tmp/queueTest.XXXXXX";
+  if( mkdtemp(dir) == NULL )
+  {
+    perror( "queueTest: mkdtemp" );
+    return 2;
+  } // if
+  pOptions = new options( );
+  pOptions->logBaseDir = std::string(dir) + "/";
+  pOptionsNucleus = new optionsNucleus( );
+  pOptionsNucleus->spillDir = std::string(dir) + "/spill/";
+  pOptionsNucleus->bFlushLogs = false;
+
+  try
+  {
+    testSpilledLevelWithoutMemory( );
+    testSpillOrder( );
+  } // try
+  catch( Exception e )
+  {
+    printf( "FAIL exception: %s\n", e.getMessage() );
+    numFailed++;
+  } // catch
+
+  std::string cmd = std::string("rm -rf ") + dir;
+  if( system( cmd.c_str() ) != 0 ) fprintf( stderr, "queueTest: failed to remove %s\n", dir );
+  printf( "queueTest: %d failed\n", numFailed );
+  return (numFailed==0)?0:1;
+} // main
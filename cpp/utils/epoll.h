@@ -5,6 +5,7 @@
  Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
  @version 1.0.0		28/01/2011		Gerhardus Muller		Script created
  @version 1.0.1		17/09/2012		Gerhardus Muller    events in getReadyRef should be an unsigned it
+ @version 1.1.0		16/10/2026		agent		getEpollFd so an epoll set can be nested in another
 
  @note
 
@@ -36,6 +37,7 @@ class epoll : public object
     int   waitForEvent( int timeout );
     int   getNextFd( );
     int   getNumReadyEvents( )                          {return numReadyEvents;}
+    int   getEpollFd( )                                 {return epollFd;}
     bool  isFdError( )                                  {return lastErrorFd != -1;}
     int   getLastErrorFd( )                             {return lastErrorFd;}
     void* getReadyRef( int index, bool& bErr, unsigned int& events ){if(index<numReadyEvents){events=pEvents[index].events;bErr=(events&(EPOLLERR|EPOLLHUP));return pEvents[index].data.ptr;}else throw Exception( log, log.ERROR, "getReadyRef: index out of range i:%d numReadyEvents:%d",index,numReadyEvents );}
@@ -12,6 +12,12 @@
  @version 1.6.0		04/06/2013		Gerhardus Muller		changed the loglevel in multiFdWaitForEvent
  @version 1.7.0		05/06/2013		Gerhardus Muller		added the FD_CLOEXEC flag to the socketpair call; added setCloseOnExec
  @version 1.8.0		06/08/2014		Gerhardus Muller		added writeOnceTo
+ @version 1.9.0		16/10/2026		agent		replaced unusedChars with a receive buffer that frames can be parsed from in place
+ @version 1.10.0		16/10/2026		agent		added writeOnceV
+ @version 1.11.0		16/10/2026		agent		added resyncRx
+ @version 1.12.0		16/10/2026		agent		ET_TIMER
+ @version 1.13.0		16/10/2026		agent		ET_WRITE_READY; writeOnceV with MSG_DONTWAIT and errno preserved for the caller
+ @version 1.14.0		17/10/2026		agent		addWriteFd - getNextFd also returns the fds that are ready for writing
 
  @note
 
@@ -51,6 +57,13 @@ unixSocket::unixSocket( int fd, eEventType eType, bool isUdp, const char* name )
   pollTimeout = -1;
   bPipe = false;
   lastErrorFd = -1;
+  bNonblocking = false;
+  bReadAhead = false;
+  rxBuf = NULL;
+  rxBufSize = 0;
+  rxStart = 0;
+  rxEnd = 0;
+  rxFrameLen = 0;
 }	// unixSocket
 
 /**
@@ -64,6 +77,7 @@ unixSocket::~unixSocket()
     delete[] pollFd;
     pollFd = NULL;
   }
+  if( rxBuf != NULL ) delete[] rxBuf;
 }	// ~unixSocket
 
 /**
@@ -168,6 +182,137 @@ bool unixSocket::waitForEvent(  )
     throw Exception( log, log.DEBUG,  "waitForEvent: unspecified error" );
 } // waitForEvent
 
+/**
+ * makes space in the receive buffer for n contiguous characters starting at rxStart
+ * compacts the unconsumed characters to the front of the buffer if that is sufficient
+ * otherwise grows the buffer
+ * @param n - number of characters required from rxStart
+ * **/
+void unixSocket::reserveRx( int n )
+{
+  int lenAvailable = rxEnd-rxStart;
+  if( (rxBuf!=NULL) && (rxStart+n<=rxBufSize) ) return;
+  if( (rxBuf!=NULL) && (n<=rxBufSize) )
+  {
+    memmove( rxBuf, rxBuf+rxStart, lenAvailable );
+    rxStart = 0;
+    rxEnd = lenAvailable;
+    return;
+  } // if
+
+  int newSize = (rxBufSize*2>n)?rxBufSize*2:n;
+  if( newSize < READ_BUF_SIZE ) newSize = READ_BUF_SIZE;
+  char* newBuf = new char[newSize+1];   // one spare for a terminator past the last character
+  if( lenAvailable > 0 ) memcpy( newBuf, rxBuf+rxStart, lenAvailable );
+  if( rxBuf != NULL ) delete[] rxBuf;
+  if( rxBufSize > 0 ) log.debug( log.MIDLEVEL, "reserveRx: fd:%d grew the receive buffer from %d to %d", socketfd, rxBufSize, newSize );
+  rxBuf = newBuf;
+  rxBufSize = newSize;
+  rxStart = 0;
+  rxEnd = lenAvailable;
+} // reserveRx
+
+/**
+ * reads from the socket into the free space at the end of the receive buffer
+ * restarts the read if interrupted by a signal
+ * for Udp the free space is first made large enough to hold an entire datagram
+ * @param maxLen - maximum number of characters to read; 0 for as many as fit
+ * @return the number of characters read, 0 if nothing is available or -1 on eof or other error - bEof will be set if end of file condition was set
+ * @exception throws on eof - set by calling setThrowEof()
+ * **/
+int unixSocket::fillRxBuffer( int maxLen )
+{
+  if( bUdp )
+    reserveRx( rxEnd-rxStart+READ_BUF_SIZE );
+  else if( rxBuf == NULL )
+    reserveRx( (maxLen>READ_BUF_SIZE)?maxLen:READ_BUF_SIZE );
+  else if( rxEnd == rxBufSize )
+    reserveRx( (rxStart>0)?(rxEnd-rxStart+1):(rxBufSize+1) );
+
+  int lenToRead = rxBufSize-rxEnd;
+  if( (maxLen>0) && (maxLen<lenToRead) && !bUdp ) lenToRead = maxLen;
+  int bytesReceived = 0;
+  do 
+  {
+    if( bPipe )
+      bytesReceived = ::read( socketfd, rxBuf+rxEnd, lenToRead );
+    else
+      bytesReceived = recv( socketfd, rxBuf+rxEnd, lenToRead, 0 );
+  }
+  while( ( bytesReceived == -1 ) && ( errno == EINTR ) );
+  if( bytesReceived == 0 )
+  {
+    bEof = true;
+    if( bThrowEof ) throw Exception( log, log.ERROR, "read: eof on fd:%d", socketfd );
+    return -1;
+  } // if
+  else if( bytesReceived == -1 )
+  {
+    // given that this is the result of a poll return we should not normally get a EAGAIN
+    if( errno != EAGAIN )
+    {
+      log.warn( log.LOGALWAYS, "read error on fd:%d - %s", socketfd, strerror(errno) );
+      return -1;
+    } // if
+    log.debug( log.LOGSELDOM, "read: no data" );
+    return 0;
+  } // else if
+
+  if( log.wouldLog( log.LOGSELDOM ) ) log.debug( log.LOGONOCCASION ) << "fd:" << socketfd << " read len:" << bytesReceived << " bytes:'" << std::string( rxBuf+rxEnd, bytesReceived ) << "'";
+  else if( log.wouldLog( log.LEVEL8 ) ) log.debug( log.MIDLEVEL, "fd:%d read len:%d bytes buffered:%d", socketfd, bytesReceived, rxEnd+bytesReceived-rxStart );
+  rxEnd += bytesReceived;
+  return bytesReceived;
+} // fillRxBuffer
+
+/**
+ * makes sure that at least n characters are available contiguously at getRxData()
+ * characters already in the receive buffer are left in place; a partial frame remains 
+ * buffered until a later call finds the balance
+ * only reads as many characters as are missing unless read ahead is set; a non-blocking
+ * socket is read until it runs dry or n is satisfied, a blocking socket is read once
+ * @param n - number of characters required
+ * @return true if n characters are available
+ * @exception throws on eof - set by calling setThrowEof()
+ * **/
+bool unixSocket::ensureRxAvailable( int n )
+{
+  if( rxEnd-rxStart >= n ) return true;
+  reserveRx( n );
+
+  int bytesReceived = 0;
+  do
+    bytesReceived = fillRxBuffer( bReadAhead?0:n-(rxEnd-rxStart) );
+  while( bNonblocking && (bytesReceived>0) && (rxEnd-rxStart<n) );
+  return rxEnd-rxStart >= n;
+} // ensureRxAvailable
+
+/**
+ * discards received characters up to the next occurrence of marker after rxStart
+ * used to find the start of the next frame after a corrupt one - if the marker is not
+ * buffered everything is discarded except a tail that may be the start of the marker
+ * at least one character is always discarded
+ * @param marker
+ * @param markerLen
+ * @return the number of characters discarded
+ * **/
+int unixSocket::resyncRx( const char* marker, int markerLen )
+{
+  rxFrameLen = 0;
+  int lenAvailable = rxEnd-rxStart;
+  if( lenAvailable <= 0 ) return 0;
+
+  int discard;
+  const char* p = (const char*)memmem( rxBuf+rxStart+1, lenAvailable-1, marker, markerLen );
+  if( p != NULL )
+    discard = p-(rxBuf+rxStart);
+  else
+    discard = lenAvailable-(markerLen-1);
+  if( discard < 1 ) discard = 1;
+  consumeRx( discard );
+  log.debug( log.MIDLEVEL, "resyncRx: fd:%d discarded %d characters marker %s", socketfd, discard, (p!=NULL)?"found":"not found" );
+  return discard;
+} // resyncRx
+
 /** 
  * stream interface - reading from socket
  * restart the recv if we were interrupted by a signal
@@ -184,53 +329,24 @@ std::streamsize unixSocket::read( char* s, std::streamsize n )
   if( log.wouldLog( log.LOGSELDOM ) )
     log.debug( log.MIDLEVEL, "read requested for %d bytes", n );
 
-  // for Udp we always pre-read into the unusedChars buffer if the buffer is empty
-  if( bUdp && unusedChars.empty() )
+  // for Udp we always pre-read into the receive buffer if the buffer is empty
+  if( bUdp && (rxEnd==rxStart) )
   {
-    char tempBuf[READ_BUF_SIZE];
-    do 
-    {
-      if( bPipe )
-        bytesReceived = ::read( socketfd, tempBuf, READ_BUF_SIZE-1 );
-      else
-        bytesReceived = recv( socketfd, tempBuf, READ_BUF_SIZE-1, 0 );
-    }
-    while( ( bytesReceived == -1 ) && ( errno == EINTR ) );
-    if( bytesReceived == 0 )
-    {
-      bEof = true;
-      if( bThrowEof ) throw Exception( log, log.ERROR, "read: eof on fd:%d", socketfd );
-      return -1;
-    } // if
-    else if( bytesReceived == -1 )
-    {
-      // given that this is the result of a poll return we should not normally get a EAGAIN
-      if( errno != EAGAIN )
-        log.warn( log.MIDLEVEL, "bUdp read error on fd %d - %s", socketfd, strerror( errno ) );
-      return -1;    // eof or other error
-    } // else if
-    else
-    {
-      tempBuf[bytesReceived] = '\0';
-      if( log.LOGSELDOM <= log.getLogLevel() ) log.debug( log.LOGONOCCASION ) << "bUdp read len " << bytesReceived << " bytes: " << tempBuf;
-      else if( log.LOGONOCCASION < log.getLogLevel() ) log.debug( log.MIDLEVEL, "bUdp read len %d bytes", bytesReceived );
-      unusedChars.append( tempBuf, bytesReceived );
-    } // else( ( bytesReceived
-    bytesReceived = 0;
+    if( fillRxBuffer( 0 ) < 1 ) return -1;
   } // if( bUdp
 
-  // output any unused characters first
-  int lenAvailable = unusedChars.length();
+  // output any buffered characters first
+  int lenAvailable = rxEnd-rxStart;
   int lenToCopy = 0;
   if( lenAvailable > 0 )
   {
     lenToCopy = (lenAvailable>n)?n:lenAvailable;
-    memcpy( buf, unusedChars.data(), lenToCopy );
-    unusedChars.erase( 0, lenToCopy );
+    memcpy( buf, rxBuf+rxStart, lenToCopy );
+    consumeRx( lenToCopy );
     n -= lenToCopy;
     buf += lenToCopy;
     *buf = '\0';
-  } // unusedChars
+  } // lenAvailable
 
   // read the balance of the characters from the input socket if any more are required
   if( n > 0 )
@@ -269,7 +385,6 @@ std::streamsize unixSocket::read( char* s, std::streamsize n )
     } // else( ( bytesReceived
   } // if( n > 0
   
-//(log.debug( log.LOGNORMAL ) << "packet data: ").hexDump( std::string((const char*)s,bytesReceived+lenToCopy) );
   if( log.wouldLog( log.LOGSELDOM ) ) log.debug( log.LOGONOCCASION ) << "fd:" << socketfd << " read len:" << (bytesReceived+lenToCopy) << " bytes:'" << s << "'";
   else if( log.wouldLog( log.LEVEL8 ) ) log.debug( log.MIDLEVEL, "fd:%d read len:%d bytes", socketfd, bytesReceived+lenToCopy );
   return bytesReceived + lenToCopy;
@@ -280,20 +395,10 @@ std::streamsize unixSocket::read( char* s, std::streamsize n )
  * **/
 std::string unixSocket::read( )
 {
-  char strBuf[READ_BUF_SIZE];
-  int bufLen = READ_BUF_SIZE;
-  int lenAvailable = unusedChars.length();
-  int lenToCopy = 0;
-  if( lenAvailable > 0 )
-  {
-    lenToCopy = (lenAvailable>READ_BUF_SIZE)?READ_BUF_SIZE:lenAvailable;
-    memcpy( strBuf, unusedChars.data(), lenToCopy );
-    unusedChars.erase( 0, lenToCopy );
-    bufLen -= lenToCopy;
-  } // if
-  
-  int newLen = read( strBuf+lenToCopy, bufLen );
-  return std::string( strBuf, newLen+lenToCopy );
+  char strBuf[READ_BUF_SIZE+1];
+  int newLen = read( strBuf, READ_BUF_SIZE );
+  if( newLen < 1 ) return std::string();
+  return std::string( strBuf, newLen );
 } // read
 
 /**
@@ -306,14 +411,16 @@ void unixSocket::returnUnusedCharacters( const char* buf, int n )
 {
   if( n > 0 )
   {
-    if( unusedChars.empty() )
-      unusedChars.append( buf, n );
-    else
+    if( rxStart < n )
     {
-      std::string tmp = unusedChars;
-      unusedChars.assign( buf, n );
-      unusedChars.append( tmp );
-    } // else
+      int lenAvailable = rxEnd-rxStart;
+      reserveRx( lenAvailable+n );
+      memmove( rxBuf+n, rxBuf+rxStart, lenAvailable );
+      rxStart = n;
+      rxEnd = n+lenAvailable;
+    } // if
+    rxStart -= n;
+    memcpy( rxBuf+rxStart, buf, n );
     log.debug( log.MIDLEVEL, "returnUnusedCharacters returned %d characters fd:%d", n, socketfd );
   }
   else
@@ -385,6 +492,52 @@ std::streamsize unixSocket::writeOnce( int fd, const std::string& s, bool bPipe
   } // else
 } // writeOnce
 
+/**
+ * scatter-gather version of writeOnce - writes the buffers in a single call without joining them first
+ * @param fd - the socket fd to use
+ * @param iov - the buffers to write
+ * @param iovcnt - number of entries in iov
+ * @param bPipe - true to write to a pipe rather than a socket
+ * @param bDontWait - true to return EAGAIN rather than block on a socket that is blocking
+ * @return - the number of bytes sent or -1 for error with errno set
+ * **/
+std::streamsize unixSocket::writeOnceV( int fd, const struct iovec* iov, int iovcnt, bool bPipe, bool bDontWait )
+{
+  int bytesSent = 0;
+  do
+  {
+    if( bPipe )
+      bytesSent = ::writev( fd, iov, iovcnt );
+    else
+    {
+      struct msghdr msg;
+      memset( &msg, 0, sizeof(msg) );
+      msg.msg_iov = (struct iovec*)iov;
+      msg.msg_iovlen = iovcnt;
+      int flags = bDontWait?MSG_DONTWAIT:0;
+#ifdef PLATFORM_MAC
+      bytesSent = sendmsg( fd, &msg, flags ); // block the SIGPIPE signal - for MAC this is a SO_NOSIGPIPE
+#else
+      bytesSent = sendmsg( fd, &msg, flags|MSG_NOSIGNAL ); // block the SIGPIPE signal - will receive a EPIPE error on socket closure by the remote end 
+#endif
+    } // else
+  }
+  while( ( bytesSent  == -1 ) && ( errno == EINTR ) );
+  if( bytesSent == -1 )
+  {
+    int err = errno;
+    if( (err != EAGAIN) && (err != EWOULDBLOCK) )
+      pStaticLogger->info( loggerDefs::LOGMOSTLY, "writeOnceV error on fd %d - %s", fd, strerror(err) );
+    errno = err;    // the caller decides whether to retry
+    return -1;
+  } // if( bytesSent
+  else
+  {
+    if( pStaticLogger->wouldLog( pStaticLogger->LEVEL8 ) ) pStaticLogger->debug( pStaticLogger->MIDLEVEL, "writeOnceV fd:%d iovcnt %d bytesSent %d", fd, iovcnt, bytesSent );
+    return bytesSent;
+  } // else
+} // writeOnceV
+
 /**
  * unix domain datagram interface capable of sending on an unconnected socket
  * @param fd - the socket fd to use
@@ -463,6 +616,8 @@ void unixSocket::setNonblocking( )
   opts = opts | O_NONBLOCK;
   if( fcntl( socketfd, F_SETFL, opts ) < 0 ) 
     log.warn( log.LOGALWAYS, "setNonblocking failed to set opts - %s", strerror( errno ) );
+  else
+    bNonblocking = true;
 } // setnonblocking
 
 /**
@@ -506,6 +661,22 @@ void unixSocket::addReadFd( int fd )
   pollFd[pollFdCount++].events = POLLIN;
 } // addReadFd
 
+/**
+ * adds an fd that is to be polled for writing - getNextFd returns it once it is writable
+ * @param fd
+ * **/
+void unixSocket::addWriteFd( int fd )
+{
+  if( pollFdCount >= numPollFdEntries)
+  {
+    log.error( "addWriteFd: failed to add fd %d - out of space (%d entries)", fd, numPollFdEntries );
+    return;
+  } // if
+  
+  pollFd[pollFdCount].fd = fd;
+  pollFd[pollFdCount++].events = POLLOUT;
+} // addWriteFd
+
 /**
  * waits in blocking mode for a message / event from any of the sockets
  * does not restart after a signal
@@ -552,7 +723,7 @@ bool unixSocket::multiFdWaitForEvent( )
     std::string strFds;
     for( int i = 0; i < pollFdCount; i++ )
     {
-      if( pollFd[i].revents & (POLLIN|POLLPRI|POLLERR|POLLHUP|POLLNVAL) )
+      if( pollFd[i].revents & (POLLIN|POLLPRI|POLLOUT|POLLERR|POLLHUP|POLLNVAL) )
       {
         char str[32];
         sprintf( str, "%d,", pollFd[i].fd );
@@ -579,7 +750,7 @@ int unixSocket::getNextFd( )
   bool bFound = false;
   while( !bFound && ( ++lastFdProcessed < pollFdCount ) )
   {
-    if( pollFd[lastFdProcessed].revents & (POLLIN|POLLPRI) )
+    if( pollFd[lastFdProcessed].revents & (POLLIN|POLLPRI|POLLOUT) )
     {
       bFound = true;
       numPollFdsProcessed++;
@@ -628,6 +799,12 @@ const char* unixSocket::eEventTypeToStr( eEventType e )
     case ET_WORKER_PIPE:
       return "ET_WORKER_PIPE";
       break;
+    case ET_TIMER:
+      return "ET_TIMER";
+      break;
+    case ET_WRITE_READY:
+      return "ET_WRITE_READY";
+      break;
     default:
       return "eEventType not recognised";
       break;
@@ -9,6 +9,12 @@
  @version 1.3.0		05/09/2012		Gerhardus Muller		added an event type
  @version 1.4.0		27/02/2013		Gerhardus Muller		added getPipe
  @version 1.5.0		05/06/2013		Gerhardus Muller		added the FD_CLOEXEC flag to the socketpair call; added setCloseOnExec
+ @version 1.6.0		16/10/2026		agent		replaced unusedChars with a receive buffer that frames can be parsed from in place
+ @version 1.7.0		16/10/2026		agent		added writeOnceV
+ @version 1.8.0		16/10/2026		agent		frame decode state kept with the receive buffer; resyncRx
+ @version 1.9.0		16/10/2026		agent		ET_TIMER
+ @version 1.10.0		16/10/2026		agent		ET_WRITE_READY; writeOnceV can skip blocking
+ @version 1.11.0		17/10/2026		agent		addWriteFd
 
  @note
 
@@ -24,12 +30,13 @@
 
 #include "utils/object.h"
 #include <sys/poll.h>
+#include <sys/uio.h>
 
 class unixSocket : public object
 {
   // Definitions
   public:
-  enum eEventType { ET_OTHER,ET_QUEUE_EVENT,ET_WORKER_RET,ET_SIGNAL,ET_LISTEN,ET_WORKER_PIPE };
+  enum eEventType { ET_OTHER,ET_QUEUE_EVENT,ET_WORKER_RET,ET_SIGNAL,ET_LISTEN,ET_WORKER_PIPE,ET_TIMER,ET_WRITE_READY };
   static const int READ_BUF_SIZE = 32768;
   //  static const int READ_BUF_SIZE = 4096;
 
@@ -46,10 +53,19 @@ class unixSocket : public object
   std::streamsize write(const char* s, std::streamsize n);
   static std::streamsize writeOnce( int fd, const std::string& s, bool bPipe=false );
   static std::streamsize writeOnceTo( int fd, const std::string& s, const std::string& dest );
+  static std::streamsize writeOnceV( int fd, const struct iovec* iov, int iovcnt, bool bPipe=false, bool bDontWait=false );
   void setCloseOnExec( bool bSet );
   void setNonblocking( );
   void setNoSigPipe( );
   void returnUnusedCharacters( const char* buf, int n );
+  bool ensureRxAvailable( int n );
+  char* getRxData( )                              {return rxBuf+rxStart;}
+  int  getRxAvailable( )                          {return rxEnd-rxStart;}
+  void consumeRx( int n )                         {rxStart+=n;if(rxStart>=rxEnd){rxStart=0;rxEnd=0;}}
+  void setReadAhead( bool b )                     {bReadAhead=b;}
+  int  getRxFrameLen( )                           {return rxFrameLen;}
+  void setRxFrameLen( int n )                     {rxFrameLen=n;}
+  int  resyncRx( const char* marker, int markerLen );
   int  getSocketFd( )                             {return socketfd;};
   bool isEof( )                                   {return bEof;};
   void resetEof( )                                {bEof=false;};
@@ -67,12 +83,15 @@ class unixSocket : public object
   int  getNextFd( );
   int  getLastErrorFd( )                          {return lastErrorFd;}
   void addReadFd( int fd );
+  void addWriteFd( int fd );
   void setPipe( )                                 {bPipe=true;}
   bool getPipe( )                                 {return bPipe;}
   void setThrowEof( )                             {bThrowEof=true;}
   static const char* eEventTypeToStr( eEventType e );
 
   private:
+  int  fillRxBuffer( int maxLen );
+  void reserveRx( int n );
 
   // Properties
   public:
@@ -96,7 +115,13 @@ class unixSocket : public object
   int                               lastErrorFd;          ///< last fd with a detected error on it
   int                               pollFdCount;          ///< used to assemble the pollFd structure
   int                               pollTimeout;          ///< time that poll blocks in milliseconds
-  std::string                       unusedChars;          ///< characters read from the socket and left over
+  bool                              bNonblocking;         ///< true once setNonblocking has been called
+  bool                              bReadAhead;           ///< true to read as much as is available rather than only what ensureRxAvailable asked for - only for sockets whose events are drained until unSerialise returns NULL
+  char*                             rxBuf;                ///< receive buffer - characters read from the socket and not yet consumed; allocated on first use with one spare byte for a terminator
+  int                               rxBufSize;            ///< usable size of rxBuf
+  int                               rxStart;              ///< offset of the first unconsumed character in rxBuf
+  int                               rxEnd;                ///< offset one past the last character received into rxBuf
+  int                               rxFrameLen;           ///< length of the frame starting at rxStart once its frame header has been decoded - 0 while waiting for a frame header
 };	// class unixSocket
 
 #endif // !defined( unixSocket_defined_)
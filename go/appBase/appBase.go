@@ -2,8 +2,12 @@
 // 
 // Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
 // @version 1.0.0   17/04/2014    Gerhardus Muller     Script created
+// @version 1.1.0   16/10/2026    agent     support for a pipelined worker - PipelineRef, DeferResult, CompleteResult and ConcurrentEventHandlingIf
 //
 // @note
+// with a queue pipelineDepth>1 the worker writes up to pipelineDepth events before reading the results.
+// an app implementing ConcurrentEventHandlingIf then handles each non command event in a go routine of
+// its own; any handler can also take over its result with DeferResult and complete it later
 //
 // @todo 
 //
@@ -32,6 +36,7 @@ type ChanEvent struct {
   event                   *BaseEvent
   err                     error
   chanId                  int
+  newEvents               []*BaseEvent          // events generated along with a completed result (ID_RESULT)
 }
 
 type AppBase struct {
@@ -55,6 +60,9 @@ type AppBase struct {
   ownQueue                string
   workerPid               uint
   resultEvent             *BaseEvent
+  pipelineDepth           uint                  // events the worker can have in flight
+  bResultDeferred         bool                  // the handler took over the result with DeferResult
+  numDeferred             int                   // deferred results not yet completed
   buildString             string
   beVerbose               bool
   bMainLoopVerbose        bool
@@ -69,6 +77,7 @@ type AppBase struct {
 } // type AppBase struct
 
 const ID_STDIO = 0                              // id for events from stdio
+const ID_RESULT = -1                            // id for results completed with CompleteResult
 
 /**
  * initialisation - call in sequence
@@ -81,6 +90,7 @@ func (s *AppBase) Init( appName, logDir string, bUseStdErr, bVerbose, bFlushLogs
   s.beVerbose = bVerbose
   s.bMainLoopVerbose = bVerbose
   s.buildString = buildStr
+  s.pipelineDepth = 1
 
   if !strings.HasSuffix( s.logDir, "/" ) { s.logDir += "/" }
 
@@ -227,6 +237,15 @@ func (s *AppBase) GenerateStats( event *BaseEvent ) []*BaseEvent {
   return nil
 } // AppBase::GenerateStats
 
+/**
+ * optional - events handled concurrently by a pipelined app (queue pipelineDepth>1)
+ * HandleConcurrentEvent runs in a go routine of its own and fills in result which is written
+ * once it returns; the events it returns are processed as for HandleNewEvent
+ * **/
+type ConcurrentEventHandlingIf interface {
+  HandleConcurrentEvent( event, result *BaseEvent ) []*BaseEvent
+} // interface ConcurrentEventHandlingIf
+
 /**
  * event handling and processing interfaces
  * **/
@@ -370,12 +389,14 @@ func (s *AppBase) HandlePersistentCommand( event *BaseEvent ) []*BaseEvent {
       Log.Print( "info  AppBase::HandlePersistentCommand unfreezing execution" )
     case "exit":
       Log.Print( "info  AppBase::HandlePersistentCommand bTimeToDie" )
+      if s.numDeferred > 0 { Log.Print( "WARN AppBase::HandlePersistentCommand deferred results outstanding:", s.numDeferred ) }
       s.bTimeToDie = true
       newEvents = s.PrepareToExit( event )
     case "startupinfo":
       s.ownQueue,_ = event.GetParamAsStr("ownqueue")
       s.workerPid,_ = event.GetParamAsUint("workerpid")
-      Log.Printf( "info  AppBase::HandlePersistentCommand ownQueue:%s workerPid:%v", s.ownQueue, s.workerPid )
+      if depth,err := event.GetParamAsUint("pipelinedepth"); err == nil { s.pipelineDepth = depth }
+      Log.Printf( "info  AppBase::HandlePersistentCommand ownQueue:%s workerPid:%v pipelineDepth:%v", s.ownQueue, s.workerPid, s.pipelineDepth )
     default:
       newEvents = s.HandleUnhandledCmdEvents( event )
     } // switch
@@ -424,6 +445,7 @@ func (s *AppBase) Run( appInt interface{} ) {
   iLoop := appInt.(LoopTasksIf)                     // StartLoopProcess, ExecRegularTasks
   iAddEvents := appInt.(AdditionalEventSourcesIf)   // HandlePolledFh
   iEventHandling := appInt.(EventHandlingIf)        // HandleNewEvent
+  iConcurrent,bConcurrent := appInt.(ConcurrentEventHandlingIf)   // HandleConcurrentEvent - optional
 
   extraEvents := make( []*BaseEvent, 0, 5 )
   var outputString string
@@ -441,6 +463,8 @@ func (s *AppBase) Run( appInt interface{} ) {
     // we could also implement a maintInterval like the C++ with a select and case <- time.After(time.Second):
     // check for eof - we return a nil event
     eventPacket := <- s.eventSrc
+    outputString = ""
+    s.bResultDeferred = false
     if eventPacket.chanId == ID_STDIO {
       if eventPacket.event == nil {
         if eventPacket.err == io.EOF {
@@ -451,27 +475,44 @@ func (s *AppBase) Run( appInt interface{} ) {
             s.constructFailResultEvent( eventPacket.err.Error() )
             outputString = s.sendDone()
           } // else
+      } else if bConcurrent && (s.pipelineDepth > 1) && (eventPacket.event.EventType() != EV_COMMAND) {
+        // the worker limits the events in flight and with it the number of go routines
+        event := eventPacket.event
+        s.constructDefaultResultEvent( event )
+        result := s.DeferResult()
+        outputString = s.sendDone()
+        go func() {
+          newEvents := iConcurrent.HandleConcurrentEvent( event, result )
+          s.CompleteResult( result, newEvents )
+        }()
       } else {
         // otherwise process event
         s.constructDefaultResultEvent( eventPacket.event )
         newEvents := iEventHandling.HandleNewEvent( eventPacket.event )
         if newEvents != nil { extraEvents = append( extraEvents, newEvents... ) }
 
-        // write a mandatory response
+        // write a mandatory response - unless the handler deferred it
         outputString = s.sendDone()
       } // else
-
-      // os.Stdout.Write is by default unbuffered
-      if _,err := os.Stdout.Write([]byte(outputString)); err != nil {
-        Log.Print( "WARN AppBase::Run writing to stdout error - terminating - ", err )
-        s.bTimeToDie = true
-      } // if
+    } else if eventPacket.chanId == ID_RESULT {
+      if s.numDeferred > 0 { s.numDeferred-- }
+      var err error
+      if outputString,err = eventPacket.event.SerialiseToString(); err!=nil { Log.Print( "WARN AppBase::Run failed to serialise: ", eventPacket.event.String(), " err - ", err ) }
+      if eventPacket.newEvents != nil { extraEvents = append( extraEvents, eventPacket.newEvents... ) }
     } else { // if ID_STDIO
       // the new event originates from somewhere other than stdin
       newEvents := iAddEvents.HandlePolledFh( &eventPacket )
       if newEvents != nil { extraEvents = append( extraEvents, newEvents... ) }
     } // else ID_STDIO
 
+    // os.Stdout.Write is by default unbuffered
+    if len(outputString) > 0 {
+      if _,err := os.Stdout.Write([]byte(outputString)); err != nil {
+        Log.Print( "WARN AppBase::Run writing to stdout error - terminating - ", err )
+        s.bTimeToDie = true
+      } // if
+    } // if
+
     // handle maintenance tasks
     if !s.bFrozen {
       newEvents := iLoop.ExecRegularTasks()
@@ -503,6 +544,26 @@ Log.Print( "debug AppBase::Run extra event:", event )
 } // func AppBase::Run
 
 
+/**
+ * takes over the result of the event being handled so that it can be completed later with
+ * CompleteResult - only of use with a pipelined worker (queue pipelineDepth>1)
+ * **/
+func (s *AppBase) DeferResult() *BaseEvent {
+  result := s.resultEvent
+  s.resultEvent = nil
+  s.bResultDeferred = true
+  s.numDeferred++
+  return result
+} // AppBase::DeferResult
+
+/**
+ * hands a deferred result and the events generated along with it to the main loop for writing
+ * results may be completed in any order and from any go routine
+ * **/
+func (s *AppBase) CompleteResult( result *BaseEvent, newEvents []*BaseEvent ) {
+  go func() { s.eventSrc <- ChanEvent{result,nil,ID_RESULT,newEvents} }()
+} // AppBase::CompleteResult
+
 /**
  * private functions
  * **/
@@ -565,9 +626,9 @@ func readStdIn( eventSrc chan<- ChanEvent, id int, bTimeToDie *bool ) {
     event,err := UnSerialiseFromSocket( os.Stdin, true )
     if err != nil {
       Log.Print( "info  AppBase::readStdIn err:", err )
-      packet = ChanEvent{nil,err,id}
+      packet = ChanEvent{nil,err,id,nil}
     } else {
-      packet = ChanEvent{event,err,id}
+      packet = ChanEvent{event,err,id,nil}
     } // else
     eventSrc <- packet
   } // for
@@ -596,6 +657,7 @@ func (s *AppBase) constructDefaultResultEvent( event *BaseEvent ) {
   if err != nil { Log.Print( "WARN AppBase::constructDefaultResultEvent NewBaseEvent error:", err ); return }
   s.resultEvent.SetBSuccess( true )
   s.resultEvent.SetReference( event.Reference() )
+  s.resultEvent.SetPipelineRef( event.PipelineRef() )
   if resultQueue,err := event.GetParamAsStr("resultQueue"); err == nil {
     s.resultEvent.SetDestQueue( resultQueue )
   } // if
@@ -617,6 +679,10 @@ func (s *AppBase) constructFailResultEvent( errorString string ) {
  * **/
 func (s *AppBase) sendDone() string {
   var err error
+  if s.bResultDeferred {
+    s.bResultDeferred = false
+    return ""
+  } // if
   if s.resultEvent == nil {
     Log.Print( "debug AppBase::sendDone creating result event" )
     s.resultEvent,_ = NewBaseEvent( EV_RESULT )
@@ -2,6 +2,7 @@
 // 
 // Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
 // @version 1.0.0   04/04/2014    Gerhardus Muller     Script created
+// @version 1.1.0   16/10/2026    agent     added pipelineRef - matches the results of a pipelined persistent app to its events
 //
 // @note extraction of part2 et al is handled differently to the C code; panics on attempting to use part2 et al without extraction
 //
@@ -55,6 +56,7 @@ type sysParamsType struct {
   SystemParam             string        `json:"systemParam,omitempty"`
   ElapsedTime             uint          `json:"elapsedTime,omitempty"`
   BGeneratedRecoveryEvent bool          `json:"bGeneratedRecoveryEvent,omitempty"`
+  PipelineRef             uint32        `json:"pipelineRef,omitempty"`        // set by a pipelined worker - has to be copied to the result
 } // sysParamsType
 type BaseEvent struct {
   part1Json               []byte
@@ -485,6 +487,18 @@ func (s *BaseEvent) SetBGeneratedRecoveryEvent( t bool ) error {
   return nil
 } // BaseEvent SetBGeneratedRecoveryEvent
 
+/**
+ * pipelineRef
+ * **/
+func (s *BaseEvent) PipelineRef() uint32 {
+  if !s.sysParamsExtracted { panic("!s.sysParamsExtracted"); }
+  return s.sysParams.PipelineRef
+} // BaseEvent 
+func (s *BaseEvent) SetPipelineRef( t uint32 ) error {
+  s.sysParams.PipelineRef = t
+  return nil
+} // BaseEvent SetPipelineRef
+
 /**
  * execParams
  * positional take precendence over named parameters
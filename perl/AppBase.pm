@@ -17,6 +17,7 @@
 # @version 1.9.0    13/05/2013    Gerhardus Muller    changed AppBase logging string for consistency
 # @version 1.10.0   25/08/2014    Gerhardus Muller    stub execRegularTasks did not return undef
 # @version 1.10.1		07/11/2014		Gerhardus Muller		changed INFO to info in log statements
+# @version 1.11.0		16/10/2026		agent		support for a pipelined worker - unbuffered stdin, pipelineRef, deferResult and completeResult
 #
 # perl -MCPAN -e "install IO::Handle, IO::Select, IO::Socket, Date::Manip::Date, Date::Manip::Delta"
 #
@@ -56,6 +57,10 @@ sub new
     ownQueue            => undef,
     workerPid           => -1,
     resultEvent         => undef,
+    stdinBuffer         => '',
+    pipelineDepth       => 1,
+    bResultDeferred     => 0,
+    numDeferred         => 0,
     buildString         => $buildStr,
     beVerbose           => $bVerbose,
     bMainLoopVerbose    => $bVerbose,
@@ -184,17 +189,25 @@ sub run
       {
         if( $fh == $this->{stdio} )
         {
-          if( $this->{stdio}->eof() )
+          # read unbuffered - with a pipelined worker several events can be waiting and the select
+          # would not wake up for those already sitting in a buffered handle
+          my $bytesRead = sysread( $this->{stdio}, $this->{stdinBuffer}, $TxProc::READ_BUF_SIZE, length($this->{stdinBuffer}) );
+          if( !$bytesRead )
           {
             print LOGFILE "$timestamp info  AppBase::run stdio eof\n";
             $this->{bTimeToDie} = 1;
           } # if
-          else
+          while( !$this->{bTimeToDie} && ((my $frameLen = TxProc->frameLength($this->{stdinBuffer})) != 0) )
           {
             my $outputString;
+            my $frame = $this->{stdinBuffer};
+            $frameLen = length($frame) if( $frameLen < 0 );
+            $this->{stdinBuffer} = substr( $frame, $frameLen );
+            $frame = substr( $frame, 0, $frameLen );
+            $this->{bResultDeferred} = 0;
             eval
             {
-              my ($txProcEvent,$err) = TxProc->unSerialise( $this->{stdio} );
+              my ($txProcEvent,$err) = TxProc->unSerialiseFromString( $frame );
               if( $txProcEvent )
               {
                 $this->constructDefaultResultEvent( $txProcEvent );
@@ -229,12 +242,13 @@ sub run
               $this->{resultEvent} = new TxProc( 'EV_RESULT' ) if(!defined($this->{resultEvent}));
               $this->{resultEvent}->bSuccess(0);
               $this->{resultEvent}->errorString( " AppBase::run($this->{appName}) application exception: '$@'" );
+              $this->{bResultDeferred} = 0;
               $outputString = $this->sendDone();
             } # if
 
-            # write a mandatory response
-            print $outputString;
-          } # else !stdio eof
+            # write a mandatory response - unless the handler deferred it
+            print $outputString if( length($outputString) > 0 );
+          } # while frameLength
         } # if $fh == $stdio
         else
         {
@@ -471,12 +485,14 @@ sub handlePersistentCommand
     $this->{bTimeToDie} = 1;
     $newEvents = $this->prepareToExit( $event );
     print LOGFILE "$timestamp info  AppBase::handlePersistentCommand: exiting\n";
+    print LOGFILE "$timestamp WARN AppBase::handlePersistentCommand: $this->{numDeferred} deferred results outstanding\n" if( $this->{numDeferred} > 0 );
   } # if exit
   elsif( $cmd eq "startupinfo" )
   {
     $this->{ownQueue} = $event->getParam('ownqueue');
     $this->{workerPid} = $event->getParam('workerpid');
-    print LOGFILE "$timestamp info  AppBase::handlePersistentCommand: ownQueue:$this->{ownQueue} workerPid:$this->{workerPid}\n";
+    $this->{pipelineDepth} = $event->getParam('pipelinedepth') if( defined($event->getParam('pipelinedepth')) );
+    print LOGFILE "$timestamp info  AppBase::handlePersistentCommand: ownQueue:$this->{ownQueue} workerPid:$this->{workerPid} pipelineDepth:$this->{pipelineDepth}\n";
   } # if exit
   else
   {
@@ -602,6 +618,7 @@ sub constructDefaultResultEvent
   $this->{resultEvent} = new TxProc( 'EV_RESULT' );
   $this->{resultEvent}->bSuccess(1);
   $this->{resultEvent}->reference( $event->reference() );
+  $this->{resultEvent}->pipelineRef( $event->pipelineRef() ) if( defined($event->pipelineRef()) );
   my $resultQueue = $event->getParam('resultQueue');
   $this->{resultEvent}->destQueue( $resultQueue ) if(defined($resultQueue));
   $this->{resultEvent}->addParam( 'generatedby', $this->{appName} );
@@ -613,6 +630,11 @@ sub constructDefaultResultEvent
 sub sendDone
 {
   my ($this) = @_;
+  if( $this->{bResultDeferred} )
+  {
+    $this->{bResultDeferred} = 0;
+    return '';
+  } # if
   if( !defined($this->{resultEvent}) )
   {
     print LOGFILE "$timestamp DEBUG sendDone: creating resultEvent\n";
@@ -624,6 +646,29 @@ sub sendDone
   return $resultString;
 } # sendDone
 
+#######
+# takes over the result of the event being handled so that it can be completed later with completeResult - only
+# of use with a pipelined worker (queue pipelineDepth>1) where the other events in flight are handled meanwhile
+# @return the result event
+sub deferResult
+{
+  my ($this) = @_;
+  my $result = $this->{resultEvent};
+  undef($this->{resultEvent});
+  $this->{bResultDeferred} = 1;
+  $this->{numDeferred}++;
+  return $result;
+} # deferResult
+
+#######
+# writes the mandatory response for a deferred result - results may be completed in any order
+sub completeResult
+{
+  my ($this,$result) = @_;
+  print $result->serialiseToString();
+  $this->{numDeferred}-- if( $this->{numDeferred} > 0 );
+} # completeResult
+
 #######
 # should be overridden to do something useful
 sub generateStats
@@ -791,6 +836,16 @@ sub bTimeToDie
   $this->{bTimeToDie} = $val if(defined($val));
   return $this->{bTimeToDie};
 } # sub bTimeToDie
+sub pipelineDepth
+{
+  my ($this) = @_;
+  return $this->{pipelineDepth};
+} # sub pipelineDepth
+sub numDeferred
+{
+  my ($this) = @_;
+  return $this->{numDeferred};
+} # sub numDeferred
 sub bFrozen
 {
   my ($this,$val) = @_;
@@ -18,6 +18,12 @@
 # @version 1.10.0		26/11/2013		Gerhardus Muller		fixed unserialise to handle fragmented packets
 # @version 1.10.1		05/11/2014		Gerhardus Muller		for consistency prependScriptParam should check if execParams is still a HASH
 # @version 1.10.2		07/11/2014		Gerhardus Muller		changed INFO to info in log statements
+# @version 1.11.0		16/10/2026		agent		added EV_BATCH and submitBatch
+# @version 1.12.0		16/10/2026		agent		added readyTime - seconds the nucleus holds the event back before queuing it
+# @version 1.13.0		16/10/2026		agent		added priority - level on a priority queue, higher is more urgent
+# @version 1.14.0		16/10/2026		agent		added coalesceKey - collapses queued events with the same key on a queue with a coalescePolicy
+# @version 1.15.0		16/10/2026		agent		added pipelineRef - matches the results of a pipelined persistent app to its events; added frameLength
+# @version 1.15.1		17/10/2026		agent		submitBatch writes the events to the pipe one at a time
 #
 # perl -MCPAN -e "install JSON::XS"
 #
@@ -138,13 +144,17 @@ sub eventType
     {
       $this->{eventType} = 10;
     } # elsif
+    elsif( $val eq 'EV_BATCH' )
+    {
+      $this->{eventType} = 11;
+    } # elsif
     else
     {
       warn "TxProc::command unknown eventType '$val'\n";
     } # else
   } # if
   my @textVal = ('EV_UNKNOWN','EV_BASE','EV_SCRIPT','EV_PERL','EV_BIN',
-    'EV_URL','EV_RESULT','EV_WORKER_DONE','EV_COMMAND','EV_REPLY','EV_ERROR');
+    'EV_URL','EV_RESULT','EV_WORKER_DONE','EV_COMMAND','EV_REPLY','EV_ERROR','EV_BATCH');
   return $textVal[$this->{eventType}];
 } # eventType
 sub reference 
@@ -169,7 +179,7 @@ sub destQueue
   return undef;
 } # sub destQueue
 
-# part2 properties - trace,traceTimestamp,expiryTime,lifetime,retries,workerPid(wpid)
+# part2 properties - trace,traceTimestamp,expiryTime,lifetime,retries,workerPid(wpid),readyTime,priority,coalesceKey
 sub trace
 {
   my ($this, $val) = @_;
@@ -212,9 +222,30 @@ sub wpid
   return $this->{part2}->{wpid} if( exists($this->{part2}->{wpid}) );
   return undef;
 } # sub wpid
+sub readyTime
+{
+  my ($this, $val) = @_;
+  $this->{part2}->{readyTime} = $val if defined($val);
+  return $this->{part2}->{readyTime} if( exists($this->{part2}->{readyTime}) );
+  return undef;
+} # sub readyTime
+sub priority
+{
+  my ($this, $val) = @_;
+  $this->{part2}->{priority} = int($val) if defined($val);
+  return $this->{part2}->{priority} if( exists($this->{part2}->{priority}) );
+  return undef;
+} # sub priority
+sub coalesceKey
+{
+  my ($this, $val) = @_;
+  $this->{part2}->{coalesceKey} = "$val" if defined($val);
+  return $this->{part2}->{coalesceKey} if( exists($this->{part2}->{coalesceKey}) );
+  return undef;
+} # sub coalesceKey
 
 # sysParams - bStandardResponse,command,url,scriptName,result,bSuccess,bExpectReply,
-# errorString,failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent
+# errorString,failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent,pipelineRef
 # 
 sub bStandardResponse
 {
@@ -386,6 +417,13 @@ sub bGeneratedRecoveryEvent
   return $this->{sysParams}->{bGeneratedRecoveryEvent} if( exists($this->{sysParams}->{bGeneratedRecoveryEvent}) );
   return undef;
 } # sub bGeneratedRecoveryEvent
+sub pipelineRef
+{
+  my ($this, $val) = @_;
+  $this->{sysParams}->{pipelineRef} = int($val) if defined($val);
+  return $this->{sysParams}->{pipelineRef} if( exists($this->{sysParams}->{pipelineRef}) );
+  return undef;
+} # sub pipelineRef
 
 # execParams
 # named parameters
@@ -522,6 +560,7 @@ sub toString
     $str .= "lifetime:'$this->{part2}->{lifetime}' " if(exists($this->{part2}->{lifetime}) && defined($this->{part2}->{lifetime}));
     $str .= "retries:'$this->{part2}->{retries}' " if(exists($this->{part2}->{retries}) && defined($this->{part2}->{retries}));
     $str .= "wpid:'$this->{part2}->{wpid}' " if(exists($this->{part2}->{wpid}) && defined($this->{part2}->{wpid}));
+    $str .= "readyTime:'$this->{part2}->{readyTime}' " if(exists($this->{part2}->{readyTime}) && defined($this->{part2}->{readyTime}));
   } # if
   return $str;
 } # toString
@@ -554,6 +593,7 @@ sub serialisePart2
     $this->{part2}->{lifetime} += 0 if(exists($this->{part2}->{lifetime}));
     $this->{part2}->{retries} += 0 if(exists($this->{part2}->{retries}));
     $this->{part2}->{wpid} += 0 if(exists($this->{part2}->{wpid}));
+    $this->{part2}->{readyTime} += 0 if(exists($this->{part2}->{readyTime}));
 #    $jsonStr = to_json( $this->{part2}, {pretty=>$this->{bPrettyJson}} );
     $jsonStr = $this->{json}->encode( $this->{part2} );
 #    utf8::encode( $jsonStr ) if(!utf8::valid($jsonStr));
@@ -574,6 +614,7 @@ sub serialiseSysParams
     $this->{sysParams}->{bExpectReply} += 0 if(exists($this->{sysParams}->{bExpectReply}));
     $this->{sysParams}->{elapsedTime} += 0 if(exists($this->{sysParams}->{elapsedTime}));
     $this->{sysParams}->{bGeneratedRecoveryEvent} += 0 if(exists($this->{sysParams}->{bGeneratedRecoveryEvent}));
+    $this->{sysParams}->{pipelineRef} += 0 if(exists($this->{sysParams}->{pipelineRef}));
 #    $jsonStr = to_json( $this->{sysParams}, {pretty=>$this->{bPrettyJson}} );
     $jsonStr = $this->{json}->encode( $this->{sysParams} );
 #    utf8::encode( $jsonStr ) if(!utf8::valid($jsonStr));
@@ -754,6 +795,19 @@ sub unSerialiseFromString
   return (0,$errStr);
 } # unSerialiseFromString
 
+# static method
+# @return the length of the first frame in $buffer if it is complete, 0 if more data is required or -1 if the header is invalid
+sub frameLength
+{
+  my ($class,$buffer) = @_;
+  return 0 if( length($buffer) < $FRAME_HEADER_LEN );
+  my $headerTemplate = sprintf( "^%s%s:(\\d+)", $FRAME_HEADER,$PROTOCOL_VERSION_NUMBER );
+  return -1 if( substr($buffer,0,$FRAME_HEADER_LEN) !~ /$headerTemplate/ );
+  my $frameLen = $FRAME_HEADER_LEN+$1;
+  return 0 if( length($buffer) < $frameLen );
+  return $frameLen;
+} # frameLength
+
 # static method
 # precede with a call to waitForData if non-blocking and required to wait
 # not coded to properly handle non-blocking sockets - the code would then not throw and return
@@ -918,4 +972,116 @@ sub serialise
   return($retVal,$errorString);
 } # serialise
 
+# static method
+# submits a list of events as a single EV_BATCH frame - on a stream socket the events are
+# acknowledged with one aggregate result rather than a result per event
+# datagram sockets provide no acknowledgement so the events are submitted individually - as
+# they are on the pipe ('-') where the events of a worker are read a frame at a time
+# @param $events - reference to a list of TxProc objects
+# @param $socket,$unixdomainPath,$serverName,$serverService - as for serialise
+# @param $reference - optional reference for the batch
+# @return ((0 fail, 1 success, 2 expect responses),error string,results) - results has a '1' or '0' per event
+sub submitBatch
+{
+  my ($class,$events,$socket,$unixdomainPath,$serverName,$serverService,$reference) = @_;
+  my $retVal = 0;
+  my $errorString;
+  my $results = '';
+
+  # no acknowledgement on a unix domain datagram socket or the pipe
+  if( !defined($socket) && (defined($unixdomainPath) || (defined($serverName) && ($serverName eq '-'))) )
+  {
+    my $numFailed = 0;
+    foreach my $event (@$events)
+    {
+      ($retVal,$errorString) = $event->serialise( undef, $unixdomainPath, $serverName, $serverService );
+      $results .= $retVal?'1':'0';
+      $numFailed++ if( !$retVal );
+    } # foreach
+    return (0,"TxProc::submitBatch $numFailed of ".scalar(@$events)." events failed - last error: $errorString",$results) if( $numFailed );
+    return (1,'',$results);
+  } # if
+
+  my $batch = new TxProc( 'EV_BATCH' );
+  $batch->reference( $reference ) if( defined($reference) );
+  $batch->addParam( 'count', scalar(@$events) );
+  my $payload = $batch->serialiseToString();
+  $payload .= $_->serialiseToString() foreach (@$events);
+  print( LOGFILE "$timestamp info  TxProc::submitBatch: events:".scalar(@$events)." len:".length($payload)."\n" ) if($batch->{beVerbose});
+
+  my $bStreamSocket = 0;
+  my $bLocalSocketCreated = 1;
+  if( defined($socket) )
+  {
+    $bStreamSocket = 1 if($socket->socktype()==SOCK_STREAM);
+    $bLocalSocketCreated = 0;
+  } # if
+  elsif( defined($serverName) && defined($serverService) )
+  {
+    $bStreamSocket = 1;
+    $socket = IO::Socket::INET->new( PeerAddr  => $serverName,
+      PeerPort  => $serverService,
+      Proto     => 'tcp',
+      Type      => SOCK_STREAM );
+    return (0, "TxProc::submitBatch IO::Socket::INET->new failed - server:$serverName, service:$serverService - $!", $results ) if( !$socket );
+  } # elsif
+  else
+  {
+    return (0, "TxProc::submitBatch no socket definitions available", $results );
+  } # else
+
+  # if a stream socket first read the greeting
+  if( $bStreamSocket )
+  {
+    ($retVal,$errorString) = $batch->readGreeting( $socket );
+    if( !$retVal )
+    {
+      close($socket) if( $bLocalSocketCreated );
+      return ($retVal,$errorString,$results);
+    } #if
+  } # if $bStreamSocket
+
+  # send the envelope and its members in one go
+  $retVal = $socket->send( $payload );
+  if( !$retVal )
+  {
+    $errorString = "TxProc::submitBatch send failed - $!";
+    close($socket) if( $bLocalSocketCreated );
+    return ($retVal,$errorString,$results);
+  } # if
+
+  # a single aggregate result for the whole batch
+  if( $bStreamSocket )
+  {
+    my ($reply,$err) = TxProc->unSerialise( $socket );
+    if( !$reply )
+    {
+      ($retVal,$errorString) = (0,$err);
+    } # if
+    else
+    {
+      $results = $reply->getParam( 'results' );
+      $results = '' if( !defined($results) );
+      if( $reply->bSuccess() )
+      {
+        $retVal = 1+$reply->bExpectReply();
+      } # if
+      else
+      {
+        $retVal = 0;
+        $errorString = "TxProc::submitBatch ".$reply->getParam('numFailed')." of ".$reply->getParam('count')." events failed";
+      } # else
+    } # else
+  } # if $bStreamSocket
+
+  # cleanup if required
+  if( $bLocalSocketCreated )
+  {
+    close( $socket );
+    $socket = 0;
+  } # if
+
+  return ($retVal,$errorString,$results);
+} # submitBatch
+
 1;  # module return value
@@ -2,6 +2,7 @@
 #
 # Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
 # @version 1.0.0		07/11/2014		Gerhardus Muller		script created
+# @version 1.1.0		16/10/2026		agent		support for a pipelined worker - PipelineRef, DeferResult and CompleteResult
 #
 # Copyright Gerhardus Muller
 #
@@ -40,6 +41,9 @@ class AppBase:
     self.ownQueue             = None
     self.workerPid            = -1
     self.resultEvent          = None
+    self.pipelineDepth        = 1
+    self.bResultDeferred      = False
+    self.numDeferred          = 0
     self.buildString          = buildStr
     self.beVerbose            = bVerbose
     self.bMainLoopVerbose     = bVerbose
@@ -144,6 +148,7 @@ class AppBase:
         txProcEvent = None
         if fh == sys.stdin.fileno():
           outputString = None
+          self.bResultDeferred = False
           try:
             (txProcEvent,err) = TxProc.UnSerialise( sys.stdin, True )
           except OSError as msg:
@@ -167,9 +172,10 @@ class AppBase:
             self.resultEvent = TxProc( eEventType.EV_RESULT )
             self.resultEvent.BSuccess(0)
             self.resultEvent.ErrorString( 'AppBase::Run({}) application exception err:{}'.format(self.appName,str(e),err) )
+            self.bResultDeferred = False
             outputString = self.SendDone()
 
-          # write a mandatory response
+          # write a mandatory response - unless the handler deferred it
           if outputString: sys.stdout.write( outputString )
         else:
           try:
@@ -305,10 +311,12 @@ class AppBase:
       self.bTimeToDie = True
       extraEvents = self.PrepareToExit( event, extraEvents )
       log.info( '{} HandlePersistentCommand exiting'.format(Log.timestamp) )
+      if self.numDeferred > 0: log.warn( '{} HandlePersistentCommand {} deferred results outstanding'.format(Log.timestamp,self.numDeferred) )
     elif cmd == 'startupinfo':
       self.ownQueue = event.GetParam('ownqueue')
       self.workerPid = event.GetParam('workerpid')
-      log.info( '{} HandlePersistentCommand ownQueue:{} workerPid:{}'.format(Log.timestamp, self.ownQueue, self.workerPid) )
+      if event.GetParam('pipelinedepth'): self.pipelineDepth = int( event.GetParam('pipelinedepth') )
+      log.info( '{} HandlePersistentCommand ownQueue:{} workerPid:{} pipelineDepth:{}'.format(Log.timestamp, self.ownQueue, self.workerPid, self.pipelineDepth) )
     else:
       extraEvents = self.HandleUserPersistentCommand( event, extraEvents )
     return extraEvents
@@ -383,6 +391,7 @@ class AppBase:
     self.resultEvent = TxProc( eEventType.EV_RESULT )
     self.resultEvent.BSuccess(1)
     self.resultEvent.Reference( event.Reference() )
+    if event.PipelineRef() != None: self.resultEvent.PipelineRef( event.PipelineRef() )
     resultQueue = event.GetParam( 'resultQueue' )
     if resultQueue: self.resultEvent.DestQueue( resultQueue )
     self.resultEvent.AddParam( 'generatedby', self.appName )
@@ -391,6 +400,9 @@ class AppBase:
 
   #######
   def SendDone( self ):
+    if self.bResultDeferred:
+      self.bResultDeferred = False
+      return None
     if not self.resultEvent:
       self.resultEvent = TxProc( eEventType.EV_RESULT )
       self.resultEvent.BSuccess(1)
@@ -399,6 +411,25 @@ class AppBase:
     return resultString
   ##SendDone
 
+  #######
+  # takes over the result of the event being handled so that it can be completed later with CompleteResult - only
+  # of use with a pipelined worker (queue pipelineDepth>1) where the other events in flight are handled meanwhile
+  # @return the result event
+  def DeferResult( self ):
+    result = self.resultEvent
+    self.resultEvent = None
+    self.bResultDeferred = True
+    self.numDeferred += 1
+    return result
+  ##DeferResult
+
+  #######
+  # writes the mandatory response for a deferred result - results may be completed in any order
+  def CompleteResult( self, result ):
+    sys.stdout.write( result.SerialiseToString() )
+    if self.numDeferred > 0: self.numDeferred -= 1
+  ##CompleteResult
+
   ######
   # implement to do something useful
   def GenerateStats( self, event, extraEvents ):
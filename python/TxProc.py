@@ -2,6 +2,7 @@
 #
 # Versioning: a.b.c a is a major release, b represents changes or new features, c represents bug fixes. 
 # @version 1.0.0		05/11/2014		Gerhardus Muller		script created
+# @version 1.1.0		16/10/2026		agent		added PipelineRef - matches the results of a pipelined persistent app to its events
 #
 # Copyright Gerhardus Muller
 #
@@ -147,7 +148,7 @@ class TxProc:
     return self.part2['wpid'] if 'wpid' in self.part2 else None
 
   # sysParams - bStandardResponse,command,url,scriptName,result,bSuccess,bExpectReply,
-  # errorString,failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent
+  # errorString,failureCause,systemParam,elapsedTime,bGeneratedRecoveryEvent,pipelineRef
   # val has to be 0 or 1
   def BStandardResponse( self, val=None ):
     if val != None: self.sysParams['bStandardResponse'] = val
@@ -203,6 +204,10 @@ class TxProc:
     if val != None: self.sysParams['bGeneratedRecoveryEvent'] = val
     return self.sysParams['bGeneratedRecoveryEvent'] if 'bGeneratedRecoveryEvent' in self.sysParams else None
 
+  def PipelineRef( self, val=None ):
+    if val != None: self.sysParams['pipelineRef'] = int( val )
+    return self.sysParams['pipelineRef'] if 'pipelineRef' in self.sysParams else None
+
   # execParams
   # named parameters
   def AddParam( self, key, val ):
@@ -297,6 +302,8 @@ class TxProc:
       self.sysParams['elapsedTime'] = int( self.sysParams['elapsedTime'] )
     if 'bGeneratedRecoveryEvent' in self.sysParams and not isinstance(self.sysParams['bGeneratedRecoveryEvent'], Number):
       self.sysParams['bGeneratedRecoveryEvent'] = int( self.sysParams['bGeneratedRecoveryEvent'] )
+    if 'pipelineRef' in self.sysParams and not isinstance(self.sysParams['pipelineRef'], Number):
+      self.sysParams['pipelineRef'] = int( self.sysParams['pipelineRef'] )
     return json.dumps( self.sysParams, separators=(',', ':') )
     ##SerialiseSysParams
 